@@ -122,9 +122,14 @@ def get_message_flags_func(func):
 
 
 def get_protocol_flags(service: ServiceObject):
+    flags = []
     if service.is_stream():
-        return "GRACHT_PROTOCOL_FLAG_STREAM"
-    return "0"
+        flags.append("GRACHT_PROTOCOL_FLAG_STREAM")
+    if service.get_options().get("dispatch") == "ordered":
+        flags.append("GRACHT_PROTOCOL_FLAG_ORDERED")
+    if not flags:
+        return "0"
+    return " | ".join(flags)
 
 
 def get_serialized_member_size_expression(service: ServiceObject, member, names_in_scope=True):
@@ -192,6 +197,8 @@ def is_param_const(param, is_output):
         return False
     if "gracht_client_t" in param.get_typename():
         return False
+    if "gracht_client_batch_t" in param.get_typename():
+        return False
     if "gracht_server_t" in param.get_typename():
         return False
     if "gracht_message" in param.get_typename():
@@ -275,6 +282,36 @@ def get_service_internal_callback_name(service: ServiceObject, act):
     return f"__{service.get_namespace()}_{service.get_name()}_{act.get_name()}_internal"
 
 
+# The _async variants deserialize the response in place for the callback, which stream buffers and
+# string arrays do not support
+def function_supports_async(service: ServiceObject, func: FunctionObject):
+    if service.is_stream():
+        return False
+    for param in func.get_response_params():
+        if param.get_is_variable() and param.get_typename().lower() == "string":
+            return False
+    return True
+
+
+# The _into variants receive the response straight into a buffer of the caller, which is only
+# possible when the response is a single array of values or a string
+def function_supports_into(service: ServiceObject, func: FunctionObject):
+    if service.is_stream() or len(func.get_response_params()) != 1:
+        return False
+    param = func.get_response_params()[0]
+    if param.get_typename().lower() == "string":
+        return not param.get_is_variable()
+    return param.get_is_variable() and not service.typename_is_struct(param.get_typename())
+
+
+def get_function_completion_name(service: ServiceObject, func):
+    return f"__{service.get_namespace()}_{service.get_name()}_{func.get_name()}_completion"
+
+
+def get_function_async_callback_typename(service: ServiceObject, func):
+    return service.get_namespace().lower() + "_" + service.get_name().lower() + "_" + func.get_name() + "_async_fn"
+
+
 def get_event_prototype_name_single(service: ServiceObject, evt, case):
     evt_server_param = get_param_typename(service, VariableObject("gracht_server_t*", "server", False), case, False)
     evt_client_param = get_param_typename(service, VariableObject("gracht_conn_t", "client", False), case, False)
@@ -383,7 +420,7 @@ def write_variable_struct_member_serializer(service: ServiceObject, member, outf
         outfile.writeln(f"buffer->index += sizeof({get_c_typename(service, typename)}) * in->{name}_count;")
 
 
-def write_variable_member_serializer(service: ServiceObject, member, outfile: CodeWriter):
+def write_variable_member_serializer(service: ServiceObject, member, outfile: CodeWriter, segments=False):
     name = member.get_name()
     typename = member.get_typename()
     outfile.writeln(f"serialize_uint32(&__buffer, {name}_count);")
@@ -400,6 +437,13 @@ def write_variable_member_serializer(service: ServiceObject, member, outfile: Co
         outfile.writeln(f"serialize_string(&__buffer, {name}[__i]);")
         outfile.indent_dec()
         outfile.writeln("}")
+    elif segments:
+        outfile.writeln(f"if ({name}_count) {{")
+        outfile.indent_inc()
+        outfile.writeln(
+            f"serialize_segment(&__buffer, &__segments, &{name}[0], sizeof({get_c_typename(service, typename)}) * {name}_count);")
+        outfile.indent_dec()
+        outfile.writeln("}")
     else:
         outfile.writeln(f"if ({name}_count) {{")
         outfile.indent_inc()
@@ -438,9 +482,21 @@ def write_struct_member_serializer(service: ServiceObject, prefix, struct, membe
         outfile.writeln(f"serialize_{member.get_typename()}(buffer, in->{prefix}{member.get_name()});")
 
 
-def write_member_serializer(service: ServiceObject, member, outfile: CodeWriter):
+# Large arrays of plain values and strings can be sent directly from the memory of the caller
+def member_can_use_segment(service: ServiceObject, member):
+    typename = member.get_typename()
+    if service.typename_is_struct(typename):
+        return False
+    if member.get_is_variable():
+        return typename.lower() != "string"
+    return typename.lower() == "string" and not member.get_fixed()
+
+
+def write_member_serializer(service: ServiceObject, member, outfile: CodeWriter, segments=False):
     if member.get_is_variable():
-        write_variable_member_serializer(service, member, outfile)
+        write_variable_member_serializer(service, member, outfile, segments)
+    elif segments and member_can_use_segment(service, member):
+        outfile.writeln(f"serialize_string_segment(&__buffer, &__segments, {member.get_name()});")
     elif service.typename_is_struct(member.get_typename()):
         struct_type = service.lookup_struct(member.get_typename())
         outfile.writeln(f"serialize_{get_scoped_name(struct_type)}(&__buffer, {member.get_name()});")
@@ -628,10 +684,13 @@ def write_member_deserializer(service: ServiceObject, member, outfile: CodeWrite
         outfile.writeln(f"*{name}_out = deserialize_{typename}(&__buffer);")
 
 
-def write_function_body_prologue(service: ServiceObject, action_id, flags, params, is_server, outfile: CodeWriter):
+def write_function_body_prologue(service: ServiceObject, action_id, flags, params, is_server, outfile: CodeWriter,
+                                 batch=False, segments=False):
     size_expression = get_serialized_params_size_expression(service, params)
 
     outfile.writeln("gracht_buffer_t __buffer;")
+    if segments:
+        outfile.writeln("struct gracht_message_segments __segments;")
     outfile.writeln("int __status;")
     outfile.writeln("")
 
@@ -652,6 +711,8 @@ def write_function_body_prologue(service: ServiceObject, action_id, flags, param
                     outfile.writeln("__status = gracht_server_get_stream_buffer(server, &__buffer);")
             else:
                 outfile.writeln("__status = gracht_server_get_buffer(server, &__buffer);")
+    elif batch:
+        outfile.writeln("__status = gracht_client_batch_get_buffer(batch, &__buffer);")
     else:
         if service.is_stream():
             if size_expression is not None:
@@ -673,8 +734,14 @@ def write_function_body_prologue(service: ServiceObject, action_id, flags, param
     outfile.writeln(f"serialize_uint8(&__buffer, {str(action_id)});")
     outfile.writeln(f"serialize_uint8(&__buffer, {str(flags)});")
 
+    if segments:
+        outfile.writeln("__segments.count = 0;")
     for param in params:
-        write_member_serializer(service, param, outfile)
+        write_member_serializer(service, param, outfile, segments)
+
+
+def params_use_segments(service: ServiceObject, params):
+    return any(member_can_use_segment(service, param) for param in params)
 
 
 def write_function_body_epilogue(service: ServiceObject, func: FunctionObject, outfile: CodeWriter):
@@ -685,8 +752,15 @@ def write_function_body_epilogue(service: ServiceObject, func: FunctionObject, o
 def define_function_body(service: ServiceObject, func: FunctionObject, outfile: CodeWriter):
     flags = get_message_flags_func(func)
     response_size_expression = get_serialized_params_size_expression(service, func.get_response_params(), names_in_scope=False)
-    write_function_body_prologue(service, func.get_id(), flags, func.get_request_params(), False, outfile)
-    if service.is_stream():
+    segments = params_use_segments(service, func.get_request_params())
+    write_function_body_prologue(service, func.get_id(), flags, func.get_request_params(), False, outfile, segments=segments)
+    if segments:
+        if service.is_stream():
+            response_size = response_size_expression if response_size_expression is not None else "0"
+            outfile.write(f"__status = gracht_client_invoke_stream_segments(client, context, &__buffer, {response_size}, &__segments);\n")
+        else:
+            outfile.write("__status = gracht_client_invoke_segments(client, context, &__buffer, &__segments);\n")
+    elif service.is_stream():
         if response_size_expression is not None:
             outfile.write(f"__status = gracht_client_invoke_stream_sized(client, context, &__buffer, {response_size_expression});\n")
         else:
@@ -697,6 +771,94 @@ def define_function_body(service: ServiceObject, func: FunctionObject, outfile:
     return
 
 
+def define_batch_function_body(service: ServiceObject, func: FunctionObject, outfile: CodeWriter):
+    flags = get_message_flags_func(func)
+    write_function_body_prologue(service, func.get_id(), flags, func.get_request_params(), False, outfile, batch=True)
+    outfile.write("__status = gracht_client_batch_add(batch, context, &__buffer);\n")
+    write_function_body_epilogue(service, func, outfile)
+    return
+
+
+def define_async_function_body(service: ServiceObject, func: FunctionObject, outfile: CodeWriter):
+    flags = get_message_flags_func(func)
+    write_function_body_prologue(service, func.get_id(), flags, func.get_request_params(), False, outfile)
+    outfile.write(f"__status = gracht_client_invoke_callback(client, &__buffer, {get_function_completion_name(service, func)}, "
+                  + "(void*)callback, userctx);\n")
+    write_function_body_epilogue(service, func, outfile)
+    return
+
+
+def define_into_function_body(service: ServiceObject, func: FunctionObject, outfile: CodeWriter):
+    flags = get_message_flags_func(func)
+    param = func.get_response_params()[0]
+    name = param.get_name()
+    if param.get_is_variable():
+        size_expression = f"sizeof({get_param_typename(service, param, CONST.TYPENAME_CASE_SIZEOF, False)}) * {name}_count"
+    else:
+        size_expression = f"{name}_max_length"
+    write_function_body_prologue(service, func.get_id(), flags, func.get_request_params(), False, outfile)
+    outfile.write(f"__status = gracht_client_invoke_into(client, context, &__buffer, {name}_out, {size_expression});\n")
+    write_function_body_epilogue(service, func, outfile)
+    return
+
+
+def get_into_count_name(param):
+    if param.get_is_variable():
+        return f"{param.get_name()}_count_out"
+    return f"{param.get_name()}_length_out"
+
+
+def define_into_status_body(service: ServiceObject, func: FunctionObject, outfile: CodeWriter):
+    count_name = get_into_count_name(func.get_response_params()[0])
+    outfile.writeln(f"int __status = gracht_client_get_destination_status(client, context, {count_name});")
+    outfile.writeln("if (__status != GRACHT_MESSAGE_COMPLETED) {")
+    outfile.writeln("    return __status;")
+    outfile.writeln("}")
+    outfile.writeln("return 0;")
+
+
+# The completion handler of the _async variant, this deserializes the response in place
+# and invokes the callback of the caller
+def define_function_completion(service: ServiceObject, func: FunctionObject, outfile: CodeWriter):
+    members = func.get_response_params()
+    outfile.writeln(f"static void {get_function_completion_name(service, func)}(gracht_client_t* __client, int __status, "
+                    + "gracht_buffer_t* __buffer, void* __callback, void* __context)")
+    outfile.writeln("{")
+    outfile.indent_inc()
+
+    # the members are zeroed, as the callback is also invoked with them when the call failed
+    write_deserializer_prologue(service, members, outfile)
+    for param in members:
+        if param.get_is_variable():
+            outfile.writeln(f"{param.get_name()}_count = 0;")
+        else:
+            outfile.writeln(f"memset(&{param.get_name()}, 0, sizeof({param.get_name()}));")
+    outfile.writeln("")
+
+    outfile.writeln("if (__status == GRACHT_MESSAGE_COMPLETED) {")
+    outfile.indent_inc()
+    for param in members:
+        write_member_deserializer2(service, param, outfile)
+    outfile.indent_dec()
+    outfile.writeln("}")
+    outfile.writeln("")
+
+    outfile.write(f"(({get_function_async_callback_typename(service, func)})__callback)(__client, __status")
+    write_deserializer_invocation_members(service, members, outfile)
+    outfile.append(", __context);\n")
+
+    if any(m.get_is_variable() or service.typename_is_struct(m.get_typename()) for m in members):
+        outfile.writeln("")
+        outfile.writeln("if (__status == GRACHT_MESSAGE_COMPLETED) {")
+        outfile.indent_inc()
+        write_deserializer_destroy_members(service, members, outfile)
+        outfile.indent_dec()
+        outfile.writeln("}")
+    outfile.indent_dec()
+    outfile.writeln("}")
+    outfile.writeln("")
+
+
 def write_status_body_prologue(service: ServiceObject, func: FunctionObject, outfile: CodeWriter):
     outfile.writeln("gracht_buffer_t __buffer;")
     outfile.writeln("int __status;")
@@ -729,8 +891,12 @@ def define_status_body(service: ServiceObject, func: FunctionObject, outfile: Co
 
 def define_event_body_single(service: ServiceObject, evt, outfile: CodeWriter):
     flags = "MESSAGE_FLAG_EVENT"
-    write_function_body_prologue(service, evt.get_id(), flags, evt.get_params(), True, outfile)
-    if service.is_stream():
+    segments = params_use_segments(service, evt.get_params())
+    write_function_body_prologue(service, evt.get_id(), flags, evt.get_params(), True, outfile, segments=segments)
+    if segments:
+        stream = "_stream" if service.is_stream() else ""
+        outfile.write(f"__status = gracht_server_send{stream}_event_segments(server, client, &__buffer, 0, &__segments);\n")
+    elif service.is_stream():
         outfile.write("__status = gracht_server_send_stream_event(server, client, &__buffer, 0);\n")
     else:
         outfile.write("__status = gracht_server_send_event(server, client, &__buffer, 0);\n")
@@ -749,8 +915,12 @@ def define_event_body_all(service: ServiceObject, evt, outfile: CodeWriter):
 
 def define_response_body(service: ServiceObject, func, flags, outfile: CodeWriter):
     flags = "MESSAGE_FLAG_RESPONSE"
-    write_function_body_prologue(service, func.get_id(), flags, func.get_response_params(), True, outfile)
-    if service.is_stream():
+    segments = params_use_segments(service, func.get_response_params())
+    write_function_body_prologue(service, func.get_id(), flags, func.get_response_params(), True, outfile, segments=segments)
+    if segments:
+        stream = "_stream" if service.is_stream() else ""
+        outfile.write(f"__status = gracht_server_respond{stream}_segments(message, &__buffer, &__segments);\n")
+    elif service.is_stream():
         outfile.write("__status = gracht_server_respond_stream(message, &__buffer);\n")
     else:
         outfile.write("__status = gracht_server_respond(message, &__buffer);\n")
@@ -818,6 +988,31 @@ static inline void serialize_string(gracht_buffer_t* buffer, const char* string)
     buffer->index += (sizeof(uint32_t) + length + 1);
 }
 
+// Large values are sent directly from the memory of the caller as long as the message has
+// room for more segments, anything else is copied into the message buffer
+static inline void serialize_segment(gracht_buffer_t* buffer, struct gracht_message_segments* segments, const void* data, uint32_t length) {
+    if (length >= GRACHT_MESSAGE_SEGMENT_THRESHOLD && segments->count < GRACHT_MESSAGE_MAX_SEGMENTS) {
+        segments->entries[segments->count].offset = buffer->index;
+        segments->entries[segments->count].data   = data;
+        segments->entries[segments->count].length = length;
+        segments->count++;
+        return;
+    }
+    memcpy(&buffer->data[buffer->index], data, length);
+    buffer->index += length;
+}
+
+static inline void serialize_string_segment(gracht_buffer_t* buffer, struct gracht_message_segments* segments, const char* string) {
+    uint32_t length = string != NULL ? (uint32_t)strlen(string) : 0;
+    if (length < GRACHT_MESSAGE_SEGMENT_THRESHOLD) {
+        serialize_string(buffer, string);
+        return;
+    }
+    *((uint32_t*)&buffer->data[buffer->index]) = length;
+    buffer->index += sizeof(uint32_t);
+    serialize_segment(buffer, segments, string, length + 1);
+}
+
 static inline void deserialize_string_copy(gracht_buffer_t* buffer, char* out, uint32_t maxLength) {
     uint32_t length = *((uint32_t*)&buffer->data[buffer->index]);
     uint32_t clampedLength = GRMIN(length, maxLength - 1);
@@ -1210,6 +1405,13 @@ GRACHTAPI int gracht_client_status_finalize(gracht_client_t*, struct gracht_buff
 GRACHTAPI int gracht_client_invoke(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*);
 GRACHTAPI int gracht_client_invoke_stream_sized(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*, uint32_t);
 GRACHTAPI int gracht_client_invoke_stream(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*);
+GRACHTAPI int gracht_client_invoke_segments(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*, struct gracht_message_segments*);
+GRACHTAPI int gracht_client_invoke_stream_segments(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*, uint32_t, struct gracht_message_segments*);
+GRACHTAPI int gracht_client_invoke_callback(gracht_client_t*, gracht_buffer_t*, gracht_client_completion_fn, void*, void*);
+GRACHTAPI int gracht_client_invoke_into(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*, void*, uint32_t);
+GRACHTAPI int gracht_client_get_destination_status(gracht_client_t*, struct gracht_message_context*, uint32_t*);
+GRACHTAPI int gracht_client_batch_get_buffer(gracht_client_batch_t*, gracht_buffer_t*);
+GRACHTAPI int gracht_client_batch_add(gracht_client_batch_t*, struct gracht_message_context*, gracht_buffer_t*);
 """)
 
 
@@ -1220,8 +1422,12 @@ GRACHTAPI int gracht_server_get_stream_buffer(gracht_server_t*, gracht_buffer_t*
 GRACHTAPI int gracht_server_get_stream_buffer_sized(gracht_server_t*, uint32_t, gracht_buffer_t*);
 GRACHTAPI int gracht_server_respond(struct gracht_message*, gracht_buffer_t*);
 GRACHTAPI int gracht_server_respond_stream(struct gracht_message*, gracht_buffer_t*);
+GRACHTAPI int gracht_server_respond_segments(struct gracht_message*, gracht_buffer_t*, struct gracht_message_segments*);
+GRACHTAPI int gracht_server_respond_stream_segments(struct gracht_message*, gracht_buffer_t*, struct gracht_message_segments*);
 GRACHTAPI int gracht_server_send_event(gracht_server_t*, gracht_conn_t client, gracht_buffer_t*, unsigned int flags);
 GRACHTAPI int gracht_server_send_stream_event(gracht_server_t*, gracht_conn_t client, gracht_buffer_t*, unsigned int flags);
+GRACHTAPI int gracht_server_send_event_segments(gracht_server_t*, gracht_conn_t client, gracht_buffer_t*, unsigned int flags, struct gracht_message_segments*);
+GRACHTAPI int gracht_server_send_stream_event_segments(gracht_server_t*, gracht_conn_t client, gracht_buffer_t*, unsigned int flags, struct gracht_message_segments*);
 GRACHTAPI int gracht_server_broadcast_event(gracht_server_t*, gracht_buffer_t*, unsigned int flags);
 GRACHTAPI int gracht_server_broadcast_stream_event(gracht_server_t*, gracht_buffer_t*, unsigned int flags);
 """)
@@ -1468,6 +1674,66 @@ class CGenerator:
 
         return function_prototype + input_parameters + ")"
 
+    def get_function_batch_prototype(self, service, func, case):
+        function_prototype = "int " + service.get_namespace().lower() + "_" \
+                             + service.get_name().lower() + "_" + func.get_name() + "_batch"
+        function_batch_param = get_param_typename(service, VariableObject("gracht_client_batch_t*", "batch", False), case,
+                                                  False)
+        function_context_param = get_param_typename(service,
+                                                    VariableObject("struct gracht_message_context*", "context", False),
+                                                    case, False)
+        function_prototype = function_prototype + "(" + function_batch_param + ", " + function_context_param
+        input_parameters = get_parameter_string(service, func.get_request_params(), case, False)
+
+        if input_parameters != "":
+            input_parameters = ", " + input_parameters
+
+        return function_prototype + input_parameters + ")"
+
+    def get_function_async_callback_prototype(self, service, func):
+        prototype = "typedef void (*" + get_function_async_callback_typename(service, func) + ")("
+        prototype = prototype + "gracht_client_t* client, int status"
+        if len(func.get_response_params()) > 0:
+            prototype = prototype + ", " + get_parameter_string(service, func.get_response_params(),
+                                                                CONST.TYPENAME_CASE_FUNCTION_CALL, False)
+        return prototype + ", void* userctx)"
+
+    def get_function_async_prototype(self, service, func, case):
+        function_prototype = "int " + service.get_namespace().lower() + "_" \
+                             + service.get_name().lower() + "_" + func.get_name() + "_async"
+        function_client_param = get_param_typename(service, VariableObject("gracht_client_t*", "client", False), case,
+                                                   False)
+        function_prototype = function_prototype + "(" + function_client_param
+        input_parameters = get_parameter_string(service, func.get_request_params(), case, False)
+
+        if input_parameters != "":
+            function_prototype = function_prototype + ", " + input_parameters
+
+        return function_prototype + ", " + get_function_async_callback_typename(service, func) \
+            + " callback, void* userctx)"
+
+    def get_function_into_prototype(self, service, func):
+        function_prototype = "int " + service.get_namespace().lower() + "_" \
+                             + service.get_name().lower() + "_" + func.get_name() + "_into"
+        parameter_string = get_param_typename(service, VariableObject("gracht_client_t*", "client", False),
+                                              CONST.TYPENAME_CASE_FUNCTION_CALL, False)
+        parameter_string = parameter_string + ", " + get_param_typename(
+            service, VariableObject("struct gracht_message_context*", "context", False),
+            CONST.TYPENAME_CASE_FUNCTION_CALL, False)
+        input_parameters = get_parameter_string(service, func.get_request_params(), CONST.TYPENAME_CASE_FUNCTION_CALL, False)
+        if input_parameters != "":
+            parameter_string = parameter_string + ", " + input_parameters
+
+        # the destination is described like the output of the _result function
+        output_parameters = get_parameter_string(service, func.get_response_params(), CONST.TYPENAME_CASE_FUNCTION_STATUS, True)
+        return function_prototype + "(" + parameter_string + ", " + output_parameters + ")"
+
+    def get_function_into_status_prototype(self, service, func):
+        count_name = get_into_count_name(func.get_response_params()[0])
+        return "int " + service.get_namespace().lower() + "_" + service.get_name().lower() + "_" + func.get_name() \
+            + "_into_result(gracht_client_t* client, struct gracht_message_context* context, uint32_t* " \
+            + count_name + ")"
+
     def get_function_status_prototype(self, service, func):
         case = CONST.TYPENAME_CASE_FUNCTION_STATUS
         client_param = VariableObject("gracht_client_t*", "client", False)
@@ -1491,8 +1757,19 @@ class CGenerator:
         for func in service.get_functions():
             outfile.write("    " +
                           self.get_function_prototype(service, func, CONST.TYPENAME_CASE_FUNCTION_CALL) + ";\n")
+            # stream calls are serialized into buffers sized by the call, so they can not be batched
+            if not service.is_stream():
+                outfile.write("    " +
+                              self.get_function_batch_prototype(service, func, CONST.TYPENAME_CASE_FUNCTION_CALL) + ";\n")
             if len(func.get_response_params()) > 0:
                 outfile.write("    " + self.get_function_status_prototype(service, func) + ";\n")
+                if function_supports_async(service, func):
+                    outfile.write("    " + self.get_function_async_callback_prototype(service, func) + ";\n")
+                    outfile.write("    " +
+                                  self.get_function_async_prototype(service, func, CONST.TYPENAME_CASE_FUNCTION_CALL) + ";\n")
+                if function_supports_into(service, func):
+                    outfile.write("    " + self.get_function_into_prototype(service, func) + ";\n")
+                    outfile.write("    " + self.get_function_into_status_prototype(service, func) + ";\n")
         outfile.write("\n")
 
     def define_client_service_extern(self, service, outfile):
@@ -1565,6 +1842,14 @@ class CGenerator:
             outfile.writeln("}")
             outfile.writeln("")
 
+            if not service.is_stream():
+                outfile.writeln(f"{self.get_function_batch_prototype(service, func, CONST.TYPENAME_CASE_FUNCTION_CALL)} {{")
+                outfile.indent_inc()
+                define_batch_function_body(service, func, outfile)
+                outfile.indent_dec()
+                outfile.writeln("}")
+                outfile.writeln("")
+
             if len(func.get_response_params()) > 0:
                 outfile.writeln(f"{self.get_function_status_prototype(service, func)} {{")
                 outfile.indent_inc()
@@ -1572,6 +1857,30 @@ class CGenerator:
                 outfile.indent_dec()
                 outfile.writeln("}")
                 outfile.writeln("")
+
+                if function_supports_async(service, func):
+                    define_function_completion(service, func, outfile)
+                    outfile.writeln(f"{self.get_function_async_prototype(service, func, CONST.TYPENAME_CASE_FUNCTION_CALL)} {{")
+                    outfile.indent_inc()
+                    define_async_function_body(service, func, outfile)
+                    outfile.indent_dec()
+                    outfile.writeln("}")
+                    outfile.writeln("")
+
+                if function_supports_into(service, func):
+                    outfile.writeln(f"{self.get_function_into_prototype(service, func)} {{")
+                    outfile.indent_inc()
+                    define_into_function_body(service, func, outfile)
+                    outfile.indent_dec()
+                    outfile.writeln("}")
+                    outfile.writeln("")
+
+                    outfile.writeln(f"{self.get_function_into_status_prototype(service, func)} {{")
+                    outfile.indent_inc()
+                    define_into_status_body(service, func, outfile)
+                    outfile.indent_dec()
+                    outfile.writeln("}")
+                    outfile.writeln("")
         return
 
     def define_server_responses(self, service: ServiceObject, outfile: CodeWriter):
@@ -327,6 +327,10 @@ def get_service_scope_syntax():
         # event <identifier> : <identifier> = <DIGIT>;
         ("event", handle_event): [TOKENS.EVENT, TOKENS.IDENTIFIER, TOKENS.COLON, TOKENS.IDENTIFIER,
                                   TOKENS.EQUAL, TOKENS.DIGIT, TOKENS.SEMICOLON],
+
+        # option <identifier> = <identifier>;
+        ("option_ident", handle_option): [TOKENS.OPTION, TOKENS.IDENTIFIER, TOKENS.EQUAL, TOKENS.IDENTIFIER,
+                                           TOKENS.SEMICOLON],
     }
     return syntax
 
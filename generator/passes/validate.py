@@ -19,7 +19,7 @@ def validate_stream_options(service: ServiceObject):
 
     valid_directions = {"to_server", "to_client"}
     valid_modes = {"bounded", "live"}
-    valid_keys = {"direction", "mode", "chunk_size"}
+    valid_keys = {"direction", "mode", "chunk_size", "dispatch"}
 
     unknown_options = set(options.keys()) - valid_keys
     if unknown_options:
@@ -32,9 +32,27 @@ def validate_stream_options(service: ServiceObject):
         raise ValueError(f"Stream service {service.get_name()} must declare a positive numeric chunk_size")
 
 
+def validate_message_options(service: ServiceObject):
+    options = service.get_options()
+    valid_keys = {"dispatch"}
+
+    unknown_options = set(options.keys()) - valid_keys
+    if unknown_options:
+        raise ValueError(f"Unknown option(s) for service {service.get_name()}: {', '.join(sorted(unknown_options))}")
+
+
+def validate_dispatch_option(service: ServiceObject):
+    dispatch = service.get_options().get("dispatch")
+    if dispatch is not None and dispatch not in {"ordered", "parallel"}:
+        raise ValueError(f"Service {service.get_name()} must declare option dispatch = ordered|parallel")
+
+
 def validate_service(service: ServiceObject):
     if service.is_stream():
         validate_stream_options(service)
+    else:
+        validate_message_options(service)
+    validate_dispatch_option(service)
 
 def resolve_type(service: ServiceObject, service_imports: list, param):
     if isinstance(param, VariableVariantObject):
@@ -123,8 +123,62 @@ class GeneratorTests(unittest.TestCase):
             self.assertIn("GRACHT_PROTOCOL_FLAG_STREAM", video_client)
             self.assertIn("gracht_client_get_buffer", calculator_client)
             self.assertIn("gracht_client_invoke", calculator_client)
+            self.assertIn("gracht_client_batch_get_buffer(batch, &__buffer)", calculator_client)
+            self.assertIn("gracht_client_batch_add(batch, context, &__buffer)", calculator_client)
+            self.assertNotIn("gracht_client_batch_add(batch", upload_client)
+            self.assertIn("gracht_client_invoke_callback(client, &__buffer, __gracht_calculator_add_completion", calculator_client)
+            self.assertNotIn("gracht_calculator_getHistories_async", calculator_client)
+            self.assertIn("gracht_client_invoke_into(client, context, &__buffer, history_out, history_max_length)", calculator_client)
+            self.assertIn("gracht_client_invoke_into(client, context, &__buffer, statuses_out, sizeof(int) * statuses_count)", calculator_client)
+            self.assertNotIn("gracht_calculator_getHistories_into", calculator_client)
+            self.assertNotIn("gracht_calculator_getVehicle_into", calculator_client)
             self.assertIn("GRACHT_PROTOCOL_INIT", calculator_client)
 
+            download_server = (out_root / "gracht_download_service_server.c").read_text()
+            self.assertIn("serialize_segment(&__buffer, &__segments, &data[0], sizeof(uint8_t) * data_count)", upload_client)
+            self.assertIn("gracht_client_invoke_stream_segments(client, context, &__buffer", upload_client)
+            self.assertIn("gracht_server_respond_stream_segments(message, &__buffer, &__segments)", download_server)
+
+    def test_ordered_dispatch_option_sets_protocol_flag(self):
+        with tempfile.TemporaryDirectory() as out_dir:
+            service_path = Path(out_dir) / "ordered_service.gr"
+            service_path.write_text(
+                "namespace test\n"
+                "service ordered : message {\n"
+                "    option dispatch = ordered;\n"
+                "    func ping(int value) : (int value) = 1;\n"
+                "}\n"
+            )
+            services = parse_services(service_path)
+            self.assertEqual(services[0].get_options()["dispatch"], "ordered")
+
+            args = argparse.Namespace(
+                trace=False,
+                service=str(service_path),
+                include=None,
+                out=out_dir,
+                client=False,
+                server=True,
+                lang_c=True,
+            )
+            service_parser.main(args)
+
+            server_source = (Path(out_dir) / "test_ordered_service_server.c").read_text()
+            self.assertIn("GRACHT_PROTOCOL_FLAG_ORDERED", server_source)
+
+    def test_invalid_dispatch_option_is_rejected(self):
+        with tempfile.TemporaryDirectory() as out_dir:
+            service_path = Path(out_dir) / "ordered_service.gr"
+            service_path.write_text(
+                "namespace test\n"
+                "service ordered : message {\n"
+                "    option dispatch = sequential;\n"
+                "    func ping(int value) : (int value) = 1;\n"
+                "}\n"
+            )
+            with self.assertRaises(ValueError):
+                parse_services(service_path)
+
 
 if __name__ == "__main__":
     unittest.main()
\ No newline at end of file
@@ -35,15 +35,32 @@ typedef struct ioset_event gracht_aio_event_t;
 #define GRACHT_AIO_EVENT_DISCONNECT IOSETCTL
 
 #define gracht_aio_create()                ioset(0)
-#define gracht_io_wait(aio, events, count) ioset_wait(aio, events, count, NULL)
 #define gracht_aio_destroy(aio)            close(aio)
 
+// gracht_io_wait waits for at most timeoutMs for events, a negative timeout waits forever
+static int gracht_io_wait(gracht_handle_t aio, gracht_aio_event_t* events, int count, int timeoutMs) {
+    struct timespec timeout;
+    if (timeoutMs < 0) {
+        return ioset_wait(aio, events, count, NULL);
+    }
+
+    timeout.tv_sec  = timeoutMs / 1000;
+    timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000L;
+    return ioset_wait(aio, events, count, &timeout);
+}
+
 #define gracht_aio_event_handle(event)    (event)->data.iod
 #define gracht_aio_event_events(event) (event)->events
 
+#define gracht_aio_wake_create(aio)        GRACHT_CONN_INVALID
+#define gracht_aio_wake_signal(wake)
+#define gracht_aio_wake_drain(wake)
+#define gracht_aio_wake_destroy(aio, wake)
+
 #elif defined(__linux__)
 #include <unistd.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 
 typedef struct epoll_event gracht_aio_event_t;
@@ -51,12 +68,72 @@ typedef struct epoll_event gracht_aio_event_t;
 #define GRACHT_AIO_EVENT_DISCONNECT EPOLLRDHUP
 
 #define gracht_aio_create()                epoll_create1(0)
-#define gracht_io_wait(aio, events, count) epoll_wait(aio, events, count, -1);
 #define gracht_aio_destroy(aio)            close(aio)
 
+// gracht_io_wait waits for at most timeoutMs for events, a negative timeout waits forever
+#define gracht_io_wait(aio, events, count, timeoutMs) epoll_wait(aio, events, count, timeoutMs)
+
 #define gracht_aio_event_handle(event) (event)->data.fd
 #define gracht_aio_event_events(event) (event)->events
 
+// Wake handles are used to interrupt a thread that is blocked in gracht_io_wait
+// on the set, the handle will be reported as a regular event on the set.
+#define GRACHT_AIO_HAS_WAKE
+
+static gracht_conn_t gracht_aio_wake_create(gracht_handle_t aio) {
+    struct epoll_event event = { .events = EPOLLIN };
+    int                fd    = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        return GRACHT_CONN_INVALID;
+    }
+
+    event.data.fd = fd;
+    if (epoll_ctl(aio, EPOLL_CTL_ADD, fd, &event)) {
+        close(fd);
+        return GRACHT_CONN_INVALID;
+    }
+    return fd;
+}
+
+static void gracht_aio_wake_signal(gracht_conn_t wake) {
+    uint64_t value = 1;
+    if (wake != GRACHT_CONN_INVALID) {
+        (void)!write(wake, &value, sizeof(uint64_t));
+    }
+}
+
+static void gracht_aio_wake_drain(gracht_conn_t wake) {
+    uint64_t value;
+    (void)!read(wake, &value, sizeof(uint64_t));
+}
+
+static void gracht_aio_wake_destroy(gracht_handle_t aio, gracht_conn_t wake) {
+    if (wake != GRACHT_CONN_INVALID) {
+        epoll_ctl(aio, EPOLL_CTL_DEL, wake, NULL);
+        close(wake);
+    }
+}
+
+// Pausing removes a connection from the set, so no events are delivered for it until it
+// is resumed again. The events must match those the links register their connections with.
+#define GRACHT_AIO_HAS_PAUSE
+
+static int gracht_aio_pause(gracht_handle_t aio, gracht_conn_t iod) {
+    return epoll_ctl(aio, EPOLL_CTL_DEL, iod, NULL);
+}
+
+static int gracht_aio_resume(gracht_handle_t aio, gracht_conn_t iod) {
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLRDHUP,
+        .data.fd = iod
+    };
+    return epoll_ctl(aio, EPOLL_CTL_ADD, iod, &event);
+}
+
+// Links may watch their connections for becoming writable, which the set reports as
+// GRACHT_AIO_EVENT_OUT until the link removes the watch again.
+#define GRACHT_AIO_EVENT_OUT EPOLLOUT
+
 #elif defined(_WIN32)
 #include <windows.h>
 #include <stdlib.h>
@@ -102,15 +179,19 @@ static int gracht_aio_destroy(gracht_handle_t aio) {
     return 0;
 }
 
-static int gracht_io_wait(gracht_handle_t aio, gracht_aio_event_t* events, int count)
+// gracht_io_wait waits for at most timeoutMs for events, a negative timeout waits forever
+static int gracht_io_wait(gracht_handle_t aio, gracht_aio_event_t* events, int count, int timeoutMs)
 {
     struct iocp_handle* iocp    = aio;
     OVERLAPPED* overlapped      = NULL;
     DWORD       bytesTransfered = 0;
     void*       context         = NULL;
     BOOL        status          = GetQueuedCompletionStatus(iocp->iocp,
-        &bytesTransfered, (PULONG_PTR)&context, &overlapped, INFINITE);
+        &bytesTransfered, (PULONG_PTR)&context, &overlapped, timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs);
     if (overlapped == NULL) {
+        if (GetLastError() == WAIT_TIMEOUT) {
+            return 0;
+        }
         // something horrible failed
         return -1;
     }
@@ -130,6 +211,11 @@ static int gracht_io_wait(gracht_handle_t aio, gracht_aio_event_t* events, int c
 
 #define gracht_aio_event_handle(event) (event)->iod
 #define gracht_aio_event_events(event) (event)->events
+
+#define gracht_aio_wake_create(aio)        GRACHT_CONN_INVALID
+#define gracht_aio_wake_signal(wake)
+#define gracht_aio_wake_drain(wake)
+#define gracht_aio_wake_destroy(aio, wake)
 #else
 #error "Undefined platform for aio"
 #endif
@@ -0,0 +1,90 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Call Table Type Definitions & Structures
+ * - This header describes the table of outstanding calls in the client. Every call
+ *   occupies a slot, and the id of the call encodes both the index of the slot and
+ *   the generation of the slot, so a lookup is a single index operation. Slots are
+ *   locked individually, and free slots are kept on a lock-free stack.
+ */
+
+#ifndef __GRACHT_CALL_TABLE_H__
+#define __GRACHT_CALL_TABLE_H__
+
+#include "gatomic.h"
+#include "thread_api.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// the lower bits of an id are the slot index, the upper bits are the generation
+#define GR_CALL_TABLE_INDEX_BITS      16
+#define GR_CALL_TABLE_INDEX_MASK      ((1U << GR_CALL_TABLE_INDEX_BITS) - 1)
+#define GR_CALL_TABLE_CHUNK_SIZE      256
+#define GR_CALL_TABLE_MAX_SLOTS       GR_CALL_TABLE_INDEX_MASK
+#define GR_CALL_TABLE_MAX_CHUNKS      ((GR_CALL_TABLE_MAX_SLOTS + GR_CALL_TABLE_CHUNK_SIZE - 1) / GR_CALL_TABLE_CHUNK_SIZE)
+
+// ids with a generation of 0 are never handed out by the table
+#define GR_CALL_TABLE_ID_IS_SLOT(id) (((id) >> GR_CALL_TABLE_INDEX_BITS) != 0)
+
+struct gr_call_table {
+    size_t           element_size;
+    size_t           slot_size;
+    atomic_uintptr_t chunks[GR_CALL_TABLE_MAX_CHUNKS];
+    atomic_size_t    slot_count;
+    atomic_size_t    free_head;
+    atomic_int       active_count;
+    mtx_t            grow_lock;
+};
+
+typedef void (*gr_call_table_enum_fn)(uint32_t id, void* element, void* context);
+
+void  gr_call_table_construct(struct gr_call_table* table, size_t elementSize);
+void  gr_call_table_destroy(struct gr_call_table* table);
+
+/**
+ * Allocates a slot and returns its zeroed element, the slot is locked and must be unlocked
+ * once the element has been initialized. Returns NULL and sets errno to ENOMEM if all slots
+ * are in use.
+ */
+void* gr_call_table_acquire(struct gr_call_table* table, uint32_t* idOut);
+
+/**
+ * Looks up and locks the element of the call with the given id. Returns NULL and sets errno
+ * to ENOENT if the call does not exist (anymore).
+ */
+void* gr_call_table_lock(struct gr_call_table* table, uint32_t id);
+void  gr_call_table_unlock(struct gr_call_table* table, void* element);
+
+/**
+ * Frees the slot of a locked element, the id is invalidated and the slot is unlocked.
+ */
+void  gr_call_table_release(struct gr_call_table* table, void* element);
+
+/**
+ * Invokes <enumFn> for every call in the table, each slot is locked while it is enumerated.
+ */
+void  gr_call_table_enumerate(struct gr_call_table* table, gr_call_table_enum_fn enumFn, void* context);
+
+/**
+ * Returns the number of calls in the table, this is only a snapshot.
+ */
+static inline int gr_call_table_count(struct gr_call_table* table)
+{
+    return (int)atomic_load(&table->active_count);
+}
+
+#endif // !__GRACHT_CALL_TABLE_H__
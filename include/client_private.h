@@ -27,8 +27,25 @@
 
 // forward declarations
 struct gracht_client;
+struct gracht_client_pool;
 
 // Callback prototype
 typedef void (*client_invoke_t)(struct gracht_client*, gracht_buffer_t*);
 
+// Used by the client pool to balance calls and detect connections that have been lost. A client
+// is only considered connected while its receive thread is running.
+extern int gracht_client_outstanding_calls(struct gracht_client* client);
+extern int gracht_client_is_connected(struct gracht_client* client);
+
+// The handle of a client pool is a client without a connection of its own, every call made on it
+// is forwarded to a connection of the pool.
+extern int  gracht_client_create_pooled(struct gracht_client_pool* pool, struct gracht_client** clientOut);
+extern void gracht_client_destroy_pooled(struct gracht_client* client);
+
+// Used by the handle of a client pool to pick the connection of a new call, and to find it again
+// for the calls that have been made. The connection is in use until it is released.
+extern struct gracht_client* gracht_client_pool_acquire_call(struct gracht_client_pool* pool, uint32_t* connectionOut);
+extern struct gracht_client* gracht_client_pool_lookup_call(struct gracht_client_pool* pool, uint32_t connection);
+extern void                  gracht_client_pool_release_call(struct gracht_client_pool* pool, uint32_t connection);
+
 #endif // !__CLIENT_PRIVATE_H__
@@ -0,0 +1,124 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Client Registry Type Definitions & Structures
+ * - This header describes the table of connected clients in the server. Lookups
+ *   are done without taking any locks, readers only ever write to their own reader
+ *   slot. Clients are reference counted, so they can be used outside of the read
+ *   section, and removing a client never waits for the threads that use it.
+ */
+
+#ifndef __GRACHT_CLIENT_REGISTRY_H__
+#define __GRACHT_CLIENT_REGISTRY_H__
+
+#include "gatomic.h"
+#include "gracht/link/link.h"
+#include "thread_api.h"
+#include <stddef.h>
+
+// The number of reader slots, threads are spread over the slots and only share
+// a slot (and thus a cache line) if there are more threads than slots.
+#define GR_CLIENT_REGISTRY_READERS 64
+
+struct gracht_reactor;
+struct gr_outbound_queue;
+
+struct gr_client_entry {
+    gracht_conn_t                handle;
+    struct gracht_link*          link;
+    struct gracht_server_client* client;
+    struct gracht_reactor*       reactor;
+    struct gr_outbound_queue*    outbound;
+};
+
+struct gr_client_registry_reader {
+    atomic_uint active[2];
+    char        padding[64 - (2 * sizeof(atomic_uint))];
+};
+
+typedef void (*gr_client_registry_enumfn)(struct gr_client_entry* entry, void* context);
+typedef int  (*gr_client_registry_matchfn)(struct gr_client_entry* entry, void* context);
+
+struct gr_client_retired;
+
+struct gr_client_registry {
+    atomic_uintptr_t                 table;
+    atomic_uint                      phase;
+    mtx_t                            writer_lock;
+    mtx_t                            sync_lock;
+    size_t                           count;
+    gr_client_registry_enumfn        released;
+    void*                            released_context;
+    struct gr_client_retired*        retired;
+    struct gr_client_retired*        reclaiming;
+    unsigned int                     reclaim_phase;
+    int                              reclaim_round;
+    struct gr_client_registry_reader readers[GR_CLIENT_REGISTRY_READERS];
+};
+
+/**
+ * Constructs the registry, the released callback is invoked for each client once it has been
+ * removed and the last reference to it is released. It is invoked from the thread that releases
+ * the last reference.
+ */
+int  gr_client_registry_construct(struct gr_client_registry* registry, gr_client_registry_enumfn released, void* context);
+void gr_client_registry_destroy(struct gr_client_registry* registry);
+
+/**
+ * Enters a read section, entries returned by the registry stay valid until the section
+ * is left again. Read sections can be nested and must be kept short, the memory of removed
+ * clients is not reclaimed while a read section is active. The returned value must be passed
+ * to gr_client_registry_read_unlock.
+ */
+unsigned int gr_client_registry_read_lock(struct gr_client_registry* registry);
+void         gr_client_registry_read_unlock(struct gr_client_registry* registry, unsigned int section);
+
+/**
+ * Looks up the client with the given handle, the caller must be inside a read section.
+ */
+struct gr_client_entry* gr_client_registry_get(struct gr_client_registry* registry, gracht_conn_t handle);
+
+/**
+ * Looks up the client with the given handle and takes a reference on it, the client stays valid
+ * until the reference is released again. Returns NULL if the client is not registered.
+ */
+struct gr_client_entry* gr_client_registry_acquire(struct gr_client_registry* registry, gracht_conn_t handle);
+void                    gr_client_registry_release(struct gr_client_registry* registry, struct gr_client_entry* entry);
+
+/**
+ * Invokes the callback for all clients, the read section is entered by the registry.
+ */
+void gr_client_registry_enumerate(struct gr_client_registry* registry, gr_client_registry_enumfn callback, void* context);
+
+/**
+ * Adds a new client, returns -1 and sets errno to EEXIST if the handle is already registered.
+ */
+int gr_client_registry_add(struct gr_client_registry* registry, const struct gr_client_entry* entry);
+
+/**
+ * Removes the client with the given handle and releases the reference of the registry, this does not
+ * wait for other threads to release theirs. Returns -1 and sets errno to ENOENT if the handle is not
+ * registered.
+ */
+int gr_client_registry_remove(struct gr_client_registry* registry, gracht_conn_t handle);
+
+/**
+ * Removes all clients the match callback returns non-zero for. Returns the number of clients removed.
+ */
+int gr_client_registry_remove_if(struct gr_client_registry* registry, gr_client_registry_matchfn match, void* context);
+
+#endif // !__GRACHT_CLIENT_REGISTRY_H__
@@ -95,6 +95,29 @@ static inline int atomic_compare_exchange_strong(
 #endif
 #else
 #include <stdatomic.h>
+#include <stdint.h>
+#endif
+
+// Operations on plain 32 bit words, for state that lives in the public structures
+// where the atomic types cannot be exposed.
+#ifdef _WIN32
+#define atomic_load_u32(object) \
+    ((uint32_t)InterlockedCompareExchange((volatile LONG*)(object), 0, 0))
+#define atomic_store_u32(object, value) \
+    ((void)InterlockedExchange((volatile LONG*)(object), (LONG)(value)))
+#define atomic_fetch_or_u32(object, operand) \
+    ((uint32_t)InterlockedOr((volatile LONG*)(object), (LONG)(operand)))
+#define atomic_fetch_and_u32(object, operand) \
+    ((uint32_t)InterlockedAnd((volatile LONG*)(object), (LONG)(operand)))
+#else
+#define atomic_load_u32(object) \
+    atomic_load((_Atomic uint32_t*)(object))
+#define atomic_store_u32(object, value) \
+    atomic_store((_Atomic uint32_t*)(object), (uint32_t)(value))
+#define atomic_fetch_or_u32(object, operand) \
+    atomic_fetch_or((_Atomic uint32_t*)(object), (uint32_t)(operand))
+#define atomic_fetch_and_u32(object, operand) \
+    atomic_fetch_and((_Atomic uint32_t*)(object), (uint32_t)(operand))
 #endif
 
 #endif //! __GRACHT_ATOMIC_H__
@@ -54,10 +54,66 @@ typedef struct gracht_client_configuration {
     // <stream_buffer_count> configures how many concurrent stream/data-plane send buffers are kept.
     int                 stream_buffer_size;
     int                 stream_buffer_count;
+
+    // <send_buffer_count> configures the number of buffers used for sending messages. With more than one
+    //                     buffer, multiple threads can serialize messages at the same time, and only the
+    //                     writes to the link are serialized. This is ignored if send_buffer is provided.
+    int                 send_buffer_count;
+
+    // <receive_thread> if set, the client starts a dedicated thread on connect that receives and handles all
+    //                  incoming messages. Waiting for a response then only blocks the caller until the receive
+    //                  thread completes it, and events are invoked from the receive thread. Requires a link that
+    //                  supports being interrupted.
+    int                 receive_thread;
+
+    // <call_timeout_ms> the default timeout of calls that expect a response. Calls that have not completed in time
+    //                   fail with ETIMEDOUT, and the time left is sent along with the call so the server can skip
+    //                   calls that expired while queued. If not set calls never time out.
+    int                 call_timeout_ms;
 } gracht_client_configuration_t;
 
+/**
+ * Creates a new link for a connection of a client pool, this is invoked every time the pool dials a connection.
+ * The link is owned by the connection from then on.
+ */
+typedef int (*gracht_client_pool_link_fn)(void* context, struct gracht_link** linkOut);
+
+typedef struct gracht_client_pool_configuration {
+    // <client_config> every connection of the pool is a client created from this configuration. The link, send_buffer
+    //                 and recv_buffer are ignored as they can not be shared between connections, and the receive thread
+    //                 is always enabled, as that is how the pool notices connections that are lost.
+    gracht_client_configuration_t client_config;
+
+    // <connection_count> the number of connections the pool keeps to the server. Defaults to
+    //                    GRACHT_CLIENT_POOL_DEFAULT_CONNECTIONS, and can be at most GRACHT_CLIENT_POOL_MAX_CONNECTIONS.
+    int                        connection_count;
+
+    // <create_link>  creates the link of a connection, <link_context> is passed along.
+    gracht_client_pool_link_fn create_link;
+    void*                      link_context;
+
+    // <reconnect_interval_ms> how often the pool checks its connections and redials the ones that were lost. Lost
+    //                         connections that are noticed when acquiring a connection are redialed right away.
+    int                        reconnect_interval_ms;
+} gracht_client_pool_configuration_t;
+
+#define GRACHT_CLIENT_POOL_DEFAULT_CONNECTIONS 4
+#define GRACHT_CLIENT_POOL_DEFAULT_INTERVAL_MS 1000
+#define GRACHT_CLIENT_POOL_MAX_CONNECTIONS     256
+
 // Prototype declaration to hide implementation details.
 typedef struct gracht_client gracht_client_t;
+typedef struct gracht_client_batch gracht_client_batch_t;
+typedef struct gracht_client_pool gracht_client_pool_t;
+
+/**
+ * The completion handler of a call that was invoked with a callback, this is used by the generated _async
+ * functions. The handler is invoked by the thread that receives the response, which is either the receive thread or
+ * the thread pumping the client with gracht_client_wait_message. The status is GRACHT_MESSAGE_COMPLETED with the
+ * response, or GRACHT_MESSAGE_ERROR without a response if the call failed. The response is only valid until the
+ * handler returns. The callback and context are the ones provided when the call was invoked.
+ */
+typedef void (*gracht_client_completion_fn)(gracht_client_t* client, int status, gracht_buffer_t* response, void* callback, void* context);
 
 #ifdef __cplusplus
 extern "C" {
@@ -72,6 +128,15 @@ GRACHTAPI void gracht_client_configuration_set_send_buffer(gracht_client_configu
 GRACHTAPI void gracht_client_configuration_set_recv_buffer(gracht_client_configuration_t* config, void* buffer, int size);
 GRACHTAPI void gracht_client_configuration_set_max_msg_size(gracht_client_configuration_t* config, int maxMessageSize);
 GRACHTAPI void gracht_client_configuration_set_stream_buffer_size(gracht_client_configuration_t* config, int bufferSize, int bufferCount);
+GRACHTAPI void gracht_client_configuration_set_send_buffer_count(gracht_client_configuration_t* config, int bufferCount);
+GRACHTAPI void gracht_client_configuration_set_receive_thread(gracht_client_configuration_t* config, int enable);
+GRACHTAPI void gracht_client_configuration_set_call_timeout(gracht_client_configuration_t* config, int timeoutMs);
+
+GRACHTAPI void gracht_client_pool_configuration_init(gracht_client_pool_configuration_t* config);
+GRACHTAPI void gracht_client_pool_configuration_set_client_config(gracht_client_pool_configuration_t* config, const gracht_client_configuration_t* clientConfig);
+GRACHTAPI void gracht_client_pool_configuration_set_connection_count(gracht_client_pool_configuration_t* config, int connectionCount);
+GRACHTAPI void gracht_client_pool_configuration_set_link_factory(gracht_client_pool_configuration_t* config, gracht_client_pool_link_fn createLink, void* context);
+GRACHTAPI void gracht_client_pool_configuration_set_reconnect_interval(gracht_client_pool_configuration_t* config, int intervalMs);
 
 /**
  * Creates a new instance of a gracht client based on the link configuration. An application
@@ -118,6 +183,17 @@ GRACHTAPI void gracht_client_unregister_protocol(gracht_client_t* client, gracht
  */
 GRACHTAPI void gracht_client_shutdown(gracht_client_t* client);
 
+/**
+ * Sets the options of the next call that the calling thread invokes on the client, the options are
+ * reset after that call. Currently only timeout_ms is used, which overrides the configured call timeout,
+ * a value of 0 means the call never times out.
+ * 
+ * @param client A pointer to a previously created gracht client.
+ * @param options The options to use for the next call.
+ * @return int Returns 0 if the options were set.
+ */
+GRACHTAPI int gracht_client_set_call_options(gracht_client_t* client, const struct gracht_call_options* options);
+
 /**
  * Returns the associated connection handle/descriptor that the clients uses. This can be
  * usefull if an application wants to support async transfers with epoll/select/completion ports.
@@ -132,6 +208,9 @@ GRACHTAPI gracht_conn_t gracht_client_iod(gracht_client_t* client);
  * This should not be invoked to wait for a specific message, but rather be used to poll for new events. 
  * It is not mandatory to use this call if the client is not used for events.
  * 
+ * If the client uses a receive thread, then this only waits for the receive thread to handle the next message, or
+ * for the message provided by context to complete. Without GRACHT_MESSAGE_BLOCK this fails with EBUSY.
+ * 
  * @param client A pointer to a previously created gracht client.
  * @param context The message context if required.
  * @param flags The flag GRACHT_MESSAGE_BLOCK can be specified to block untill a new message is received.
@@ -165,10 +244,124 @@ GRACHTAPI int gracht_client_await(gracht_client_t* client, struct gracht_message
  */
 GRACHTAPI int gracht_client_await_multiple(gracht_client_t* client, struct gracht_message_context** contexts, int count, unsigned int flags);
 
+/**
+ * Creates a new batch for the client. Calls are added to a batch by using the generated _batch variants of the
+ * protocol functions, which serialize the calls back to back into the batch instead of sending them. The batch
+ * is then sent with a single write by gracht_client_batch_flush. A batch must only be used by one thread at the time.
+ * 
+ * @param client A pointer to a previously created gracht client.
+ * @param capacity The number of bytes the batch can hold before it is flushed automatically. Set to 0 to use the default.
+ *                 The capacity is never less than the max message size of the client.
+ * @param batchOut Storage for the batch pointer.
+ * @return int Returns 0 if the batch was created.
+ */
+GRACHTAPI int gracht_client_batch_create(gracht_client_t* client, int capacity, gracht_client_batch_t** batchOut);
+
+/**
+ * Destroys a batch. Calls that were added but never flushed are discarded.
+ * 
+ * @param batch A pointer to a previously created batch.
+ */
+GRACHTAPI void gracht_client_batch_destroy(gracht_client_batch_t* batch);
+
+/**
+ * Sends all the calls that have been added to the batch since the last flush. If the send fails, the calls
+ * that were not sent are discarded and removed from the contexts of the batch.
+ * 
+ * @param batch A pointer to a previously created batch.
+ * @return int Returns 0 if all the calls were sent.
+ */
+GRACHTAPI int gracht_client_batch_flush(gracht_client_batch_t* batch);
+
+/**
+ * Discards calls that have not been flushed yet, and clears the contexts of the batch so it can be reused.
+ * 
+ * @param batch A pointer to a previously created batch.
+ */
+GRACHTAPI void gracht_client_batch_reset(gracht_client_batch_t* batch);
+
+/**
+ * Returns the contexts of the calls that expect a response and were added since the batch was last reset. The
+ * contexts are in the order the calls were added, and can be passed directly to gracht_client_await_multiple
+ * once the batch has been flushed.
+ * 
+ * @param batch A pointer to a previously created batch.
+ * @param countOut Storage for the number of contexts.
+ * @return struct gracht_message_context** The contexts of the batch, valid until the next call is added or the batch is reset.
+ */
+GRACHTAPI struct gracht_message_context** gracht_client_batch_contexts(gracht_client_batch_t* batch, int* countOut);
+
+/**
+ * Creates a pool of connections to the same server, and dials all of them. Connections that fail to connect or are
+ * lost later on are redialed in the background. Calls are made either through the handle of the pool, or on a
+ * connection acquired from the pool, both work with the generated functions like any other client.
+ * 
+ * @param config The pool configuration which has been initialized prior to this call.
+ * @param poolOut Storage for the pool pointer.
+ * @return int Returns 0 if the pool was created and atleast one connection was established.
+ */
+GRACHTAPI int gracht_client_pool_create(gracht_client_pool_configuration_t* config, gracht_client_pool_t** poolOut);
+
+/**
+ * Destroys the pool and shuts down all its connections. All acquired connections must have been released.
+ * 
+ * @param pool A pointer to a previously created pool.
+ */
+GRACHTAPI void gracht_client_pool_destroy(gracht_client_pool_t* pool);
+
+/**
+ * Registers a protocol with every connection of the pool, including connections that are dialed later on.
+ * 
+ * @param pool A pointer to a previously created pool.
+ * @param protocol The protocol instance to register.
+ * @return int Returns 0 if the protocol was registered.
+ */
+GRACHTAPI int gracht_client_pool_register_protocol(gracht_client_pool_t* pool, gracht_protocol_t* protocol);
+
+/**
+ * Returns the handle of the pool, which can be passed to the generated functions instead of a client. Every call is
+ * made on the connected connection with the fewest outstanding calls, and awaiting the call or reading its result
+ * through the handle finds that connection again. Calls on a connection that was lost fail with ENOTCONN.
+ * 
+ * The handle is owned by the pool and must not be shut down. Batches and gracht_client_iod are not supported
+ * by the handle, and awaiting any of several calls (GRACHT_AWAIT_ANY) only works if they were made on the same
+ * connection. Events and completion handlers are invoked with the client of the connection instead of the handle.
+ * 
+ * @param pool A pointer to a previously created pool.
+ * @return gracht_client_t* The handle of the pool.
+ */
+GRACHTAPI gracht_client_t* gracht_client_pool_handle(gracht_client_pool_t* pool);
+
+/**
+ * Acquires the connected connection with the fewest outstanding calls. The connection stays valid until it is released,
+ * so calls must be invoked, awaited and read on the same connection before releasing it.
+ * 
+ * @param pool A pointer to a previously created pool.
+ * @return gracht_client_t* The client of the connection, or NULL with errno set to ENOTCONN if no connections are up.
+ */
+GRACHTAPI gracht_client_t* gracht_client_pool_acquire(gracht_client_pool_t* pool);
+
+/**
+ * Releases a connection acquired from the pool.
+ * 
+ * @param pool A pointer to a previously created pool.
+ * @param client The client returned by gracht_client_pool_acquire.
+ */
+GRACHTAPI void gracht_client_pool_release(gracht_client_pool_t* pool, gracht_client_t* client);
+
+/**
+ * Returns the number of connections of the pool that are currently connected.
+ * 
+ * @param pool A pointer to a previously created pool.
+ * @return int The number of connected connections.
+ */
+GRACHTAPI int gracht_client_pool_connected(gracht_client_pool_t* pool);
+
 GRACHTAPI int gracht_client_get_stream_buffer(gracht_client_t* client, gracht_buffer_t* buffer);
 GRACHTAPI int gracht_client_get_stream_buffer_sized(gracht_client_t* client, uint32_t requiredSize, gracht_buffer_t* buffer);
 GRACHTAPI int gracht_client_invoke_stream(gracht_client_t* client, struct gracht_message_context* context, gracht_buffer_t* message);
 GRACHTAPI int gracht_client_invoke_stream_sized(gracht_client_t* client, struct gracht_message_context* context, gracht_buffer_t* message, uint32_t responseBufferSize);
+GRACHTAPI int gracht_client_invoke_callback(gracht_client_t* client, gracht_buffer_t* message, gracht_client_completion_fn handler, void* callback, void* context);
 
 #ifdef __cplusplus
 }
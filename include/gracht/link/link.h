@@ -35,6 +35,7 @@ enum gracht_link_type {
 
 // Represents a client from the server point of view, and will be given when trying
 // to communicate with the client. The link functions will have this information available.
+// The flags and subscriptions are owned by the server, which updates them atomically.
 struct gracht_server_client {
     gracht_conn_t handle;
     uint32_t      flags;
@@ -44,20 +45,32 @@ struct gracht_server_client {
 // forward declares
 struct gracht_link;
 
-// Server link API callbacks.
+// A segment of a message when a message is received into, or sent from, multiple buffers.
+#define GRACHT_LINK_MAX_VECTORS 8
+struct gracht_iovec {
+    void*    data;
+    uint32_t length;
+};
+
+// Server link API callbacks. The server passes GRACHT_HANDLE_INVALID to destroy_client when it has
+// already removed the client connection from the set itself.
 typedef int (*server_accept_client_fn)(struct gracht_link*, gracht_handle_t set_handle, struct gracht_server_client**);
 typedef int (*server_create_client_fn)(struct gracht_link*, struct gracht_message*, struct gracht_server_client**);
 typedef int (*server_destroy_client_fn)(struct gracht_server_client*, gracht_handle_t set_handle);
 typedef int (*server_recv_client_fn)(struct gracht_server_client*, struct gracht_message*, unsigned int flags);
 typedef int (*server_send_client_fn)(struct gracht_server_client*, struct gracht_buffer*, unsigned int flags);
 typedef int (*server_peek_client_fn)(struct gracht_server_client*, uint32_t* messageLengthOut, uint8_t* serviceIdOut, unsigned int flags);
+typedef int (*server_recv_client_inplace_fn)(struct gracht_server_client*, struct gracht_message** messageOut, unsigned int flags);
+typedef int (*server_flush_client_fn)(struct gracht_server_client*);
+typedef int (*server_send_client_vectored_fn)(struct gracht_server_client*, struct gracht_iovec* vectors, int count, unsigned int flags);
 
 typedef int (*server_link_recv_fn)(struct gracht_link*, struct gracht_message*, unsigned int flags);
 typedef int (*server_link_send_fn)(struct gracht_link*, struct gracht_message*, struct gracht_buffer*);
 typedef int (*server_link_peek_fn)(struct gracht_link*, uint32_t* messageLengthOut, uint8_t* serviceIdOut, unsigned int flags);
 
-typedef gracht_conn_t (*server_link_setup_fn)(struct gracht_link*, gracht_handle_t set_handle);
-typedef void          (*server_link_destroy_fn)(struct gracht_link*, gracht_handle_t set_handle);
+typedef gracht_conn_t       (*server_link_setup_fn)(struct gracht_link*, gracht_handle_t set_handle);
+typedef void                (*server_link_destroy_fn)(struct gracht_link*, gracht_handle_t set_handle);
+typedef struct gracht_link* (*server_link_clone_fn)(struct gracht_link*);
 
 struct server_link_ops {
     /**
@@ -71,6 +84,32 @@ struct server_link_ops {
     server_send_client_fn    send_client;
     server_peek_client_fn    peek_client;
 
+    /**
+     * Optional function for connection oriented links that keep received data in their own
+     * buffers. The message returned points directly to the data in the link buffer, and the link
+     * must set message->release, which is invoked by the server once the message has been handled.
+     * Should fail with ENOBUFS if the message cannot be received in-place, in which case recv_client
+     * is used instead, or with ENOSPC if the link has no room for more data until messages are released.
+     */
+    server_recv_client_inplace_fn recv_client_inplace;
+
+    /**
+     * Optional function for connection oriented links that queue the data a connection could not
+     * take right away. Such links watch the connection for becoming writable themselves, and the
+     * server invokes this when the aio set reports it as writable. Should return 0 once all queued
+     * data has been written, or fail with EAGAIN if data is still queued. Such links may also queue
+     * messages sent with GRACHT_MESSAGE_COALESCE without writing them, the server then invokes this
+     * to write them.
+     */
+    server_flush_client_fn flush_client;
+
+    /**
+     * Optional function for connection oriented links that sends a single message from multiple
+     * segments, in order. The segments belong to the caller and must not be referenced once this
+     * returns. The server copies the segments into the message buffer if the link does not support this.
+     */
+    server_send_client_vectored_fn send_client_vectored;
+
     /**
      * Connection-less oriented functions, and must be supported by the link
      * if the link-type is packet.
@@ -84,6 +123,13 @@ struct server_link_ops {
      */
     server_link_setup_fn       setup;
     server_link_destroy_fn     destroy;
+
+    /**
+     * Optional function for links that can be sharded across multiple server reactors. The clone
+     * must be an identical, but not yet set up, copy of the link that can listen on the same address
+     * as the original. Should return NULL if the link cannot be sharded.
+     */
+    server_link_clone_fn       clone;
 };
 
 // Client link API callbacks.
@@ -91,7 +137,12 @@ typedef gracht_conn_t (*client_link_connect_fn)(struct gracht_link*);
 typedef int           (*client_link_recv_fn)(struct gracht_link*, struct gracht_buffer*, unsigned int flags);
 typedef int           (*client_link_send_fn)(struct gracht_link*, struct gracht_buffer*, void* messageContext);
 typedef int           (*client_link_peek_fn)(struct gracht_link*, uint32_t* messageLengthOut, uint8_t* serviceIdOut, unsigned int flags);
+typedef void          (*client_link_interrupt_fn)(struct gracht_link*);
+typedef int           (*client_link_poll_fn)(struct gracht_link*, int timeoutMs);
 typedef void          (*client_link_destroy_fn)(struct gracht_link*);
+typedef int           (*client_link_peek_header_fn)(struct gracht_link*, uint8_t* header, unsigned int flags);
+typedef int           (*client_link_recv_vectored_fn)(struct gracht_link*, struct gracht_iovec* vectors, int count, unsigned int flags);
+typedef int           (*client_link_send_vectored_fn)(struct gracht_link*, struct gracht_iovec* vectors, int count, void* messageContext);
 
 struct client_link_ops {
     client_link_connect_fn connect;
@@ -99,6 +150,34 @@ struct client_link_ops {
     client_link_send_fn    send;
     client_link_peek_fn    peek;
     client_link_destroy_fn destroy;
+
+    /**
+     * Optional function that wakes up any thread that is blocked receiving on the link, and makes
+     * all following receives fail. Required by clients that use a dedicated receive thread.
+     */
+    client_link_interrupt_fn interrupt;
+
+    /**
+     * Optional function that waits up to timeoutMs for data to be received. Returns 0 when data
+     * is available, or -1 and sets errno to ETIMEDOUT if nothing was received in time. The client
+     * needs this to expire calls while it waits for responses.
+     */
+    client_link_poll_fn poll;
+
+    /**
+     * Optional functions that let the client receive responses straight into buffers provided by the
+     * caller. peek_header copies the GRACHT_MESSAGE_HEADER_SIZE bytes of the header of the next message
+     * without consuming it, and recv_vectored then receives that message into the segments in order, waiting
+     * for all of it. The segments must add up to the length of the message.
+     */
+    client_link_peek_header_fn   peek_header;
+    client_link_recv_vectored_fn recv_vectored;
+
+    /**
+     * Optional function that sends a single message from multiple segments, in order. The client
+     * copies the segments into the message buffer before sending if the link does not support this.
+     */
+    client_link_send_vectored_fn send_vectored;
 };
 
 #ifdef __cplusplus
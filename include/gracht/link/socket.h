@@ -71,6 +71,34 @@ GRACHTAPI void gracht_link_socket_set_type(struct gracht_link_socket* link, enum
 GRACHTAPI void gracht_link_socket_set_listen(struct gracht_link_socket* link, int listen);
 GRACHTAPI void gracht_link_socket_set_domain(struct gracht_link_socket* link, int socketDomain);
 
+/**
+ * @brief Sets the size of the receive buffer that is kept for each connection accepted by
+ * a listening stream link. All data available on the connection is read into this buffer at
+ * once, and messages are then taken from the buffer, which means pipelined connections need
+ * far less than one system call per message. Messages that fit in the buffer are handled
+ * directly from it without being copied, so the size is rounded up to the page size, and
+ * the connection is paused while the buffer is full of messages being handled. A size of 0
+ * disables the buffering.
+ * 
+ * @param link The socket link to configure.
+ * @param size The size of the receive buffer in bytes.
+ */
+GRACHTAPI void gracht_link_socket_set_recv_buffer_size(struct gracht_link_socket* link, size_t size);
+
+/**
+ * @brief Sets the watermarks of the send queue that is kept for each connection accepted by
+ * a listening stream link. Data that the connection cannot take right away is queued and written
+ * once the connection is writable again, so sends never wait on a slow peer. Once more than
+ * <highWater> bytes are queued, sends without GRACHT_MESSAGE_BLOCK fail with EAGAIN, which means
+ * gracht_server_send_event and broadcasts see the peer is falling behind. Blocking sends, like
+ * responses, wait instead until the queue has been written down to <lowWater> bytes.
+ * 
+ * @param link The socket link to configure.
+ * @param lowWater The number of queued bytes blocking sends wait for.
+ * @param highWater The number of queued bytes at which sends are refused.
+ */
+GRACHTAPI void gracht_link_socket_set_send_watermarks(struct gracht_link_socket* link, size_t lowWater, size_t highWater);
+
 /**
  * @brief Sets the bind address for the socket link.
  * 
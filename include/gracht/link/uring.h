@@ -0,0 +1,68 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht io_uring Link Type Definitions & Structures
+ * - This header describes the io_uring link, which serves listening stream socket
+ *   links through io_uring on Linux. Refer to socket.h for configuring the link.
+ */
+
+#ifndef __GRACHT_LINK_URING_H__
+#define __GRACHT_LINK_URING_H__
+
+#include "socket.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Creates a socket link that, once it is set to listen for stream connections, accepts,
+ * receives from and sends to its connections through io_uring instead of waiting for the connections
+ * to become ready. Connections are accepted and received from with multishot requests, which keep
+ * delivering data without being queued again, and the data is received into a ring of buffers shared
+ * by all connections of the link. The link is configured with the gracht_link_socket_* functions, and
+ * is a regular socket link if io_uring is not available, or the link is not a listening stream link.
+ * 
+ * @param linkOut The created link.
+ * @return int 0 on success, -1 on failure and errno is set.
+ */
+GRACHTAPI int gracht_link_uring_create(struct gracht_link_socket** linkOut);
+
+/**
+ * @brief Sets the buffers that the connections of the link are received into. The buffers are
+ * shared by all connections, and a connection keeps the buffers it has received into until its
+ * messages are read. The count is rounded up to a power of two.
+ * 
+ * @param link The link to configure.
+ * @param bufferSize The size of each buffer in bytes.
+ * @param bufferCount The number of buffers.
+ */
+GRACHTAPI void gracht_link_uring_set_buffers(struct gracht_link_socket* link, size_t bufferSize, size_t bufferCount);
+
+/**
+ * @brief Returns whether the link is served through io_uring. This is only known once the link has
+ * been added to a server, as the link falls back to a regular socket link if io_uring is unavailable.
+ * 
+ * @param link The link to query.
+ * @return int 1 if the link is served through io_uring, otherwise 0.
+ */
+GRACHTAPI int gracht_link_uring_is_active(struct gracht_link_socket* link);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // !__GRACHT_LINK_URING_H__
@@ -26,6 +26,16 @@
 #include "types.h"
 #include "link/link.h"
 
+/**
+ * Policies for clients that fall behind on broadcasted events. Broadcasts are queued for each
+ * subscribed client, and when the queue of a client is full the policy decides what is discarded.
+ * Coalescing replaces a pending event of the same protocol and action with the new one, and drops
+ * the oldest pending event if there was none to replace.
+ */
+#define GRACHT_BROADCAST_DROP_OLDEST 0
+#define GRACHT_BROADCAST_DROP_NEWEST 1
+#define GRACHT_BROADCAST_COALESCE    2
+
 struct gracht_server_callbacks {
     void (*clientConnected)(gracht_conn_t client);    // invoked only when a new stream-based client has connected
                                                       // or when a new connectionless-client has subscribed to the server
@@ -53,12 +63,49 @@ typedef struct gracht_server_configuration {
     // <stream_buffer_size> configures the size of buffers used for stream/data-plane sends. If not set it falls
     //                      back to max_message_size.
     // <stream_buffer_count> configures how many concurrent stream/data-plane send buffers are kept.
+    // <server_reactors>  specifies the number of event loops (reactors) that gracht_server_main_loop will run. Each
+    //                    reactor runs on its own thread with its own aio set, and connections stay on the reactor
+    //                    they were assigned to. Links that support sharding listen from every reactor. Values above
+    //                    1 are only supported when the server owns the aio set and gracht_server_main_loop is used.
+    // <worker_queue_depth> specifies how many messages can be queued for each worker. When all worker queues are
+    //                      full the server stops reading from the connection until a worker has capacity again.
+    //                      The depth is rounded up to a power of two, and is atleast 2. If not set it defaults to 32.
+    // <event_batch_size> specifies how many events each reactor can receive from the aio set per wait. If not
+    //                    set it defaults to 32.
+    // <broadcast_queue_depth> specifies how many broadcasted events can be pending for each client before the
+    //                         <broadcast_policy> is applied. If not set it defaults to 64.
+    // <broadcast_policy> one of the GRACHT_BROADCAST_* policies, defaults to GRACHT_BROADCAST_DROP_OLDEST.
+    // <coalesce_threshold> enables coalescing of responses when set. Responses to connected clients are then held
+    //                      by the link, and written together by the reactor of the client once per iteration, or as
+    //                      soon as <coalesce_threshold> bytes are held for the client. Links that cannot hold data
+    //                      for their clients send the responses right away. Defaults to 0, which is disabled.
     int                            server_workers;
     int                            max_message_size;
     int                            stream_buffer_size;
     int                            stream_buffer_count;
+    int                            server_reactors;
+    int                            worker_queue_depth;
+    int                            event_batch_size;
+    int                            broadcast_queue_depth;
+    int                            broadcast_policy;
+    int                            coalesce_threshold;
 } gracht_server_configuration_t;
 
+typedef struct gracht_server_stats {
+    // <throttle_count>    the number of times a connection (or link) was paused because all worker queues were full.
+    // <throttled_time_us> the accumulated time connections have spent paused, this includes only finished pauses.
+    // <throttled_now>     the number of connections that are currently paused.
+    // <expired_count>     the number of calls that were dropped because they expired before they could be handled.
+    // <broadcast_dropped> the number of broadcasted events that were discarded for clients that fell behind.
+    uint64_t throttle_count;
+    uint64_t throttled_time_us;
+    int      throttled_now;
+    uint64_t expired_count;
+    uint64_t broadcast_dropped;
+} gracht_server_stats_t;
+
+typedef void (*gracht_server_timer_fn)(gracht_server_t* server, void* context);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -75,6 +122,11 @@ GRACHTAPI void gracht_server_configuration_set_aio_descriptor(gracht_server_conf
 GRACHTAPI void gracht_server_configuration_set_num_workers(gracht_server_configuration_t* config, int workerCount);
 GRACHTAPI void gracht_server_configuration_set_max_msg_size(gracht_server_configuration_t* config, int maxMessageSize);
 GRACHTAPI void gracht_server_configuration_set_stream_buffer_size(gracht_server_configuration_t* config, int bufferSize, int bufferCount);
+GRACHTAPI void gracht_server_configuration_set_num_reactors(gracht_server_configuration_t* config, int reactorCount);
+GRACHTAPI void gracht_server_configuration_set_worker_queue_depth(gracht_server_configuration_t* config, int queueDepth);
+GRACHTAPI void gracht_server_configuration_set_event_batch_size(gracht_server_configuration_t* config, int eventCount);
+GRACHTAPI void gracht_server_configuration_set_broadcast_queue(gracht_server_configuration_t* config, int queueDepth, int policy);
+GRACHTAPI void gracht_server_configuration_set_response_coalescing(gracht_server_configuration_t* config, int byteThreshold);
 
 /**
  * Creates a new instance of the gracht server instance based on the config provided. The configuratipn
@@ -107,9 +159,6 @@ GRACHTAPI void gracht_server_request_shutdown(gracht_server_t* server);
  */
 GRACHTAPI int gracht_server_add_link(gracht_server_t* server, struct gracht_link* link);
 
-GRACHTAPI const struct gracht_security_context*
-gracht_server_get_security_context(gracht_server_request_t* request);
-
 /**
  * Registers a new protocol with the server. A max of 255 protocols can be registered, and if
  * the server is called with an unsupported protocol it ignores the message. Only messages that
@@ -143,19 +192,58 @@ GRACHTAPI int gracht_server_handle_event(gracht_server_t* server, gracht_conn_t
  * The server main loop function. This can be invoked if no additional handling is required by
  * the application. Currently this function does not return at any point. exit() should be called
  * to shutdown. It is not required to invoke the main_loop function, this is only a way to present
- * an easy way to run a server that has no additional logic.
+ * an easy way to run a server that has no additional logic. If multiple reactors were configured,
+ * the additional reactors are started on their own threads and the calling thread runs the first.
  * 
  * @return int exit code of the application.
  */
 GRACHTAPI int gracht_server_main_loop(gracht_server_t* server);
 
 /**
- * Returns the epoll/select/completion port handle/descriptor that is used by the server.
+ * Returns the epoll/select/completion port handle/descriptor that is used by the server. If the server
+ * runs multiple reactors, then this is the descriptor of the first reactor.
  * 
  * @return aio_handle_t The handle/descriptor.
  */
 GRACHTAPI gracht_handle_t gracht_server_get_aio_handle(gracht_server_t* server);
 
+/**
+ * Retrieves runtime statistics of the server. The values are read without synchronization
+ * between them, so they should be treated as a snapshot.
+ * 
+ * @param stats Storage for the statistics.
+ * @return int Returns 0 on success, otherwise -1 and errno is set.
+ */
+GRACHTAPI int gracht_server_get_stats(gracht_server_t* server, gracht_server_stats_t* stats);
+
+/**
+ * Adds a timer that invokes the callback on the server loop once the interval has elapsed. Periodic timers
+ * are rescheduled after each invocation until they are removed. Timers can be added and removed from any
+ * thread, including from the callback itself. Callbacks run on the first reactor, so they should not block.
+ * 
+ * @param intervalMs The time in milliseconds before the callback is invoked, must be non-zero for periodic timers.
+ * @param periodic Whether the timer should be rescheduled after it has been invoked.
+ * @param timerIdOut Optional storage for the id of the timer, which is used to remove it again.
+ * @return int Returns 0 on success, otherwise -1 and errno is set.
+ */
+GRACHTAPI int gracht_server_add_timer(gracht_server_t* server, unsigned int intervalMs, int periodic,
+    gracht_server_timer_fn callback, void* context, uint32_t* timerIdOut);
+
+/**
+ * Removes a timer before it expires. A one-shot timer is removed automatically once it has been invoked.
+ * 
+ * @return int Returns 0 on success, otherwise -1 and errno is set to ENOENT if the timer did not exist.
+ */
+GRACHTAPI int gracht_server_remove_timer(gracht_server_t* server, uint32_t timerId);
+
+/**
+ * Invokes all timers that have expired. This should only be called when main_loop is not used, as
+ * the application then waits for events itself and must use the returned value as its wait timeout.
+ * 
+ * @return int The number of milliseconds until the next timer expires, or -1 if no timers are active.
+ */
+GRACHTAPI int gracht_server_run_timers(gracht_server_t* server);
+
 /**
  * Creates a deferrable copy of a received message, allowing the caller to specify both
  * storage that must be of size GRACHT_MESSAGE_DEFERRABLE_SIZE, and also the message that
@@ -72,6 +72,14 @@ typedef int gracht_conn_t;
 #define MESSAGE_FLAG_EVENT    0x00000002
 #define MESSAGE_FLAG_RESPONSE 0x00000003
 
+/**
+ * Set in addition to the message type when a call has a deadline. The time left of the
+ * call in milliseconds is then appended to the message as a trailer, which allows the
+ * server to drop calls that the caller has already given up on.
+ */
+#define MESSAGE_FLAG_DEADLINE        0x00000004
+#define GRACHT_MESSAGE_DEADLINE_SIZE 4
+
 /**
  * The message status, this is returned by any function that directly
  * refers to a specific message. Error indiciates a transmission error
@@ -98,6 +106,13 @@ typedef int gracht_conn_t;
 #define GRACHT_MESSAGE_BLOCK   0x1
 #define GRACHT_MESSAGE_WAITALL 0x2
 
+/**
+ * Used by the server when sending to a client, and lets links that queue data for their clients
+ * hold the message to send it together with the messages that follow. The server flushes the client
+ * once it is done.
+ */
+#define GRACHT_MESSAGE_COALESCE 0x4
+
 /**
  * The library is configured to use a default message of 2048 bytes. This
  * value is rather small to some, but it fits most needs.
@@ -115,7 +130,9 @@ struct gracht_message {
     uint32_t         size;    // size of the payload
     uint32_t         rsize;  // the number of bytes that are reserved in the payload
     uint32_t         index;   // used internally for payload storage
-    uint8_t          payload[]; // payload follows this message header
+    uint8_t*         payload; // payload follows this message header, unless the link received it in-place
+    void           (*release)(struct gracht_message*); // used internally by links that receive in-place
+    uint64_t         deadline; // used internally, the time the caller stops waiting for the response, 0 if none
 };
 
 enum gracht_capability_format {
@@ -139,6 +156,26 @@ typedef struct gracht_buffer {
     uint32_t index;
 } gracht_buffer_t;
 
+/**
+ * Memory of the caller that is sent as part of a message without being copied into the
+ * message buffer. Each segment is sent in place at <offset> of the message buffer, followed
+ * by the rest of the buffer. Used by the generated system for large arrays and strings, which
+ * are only sent from their segment if they are at least GRACHT_MESSAGE_SEGMENT_THRESHOLD bytes.
+ */
+#define GRACHT_MESSAGE_MAX_SEGMENTS      3
+#define GRACHT_MESSAGE_SEGMENT_THRESHOLD 1024
+
+struct gracht_message_segment {
+    uint32_t    offset;
+    const void* data;
+    uint32_t    length;
+};
+
+struct gracht_message_segments {
+    struct gracht_message_segment entries[GRACHT_MESSAGE_MAX_SEGMENTS];
+    int                           count;
+};
+
 /**
  * The context of a message. This is used as the message identifier when using
  * function calls that expect responses. The context that the message was invoked with
@@ -147,6 +184,7 @@ typedef struct gracht_buffer {
  */
 struct gracht_message_context {
     uint32_t message_id;
+    uint32_t connection; // the connection of a client pool that the call was made on
 };
 
 typedef struct gracht_protocol_function {
@@ -164,6 +202,13 @@ typedef struct gracht_protocol {
 
 #define GRACHT_PROTOCOL_FLAG_STREAM 0x1u
 
+/**
+ * Messages of ordered protocols are executed in the order they were received for each
+ * client, and never concurrently for the same client. Messages of different clients are
+ * still executed in parallel when the server runs with multiple workers.
+ */
+#define GRACHT_PROTOCOL_FLAG_ORDERED 0x2u
+
 #define GRACHT_PROTOCOL_INIT(id, name, num_functions, functions) { id, name, 0, num_functions, functions }
 #define GRACHT_PROTOCOL_INIT_FLAGS(id, name, flags, num_functions, functions) { id, name, flags, num_functions, functions }
 
@@ -0,0 +1,53 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Time Helpers
+ * - Monotonic clock used for measuring durations, this must never be used
+ *   for wall-clock time.
+ */
+
+#ifndef __GRACHT_TIME_H__
+#define __GRACHT_TIME_H__
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+
+static inline uint64_t gracht_time_ns(void)
+{
+    static LARGE_INTEGER frequency = { 0 };
+    LARGE_INTEGER        counter;
+
+    if (!frequency.QuadPart) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * (1000000000.0 / (double)frequency.QuadPart));
+}
+#else
+#include <time.h>
+
+static inline uint64_t gracht_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+#endif // !__GRACHT_TIME_H__
@@ -0,0 +1,70 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht MPMC Queue Type Definitions & Structures
+ * - This header describes the bounded lock-free queue used by the worker pool,
+ *   any thread may enqueue and any thread may dequeue, which allows idle workers
+ *   to steal from the queues of busy workers.
+ */
+
+#ifndef __GRACHT_MPMC_QUEUE_H__
+#define __GRACHT_MPMC_QUEUE_H__
+
+#include "gatomic.h"
+#include <stddef.h>
+
+struct gr_mpmc_cell {
+    atomic_size_t sequence;
+    void*         data;
+};
+
+struct gr_mpmc_queue {
+    struct gr_mpmc_cell* cells;
+    size_t               mask;
+    atomic_size_t        enqueue_index;
+    atomic_size_t        dequeue_index;
+};
+
+/**
+ * Returns the capacity a queue constructed with <capacity> will have. The capacity is rounded up
+ * to the nearest power of two, and is atleast two.
+ */
+size_t gr_mpmc_queue_capacity(unsigned int capacity);
+
+/**
+ * Constructs a new queue, the capacity is rounded up as described by gr_mpmc_queue_capacity.
+ */
+int    gr_mpmc_queue_construct(struct gr_mpmc_queue* queue, unsigned int capacity);
+void   gr_mpmc_queue_destroy(struct gr_mpmc_queue* queue);
+
+/**
+ * Enqueues a pointer, returns -1 and sets errno to ENOENT if the queue is full.
+ */
+int    gr_mpmc_queue_enqueue(struct gr_mpmc_queue* queue, void* pointer);
+
+/**
+ * Dequeues the oldest pointer, returns NULL and sets errno to ENOENT if the queue is empty.
+ */
+void*  gr_mpmc_queue_dequeue(struct gr_mpmc_queue* queue);
+
+/**
+ * Returns the number of queued elements. This is only a snapshot when other threads
+ * are using the queue at the same time.
+ */
+size_t gr_mpmc_queue_count(struct gr_mpmc_queue* queue);
+
+#endif // !__GRACHT_MPMC_QUEUE_H__
@@ -0,0 +1,87 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Outbound Queue Type Definitions & Structures
+ * - This header describes the shared message bodies used for broadcasting, and the
+ *   per-client queues that hold them until the reactor of the client can send them.
+ *   A broadcast is serialized once, and every queue it is pushed to holds a reference.
+ */
+
+#ifndef __GRACHT_OUTBOUND_QUEUE_H__
+#define __GRACHT_OUTBOUND_QUEUE_H__
+
+#include "gatomic.h"
+#include "thread_api.h"
+#include <stdint.h>
+
+struct gr_shared_message {
+    atomic_int references;
+    uint32_t   length;
+    char       data[];
+};
+
+/**
+ * Creates a copy of the serialized message with a single reference.
+ */
+struct gr_shared_message* gr_shared_message_create(const void* data, uint32_t length);
+void                      gr_shared_message_acquire(struct gr_shared_message* message);
+void                      gr_shared_message_release(struct gr_shared_message* message);
+
+// The queue is filled by broadcasting threads and drained by the reactor of the client. The
+// message at the front is marked busy while the reactor is sending it, so the drop policies
+// never discard a message that is partly on the wire. <scheduled> is set while the client is
+// waiting for the reactor, queues are created with <scheduled> set so the client is not handed
+// to the reactor before it is registered. <coalesced> counts the bytes of responses the link holds
+// for the client since it was last flushed.
+struct gr_outbound_queue {
+    mtx_t                      lock;
+    struct gr_shared_message** messages;
+    int                        head;
+    int                        count;
+    int                        capacity;
+    int                        policy;
+    int                        busy;
+    atomic_int                 scheduled;
+    atomic_uint                coalesced;
+};
+
+int  gr_outbound_queue_create(int capacity, int policy, struct gr_outbound_queue** queueOut);
+void gr_outbound_queue_destroy(struct gr_outbound_queue* queue);
+
+/**
+ * Adds a reference of the message to the queue, when the queue is full the policy of the queue
+ * decides which message is discarded. Returns the number of messages that were discarded.
+ */
+int gr_outbound_queue_push(struct gr_outbound_queue* queue, struct gr_shared_message* message);
+
+/**
+ * Returns the number of messages in the queue.
+ */
+int gr_outbound_queue_count(struct gr_outbound_queue* queue);
+
+/**
+ * Returns the message at the front of the queue and marks it busy, or NULL if the queue is empty.
+ * The queue keeps its reference, and the caller must finish with gr_outbound_queue_complete.
+ */
+struct gr_shared_message* gr_outbound_queue_front(struct gr_outbound_queue* queue);
+
+/**
+ * Clears the busy mark of the front message, and removes it from the queue if <sent> is set.
+ */
+void gr_outbound_queue_complete(struct gr_outbound_queue* queue, int sent);
+
+#endif // !__GRACHT_OUTBOUND_QUEUE_H__
@@ -0,0 +1,57 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Parker Type Definitions & Structures
+ * - A parker lets a single thread sleep until another thread unparks it. On linux
+ *   this is a futex word, on other platforms it falls back to a mutex and condition.
+ */
+
+#ifndef __GRACHT_PARKER_H__
+#define __GRACHT_PARKER_H__
+
+#include "gatomic.h"
+#include "thread_api.h"
+
+#if defined(__linux__)
+#define GRACHT_PARKER_FUTEX
+#endif
+
+struct gr_parker {
+    atomic_int state;
+#ifndef GRACHT_PARKER_FUTEX
+    mtx_t      lock;
+    cnd_t      signal;
+#endif
+};
+
+void gr_parker_init(struct gr_parker* parker);
+void gr_parker_destroy(struct gr_parker* parker);
+
+/**
+ * Parking is a two-step operation to avoid lost wakeups. The thread first announces that
+ * it will park, then checks for work a final time, and then either waits or cancels.
+ */
+void gr_parker_prepare(struct gr_parker* parker);
+void gr_parker_cancel(struct gr_parker* parker);
+void gr_parker_wait(struct gr_parker* parker);
+
+/**
+ * Wakes the parked thread, returns 1 if the thread was parked (or about to), otherwise 0.
+ */
+int  gr_parker_unpark(struct gr_parker* parker);
+
+#endif // !__GRACHT_PARKER_H__
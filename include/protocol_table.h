@@ -0,0 +1,92 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Protocol Table Type Definitions & Structures
+ * - This header describes the table of registered protocols. The table is a two-level
+ *   array indexed by protocol and action id, it is never modified once published. Any
+ *   registration builds a new table that replaces the current one with an atomic store,
+ *   so lookups need no locks.
+ */
+
+#ifndef __GRACHT_PROTOCOL_TABLE_H__
+#define __GRACHT_PROTOCOL_TABLE_H__
+
+#include "gatomic.h"
+#include "gracht/types.h"
+#include "thread_api.h"
+
+#define GR_PROTOCOL_TABLE_SIZE 256
+
+struct gr_protocol_entry {
+    struct gr_protocol_entry*   retired_next;
+    gracht_protocol_t           protocol;
+    gracht_protocol_function_t* actions[GR_PROTOCOL_TABLE_SIZE];
+};
+
+struct gr_protocol_snapshot {
+    struct gr_protocol_snapshot* retired_next;
+    struct gr_protocol_entry*    protocols[GR_PROTOCOL_TABLE_SIZE];
+};
+
+// Readers can still be using a table after it has been replaced, so replaced tables and
+// entries are kept until the protocol table is destroyed. Registrations are rare, so
+// this is only a small amount of memory.
+struct gr_protocol_table {
+    atomic_uintptr_t             current;
+    mtx_t                        lock;
+    struct gr_protocol_snapshot* retired_tables;
+    struct gr_protocol_entry*    retired_entries;
+};
+
+int  gr_protocol_table_construct(struct gr_protocol_table* table);
+void gr_protocol_table_destroy(struct gr_protocol_table* table);
+
+/**
+ * Registers a copy of the protocol, returns -1 and sets errno to EEXIST if a protocol
+ * with the same id is already registered.
+ */
+int  gr_protocol_table_add(struct gr_protocol_table* table, const gracht_protocol_t* protocol);
+
+/**
+ * Registers a copy of the protocol, replacing any protocol registered with the same id. The
+ * replacement is published at once, so lookups never find the protocol missing in between.
+ */
+int  gr_protocol_table_replace(struct gr_protocol_table* table, const gracht_protocol_t* protocol);
+
+/**
+ * Unregisters the protocol with the id of the given protocol, returns -1 and sets errno
+ * to ENOENT if it was not registered.
+ */
+int  gr_protocol_table_remove(struct gr_protocol_table* table, const gracht_protocol_t* protocol);
+
+/**
+ * Returns the registered protocol with the given id, or NULL if it is not registered.
+ */
+static inline const gracht_protocol_t* gr_protocol_table_get(struct gr_protocol_table* table, uint8_t protocolId)
+{
+    struct gr_protocol_snapshot* snapshot = (struct gr_protocol_snapshot*)atomic_load(&table->current);
+    struct gr_protocol_entry*    entry    = snapshot->protocols[protocolId];
+    return entry ? &entry->protocol : NULL;
+}
+
+/**
+ * Returns the function registered for the action, returns NULL and sets errno to ENOTSUP if
+ * either the protocol or the action is not implemented.
+ */
+gracht_protocol_function_t* gr_protocol_table_get_action(struct gr_protocol_table* table, uint8_t protocolId, uint8_t actionId);
+
+#endif // !__GRACHT_PROTOCOL_TABLE_H__
@@ -0,0 +1,94 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Receive Ring Type Definitions & Structures
+ * - This header describes the per-connection receive ring. Data is received directly
+ *   into the ring, and messages are handed out pointing to their data inside the ring.
+ *   The memory is mapped twice back-to-back, so data never wraps around the end of the ring.
+ */
+
+#ifndef __GRACHT_RECV_RING_H__
+#define __GRACHT_RECV_RING_H__
+
+#include "gatomic.h"
+#include "gracht/types.h"
+#include <stddef.h>
+
+struct gr_recv_ring;
+
+// Every message that is handed out occupies a slot until it is released. The slots
+// are released in any order, but the ring space is only reclaimed in order.
+struct gr_recv_ring_slot {
+    struct gracht_message message;
+    struct gr_recv_ring*  ring;
+    uint64_t              end;
+    atomic_int            busy;
+};
+
+// The positions are running counters, only the owning thread (reactor) modifies them. The
+// data in [head, parse) is in use by messages, [parse, tail) is received but not handed out.
+struct gr_recv_ring {
+    char*                     base;
+    size_t                    capacity;
+    uint64_t                  head;
+    uint64_t                  parse;
+    uint64_t                  tail;
+    struct gr_recv_ring_slot* slots;
+    unsigned int              slot_count;
+    unsigned int              slot_head;
+    unsigned int              slot_tail;
+    atomic_int                references;
+};
+
+/**
+ * Creates a new ring, the size is rounded up to the page size. Returns -1 and sets errno
+ * to ENOTSUP if the platform does not support mirrored mappings.
+ */
+int    gr_recv_ring_create(size_t size, unsigned int slotCount, struct gr_recv_ring** ringOut);
+
+/**
+ * Releases the reference of the owner, the ring is destroyed once all messages have been released.
+ */
+void   gr_recv_ring_put(struct gr_recv_ring* ring);
+
+/**
+ * Returns the contiguous free space at the end of the ring, after reclaiming space of released messages.
+ */
+size_t gr_recv_ring_space(struct gr_recv_ring* ring, char** spaceOut);
+
+/**
+ * Marks <length> bytes at the end of the ring as received.
+ */
+void   gr_recv_ring_produce(struct gr_recv_ring* ring, size_t length);
+
+/**
+ * Returns the number of received bytes that have not yet been handed out, and a pointer to them.
+ */
+size_t gr_recv_ring_peek(struct gr_recv_ring* ring, char** dataOut);
+
+/**
+ * Consumes <length> bytes that have been copied out of the ring.
+ */
+void   gr_recv_ring_consume(struct gr_recv_ring* ring, size_t length);
+
+/**
+ * Hands out the next <length> bytes as a message, the message must be released by invoking
+ * message->release. Returns NULL and sets errno to ENOSPC if all slots are in use.
+ */
+struct gracht_message* gr_recv_ring_take(struct gr_recv_ring* ring, size_t length);
+
+#endif //!__GRACHT_RECV_RING_H__
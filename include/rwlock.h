@@ -14,9 +14,13 @@
  * You should have received a copy of the GNU General Public License
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  *
- * Reader/Writer mutex implementation
- * It is a rather crude implementation of a read-write mutex that uses
- * a reader counter and a mutex/condition for synchronization.
+ *
+ * Reader/Writer lock implementation
+ * The lock maps to the native reader-writer lock of the platform, where taking
+ * the read lock is a single atomic operation when there is no writer. Platforms
+ * without one use the mutex based implementation, which uses a reader counter
+ * and a mutex/condition for synchronization.
+ * Read locks must not be nested, as waiting writers are given priority.
  */
 
 #ifndef __GRACHT_RWLOCK_H__
@@ -25,34 +29,38 @@
 #include "thread_api.h"
 #include <assert.h>
 
+#if defined(HAVE_PTHREAD)
+#include <pthread.h>
+#endif
+
 // taken from my other project vioarr
-struct rwlock {
+struct mtx_rwlock {
     mtx_t sync_object;
     int   readers;
     cnd_t signal;
 };
 
-static void rwlock_init(struct rwlock* lock)
+static inline void mtx_rwlock_init(struct mtx_rwlock* lock)
 {
     mtx_init(&lock->sync_object, mtx_plain);
     cnd_init(&lock->signal);
     lock->readers = 0;
 }
 
-static void rwlock_destroy(struct rwlock* lock)
+static inline void mtx_rwlock_destroy(struct mtx_rwlock* lock)
 {
     cnd_destroy(&lock->signal);
     mtx_destroy(&lock->sync_object);
 }
 
-static void rwlock_r_lock(struct rwlock* lock)
+static inline void mtx_rwlock_r_lock(struct mtx_rwlock* lock)
 {
     mtx_lock(&lock->sync_object);
     lock->readers++;
     mtx_unlock(&lock->sync_object);
 }
 
-static void rwlock_r_unlock(struct rwlock* lock)
+static inline void mtx_rwlock_r_unlock(struct mtx_rwlock* lock)
 {
     mtx_lock(&lock->sync_object);
     assert(lock->readers);
@@ -63,7 +71,7 @@ static void rwlock_r_unlock(struct rwlock* lock)
     mtx_unlock(&lock->sync_object);
 }
 
-static void rwlock_w_lock(struct rwlock* lock)
+static inline void mtx_rwlock_w_lock(struct mtx_rwlock* lock)
 {
     mtx_lock(&lock->sync_object);
     while (lock->readers) {
@@ -71,11 +79,104 @@ static void rwlock_w_lock(struct rwlock* lock)
     }
 }
 
-static void rwlock_w_unlock(struct rwlock* lock)
+static inline void mtx_rwlock_w_unlock(struct mtx_rwlock* lock)
 {
     mtx_unlock(&lock->sync_object);
     cnd_signal(&lock->signal);
 }
 
-#endif //! __GRACHT_RWLOCK_H__
+#if defined(HAVE_PTHREAD)
+// The default pthread lock prefers readers, which means a steady stream of readers can
+// keep a writer waiting forever. Writers are preferred where glibc supports it.
+struct rwlock {
+    pthread_rwlock_t native;
+};
+
+static inline void rwlock_init(struct rwlock* lock)
+{
+    pthread_rwlockattr_t attributes;
+
+    pthread_rwlockattr_init(&attributes);
+#if defined(__GLIBC__) && (defined(__USE_UNIX98) || defined(__USE_XOPEN2K))
+    pthread_rwlockattr_setkind_np(&attributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&lock->native, &attributes);
+    pthread_rwlockattr_destroy(&attributes);
+}
+
+static inline void rwlock_destroy(struct rwlock* lock)
+{
+    pthread_rwlock_destroy(&lock->native);
+}
 
+static inline void rwlock_r_lock(struct rwlock* lock)
+{
+    int status = pthread_rwlock_rdlock(&lock->native);
+    assert(status == 0);
+    (void)status;
+}
+
+static inline void rwlock_r_unlock(struct rwlock* lock)
+{
+    pthread_rwlock_unlock(&lock->native);
+}
+
+static inline void rwlock_w_lock(struct rwlock* lock)
+{
+    int status = pthread_rwlock_wrlock(&lock->native);
+    assert(status == 0);
+    (void)status;
+}
+
+static inline void rwlock_w_unlock(struct rwlock* lock)
+{
+    pthread_rwlock_unlock(&lock->native);
+}
+#elif defined(_WIN32)
+struct rwlock {
+    SRWLOCK native;
+};
+
+static inline void rwlock_init(struct rwlock* lock)
+{
+    InitializeSRWLock(&lock->native);
+}
+
+static inline void rwlock_destroy(struct rwlock* lock)
+{
+    (void)lock;
+}
+
+static inline void rwlock_r_lock(struct rwlock* lock)
+{
+    AcquireSRWLockShared(&lock->native);
+}
+
+static inline void rwlock_r_unlock(struct rwlock* lock)
+{
+    ReleaseSRWLockShared(&lock->native);
+}
+
+static inline void rwlock_w_lock(struct rwlock* lock)
+{
+    AcquireSRWLockExclusive(&lock->native);
+}
+
+static inline void rwlock_w_unlock(struct rwlock* lock)
+{
+    ReleaseSRWLockExclusive(&lock->native);
+}
+#else
+struct rwlock {
+    struct mtx_rwlock fallback;
+};
+
+#define rwlock_init(lock)      mtx_rwlock_init(&(lock)->fallback)
+#define rwlock_destroy(lock)   mtx_rwlock_destroy(&(lock)->fallback)
+#define rwlock_r_lock(lock)    mtx_rwlock_r_lock(&(lock)->fallback)
+#define rwlock_r_unlock(lock)  mtx_rwlock_r_unlock(&(lock)->fallback)
+#define rwlock_w_lock(lock)    mtx_rwlock_w_lock(&(lock)->fallback)
+#define rwlock_w_unlock(lock)  mtx_rwlock_w_unlock(&(lock)->fallback)
+#endif
+
+#endif //! __GRACHT_RWLOCK_H__
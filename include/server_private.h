@@ -42,10 +42,11 @@ typedef void (*server_invoke_t)(struct gracht_message*, struct gracht_buffer*);
  * 
  * @param server
  * @param numberOfWorkers The number of workers that should be in the pool
+ * @param queueDepth The number of messages that can be queued per worker, 0 for the default.
  * @param poolOut A pointer to storage for the worker pool.
  * @return int Returns 0 if creation was succesfull, otherwise errno is set.
  */
-int gracht_worker_pool_create(struct gracht_server* server, int numberOfWorkers, struct gracht_worker_pool** poolOut);
+int gracht_worker_pool_create(struct gracht_server* server, int numberOfWorkers, int queueDepth, struct gracht_worker_pool** poolOut);
 
 /**
  * Defined in dispatch.c
@@ -58,12 +59,26 @@ void gracht_worker_pool_destroy(struct gracht_worker_pool* pool);
 
 /**
  * Defined in dispatch.c
- * Dispatches the recieved message to a ready worker.
+ * Dispatches the recieved message to a ready worker. Idle workers will steal the message
+ * if the worker it was queued for is busy.
  * 
  * @param pool A pointer to the worker pool that was created earlier.
  * @param recvMessage A pointer to the recieved message.
+ * @return int Returns 0 if the message was queued, otherwise -1 and errno is set to ENOENT if all queues are full.
  */
-void gracht_worker_pool_dispatch(struct gracht_worker_pool* pool, struct gracht_message* recvMessage);
+int gracht_worker_pool_dispatch(struct gracht_worker_pool* pool, struct gracht_message* recvMessage);
+
+/**
+ * Defined in dispatch.c
+ * Dispatches the recieved message to the worker selected by the key. Messages dispatched with the same
+ * key are handled by the same worker in the order they were dispatched, and are never stolen by other workers.
+ * 
+ * @param pool A pointer to the worker pool that was created earlier.
+ * @param recvMessage A pointer to the recieved message.
+ * @param key The affinity key, usually the client the message was received from.
+ * @return int Returns 0 if the message was queued, otherwise -1 and errno is set to ENOENT if the queue is full.
+ */
+int gracht_worker_pool_dispatch_affinity(struct gracht_worker_pool* pool, struct gracht_message* recvMessage, uint64_t key);
 
 /**
  * Defined in server.c
@@ -83,4 +98,13 @@ void server_invoke_action(struct gracht_server* server, struct gracht_message* r
  */
 void server_cleanup_message(struct gracht_server* server, struct gracht_message* recvMessage);
 
+/**
+ * Defined in server.c
+ * Notifies the server that a worker has finished a message, and thus has capacity for more. This
+ * resumes any connections that were paused due to the worker queues being full.
+ * 
+ * @param server A pointer to the server the worker belongs to.
+ */
+void server_notify_capacity(struct gracht_server* server);
+
 #endif // !__SERVER_PRIVATE_H__
@@ -0,0 +1,69 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Subscriber Table Type Definitions & Structures
+ * - This header describes the per-protocol lists of subscribed clients that are used
+ *   when broadcasting events. Each list is protected by its own lock, and the table does
+ *   not track subscriptions itself, the owner decides which lists a client belongs to. The
+ *   list at GR_SUBSCRIBER_TABLE_ALL holds clients that are subscribed to all protocols.
+ */
+
+#ifndef __GRACHT_SUBSCRIBER_TABLE_H__
+#define __GRACHT_SUBSCRIBER_TABLE_H__
+
+#include "client_registry.h"
+#include "rwlock.h"
+
+#define GR_SUBSCRIBER_TABLE_ALL 0xFF
+
+struct gr_subscriber_list {
+    struct rwlock           lock;
+    struct gr_client_entry* entries;
+    int                     count;
+    int                     capacity;
+};
+
+struct gr_subscriber_table {
+    struct gr_subscriber_list lists[256];
+};
+
+typedef void (*gr_subscriber_table_enumfn)(struct gr_client_entry* entry, void* context);
+
+void gr_subscriber_table_construct(struct gr_subscriber_table* table);
+void gr_subscriber_table_destroy(struct gr_subscriber_table* table);
+
+/**
+ * Adds the client to the list of the protocol, returns -1 and sets errno to ENOMEM if the list
+ * could not grow. Adding a client that is already in the list is not checked.
+ */
+int gr_subscriber_table_add(struct gr_subscriber_table* table, uint8_t protocol, const struct gr_client_entry* entry);
+
+/**
+ * Removes the client from the list of the protocol, once this returns no enumeration of the list
+ * is using the entry anymore. Returns -1 and sets errno to ENOENT if the client was not in the list.
+ */
+int gr_subscriber_table_remove(struct gr_subscriber_table* table, uint8_t protocol, gracht_conn_t handle);
+
+/**
+ * Invokes the callback for all clients in the list of the protocol, and then for all clients in
+ * the GR_SUBSCRIBER_TABLE_ALL list. The callback is invoked with the read lock of the list held,
+ * possibly for several enumerations at once, so it must not block or modify the table.
+ */
+void gr_subscriber_table_enumerate(struct gr_subscriber_table* table, uint8_t protocol,
+    gr_subscriber_table_enumfn callback, void* context);
+
+#endif // !__GRACHT_SUBSCRIBER_TABLE_H__
@@ -36,13 +36,16 @@
 #if defined(HAVE_C11_THREADS) || defined(__VALI__)
 #include <threads.h>
 #elif defined(HAVE_PTHREAD)
+#include <errno.h>
 #include <pthread.h>
+#include <sched.h>
 
 typedef pthread_mutex_t mtx_t;
 typedef pthread_cond_t cnd_t;
 typedef pthread_t thrd_t;
 
-#define thrd_success 0
+#define thrd_success  0
+#define thrd_timedout ETIMEDOUT
 
 #define mtx_plain NULL
 
@@ -56,19 +59,26 @@ typedef pthread_t thrd_t;
 #define cnd_destroy   pthread_cond_destroy
 #define cnd_wait      pthread_cond_wait
 #define cnd_signal    pthread_cond_signal
+#define cnd_broadcast pthread_cond_broadcast
+#define cnd_timedwait pthread_cond_timedwait
 
 #define thrd_join(thr, ret)          pthread_join(thr, (void**)ret)
 #define thrd_create(thrp, func, arg) pthread_create(thrp, NULL, func, arg)
+#define thrd_yield                   sched_yield
+#define thrd_current                 pthread_self
+#define thrd_equal                   pthread_equal
 
 #elif defined(_WIN32)
 #include <windows.h>
+#include <time.h>
 
 typedef CRITICAL_SECTION mtx_t;
 typedef CONDITION_VARIABLE cnd_t;
 typedef HANDLE thrd_t;
 
-#define thrd_success 0
-#define thrd_error   -1
+#define thrd_success  0
+#define thrd_error    -1
+#define thrd_timedout -2
 
 #define mtx_plain NULL
 #define mtx_recursive NULL
@@ -109,12 +119,34 @@ static inline int cnd_signal(cnd_t* cnd)
     return thrd_success;
 }
 
+static inline int cnd_broadcast(cnd_t* cnd)
+{
+    WakeAllConditionVariable(cnd);
+    return thrd_success;
+}
+
 static inline int cnd_wait(cnd_t* cnd, mtx_t* mtx)
 {
     BOOL status = SleepConditionVariableCS(cnd, mtx, INFINITE);
     return status == TRUE ? thrd_success : thrd_error;
 }
 
+// the timeout is absolute and based on TIME_UTC like the C11 version
+static inline int cnd_timedwait(cnd_t* cnd, mtx_t* mtx, const struct timespec* ts)
+{
+    struct timespec now;
+    long long       ms;
+    BOOL            status;
+
+    timespec_get(&now, TIME_UTC);
+    ms = ((long long)(ts->tv_sec - now.tv_sec) * 1000LL) + ((ts->tv_nsec - now.tv_nsec) / 1000000L);
+    status = SleepConditionVariableCS(cnd, mtx, ms > 0 ? (DWORD)ms : 0);
+    if (status == TRUE) {
+        return thrd_success;
+    }
+    return GetLastError() == ERROR_TIMEOUT ? thrd_timedout : thrd_error;
+}
+
 static inline int thrd_create(thrd_t* thrp, int (*start)(void*), void* arg) {
     thrd_t thr = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)start, arg, 0, NULL);
     if (thr == NULL) {
@@ -124,6 +156,10 @@ static inline int thrd_create(thrd_t* thrp, int (*start)(void*), void* arg) {
     return 0;
 }
 
+static inline void thrd_yield(void) {
+    SwitchToThread();
+}
+
 static inline int thrd_join(thrd_t thrp, int* exitCode) {
     BOOL status;
     WaitForSingleObject(thrp, INFINITE);
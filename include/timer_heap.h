@@ -0,0 +1,71 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Timer Heap Type Definitions & Structures
+ * - This header describes the binary min-heap used to track deadlines, the
+ *   heap is not thread-safe and must be protected by the owner. Entries are
+ *   never removed early, instead owners skip entries that are no longer valid
+ *   when they expire, and filter the heap when too many stale entries remain.
+ */
+
+#ifndef __GRACHT_TIMER_HEAP_H__
+#define __GRACHT_TIMER_HEAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct gr_timer_entry {
+    uint64_t deadline;
+    uint64_t id;
+};
+
+struct gr_timer_heap {
+    struct gr_timer_entry* entries;
+    size_t                 count;
+    size_t                 capacity;
+};
+
+typedef int (*gr_timer_heap_filter_fn)(const struct gr_timer_entry* entry, void* context);
+
+void gr_timer_heap_construct(struct gr_timer_heap* heap);
+void gr_timer_heap_destroy(struct gr_timer_heap* heap);
+
+/**
+ * Adds a new deadline to the heap, returns -1 and sets errno to ENOMEM if the heap could not grow.
+ */
+int  gr_timer_heap_push(struct gr_timer_heap* heap, uint64_t deadline, uint64_t id);
+
+/**
+ * Removes the entry with the earliest deadline if that deadline is at or before <now>. Returns -1
+ * and sets errno to ENOENT if no entries have expired.
+ */
+int  gr_timer_heap_pop_expired(struct gr_timer_heap* heap, uint64_t now, struct gr_timer_entry* entryOut);
+
+/**
+ * Removes all entries for which <keep> returns 0.
+ */
+void gr_timer_heap_filter(struct gr_timer_heap* heap, gr_timer_heap_filter_fn keep, void* context);
+
+/**
+ * Returns the earliest deadline in the heap, or 0 if the heap is empty.
+ */
+static inline uint64_t gr_timer_heap_next(struct gr_timer_heap* heap)
+{
+    return heap->count ? heap->entries[0].deadline : 0;
+}
+
+#endif // !__GRACHT_TIMER_HEAP_H__
@@ -60,19 +60,11 @@ struct gracht_link {
 #define GB_MSG_AID(buffer) *((uint8_t*)(&((buffer)->data[(buffer)->index + MSG_INDEX_AID])))
 #define GB_MSG_FLG(buffer) *((uint8_t*)(&((buffer)->data[(buffer)->index + MSG_INDEX_FLG])))
 
-gracht_protocol_function_t* get_protocol_action(gr_hashtable_t* protocols, uint8_t protocol_id, uint8_t action_id);
-
-static uint64_t protocol_hash(const void* element)
-{
-    const struct gracht_protocol* protocol = element;
-    return protocol->id;
-}
-
-static int protocol_cmp(const void* element1, const void* element2)
-{
-    const struct gracht_protocol* protocol1 = element1;
-    const struct gracht_protocol* protocol2 = element2;
-    return protocol1->id == protocol2->id ? 0 : 1;
-}
+// Helpers for messages that are sent with segments, implemented in shared.c. The message length
+// covers both the message buffer and all segments.
+uint32_t gr_message_segments_length(const struct gracht_message_segments* segments);
+int      gr_message_segments_vectors(struct gracht_buffer* message, const struct gracht_message_segments* segments,
+                                     struct gracht_iovec* vectors);
+void     gr_message_segments_flatten(struct gracht_buffer* message, const struct gracht_message_segments* segments);
 
 #endif // !__GRACHT_UTILS_H__
@@ -0,0 +1,274 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Slot-indexed table of outstanding calls. Slots are allocated in chunks that are
+ * never freed until the table is destroyed, so a slot can always be locked safely
+ * even if the call it held is long gone, the id is then simply no longer a match.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "call_table.h"
+
+#define SLOT_HEADER_SIZE (((sizeof(struct gr_call_slot) + 15) / 16) * 16)
+
+// the free stack head stores the index + 1 of the top slot in the lower bits, and
+// a tag in the upper bits that changes on every update to avoid ABA problems
+#define FREE_INDEX(head) ((size_t)(head) & GR_CALL_TABLE_INDEX_MASK)
+#define FREE_TAG(head)   ((size_t)(head) & ~(size_t)GR_CALL_TABLE_INDEX_MASK)
+#define FREE_TAG_STEP    ((size_t)1 << GR_CALL_TABLE_INDEX_BITS)
+
+struct gr_call_slot {
+    mtx_t         lock;
+    uint32_t      id;
+    uint32_t      generation;
+    atomic_size_t next;
+};
+
+static inline struct gr_call_slot* __get_slot(struct gr_call_table* table, size_t index)
+{
+    uint8_t* chunk = (uint8_t*)atomic_load(&table->chunks[index / GR_CALL_TABLE_CHUNK_SIZE]);
+    if (!chunk) {
+        return NULL;
+    }
+    return (struct gr_call_slot*)(chunk + ((index % GR_CALL_TABLE_CHUNK_SIZE) * table->slot_size));
+}
+
+static inline void* __slot_element(struct gr_call_slot* slot)
+{
+    return (uint8_t*)slot + SLOT_HEADER_SIZE;
+}
+
+static inline struct gr_call_slot* __element_slot(void* element)
+{
+    return (struct gr_call_slot*)((uint8_t*)element - SLOT_HEADER_SIZE);
+}
+
+void gr_call_table_construct(struct gr_call_table* table, size_t elementSize)
+{
+    size_t i;
+
+    table->element_size = elementSize;
+    table->slot_size    = SLOT_HEADER_SIZE + (((elementSize + 15) / 16) * 16);
+    for (i = 0; i < GR_CALL_TABLE_MAX_CHUNKS; i++) {
+        atomic_store(&table->chunks[i], (uintptr_t)0);
+    }
+    atomic_store(&table->slot_count, 0);
+    atomic_store(&table->free_head, 0);
+    atomic_store(&table->active_count, 0);
+    mtx_init(&table->grow_lock, mtx_plain);
+}
+
+void gr_call_table_destroy(struct gr_call_table* table)
+{
+    size_t i;
+
+    for (i = 0; i < GR_CALL_TABLE_MAX_CHUNKS; i++) {
+        uint8_t* chunk = (uint8_t*)atomic_load(&table->chunks[i]);
+        size_t   j;
+
+        if (!chunk) {
+            continue;
+        }
+
+        for (j = 0; j < GR_CALL_TABLE_CHUNK_SIZE; j++) {
+            mtx_destroy(&((struct gr_call_slot*)(chunk + (j * table->slot_size)))->lock);
+        }
+        free(chunk);
+        atomic_store(&table->chunks[i], (uintptr_t)0);
+    }
+    mtx_destroy(&table->grow_lock);
+}
+
+static struct gr_call_slot* __pop_free(struct gr_call_table* table, size_t* indexOut)
+{
+    size_t head = atomic_load(&table->free_head);
+
+    while (FREE_INDEX(head)) {
+        struct gr_call_slot* slot = __get_slot(table, FREE_INDEX(head) - 1);
+        size_t               next = atomic_load(&slot->next);
+
+        // the slot might have been popped and pushed again since we read the head, in
+        // which case the tag has changed and the exchange fails
+        if (atomic_compare_exchange_strong(&table->free_head, &head, (FREE_TAG(head) + FREE_TAG_STEP) | next)) {
+            *indexOut = FREE_INDEX(head) - 1;
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static void __push_free(struct gr_call_table* table, struct gr_call_slot* slot, size_t index)
+{
+    size_t head = atomic_load(&table->free_head);
+
+    do {
+        atomic_store(&slot->next, FREE_INDEX(head));
+    } while (!atomic_compare_exchange_strong(&table->free_head, &head,
+        (FREE_TAG(head) + FREE_TAG_STEP) | (index + 1)));
+}
+
+// Adds a chunk of slots to the table and returns its first slot, the rest of the slots are
+// put on the free stack. The chunk is allocated before any of its indices are handed out,
+// so a failed allocation leaves nothing to undo.
+static struct gr_call_slot* __grow(struct gr_call_table* table, size_t* indexOut)
+{
+    struct gr_call_slot* slot;
+    size_t               count;
+    size_t               last;
+    size_t               i;
+    uint8_t*             chunk;
+
+    mtx_lock(&table->grow_lock);
+
+    // the table may have grown while we were waiting for the lock
+    slot = __pop_free(table, indexOut);
+    if (slot) {
+        mtx_unlock(&table->grow_lock);
+        return slot;
+    }
+
+    count = atomic_load(&table->slot_count);
+    if (count >= GR_CALL_TABLE_MAX_SLOTS) {
+        mtx_unlock(&table->grow_lock);
+        return NULL;
+    }
+
+    chunk = calloc(GR_CALL_TABLE_CHUNK_SIZE, table->slot_size);
+    if (!chunk) {
+        mtx_unlock(&table->grow_lock);
+        return NULL;
+    }
+
+    for (i = 0; i < GR_CALL_TABLE_CHUNK_SIZE; i++) {
+        mtx_init(&((struct gr_call_slot*)(chunk + (i * table->slot_size)))->lock, mtx_plain);
+    }
+    atomic_store(&table->chunks[count / GR_CALL_TABLE_CHUNK_SIZE], (uintptr_t)chunk);
+
+    // the chunk must be published before its indices are, lookups only check the count
+    last = count + GR_CALL_TABLE_CHUNK_SIZE;
+    if (last > GR_CALL_TABLE_MAX_SLOTS) {
+        last = GR_CALL_TABLE_MAX_SLOTS;
+    }
+    atomic_store(&table->slot_count, last);
+    for (i = last - 1; i > count; i--) {
+        __push_free(table, __get_slot(table, i), i);
+    }
+    mtx_unlock(&table->grow_lock);
+
+    *indexOut = count;
+    return __get_slot(table, count);
+}
+
+void* gr_call_table_acquire(struct gr_call_table* table, uint32_t* idOut)
+{
+    struct gr_call_slot* slot;
+    size_t               index;
+
+    if (!table || !idOut) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    slot = __pop_free(table, &index);
+    if (!slot) {
+        slot = __grow(table, &index);
+        if (!slot) {
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    // generation 0 is reserved for ids that are not backed by a slot
+    mtx_lock(&slot->lock);
+    slot->generation = (slot->generation + 1) & (0xFFFFFFFFU >> GR_CALL_TABLE_INDEX_BITS);
+    if (!slot->generation) {
+        slot->generation = 1;
+    }
+    slot->id = (slot->generation << GR_CALL_TABLE_INDEX_BITS) | (uint32_t)index;
+    memset(__slot_element(slot), 0, table->element_size);
+    atomic_fetch_add(&table->active_count, 1);
+
+    *idOut = slot->id;
+    return __slot_element(slot);
+}
+
+void* gr_call_table_lock(struct gr_call_table* table, uint32_t id)
+{
+    struct gr_call_slot* slot;
+    size_t               index = id & GR_CALL_TABLE_INDEX_MASK;
+
+    if (!GR_CALL_TABLE_ID_IS_SLOT(id) || index >= atomic_load(&table->slot_count)) {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    slot = __get_slot(table, index);
+    if (!slot) {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    mtx_lock(&slot->lock);
+    if (slot->id != id) {
+        mtx_unlock(&slot->lock);
+        errno = ENOENT;
+        return NULL;
+    }
+    return __slot_element(slot);
+}
+
+void gr_call_table_unlock(struct gr_call_table* table, void* element)
+{
+    (void)table;
+    mtx_unlock(&__element_slot(element)->lock);
+}
+
+void gr_call_table_release(struct gr_call_table* table, void* element)
+{
+    struct gr_call_slot* slot  = __element_slot(element);
+    size_t               index = slot->id & GR_CALL_TABLE_INDEX_MASK;
+
+    slot->id = 0;
+    atomic_fetch_sub(&table->active_count, 1);
+    mtx_unlock(&slot->lock);
+    __push_free(table, slot, index);
+}
+
+void gr_call_table_enumerate(struct gr_call_table* table, gr_call_table_enum_fn enumFn, void* context)
+{
+    size_t slotCount = atomic_load(&table->slot_count);
+    size_t i;
+
+    if (slotCount > GR_CALL_TABLE_MAX_SLOTS) {
+        slotCount = GR_CALL_TABLE_MAX_SLOTS;
+    }
+
+    for (i = 0; i < slotCount; i++) {
+        struct gr_call_slot* slot = __get_slot(table, i);
+        if (!slot) {
+            continue;
+        }
+
+        mtx_lock(&slot->lock);
+        if (slot->id) {
+            enumFn(slot->id, __slot_element(slot), context);
+        }
+        mtx_unlock(&slot->lock);
+    }
+}
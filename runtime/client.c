@@ -24,15 +24,21 @@
 #include "gracht/client.h"
 #include "client_private.h"
 #include "buffer_pool.h"
+#include "call_table.h"
 #include "stream_pool_registry.h"
+#include "gtime.h"
 #include "hashtable.h"
 #include "logging.h"
+#include "mpmc_queue.h"
+#include "protocol_table.h"
 #include "thread_api.h"
+#include "timer_heap.h"
 #include "control.h"
 #include "utils.h"
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 // Memory requirements of the client
 // On sending:
@@ -45,7 +51,7 @@ struct gracht_message_awaiter {
     unsigned int  flags;
     cnd_t         event;
     mtx_t         mutex;
-    int           current_count;
+    atomic_int    current_count;
     int           count;
 };
 
@@ -54,20 +60,35 @@ struct gracht_message_awaiter_entry {
     struct gracht_message_awaiter* awaiter;
 };
 
+// calls with a completion handler are completed from the receive path instead of being awaited
+struct gracht_message_completion {
+    gracht_client_completion_fn handler;
+    void*                       callback;
+    void*                       context;
+};
+
 // descriptor | message | params
 struct gracht_message_descriptor {
-    uint32_t        id;
-    int             status;
-    uint32_t        awaiter_id;
-    int             stream_buffer;
-    uint32_t        response_buffer_size;
-    gracht_buffer_t buffer;
+    int                              status;
+    uint32_t                         awaiter_id;
+    int                              stream_buffer;
+    uint32_t                         response_buffer_size;
+    uint64_t                         deadline;
+    int                              error;
+    struct gracht_message_completion completion;
+    gracht_buffer_t                  buffer;
+
+    // calls invoked with a destination have their response field received straight into
+    // it, the count that prefixes the field is kept here
+    void*                            destination;
+    uint32_t                         destination_size;
+    uint32_t                         destination_count;
 };
 
 typedef struct gracht_client {
     gracht_conn_t        iod;
-    uint32_t             current_message_id;
-    uint32_t             current_awaiter_id;
+    atomic_uint          current_message_id;
+    atomic_uint          current_awaiter_id;
     struct gracht_link*  link;
     struct gracht_buffer_pool* recv_pool;
     int                  max_message_size;
@@ -76,17 +97,89 @@ typedef struct gracht_client {
     void*                send_buffer;
     mtx_t                send_buffer_lock;
     int                  free_send_buffer;
+    
+    // when multiple send buffers are configured, the free buffers are kept in a lock-free
+    // queue and only the writes to the link are serialized by the send lock
+    int                  send_buffer_count;
+    void*                send_buffer_storage;
+    struct gr_mpmc_queue send_buffers;
+    atomic_int           send_buffer_waiters;
+    cnd_t                send_buffer_signal;
+    mtx_t                send_lock;
     mtx_t                stream_pools_lock;
     struct gracht_stream_pool_registry stream_send_pools;
     struct gracht_stream_pool_registry stream_recv_pools;
-    gr_hashtable_t       protocols;
-    gr_hashtable_t       messages;
-    mtx_t                messages_lock;
+    struct gr_protocol_table protocols;
+
+    // outstanding calls are kept in slots that are indexed by the message id, so
+    // responses only lock the slot of the call they complete
+    struct gr_call_table messages;
+
+    // number of outstanding calls with a destination, responses are only peeked for
+    // a destination while there are any
+    atomic_int           destination_calls;
+
+    // deadlines of the outstanding calls, protected by the timers lock
+    struct gr_timer_heap timers;
+    mtx_t                timers_lock;
+    uint32_t             call_timeout_ms;
     gr_hashtable_t       awaiters;
     mtx_t                awaiters_lock;
     mtx_t                wait_lock;
+
+    // the optional receive thread handles all incoming messages, callers only wait for it
+    int                  receiver_enabled;
+    thrd_t               receiver;
+    atomic_int           receiver_state;
+    atomic_int           receiver_waiters;
+    unsigned int         receiver_sequence;
+    cnd_t                receiver_signal;
+    mtx_t                receiver_lock;
+
+    // set for the handle of a client pool, which has none of the above
+    struct gracht_client_pool* pool;
 } gracht_client_t;
 
+// a batch of serialized messages that have not been sent yet, and the contexts of all
+// the calls that were added since the batch was reset
+struct gracht_client_batch_entry {
+    size_t                         offset;
+    struct gracht_message_context* context;
+    int                            sync;
+};
+
+struct gracht_client_batch {
+    gracht_client_t*                  client;
+    char*                             data;
+    size_t                            capacity;
+    size_t                            used;
+    struct gracht_client_batch_entry* entries;
+    int                               entry_count;
+    int                               entry_capacity;
+    struct gracht_message_context**   contexts;
+    int                               context_count;
+    int                               context_capacity;
+};
+
+#define GRACHT_CLIENT_BATCH_DEFAULT_MESSAGES 16
+
+// call options only apply to the next call the thread invokes on the client
+static __TLS_VAR gracht_client_t* g_callOptionsClient = NULL;
+static __TLS_VAR uint32_t         g_callTimeoutMs     = 0;
+
+// the connection of a pool that the thread got a buffer from, the generated functions always
+// use the buffer for the next call on the same handle
+static __TLS_VAR gracht_client_t* g_pooledHandle     = NULL;
+static __TLS_VAR gracht_client_t* g_pooledClient     = NULL;
+static __TLS_VAR uint32_t         g_pooledConnection = 0;
+
+enum gracht_receiver_state {
+    RECEIVER_NONE = 0,
+    RECEIVER_RUNNING,
+    RECEIVER_STOPPING,
+    RECEIVER_STOPPED
+};
+
 #define MESSAGE_STATUS_EXECUTED(status) (status == GRACHT_MESSAGE_ERROR || status == GRACHT_MESSAGE_COMPLETED)
 
 // api we export to generated files
@@ -98,74 +191,354 @@ GRACHTAPI int gracht_client_status_finalize(gracht_client_t* client, struct grac
 GRACHTAPI int gracht_client_invoke(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*);
 GRACHTAPI int gracht_client_invoke_stream(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*);
 GRACHTAPI int gracht_client_invoke_stream_sized(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*, uint32_t);
+GRACHTAPI int gracht_client_invoke_segments(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*, struct gracht_message_segments*);
+GRACHTAPI int gracht_client_invoke_stream_segments(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*, uint32_t, struct gracht_message_segments*);
+GRACHTAPI int gracht_client_invoke_callback(gracht_client_t*, gracht_buffer_t*, gracht_client_completion_fn, void*, void*);
+GRACHTAPI int gracht_client_invoke_into(gracht_client_t*, struct gracht_message_context*, gracht_buffer_t*, void*, uint32_t);
+GRACHTAPI int gracht_client_get_destination_status(gracht_client_t*, struct gracht_message_context*, uint32_t*);
+GRACHTAPI int gracht_client_batch_get_buffer(gracht_client_batch_t*, gracht_buffer_t*);
+GRACHTAPI int gracht_client_batch_add(gracht_client_batch_t*, struct gracht_message_context*, gracht_buffer_t*);
 
 // static methods
 static uint32_t get_message_id(gracht_client_t*);
 static uint32_t get_awaiter_id(gracht_client_t*);
 static void     mark_awaiters(gracht_client_t*, uint32_t);
-static uint64_t message_hash(const void* element);
-static int      message_cmp(const void* element1, const void* element2);
 static uint64_t awaiter_hash(const void* element);
 static int      awaiter_cmp(const void* element1, const void* element2);
 static int      protocol_uses_stream_pool(gracht_client_t*, uint8_t);
 
+static void __pooled_bind(gracht_client_t* handle, gracht_client_t* client, uint32_t connection)
+{
+    g_pooledHandle     = handle;
+    g_pooledClient     = client;
+    g_pooledConnection = connection;
+}
+
+// Takes the connection that the buffer of the call was acquired from, the call options
+// set for the handle apply to the connection instead
+static gracht_client_t* __pooled_take(gracht_client_t* handle, uint32_t* connectionOut)
+{
+    gracht_client_t* client = g_pooledClient;
+
+    if (g_pooledHandle != handle) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (g_callOptionsClient == handle) {
+        g_callOptionsClient = client;
+    }
+    *connectionOut = g_pooledConnection;
+    __pooled_bind(NULL, NULL, 0);
+    return client;
+}
+
+static void __release_send_buffer(gracht_client_t* client, void* buffer)
+{
+    if (client->send_buffer_count <= 1) {
+        mtx_unlock(&client->send_buffer_lock);
+        return;
+    }
+
+    gr_mpmc_queue_enqueue(&client->send_buffers, buffer);
+    if (atomic_load(&client->send_buffer_waiters)) {
+        mtx_lock(&client->send_buffer_lock);
+        cnd_signal(&client->send_buffer_signal);
+        mtx_unlock(&client->send_buffer_lock);
+    }
+}
+
+// Frees the slot of a call, the slot must be locked
+static void __release_call(gracht_client_t* client, struct gracht_message_descriptor* descriptor)
+{
+    if (descriptor->destination) {
+        atomic_fetch_sub(&client->destination_calls, 1);
+    }
+    gr_call_table_release(&client->messages, descriptor);
+}
+
+static int __keep_timer(const struct gr_timer_entry* timer, void* context)
+{
+    gracht_client_t*                  client = context;
+    struct gracht_message_descriptor* descriptor;
+    int                               keep;
+
+    descriptor = gr_call_table_lock(&client->messages, (uint32_t)timer->id);
+    if (!descriptor) {
+        return 0;
+    }
+    keep = descriptor->status == GRACHT_MESSAGE_INPROGRESS && descriptor->deadline == timer->deadline;
+    gr_call_table_unlock(&client->messages, descriptor);
+    return keep;
+}
+
 static int __add_message(
         gracht_client_t*                   client,
     struct gracht_message_context*     context,
     int                                streamBuffer,
-    uint32_t                           responseBufferSize)
+    uint32_t                           responseBufferSize,
+    uint64_t                           deadline,
+    const struct gracht_message_completion* completion,
+    uint32_t*                          messageIdOut)
 {
-    struct gracht_message_descriptor entry = { 0 };
+    struct gracht_message_descriptor* descriptor;
+    uint32_t                          messageId;
     if (context == NULL) {
         errno = EINVAL;
         return -1;
     }
 
-    entry.id = context->message_id;
-    entry.status = GRACHT_MESSAGE_INPROGRESS;
-    entry.stream_buffer = streamBuffer;
-    entry.response_buffer_size = responseBufferSize;
+    // the id of the message is decided by the slot it is stored in
+    descriptor = gr_call_table_acquire(&client->messages, &messageId);
+    if (!descriptor) {
+        GRERROR(GRSTR("gracht_client: too many outstanding calls"));
+        return -1;
+    }
 
-    mtx_lock(&client->messages_lock);
-    gr_hashtable_set(&client->messages, &entry);
-    mtx_unlock(&client->messages_lock);
+    descriptor->status = GRACHT_MESSAGE_INPROGRESS;
+    descriptor->stream_buffer = streamBuffer;
+    descriptor->response_buffer_size = responseBufferSize;
+    descriptor->deadline = deadline;
+    if (completion) {
+        descriptor->completion = *completion;
+    }
+    gr_call_table_unlock(&client->messages, descriptor);
+
+    if (deadline) {
+        mtx_lock(&client->timers_lock);
+        // timers of completed calls are left in the heap until they expire, so get rid
+        // of them once they start to outnumber the outstanding calls
+        if (client->timers.count > ((size_t)gr_call_table_count(&client->messages) * 2) + 64) {
+            gr_timer_heap_filter(&client->timers, __keep_timer, client);
+        }
+        if (gr_timer_heap_push(&client->timers, deadline, messageId)) {
+            GRWARNING(GRSTR("gracht_client: failed to add deadline for message %u"), messageId);
+        }
+        mtx_unlock(&client->timers_lock);
+    }
+    *messageIdOut = messageId;
     return 0;
 }
 
+// Frees the locked call and invokes its completion handler, the call is freed first so the
+// handler can invoke new calls on the client
+static void __complete_message(
+        gracht_client_t*                  client,
+        struct gracht_message_descriptor* descriptor,
+        int                               status,
+        struct gracht_buffer*             response)
+{
+    struct gracht_message_completion completion = descriptor->completion;
+    int                              error      = descriptor->error;
+
+    __release_call(client, descriptor);
+    if (status == GRACHT_MESSAGE_ERROR && error) {
+        errno = error;
+    }
+    completion.handler(client, status, response, completion.callback, completion.context);
+}
+
+// Fails all calls whose deadline has passed, the timers lock is not held while the calls
+// are failed, as completion handlers may invoke new calls
+static void __expire_messages(gracht_client_t* client)
+{
+    struct gr_timer_entry timer;
+    uint64_t              now;
+    int                   status;
+
+    mtx_lock(&client->timers_lock);
+    if (!gr_timer_heap_next(&client->timers)) {
+        mtx_unlock(&client->timers_lock);
+        return;
+    }
+    mtx_unlock(&client->timers_lock);
+
+    now = gracht_time_ns();
+    while (1) {
+        struct gracht_message_descriptor* descriptor;
+        uint32_t                          awaiterID;
+
+        mtx_lock(&client->timers_lock);
+        status = gr_timer_heap_pop_expired(&client->timers, now, &timer);
+        mtx_unlock(&client->timers_lock);
+        if (status) {
+            break;
+        }
+
+        descriptor = gr_call_table_lock(&client->messages, (uint32_t)timer.id);
+        if (!descriptor) {
+            continue;
+        }
+
+        if (descriptor->status != GRACHT_MESSAGE_INPROGRESS || descriptor->deadline != timer.deadline) {
+            gr_call_table_unlock(&client->messages, descriptor);
+            continue;
+        }
+
+        GRTRACE(GRSTR("gracht_client: message %u timed out"), (uint32_t)timer.id);
+        descriptor->status = GRACHT_MESSAGE_ERROR;
+        descriptor->error  = ETIMEDOUT;
+        if (descriptor->completion.handler) {
+            __complete_message(client, descriptor, GRACHT_MESSAGE_ERROR, NULL);
+            continue;
+        }
+
+        awaiterID = descriptor->awaiter_id;
+        gr_call_table_unlock(&client->messages, descriptor);
+        mark_awaiters(client, awaiterID);
+    }
+}
+
+static uint64_t __next_deadline(gracht_client_t* client)
+{
+    uint64_t deadline;
+
+    mtx_lock(&client->timers_lock);
+    deadline = gr_timer_heap_next(&client->timers);
+    mtx_unlock(&client->timers_lock);
+    return deadline;
+}
+
+static uint32_t __take_call_timeout(gracht_client_t* client)
+{
+    if (g_callOptionsClient == client) {
+        g_callOptionsClient = NULL;
+        return g_callTimeoutMs;
+    }
+    return client->call_timeout_ms;
+}
+
+// Appends the time left of the call, so the server can skip calls that have expired
+static void __append_deadline(gracht_client_t* client, struct gracht_buffer* message, uint32_t timeoutMs)
+{
+    if (message->index + GRACHT_MESSAGE_DEADLINE_SIZE > (uint32_t)client->max_message_size) {
+        return;
+    }
+
+    memcpy(&message->data[message->index], &timeoutMs, sizeof(uint32_t));
+    message->index += GRACHT_MESSAGE_DEADLINE_SIZE;
+    GB_MSG_FLG_0(message) |= MESSAGE_FLAG_DEADLINE;
+}
+
 static void __remove_message(
         gracht_client_t*                   client,
         struct gracht_message_context*     context)
 {
+    struct gracht_message_descriptor* descriptor;
+
     if (context == NULL) {
         return;
     }
 
-    mtx_lock(&client->messages_lock);
-    gr_hashtable_remove(&client->messages,
-                     &(struct gracht_message_descriptor) {
-        .id = context->message_id
-    });
-    mtx_unlock(&client->messages_lock);
+    descriptor = gr_call_table_lock(&client->messages, context->message_id);
+    if (descriptor) {
+        __release_call(client, descriptor);
+    }
 }
 
 static int protocol_uses_stream_pool(gracht_client_t* client, uint8_t protocolId)
 {
-    struct gracht_protocol* protocol;
-
-    protocol = gr_hashtable_get(&client->protocols, &(struct gracht_protocol){ .id = protocolId });
+    const gracht_protocol_t* protocol = gr_protocol_table_get(&client->protocols, protocolId);
     return protocol && (protocol->flags & GRACHT_PROTOCOL_FLAG_STREAM);
 }
 
+// Registers the call and fills in the id and length of a serialized message
+static int __prepare_message(
+        gracht_client_t*               client,
+        struct gracht_message_context* context,
+        struct gracht_buffer*          message,
+        int                            streamBuffer,
+        uint32_t                       responseBufferSize,
+        const struct gracht_message_completion* completion,
+        const struct gracht_message_segments*   segments)
+{
+    uint32_t messageID;
+    uint32_t timeoutMs;
+    uint64_t deadline = 0;
+
+    // only calls that expect a response can time out, the size of stream buffers are
+    // not known here, so stream calls only expire locally
+    timeoutMs = __take_call_timeout(client);
+    if (timeoutMs && context && MESSAGE_FLAG_TYPE(GB_MSG_FLG_0(message)) == MESSAGE_FLAG_SYNC) {
+        deadline = gracht_time_ns() + ((uint64_t)timeoutMs * 1000000ULL);
+        if (!streamBuffer) {
+            __append_deadline(client, message, timeoutMs);
+        }
+    }
+
+    // require intermediate buffer for sync operations, which also decides the id
+    if (MESSAGE_FLAG_TYPE(GB_MSG_FLG_0(message)) == MESSAGE_FLAG_SYNC) {
+        if (__add_message(client, context, streamBuffer, responseBufferSize, deadline, completion, &messageID)) {
+            return -1;
+        }
+    } else {
+        messageID = get_message_id(client);
+    }
+
+    // fill in some message details
+    GB_MSG_ID_0(message)  = messageID;
+    GB_MSG_LEN_0(message) = message->index + gr_message_segments_length(segments);
+
+    // store a copy of the message id if the context was provided.
+    if (context) {
+        context->message_id = messageID;
+    }
+    return 0;
+}
+
+static int __send_link(
+        gracht_client_t*                      client,
+        struct gracht_message_context*        context,
+        struct gracht_buffer*                 message,
+        const struct gracht_message_segments* segments)
+{
+    struct gracht_iovec vectors[GRACHT_LINK_MAX_VECTORS];
+    int                 count;
+
+    if (!segments || !segments->count) {
+        return client->link->ops.client.send(client->link, message, context);
+    }
+
+    // links that cannot send from segments get the message in one piece, the buffer was
+    // acquired with room for the entire message
+    if (!client->link->ops.client.send_vectored) {
+        gr_message_segments_flatten(message, segments);
+        return client->link->ops.client.send(client->link, message, context);
+    }
+
+    count = gr_message_segments_vectors(message, segments, &vectors[0]);
+    return client->link->ops.client.send_vectored(client->link, &vectors[0], count, context);
+}
+
+static int __send_message(
+        gracht_client_t*                      client,
+        struct gracht_message_context*        context,
+        struct gracht_buffer*                 message,
+        const struct gracht_message_segments* segments)
+{
+    int status;
+
+    if (client->send_buffer_count > 1) {
+        mtx_lock(&client->send_lock);
+        status = __send_link(client, context, message, segments);
+        mtx_unlock(&client->send_lock);
+    } else {
+        status = __send_link(client, context, message, segments);
+    }
+    return status;
+}
+
 // allocated => list_header, message_id, output_buffer
 static int gracht_client_invoke_internal(
         gracht_client_t*               client,
         struct gracht_message_context* context,
         struct gracht_buffer*          message,
     int                            streamBuffer,
-    uint32_t                       responseBufferSize)
+    uint32_t                       responseBufferSize,
+    const struct gracht_message_completion* completion,
+    const struct gracht_message_segments*   segments)
 {
-    uint32_t messageID;
-    int      status;
+    int status;
     if (streamBuffer) {
         GRTRACE(GRSTR("gracht_client_invoke_stream()"));
     } else {
@@ -176,26 +549,29 @@ static int gracht_client_invoke_internal(
         errno = EINVAL;
         return -1;
     }
-    
-    // fill in some message details
-    messageID = get_message_id(client);
-    GB_MSG_ID_0(message)  = messageID;
-    GB_MSG_LEN_0(message) = message->index;
 
-    // store a copy of the message id if the context was provided.
-    if (context) {
-        context->message_id = messageID;
-    }
-    
-    // require intermediate buffer for sync operations
-    if (MESSAGE_FLAG_TYPE(GB_MSG_FLG_0(message)) == MESSAGE_FLAG_SYNC) {
-        status = __add_message(client, context, streamBuffer, responseBufferSize);
-        if (status) {
-            goto release;
+    if (client->pool) {
+        gracht_client_t* pooled;
+        uint32_t         connection;
+
+        pooled = __pooled_take(client, &connection);
+        if (!pooled) {
+            return -1;
         }
+        status = gracht_client_invoke_internal(pooled, context, message, streamBuffer, responseBufferSize, completion, segments);
+        if (context) {
+            context->connection = connection;
+        }
+        gracht_client_pool_release_call(client->pool, connection);
+        return status;
+    }
+
+    status = __prepare_message(client, context, message, streamBuffer, responseBufferSize, completion, segments);
+    if (status) {
+        goto release;
     }
 
-    status = client->link->ops.client.send(client->link, message, context);
+    status = __send_message(client, context, message, segments);
     if (status) {
         __remove_message(client, context);
     }
@@ -208,7 +584,7 @@ release:
             mtx_unlock(&client->stream_pools_lock);
         }
     } else {
-        mtx_unlock(&client->send_buffer_lock);
+        __release_send_buffer(client, message->data);
     }
     return status;
 }
@@ -218,7 +594,7 @@ int gracht_client_invoke(
         struct gracht_message_context* context,
         struct gracht_buffer*          message)
 {
-    return gracht_client_invoke_internal(client, context, message, 0, 0);
+    return gracht_client_invoke_internal(client, context, message, 0, 0, NULL, NULL);
 }
 
 int gracht_client_invoke_stream(
@@ -226,7 +602,7 @@ int gracht_client_invoke_stream(
         struct gracht_message_context* context,
         struct gracht_buffer*          message)
 {
-    return gracht_client_invoke_internal(client, context, message, 1, 0);
+    return gracht_client_invoke_internal(client, context, message, 1, 0, NULL, NULL);
 }
 
 int gracht_client_invoke_stream_sized(
@@ -235,131 +611,636 @@ int gracht_client_invoke_stream_sized(
         struct gracht_buffer*          message,
         uint32_t                       responseBufferSize)
 {
-    return gracht_client_invoke_internal(client, context, message, 1, responseBufferSize);
+    return gracht_client_invoke_internal(client, context, message, 1, responseBufferSize, NULL, NULL);
 }
 
-static int __invoke_action(gracht_client_t* client, struct gracht_buffer* message)
+int gracht_client_invoke_segments(
+        gracht_client_t*                client,
+        struct gracht_message_context*  context,
+        struct gracht_buffer*           message,
+        struct gracht_message_segments* segments)
 {
-    gracht_protocol_function_t* function;
-    uint8_t protocol = GB_MSG_SID(message);
-    uint8_t action   = GB_MSG_AID(message);
-    GRTRACE(GRSTR("__invoke_action()"));
-
-    function = get_protocol_action(&client->protocols, protocol, action);
-    if (!function) {
-        return -1;
-    }
+    return gracht_client_invoke_internal(client, context, message, 0, 0, NULL, segments);
+}
 
-    message->index += GRACHT_MESSAGE_HEADER_SIZE;
-    ((client_invoke_t)function->address)(client, message);
-    return 0;
+int gracht_client_invoke_stream_segments(
+        gracht_client_t*                client,
+        struct gracht_message_context*  context,
+        struct gracht_buffer*           message,
+        uint32_t                        responseBufferSize,
+        struct gracht_message_segments* segments)
+{
+    return gracht_client_invoke_internal(client, context, message, 1, responseBufferSize, NULL, segments);
 }
 
-static int __handle_response(
-        gracht_client_t*      client,
-        struct gracht_buffer* buffer)
+int gracht_client_invoke_callback(
+        gracht_client_t*               client,
+        struct gracht_buffer*          message,
+        gracht_client_completion_fn    handler,
+        void*                          callback,
+        void*                          context)
 {
-    struct gracht_message_descriptor* descriptor;
-    uint32_t                          awaiterID;
-    GRTRACE(GRSTR("__handle_response()"));
+    struct gracht_message_context    messageContext;
+    struct gracht_message_completion completion = { handler, callback, context };
 
-    mtx_lock(&client->messages_lock);
-    descriptor = gr_hashtable_get(
-            &client->messages,
-            &(struct gracht_message_descriptor) {
-                .id = GB_MSG_ID(buffer)
-            }
-    );
-    if (!descriptor) {
-        mtx_unlock(&client->messages_lock);
-        // what the heck?
-        GRERROR(GRSTR("[gracht_client_wait_message] no-one was listening for message %u"), GB_MSG_ID(buffer));
+    if (!client || !message) {
+        errno = EINVAL;
         return -1;
     }
 
-    // copy data over to message, but increase index, so it skips the meta-data
-    descriptor->buffer.data  = buffer->data;
-    descriptor->buffer.index = buffer->index + GRACHT_MESSAGE_HEADER_SIZE;
-    descriptor->status = GRACHT_MESSAGE_COMPLETED;
-    awaiterID = descriptor->awaiter_id;
-    mtx_unlock(&client->messages_lock);
-
-    // iterate awaiters and mark those that contain this message
-    mark_awaiters(client, awaiterID);
-    return 0;
-}
+    if (client->pool) {
+        gracht_client_t* pooled;
+        uint32_t         connection;
+        int              status;
 
-static void* __acquire_stream_recv_buffer(gracht_client_t* client, uint32_t messageSize, uint32_t* outSize)
-{
-    size_t requestedSize = gracht_stream_normalize_buffer_size(messageSize, client->stream_buffer_size);
-    struct gracht_buffer_pool* pool;
-    void* data = NULL;
+        pooled = __pooled_take(client, &connection);
+        if (!pooled) {
+            return -1;
+        }
+        status = gracht_client_invoke_callback(pooled, message, handler, callback, context);
+        gracht_client_pool_release_call(client->pool, connection);
+        return status;
+    }
 
-    mtx_lock(&client->stream_pools_lock);
-    pool = gracht_stream_pool_registry_get_or_create(&client->stream_recv_pools, requestedSize, client->stream_buffer_count);
-    if (pool) {
-        data = gracht_buffer_pool_acquire(pool);
+    // only calls that expect a response can be completed
+    if (!handler || MESSAGE_FLAG_TYPE(GB_MSG_FLG_0(message)) != MESSAGE_FLAG_SYNC) {
+        errno = EINVAL;
+        __release_send_buffer(client, message->data);
+        return -1;
     }
-    mtx_unlock(&client->stream_pools_lock);
-    *outSize = (uint32_t)requestedSize;
-    return data;
+    return gracht_client_invoke_internal(client, &messageContext, message, 0, 0, &completion, NULL);
 }
 
-int gracht_client_wait_message(
+int gracht_client_invoke_into(
         gracht_client_t*               client,
         struct gracht_message_context* context,
-        unsigned int                   flags)
+        struct gracht_buffer*          message,
+        void*                          destination,
+        uint32_t                       destinationSize)
 {
-    struct gracht_buffer buffer = { 0 };
-    uint32_t             messageId = 0;
-    uint8_t              messageFlags;
-    int                  streamBuffer = 0;
-    uint32_t             expectedStreamSize = 0;
-    int                  status;
-    GRTRACE(GRSTR("gracht_client_wait_message()"));
+    struct gracht_message_descriptor* descriptor;
+    int                               status;
+    GRTRACE(GRSTR("gracht_client_invoke_into()"));
 
-    if (!client) {
+    if (!client || !message) {
         errno = EINVAL;
         return -1;
     }
 
-    // We must acquire hold of the client mutex as the mutex must be thread-safe in case
-    // of multiple calling threads. Only one thread can listen for client events at a time, and that
-    // means all other threads must queue up and wait for the thread that listens currently.
-listenForMessage:
-    // check message status
-    if (context) {
-        struct gracht_message_descriptor* descriptor;
+    if (client->pool) {
+        gracht_client_t* pooled;
+        uint32_t         connection;
 
-        mtx_lock(&client->messages_lock);
-        descriptor = gr_hashtable_get(
-                &client->messages,
-                &(struct gracht_message_descriptor) {
-                        .id = context->message_id
-                }
-        );
-        if (!descriptor) {
-            mtx_unlock(&client->messages_lock);
-            errno = ENOENT;
+        pooled = __pooled_take(client, &connection);
+        if (!pooled) {
             return -1;
         }
-        streamBuffer = descriptor->stream_buffer;
-        expectedStreamSize = descriptor->response_buffer_size;
-        if (descriptor->status != GRACHT_MESSAGE_INPROGRESS) {
-            mtx_unlock(&client->messages_lock);
-            return 0;
+        status = gracht_client_invoke_into(pooled, context, message, destination, destinationSize);
+        if (context) {
+            context->connection = connection;
         }
-        mtx_unlock(&client->messages_lock);
+        gracht_client_pool_release_call(client->pool, connection);
+        return status;
     }
 
-    if (mtx_trylock(&client->wait_lock) != thrd_success) {
-        if (!(flags & GRACHT_MESSAGE_BLOCK)) {
-            errno = EBUSY;
-            return -1;
-        }
+    // only calls that expect a response can be received into a destination
+    if (!context || !destination ||
+        MESSAGE_FLAG_TYPE(GB_MSG_FLG_0(message)) != MESSAGE_FLAG_SYNC) {
+        errno = EINVAL;
+        __release_send_buffer(client, message->data);
+        return -1;
+    }
 
-        if (mtx_lock(&client->wait_lock) != thrd_success) {
-            return -1;
+    status = __prepare_message(client, context, message, 0, 0, NULL, NULL);
+    if (status) {
+        goto release;
+    }
+
+    // the response cannot arrive before the message is sent, so the destination is
+    // in place before anyone looks for it
+    descriptor = gr_call_table_lock(&client->messages, context->message_id);
+    if (descriptor) {
+        descriptor->destination      = destination;
+        descriptor->destination_size = destinationSize;
+        atomic_fetch_add(&client->destination_calls, 1);
+        gr_call_table_unlock(&client->messages, descriptor);
+    }
+
+    status = __send_message(client, context, message, NULL);
+    if (status) {
+        __remove_message(client, context);
+    }
+
+release:
+    __release_send_buffer(client, message->data);
+    return status;
+}
+
+static int __grow_array(void** array, int* capacity, int count, size_t elementSize)
+{
+    void* resized;
+    int   newCapacity;
+
+    if (count < *capacity) {
+        return 0;
+    }
+
+    newCapacity = *capacity ? (*capacity * 2) : 16;
+    resized = realloc(*array, (size_t)newCapacity * elementSize);
+    if (!resized) {
+        errno = ENOMEM;
+        return -1;
+    }
+    *array = resized;
+    *capacity = newCapacity;
+    return 0;
+}
+
+// Removes the calls of the messages that were never sent, they are also removed from the
+// list of contexts, which always ends with the unsent calls
+static void __batch_discard(struct gracht_client_batch* batch, int first)
+{
+    int i;
+
+    for (i = first; i < batch->entry_count; i++) {
+        if (batch->entries[i].sync) {
+            __remove_message(batch->client, batch->entries[i].context);
+            batch->context_count--;
+        }
+    }
+    batch->entry_count = 0;
+    batch->used = 0;
+}
+
+int gracht_client_batch_create(gracht_client_t* client, int capacity, gracht_client_batch_t** batchOut)
+{
+    struct gracht_client_batch* batch;
+
+    if (!client || !batchOut) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // the calls of a batch are sent with one write, so they can not be spread over a pool
+    if (client->pool) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    if (capacity <= 0) {
+        capacity = client->max_message_size * GRACHT_CLIENT_BATCH_DEFAULT_MESSAGES;
+    }
+
+    // a batch must always be able to hold atleast one message
+    if (capacity < client->max_message_size) {
+        capacity = client->max_message_size;
+    }
+
+    batch = calloc(1, sizeof(struct gracht_client_batch));
+    if (!batch) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    batch->data = malloc((size_t)capacity);
+    if (!batch->data) {
+        free(batch);
+        errno = ENOMEM;
+        return -1;
+    }
+    batch->client = client;
+    batch->capacity = (size_t)capacity;
+    *batchOut = batch;
+    return 0;
+}
+
+void gracht_client_batch_destroy(gracht_client_batch_t* batch)
+{
+    if (!batch) {
+        return;
+    }
+
+    __batch_discard(batch, 0);
+    free(batch->entries);
+    free(batch->contexts);
+    free(batch->data);
+    free(batch);
+}
+
+int gracht_client_batch_flush(gracht_client_batch_t* batch)
+{
+    gracht_client_t*     client;
+    struct gracht_buffer buffer;
+    int                  status = 0;
+    int                  sent   = 0;
+    GRTRACE(GRSTR("gracht_client_batch_flush()"));
+
+    if (!batch) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!batch->entry_count) {
+        return 0;
+    }
+
+    // the batch is written in one go, so calls from other threads can not end up in the middle of it
+    client = batch->client;
+    if (client->send_buffer_count > 1) {
+        mtx_lock(&client->send_lock);
+    } else {
+        mtx_lock(&client->send_buffer_lock);
+    }
+
+    if (client->link->type == gracht_link_stream_based) {
+        buffer.data  = batch->data;
+        buffer.index = (uint32_t)batch->used;
+        status = client->link->ops.client.send(client->link, &buffer, batch->entries[0].context);
+        if (!status) {
+            sent = batch->entry_count;
+        }
+    } else {
+        // packet based links keep the message boundaries, so each message must be sent on its own
+        for (; sent < batch->entry_count; sent++) {
+            buffer.data  = &batch->data[batch->entries[sent].offset];
+            buffer.index = GB_MSG_LEN_0(&buffer);
+            status = client->link->ops.client.send(client->link, &buffer, batch->entries[sent].context);
+            if (status) {
+                break;
+            }
+        }
+    }
+
+    if (client->send_buffer_count > 1) {
+        mtx_unlock(&client->send_lock);
+    } else {
+        mtx_unlock(&client->send_buffer_lock);
+    }
+
+    __batch_discard(batch, sent);
+    return status;
+}
+
+void gracht_client_batch_reset(gracht_client_batch_t* batch)
+{
+    if (!batch) {
+        return;
+    }
+
+    __batch_discard(batch, 0);
+    batch->context_count = 0;
+}
+
+struct gracht_message_context** gracht_client_batch_contexts(gracht_client_batch_t* batch, int* countOut)
+{
+    if (!batch || !countOut) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    *countOut = batch->context_count;
+    return batch->contexts;
+}
+
+int gracht_client_batch_get_buffer(gracht_client_batch_t* batch, gracht_buffer_t* buffer)
+{
+    GRTRACE(GRSTR("gracht_client_batch_get_buffer()"));
+    if (!batch || !buffer) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // messages are serialized directly into the batch, so make sure the largest message fits
+    if (batch->capacity - batch->used < (size_t)batch->client->max_message_size) {
+        if (gracht_client_batch_flush(batch)) {
+            return -1;
+        }
+    }
+
+    buffer->data  = &batch->data[batch->used];
+    buffer->index = 0;
+    return 0;
+}
+
+int gracht_client_batch_add(
+        gracht_client_batch_t*         batch,
+        struct gracht_message_context* context,
+        gracht_buffer_t*               message)
+{
+    int sync;
+    GRTRACE(GRSTR("gracht_client_batch_add()"));
+
+    if (!batch || !message) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (__grow_array((void**)&batch->entries, &batch->entry_capacity,
+            batch->entry_count, sizeof(struct gracht_client_batch_entry))) {
+        return -1;
+    }
+
+    sync = MESSAGE_FLAG_TYPE(GB_MSG_FLG_0(message)) == MESSAGE_FLAG_SYNC;
+    if (sync && __grow_array((void**)&batch->contexts, &batch->context_capacity,
+            batch->context_count, sizeof(struct gracht_message_context*))) {
+        return -1;
+    }
+
+    if (__prepare_message(batch->client, context, message, 0, 0, NULL, NULL)) {
+        return -1;
+    }
+
+    batch->entries[batch->entry_count].offset  = batch->used;
+    batch->entries[batch->entry_count].context = context;
+    batch->entries[batch->entry_count].sync    = sync;
+    batch->entry_count++;
+    batch->used += message->index;
+
+    // only calls that expect a response can be awaited
+    if (sync) {
+        batch->contexts[batch->context_count++] = context;
+    }
+    return 0;
+}
+
+static int __invoke_action(gracht_client_t* client, struct gracht_buffer* message)
+{
+    gracht_protocol_function_t* function;
+    uint8_t protocol = GB_MSG_SID(message);
+    uint8_t action   = GB_MSG_AID(message);
+    GRTRACE(GRSTR("__invoke_action()"));
+
+    function = gr_protocol_table_get_action(&client->protocols, protocol, action);
+    if (!function) {
+        return -1;
+    }
+
+    message->index += GRACHT_MESSAGE_HEADER_SIZE;
+    ((client_invoke_t)function->address)(client, message);
+    return 0;
+}
+
+// The destination receives the first field of the response, which is prefixed by its count
+static void __copy_destination(
+        struct gracht_message_descriptor* descriptor,
+        struct gracht_buffer*             buffer)
+{
+    uint32_t length = GB_MSG_LEN(buffer);
+    uint32_t offset = buffer->index + GRACHT_MESSAGE_HEADER_SIZE;
+
+    if (length < GRACHT_MESSAGE_HEADER_SIZE + sizeof(uint32_t)) {
+        descriptor->status = GRACHT_MESSAGE_ERROR;
+        descriptor->error  = EPROTO;
+        return;
+    }
+
+    length -= GRACHT_MESSAGE_HEADER_SIZE + sizeof(uint32_t);
+    memcpy(&descriptor->destination_count, &buffer->data[offset], sizeof(uint32_t));
+    if (length > descriptor->destination_size) {
+        descriptor->status = GRACHT_MESSAGE_ERROR;
+        descriptor->error  = EMSGSIZE;
+        return;
+    }
+
+    if (length) {
+        memcpy(descriptor->destination, &buffer->data[offset + sizeof(uint32_t)], length);
+    }
+    descriptor->status = GRACHT_MESSAGE_COMPLETED;
+}
+
+// Receives a response straight into the destination of its call, the slot is kept locked while
+// receiving, so the call cannot expire and hand the destination back to the caller meanwhile.
+// Returns 1 if the response must be received the normal way.
+static int __recv_destination(
+        gracht_client_t* client,
+        const uint8_t*   header,
+        unsigned int     flags,
+        uint32_t*        messageIdOut)
+{
+    struct gracht_message_descriptor* descriptor;
+    struct gracht_iovec               vectors[3];
+    uint8_t                           scratch[GRACHT_MESSAGE_HEADER_SIZE];
+    uint32_t                          messageId = *((const uint32_t*)&header[MSG_INDEX_ID]);
+    uint32_t                          length    = *((const uint32_t*)&header[MSG_INDEX_LEN]);
+    uint32_t                          awaiterID;
+    int                               count = 2;
+    int                               status;
+
+    if (length < GRACHT_MESSAGE_HEADER_SIZE + sizeof(uint32_t)) {
+        return 1;
+    }
+    length -= GRACHT_MESSAGE_HEADER_SIZE + sizeof(uint32_t);
+
+    descriptor = gr_call_table_lock(&client->messages, messageId);
+    if (!descriptor) {
+        return 1;
+    }
+
+    if (!descriptor->destination || descriptor->status != GRACHT_MESSAGE_INPROGRESS ||
+        length > descriptor->destination_size) {
+        gr_call_table_unlock(&client->messages, descriptor);
+        return 1;
+    }
+
+    vectors[0].data   = &scratch[0];
+    vectors[0].length = GRACHT_MESSAGE_HEADER_SIZE;
+    vectors[1].data   = &descriptor->destination_count;
+    vectors[1].length = sizeof(uint32_t);
+    if (length) {
+        vectors[2].data   = descriptor->destination;
+        vectors[2].length = length;
+        count++;
+    }
+
+    status = client->link->ops.client.recv_vectored(client->link, &vectors[0], count, flags);
+    if (status) {
+        descriptor->status = GRACHT_MESSAGE_ERROR;
+        descriptor->error  = errno;
+    } else {
+        descriptor->status = GRACHT_MESSAGE_COMPLETED;
+    }
+    awaiterID = descriptor->awaiter_id;
+    gr_call_table_unlock(&client->messages, descriptor);
+
+    mark_awaiters(client, awaiterID);
+    *messageIdOut = messageId;
+    return status;
+}
+
+static int __handle_response(
+        gracht_client_t*      client,
+        struct gracht_buffer* buffer)
+{
+    struct gracht_message_descriptor* descriptor;
+    uint32_t                          awaiterID;
+    GRTRACE(GRSTR("__handle_response()"));
+
+    descriptor = gr_call_table_lock(&client->messages, GB_MSG_ID(buffer));
+    if (!descriptor) {
+        // what the heck?
+        GRERROR(GRSTR("[gracht_client_wait_message] no-one was listening for message %u"), GB_MSG_ID(buffer));
+        return -1;
+    }
+
+    // the call may have expired before the response arrived
+    if (descriptor->status != GRACHT_MESSAGE_INPROGRESS) {
+        gr_call_table_unlock(&client->messages, descriptor);
+        GRTRACE(GRSTR("[gracht_client_wait_message] dropping late response for message %u"), GB_MSG_ID(buffer));
+        return -1;
+    }
+
+    // completed calls are handed the response directly, the buffer is released when the handler returns
+    if (descriptor->completion.handler) {
+        struct gracht_buffer response = { buffer->data, buffer->index + GRACHT_MESSAGE_HEADER_SIZE };
+        __complete_message(client, descriptor, GRACHT_MESSAGE_COMPLETED, &response);
+        gracht_client_status_finalize(client, buffer);
+        return 0;
+    }
+
+    // the response could not be received directly into the destination, so copy it there
+    if (descriptor->destination) {
+        __copy_destination(descriptor, buffer);
+        awaiterID = descriptor->awaiter_id;
+        gr_call_table_unlock(&client->messages, descriptor);
+        gracht_client_status_finalize(client, buffer);
+        mark_awaiters(client, awaiterID);
+        return 0;
+    }
+
+    // copy data over to message, but increase index, so it skips the meta-data
+    descriptor->buffer.data  = buffer->data;
+    descriptor->buffer.index = buffer->index + GRACHT_MESSAGE_HEADER_SIZE;
+    descriptor->status = GRACHT_MESSAGE_COMPLETED;
+    awaiterID = descriptor->awaiter_id;
+    gr_call_table_unlock(&client->messages, descriptor);
+
+    // iterate awaiters and mark those that contain this message
+    mark_awaiters(client, awaiterID);
+    return 0;
+}
+
+static void* __acquire_stream_recv_buffer(gracht_client_t* client, uint32_t messageSize, uint32_t* outSize)
+{
+    size_t requestedSize = gracht_stream_normalize_buffer_size(messageSize, client->stream_buffer_size);
+    struct gracht_buffer_pool* pool;
+    void* data = NULL;
+
+    mtx_lock(&client->stream_pools_lock);
+    pool = gracht_stream_pool_registry_get_or_create(&client->stream_recv_pools, requestedSize, client->stream_buffer_count);
+    if (pool) {
+        data = gracht_buffer_pool_acquire(pool);
+    }
+    mtx_unlock(&client->stream_pools_lock);
+    *outSize = (uint32_t)requestedSize;
+    return data;
+}
+
+static void __release_recv_buffer(gracht_client_t* client, void* data, int streamBuffer)
+{
+    if (streamBuffer) {
+        mtx_lock(&client->stream_pools_lock);
+        gracht_stream_pool_registry_release(&client->stream_recv_pools, data);
+        mtx_unlock(&client->stream_pools_lock);
+    } else {
+        gracht_buffer_pool_release(client->recv_pool, data);
+    }
+}
+
+// Peeks the length and protocol of the next message. Responses for calls with a destination are
+// received directly into it when the link can receive a message in parts, in which case 1 is returned
+static int __peek_message(
+        gracht_client_t* client,
+        uint32_t*        lengthOut,
+        uint8_t*         protocolOut,
+        unsigned int     flags,
+        uint32_t*        messageIdOut)
+{
+    struct gracht_link* link = client->link;
+    uint8_t             header[GRACHT_MESSAGE_HEADER_SIZE];
+    int                 status;
+
+    if (link->type != gracht_link_stream_based || !link->ops.client.peek_header || !link->ops.client.recv_vectored) {
+        return link->ops.client.peek(link, lengthOut, protocolOut, flags);
+    }
+
+    if (link->ops.client.peek_header(link, &header[0], flags)) {
+        return -1;
+    }
+
+    if (atomic_load(&client->destination_calls) && MESSAGE_FLAG_TYPE(header[MSG_INDEX_FLG]) == MESSAGE_FLAG_RESPONSE) {
+        status = __recv_destination(client, &header[0], flags, messageIdOut);
+        if (status <= 0) {
+            return status ? -1 : 1;
+        }
+    }
+
+    *lengthOut   = *((uint32_t*)&header[MSG_INDEX_LEN]);
+    *protocolOut = header[MSG_INDEX_SID];
+    return 0;
+}
+
+static int __pump_message(
+        gracht_client_t*               client,
+        struct gracht_message_context* context,
+        unsigned int                   flags)
+{
+    struct gracht_buffer buffer = { 0 };
+    uint32_t             messageId = 0;
+    uint8_t              messageFlags;
+    int                  streamBuffer = 0;
+    uint32_t             expectedStreamSize = 0;
+    int                  status;
+
+    // We must acquire hold of the client mutex as the mutex must be thread-safe in case
+    // of multiple calling threads. Only one thread can listen for client events at a time, and that
+    // means all other threads must queue up and wait for the thread that listens currently.
+listenForMessage:
+    // check message status
+    if (context) {
+        struct gracht_message_descriptor* descriptor;
+
+        int executed;
+
+        descriptor = gr_call_table_lock(&client->messages, context->message_id);
+        if (!descriptor) {
+            errno = ENOENT;
+            return -1;
+        }
+        streamBuffer = descriptor->stream_buffer;
+        expectedStreamSize = descriptor->response_buffer_size;
+        executed = descriptor->status != GRACHT_MESSAGE_INPROGRESS;
+        gr_call_table_unlock(&client->messages, descriptor);
+        if (executed) {
+            return 0;
+        }
+    }
+
+    if (mtx_trylock(&client->wait_lock) != thrd_success) {
+        if (!(flags & GRACHT_MESSAGE_BLOCK)) {
+            errno = EBUSY;
+            return -1;
+        }
+
+        if (mtx_lock(&client->wait_lock) != thrd_success) {
+            return -1;
+        }
+    }
+
+    // never block beyond the earliest deadline, so calls can be expired while waiting
+    if ((flags & GRACHT_MESSAGE_BLOCK) && client->link->ops.client.poll) {
+        uint64_t deadline = __next_deadline(client);
+        if (deadline) {
+            uint64_t now       = gracht_time_ns();
+            int      timeoutMs = deadline > now ? (int)(((deadline - now) + 999999ULL) / 1000000ULL) : 0;
+            if (client->link->ops.client.poll(client->link, timeoutMs)) {
+                mtx_unlock(&client->wait_lock);
+                if (errno == ETIMEDOUT) {
+                    __expire_messages(client);
+                    errno = ETIMEDOUT;
+                }
+                status = -1;
+                goto listenOrExit;
+            }
         }
     }
 
@@ -368,9 +1249,12 @@ listenForMessage:
         uint32_t incomingLength;
         uint8_t  protocolId;
 
-        status = client->link->ops.client.peek(client->link, &incomingLength, &protocolId, flags);
+        status = __peek_message(client, &incomingLength, &protocolId, flags, &messageId);
         if (status) {
             mtx_unlock(&client->wait_lock);
+            if (status > 0) {
+                status = 0;
+            }
             goto listenOrExit;
         }
 
@@ -398,85 +1282,315 @@ listenForMessage:
         }
     }
 
-    if (!buffer.data) {
-        mtx_unlock(&client->wait_lock);
-        // out of memory. client should handle messages
-        errno = ENOMEM;
+    if (!buffer.data) {
+        mtx_unlock(&client->wait_lock);
+        // out of memory. client should handle messages
+        errno = ENOMEM;
+        status = -1;
+        goto listenOrExit;
+    }
+
+    status = client->link->ops.client.recv(client->link, &buffer, flags);
+    mtx_unlock(&client->wait_lock);
+    if (status) {
+        // In case of any recieving errors we must exit immediately
+        goto listenOrExit;
+    }
+
+    messageFlags = GB_MSG_FLG(&buffer);
+
+    // If the message is not an event, then do not invoke any actions. In any case if a context is provided
+    // we expect the caller wanting to listen for that specific message. That means any incoming event and/or
+    // response we recieve should be for that, or we should keep waiting.
+    GRTRACE(GRSTR("[gracht] [client] message received %u - %u:%u"),
+            messageFlags, GB_MSG_SID(&buffer), GB_MSG_AID(&buffer));
+    if (MESSAGE_FLAG_TYPE(messageFlags) == MESSAGE_FLAG_EVENT) {
+        status = __invoke_action(client, &buffer);
+    } else if (MESSAGE_FLAG_TYPE(messageFlags) == MESSAGE_FLAG_RESPONSE) {
+        // the buffer may already be released once the response is handled
+        uint32_t responseId = GB_MSG_ID(&buffer);
+
+        status = __handle_response(client, &buffer);
+        if (status) {
+            __release_recv_buffer(client, buffer.data, streamBuffer);
+            buffer.data = NULL;
+            goto listenForMessage;
+        }
+
+        // set message id handled
+        messageId = responseId;
+
+        // zero the buffer pointer, so it does not get freed, freeing is now handled by
+        // the awaiter
+        buffer.data = NULL;
+    }
+
+listenOrExit:
+    if (buffer.data) {
+        __release_recv_buffer(client, buffer.data, streamBuffer);
+    }
+
+    if (context) {
+        // In case a context was provided the meaning is that we should wait
+        // for a specific message. Make sure that the message we've handled were
+        // the one that was requested.
+        if (messageId != 0 && context->message_id != messageId) {
+            goto listenForMessage;
+        }
+    }
+    return status;
+}
+
+static void __receiver_notify(gracht_client_t* client)
+{
+    if (!atomic_load(&client->receiver_waiters)) {
+        return;
+    }
+
+    mtx_lock(&client->receiver_lock);
+    client->receiver_sequence++;
+    cnd_broadcast(&client->receiver_signal);
+    mtx_unlock(&client->receiver_lock);
+}
+
+struct gracht_failed_completions {
+    gracht_client_t* client;
+    uint32_t*        ids;
+    int              count;
+    int              capacity;
+};
+
+static void __fail_message(uint32_t id, void* element, void* context)
+{
+    struct gracht_message_descriptor* descriptor = element;
+    struct gracht_failed_completions* failed     = context;
+
+    if (descriptor->status != GRACHT_MESSAGE_INPROGRESS) {
+        return;
+    }
+    descriptor->status = GRACHT_MESSAGE_ERROR;
+
+    // the slot is locked by the enumeration, so calls with a completion handler are
+    // completed once the enumeration is done
+    if (descriptor->completion.handler) {
+        if (__grow_array((void**)&failed->ids, &failed->capacity, failed->count, sizeof(uint32_t))) {
+            GRWARNING(GRSTR("gracht_client: dropping completion of message %u"), id);
+            return;
+        }
+        failed->ids[failed->count++] = id;
+        return;
+    }
+    mark_awaiters(failed->client, descriptor->awaiter_id);
+}
+
+static void __fail_messages(gracht_client_t* client)
+{
+    struct gracht_failed_completions failed = { client, NULL, 0, 0 };
+    int                              i;
+
+    gr_call_table_enumerate(&client->messages, __fail_message, &failed);
+    for (i = 0; i < failed.count; i++) {
+        struct gracht_message_descriptor* descriptor = gr_call_table_lock(&client->messages, failed.ids[i]);
+        if (descriptor) {
+            __complete_message(client, descriptor, GRACHT_MESSAGE_ERROR, NULL);
+        }
+    }
+    free(failed.ids);
+}
+
+static int __receiver_main(void* context)
+{
+    gracht_client_t* client = context;
+    GRTRACE(GRSTR("gracht_client: receive thread running"));
+
+    while (atomic_load(&client->receiver_state) == RECEIVER_RUNNING) {
+        if (__pump_message(client, NULL, GRACHT_MESSAGE_BLOCK)) {
+            // the receive pool is exhausted until the callers read their results, events for
+            // unknown protocols are ignored and timeouts only expire calls, anything else is a
+            // broken link
+            if (errno == ENOMEM || errno == EINTR) {
+                thrd_yield();
+                continue;
+            } else if (errno != ENOTSUP && errno != ETIMEDOUT) {
+                if (atomic_load(&client->receiver_state) == RECEIVER_RUNNING) {
+                    GRERROR(GRSTR("gracht_client: receive thread lost the link: %i"), errno);
+                }
+                break;
+            }
+        }
+        __receiver_notify(client);
+    }
+
+    // fail every outstanding call, as no one will be receiving their responses
+    atomic_store(&client->receiver_state, RECEIVER_STOPPED);
+    __fail_messages(client);
+
+    mtx_lock(&client->receiver_lock);
+    cnd_broadcast(&client->receiver_signal);
+    mtx_unlock(&client->receiver_lock);
+    GRTRACE(GRSTR("gracht_client: receive thread exitting"));
+    return 0;
+}
+
+static int __wait_receiver(
+        gracht_client_t*               client,
+        struct gracht_message_context* context,
+        unsigned int                   flags)
+{
+    unsigned int sequence;
+    int          status = 0;
+
+    if (!(flags & GRACHT_MESSAGE_BLOCK)) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    if (context) {
+        return gracht_client_await(client, context, GRACHT_AWAIT_ASYNC);
+    }
+
+    mtx_lock(&client->receiver_lock);
+    atomic_fetch_add(&client->receiver_waiters, 1);
+    sequence = client->receiver_sequence;
+    while (sequence == client->receiver_sequence &&
+           atomic_load(&client->receiver_state) == RECEIVER_RUNNING) {
+        cnd_wait(&client->receiver_signal, &client->receiver_lock);
+    }
+    atomic_fetch_sub(&client->receiver_waiters, 1);
+    if (sequence == client->receiver_sequence) {
+        errno = EPIPE;
         status = -1;
-        goto listenOrExit;
+    }
+    mtx_unlock(&client->receiver_lock);
+    return status;
+}
+
+// The buffer of a call is taken from the connection the call is made on, so the connection is
+// chosen here and kept by the thread until the call has been invoked
+static int __pooled_get_buffer(gracht_client_t* handle, int streamBuffer, uint32_t requiredSize, gracht_buffer_t* buffer)
+{
+    gracht_client_t* pooled;
+    uint32_t         connection;
+    int              status;
+
+    pooled = gracht_client_pool_acquire_call(handle->pool, &connection);
+    if (!pooled) {
+        return -1;
+    }
+
+    if (streamBuffer) {
+        status = gracht_client_get_stream_buffer_sized(pooled, requiredSize, buffer);
+    } else {
+        status = gracht_client_get_buffer(pooled, buffer);
     }
 
-    status = client->link->ops.client.recv(client->link, &buffer, flags);
-    mtx_unlock(&client->wait_lock);
     if (status) {
-        // In case of any recieving errors we must exit immediately
-        goto listenOrExit;
+        gracht_client_pool_release_call(handle->pool, connection);
+        return status;
     }
+    __pooled_bind(handle, pooled, connection);
+    return 0;
+}
 
-    messageFlags = GB_MSG_FLG(&buffer);
+static int __pooled_wait_message(gracht_client_t* handle, struct gracht_message_context* context, unsigned int flags)
+{
+    gracht_client_t* pooled;
+    uint32_t         connection;
+    int              status;
 
-    // If the message is not an event, then do not invoke any actions. In any case if a context is provided
-    // we expect the caller wanting to listen for that specific message. That means any incoming event and/or
-    // response we recieve should be for that, or we should keep waiting.
-    GRTRACE(GRSTR("[gracht] [client] message received %u - %u:%u"),
-            messageFlags, GB_MSG_SID(&buffer), GB_MSG_AID(&buffer));
-    if (MESSAGE_FLAG_TYPE(messageFlags) == MESSAGE_FLAG_EVENT) {
-        status = __invoke_action(client, &buffer);
-    } else if (MESSAGE_FLAG_TYPE(messageFlags) == MESSAGE_FLAG_RESPONSE) {
-        status = __handle_response(client, &buffer);
-        if (status) {
-            goto listenForMessage;
-        }
+    if (context) {
+        connection = context->connection;
+        pooled     = gracht_client_pool_lookup_call(handle->pool, connection);
+    } else {
+        pooled = gracht_client_pool_acquire_call(handle->pool, &connection);
+    }
 
-        // set message id handled
-        messageId = GB_MSG_ID(&buffer);
+    if (!pooled) {
+        return -1;
+    }
+    status = gracht_client_wait_message(pooled, context, flags);
+    gracht_client_pool_release_call(handle->pool, connection);
+    return status;
+}
 
-        // zero the buffer pointer, so it does not get freed, freeing is now handled by
-        // the awaiter
-        buffer.data = NULL;
+// Calls on different connections are awaited one connection at the time, which is only
+// possible when all of them must complete. Calls of lost connections have already failed.
+static int __pooled_await(gracht_client_t* handle, struct gracht_message_context** contexts, int contextCount, unsigned int flags)
+{
+    gracht_client_t* pooled;
+    int              i;
+
+    for (i = 1; i < contextCount; i++) {
+        if (contexts[i]->connection != contexts[0]->connection) {
+            break;
+        }
     }
 
-listenOrExit:
-    if (buffer.data) {
-        if (streamBuffer) {
-            mtx_lock(&client->stream_pools_lock);
-            gracht_stream_pool_registry_release(&client->stream_recv_pools, buffer.data);
-            mtx_unlock(&client->stream_pools_lock);
-        } else {
-            gracht_buffer_pool_release(client->recv_pool, buffer.data);
+    if (i == contextCount) {
+        pooled = gracht_client_pool_lookup_call(handle->pool, contexts[0]->connection);
+        if (pooled) {
+            (void)gracht_client_await_multiple(pooled, contexts, contextCount, flags);
+            gracht_client_pool_release_call(handle->pool, contexts[0]->connection);
         }
+        return 0;
     }
 
-    if (context) {
-        // In case a context was provided the meaning is that we should wait
-        // for a specific message. Make sure that the message we've handled were
-        // the one that was requested.
-        if (messageId != 0 && context->message_id != messageId) {
-            goto listenForMessage;
+    if (!(flags & GRACHT_AWAIT_ALL)) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    for (i = 0; i < contextCount; i++) {
+        pooled = gracht_client_pool_lookup_call(handle->pool, contexts[i]->connection);
+        if (pooled) {
+            (void)gracht_client_await_multiple(pooled, &contexts[i], 1, flags);
+            gracht_client_pool_release_call(handle->pool, contexts[i]->connection);
         }
     }
-    return status;
+    return 0;
 }
 
-static struct gracht_message_awaiter* __awaiter_new(
-        gracht_client_t* client,
-        unsigned int     flags,
-        int              contextCount)
+int gracht_client_wait_message(
+        gracht_client_t*               client,
+        struct gracht_message_context* context,
+        unsigned int                   flags)
 {
-    struct gracht_message_awaiter* awaiter;
+    GRTRACE(GRSTR("gracht_client_wait_message()"));
+    if (!client) {
+        errno = EINVAL;
+        return -1;
+    }
 
-    awaiter = malloc(sizeof(struct gracht_message_awaiter));
-    if (!awaiter) {
-        return NULL;
+    if (client->pool) {
+        return __pooled_wait_message(client, context, flags);
+    }
+
+    if (atomic_load(&client->receiver_state) != RECEIVER_NONE) {
+        return __wait_receiver(client, context, flags);
     }
+    return __pump_message(client, context, flags);
+}
 
-    awaiter->id            = get_awaiter_id(client);
-    awaiter->flags         = flags;
-    awaiter->count         = contextCount;
-    awaiter->current_count = 0;
+// Awaiters live on the stack of the waiting thread, they are only reachable through
+// the awaiters table, and are always removed from it before the wait returns
+static void __awaiter_init(
+        gracht_client_t*               client,
+        struct gracht_message_awaiter* awaiter,
+        unsigned int                   flags,
+        int                            contextCount)
+{
+    awaiter->id    = get_awaiter_id(client);
+    awaiter->flags = flags;
+    awaiter->count = contextCount;
+    atomic_store(&awaiter->current_count, 0);
     cnd_init(&awaiter->event);
     mtx_init(&awaiter->mutex, mtx_plain);
-    return awaiter;
+}
+
+static void __awaiter_destroy(struct gracht_message_awaiter* awaiter)
+{
+    cnd_destroy(&awaiter->event);
+    mtx_destroy(&awaiter->mutex);
 }
 
 static inline void __await_add(
@@ -502,29 +1616,70 @@ static inline void __await_remove(
     mtx_unlock(&client->awaiters_lock);
 }
 
+static inline int __awaiter_done_count(struct gracht_message_awaiter* awaiter, int count)
+{
+    if (awaiter->flags & GRACHT_AWAIT_ALL) {
+        return count >= awaiter->count;
+    }
+    return count > 0;
+}
+
+static inline int __awaiter_done(struct gracht_message_awaiter* awaiter)
+{
+    return __awaiter_done_count(awaiter, atomic_load(&awaiter->current_count));
+}
+
 static inline void __await_loop(
-        gracht_client_t*                client,
-        struct gracht_message_context** contexts,
-        struct gracht_message_awaiter*  awaiter)
+        gracht_client_t*               client,
+        struct gracht_message_awaiter* awaiter)
 {
-    while (awaiter->current_count < awaiter->count) {
+    // every message that completes marks the awaiter it is attached to, so there is
+    // no need to look at the messages again after each received message
+    while (!__awaiter_done(awaiter)) {
         gracht_client_wait_message(client, NULL, GRACHT_MESSAGE_BLOCK);
 
-        // update status
-        mtx_lock(&client->messages_lock);
-        awaiter->current_count = 0;
-        for (int i = 0; i < awaiter->count; i++) {
-            struct gracht_message_descriptor* descriptor = gr_hashtable_get(
-                    &client->messages,
-                    &(struct gracht_message_descriptor) {
-                            .id = contexts[i]->message_id
-                    }
-            );
-            if (descriptor == NULL || MESSAGE_STATUS_EXECUTED(descriptor->status)) {
-                awaiter->current_count++;
+        // links that cannot be polled only expire calls here
+        __expire_messages(client);
+    }
+}
+
+static inline void __await_event(
+        gracht_client_t*               client,
+        struct gracht_message_awaiter* awaiter)
+{
+    // a stopped receive thread fails all outstanding messages before it
+    // exits, so the awaiter can never be signalled after that point
+    for (;;) {
+        uint64_t deadline = __next_deadline(client);
+        int      done;
+
+        mtx_lock(&awaiter->mutex);
+        done = __awaiter_done(awaiter) || atomic_load(&client->receiver_state) == RECEIVER_STOPPED;
+        if (!done) {
+            // the earliest deadline is never later than the deadlines of our own calls, so
+            // wake up in time to expire them in case no one else does
+            if (deadline) {
+                struct timespec ts;
+                uint64_t        now = gracht_time_ns();
+                uint64_t        remaining = deadline > now ? deadline - now : 0;
+
+                timespec_get(&ts, TIME_UTC);
+                ts.tv_sec  += (time_t)(remaining / 1000000000ULL);
+                ts.tv_nsec += (long)(remaining % 1000000000ULL);
+                if (ts.tv_nsec >= 1000000000L) {
+                    ts.tv_sec++;
+                    ts.tv_nsec -= 1000000000L;
+                }
+                cnd_timedwait(&awaiter->event, &awaiter->mutex, &ts);
+            } else {
+                cnd_wait(&awaiter->event, &awaiter->mutex);
             }
         }
-        mtx_unlock(&client->messages_lock);
+        mtx_unlock(&awaiter->mutex);
+        if (done) {
+            break;
+        }
+        __expire_messages(client);
     }
 }
 
@@ -534,9 +1689,9 @@ int gracht_client_await_multiple(
         int                             contextCount,
         unsigned int                    flags)
 {
-    struct gracht_message_awaiter* awaiter;
+    struct gracht_message_awaiter  awaiter;
     int                            i;
-    bool                           bail;
+    int                            executed = 0;
     GRTRACE(GRSTR("gracht_client_await_multiple()"));
     
     if (!client || !contexts || !contextCount) {
@@ -544,66 +1699,55 @@ int gracht_client_await_multiple(
         return -1;
     }
 
-    // create the awaiter
-    awaiter = __awaiter_new(client, flags, contextCount);
-    if (awaiter == NULL) {
-        return -1;
+    if (client->pool) {
+        return __pooled_await(client, contexts, contextCount, flags);
     }
 
-    // first step is to get a status of all messages we are awaiting
-    mtx_lock(&client->messages_lock);
+    // the awaiter must be visible before it is attached to any of the messages, otherwise
+    // a message that completes right after being attached could not signal it
+    __awaiter_init(client, &awaiter, flags, contextCount);
+    __await_add(client, &awaiter);
+
+    // first step is to get a status of all messages we are awaiting. Messages that are still
+    // in progress get the awaiter attached while the slot is locked, so each message is either
+    // counted here or marked by whoever completes it, never both.
     for (i = 0; i < contextCount; i++) {
-        struct gracht_message_descriptor* descriptor = gr_hashtable_get(
-                &client->messages,
-                &(struct gracht_message_descriptor) {
-                    .id = contexts[i]->message_id
-                }
-        );
+        struct gracht_message_descriptor* descriptor = gr_call_table_lock(&client->messages, contexts[i]->message_id);
         if (!descriptor) {
             // we were waiting for a non-existant message, in theory it could
             // have dissappeared?
-            awaiter->current_count++;
+            executed++;
             continue;
         }
 
-        descriptor->awaiter_id = awaiter->id;
         if (MESSAGE_STATUS_EXECUTED(descriptor->status)) {
-            awaiter->current_count++;
+            executed++;
+        } else {
+            descriptor->awaiter_id = awaiter.id;
         }
+        gr_call_table_unlock(&client->messages, descriptor);
     }
 
-    // calculate here whether we can bail early, so we can skip time
-    // not adding the awaiter
-    bail = (!(flags & GRACHT_AWAIT_ALL) && awaiter->current_count > 0) || awaiter->current_count == awaiter->count;
-
-    // add the awaiter while we hold the message lock to avoid a data-race
-    // between those
-    if (!bail) {
-        __await_add(client, awaiter);
-    }
-    mtx_unlock(&client->messages_lock);
-
     // early bail?
-    if (bail) {
+    if (__awaiter_done_count(&awaiter, atomic_fetch_add(&awaiter.current_count, executed) + executed)) {
         goto cleanup;
     }
     
     // in async bail mode we expect another thread to do the event pumping,
-    // and thus we should just use the awaiter
-    if (flags & GRACHT_AWAIT_ASYNC) {
-        mtx_lock(&awaiter->mutex);
-        cnd_wait(&awaiter->event, &awaiter->mutex);
-        mtx_unlock(&awaiter->mutex);
+    // and thus we should just use the awaiter. The same goes for when the
+    // client has a receive thread.
+    if ((flags & GRACHT_AWAIT_ASYNC) || atomic_load(&client->receiver_state) != RECEIVER_NONE) {
+        __await_event(client, &awaiter);
     } else {
         // otherwise we are a single threaded application (maybe) and we should also
         // handle the pumping of messages.
-        __await_loop(client, contexts, awaiter);
+        __await_loop(client, &awaiter);
     }
-    __await_remove(client, awaiter);
 
 cleanup:
     // cleanup the awaiter
-    free(awaiter);
+    __await_remove(client, &awaiter);
+    __awaiter_destroy(&awaiter);
     return 0;
 }
 
@@ -620,8 +1764,28 @@ int gracht_client_get_buffer(gracht_client_t* client, gracht_buffer_t* buffer)
         return -1;
     }
 
-    mtx_lock(&client->send_buffer_lock);
-    buffer->data = client->send_buffer;
+    if (client->pool) {
+        return __pooled_get_buffer(client, 0, 0, buffer);
+    }
+
+    if (client->send_buffer_count > 1) {
+        buffer->data = gr_mpmc_queue_dequeue(&client->send_buffers);
+        if (!buffer->data) {
+            // all buffers are in use, wait for one to be released
+            mtx_lock(&client->send_buffer_lock);
+            atomic_fetch_add(&client->send_buffer_waiters, 1);
+            buffer->data = gr_mpmc_queue_dequeue(&client->send_buffers);
+            while (!buffer->data) {
+                cnd_wait(&client->send_buffer_signal, &client->send_buffer_lock);
+                buffer->data = gr_mpmc_queue_dequeue(&client->send_buffers);
+            }
+            atomic_fetch_sub(&client->send_buffer_waiters, 1);
+            mtx_unlock(&client->send_buffer_lock);
+        }
+    } else {
+        mtx_lock(&client->send_buffer_lock);
+        buffer->data = client->send_buffer;
+    }
     buffer->index = 0;
     return 0;
 }
@@ -642,6 +1806,10 @@ int gracht_client_get_stream_buffer_sized(gracht_client_t* client, uint32_t requ
         return -1;
     }
 
+    if (client->pool) {
+        return __pooled_get_buffer(client, 1, requiredSize, buffer);
+    }
+
     normalizedSize = gracht_stream_normalize_buffer_size(requiredSize, client->stream_buffer_size);
     mtx_lock(&client->stream_pools_lock);
     pool = gracht_stream_pool_registry_get_or_create(&client->stream_send_pools, normalizedSize, client->stream_buffer_count);
@@ -667,42 +1835,98 @@ int gracht_client_get_status_buffer(
 {
     struct gracht_message_descriptor* descriptor;
     int                               status;
+    int                               streamBuffer;
     GRTRACE(GRSTR("gracht_client_get_status_buffer()"));
     
     if (!client || !context || !buffer) {
         errno = EINVAL;
         return -1;
     }
+
+    if (client->pool) {
+        gracht_client_t* pooled = gracht_client_pool_lookup_call(client->pool, context->connection);
+        if (!pooled) {
+            return -1;
+        }
+
+        // a completed call leaves the buffer with the caller, which releases it with
+        // gracht_client_status_finalize on the same connection
+        status = gracht_client_get_status_buffer(pooled, context, buffer);
+        if (status == GRACHT_MESSAGE_COMPLETED) {
+            __pooled_bind(client, pooled, context->connection);
+        } else {
+            gracht_client_pool_release_call(client->pool, context->connection);
+        }
+        return status;
+    }
     
     // guard against already checked
-    mtx_lock(&client->messages_lock);
-    descriptor = gr_hashtable_remove(
-            &client->messages,
-            &(struct gracht_message_descriptor) {
-                    .id = context->message_id
-            }
-    );
+    descriptor = gr_call_table_lock(&client->messages, context->message_id);
     if (!descriptor) {
-        mtx_unlock(&client->messages_lock);
         errno = ENOENT;
         return -1;
     }
     
     status = descriptor->status;
+    streamBuffer = descriptor->stream_buffer;
     buffer->data = descriptor->buffer.data;
     buffer->index = descriptor->buffer.index;
-    mtx_unlock(&client->messages_lock);
+    if (status == GRACHT_MESSAGE_ERROR && descriptor->error) {
+        errno = descriptor->error;
+    }
+    __release_call(client, descriptor);
 
     // immediately cleanup the buffer if an error has ocurred
-    if (descriptor->status == GRACHT_MESSAGE_ERROR && descriptor->buffer.data) {
-        if (descriptor->stream_buffer) {
+    if (status == GRACHT_MESSAGE_ERROR && buffer->data) {
+        if (streamBuffer) {
             mtx_lock(&client->stream_pools_lock);
-            gracht_stream_pool_registry_release(&client->stream_recv_pools, descriptor->buffer.data);
+            gracht_stream_pool_registry_release(&client->stream_recv_pools, buffer->data);
             mtx_unlock(&client->stream_pools_lock);
         } else {
-            gracht_buffer_pool_release(client->recv_pool, descriptor->buffer.data);
+            gracht_buffer_pool_release(client->recv_pool, buffer->data);
+        }
+    }
+    return status;
+}
+
+int gracht_client_get_destination_status(
+        gracht_client_t*               client,
+        struct gracht_message_context* context,
+        uint32_t*                      countOut)
+{
+    struct gracht_message_descriptor* descriptor;
+    int                               status;
+    GRTRACE(GRSTR("gracht_client_get_destination_status()"));
+
+    if (!client || !context) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (client->pool) {
+        gracht_client_t* pooled = gracht_client_pool_lookup_call(client->pool, context->connection);
+        if (!pooled) {
+            return -1;
         }
+        status = gracht_client_get_destination_status(pooled, context, countOut);
+        gracht_client_pool_release_call(client->pool, context->connection);
+        return status;
+    }
+
+    descriptor = gr_call_table_lock(&client->messages, context->message_id);
+    if (!descriptor) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    status = descriptor->status;
+    if (countOut) {
+        *countOut = descriptor->destination_count;
     }
+    if (status == GRACHT_MESSAGE_ERROR && descriptor->error) {
+        errno = descriptor->error;
+    }
+    __release_call(client, descriptor);
     return status;
 }
 
@@ -715,6 +1939,20 @@ int gracht_client_status_finalize(gracht_client_t* client, struct gracht_buffer*
         return -1;
     }
 
+    if (client->pool) {
+        gracht_client_t* pooled;
+        uint32_t         connection;
+        int              status;
+
+        pooled = __pooled_take(client, &connection);
+        if (!pooled) {
+            return -1;
+        }
+        status = gracht_client_status_finalize(pooled, buffer);
+        gracht_client_pool_release_call(client->pool, connection);
+        return status;
+    }
+
     if (buffer->data) {
         mtx_lock(&client->stream_pools_lock);
         if (!gracht_stream_pool_registry_release(&client->stream_recv_pools, buffer->data)) {
@@ -747,18 +1985,37 @@ int gracht_client_create(gracht_client_configuration_t* config, gracht_client_t*
     
     memset(client, 0, sizeof(gracht_client_t));
     mtx_init(&client->send_buffer_lock, mtx_plain);
+    mtx_init(&client->send_lock, mtx_plain);
+    cnd_init(&client->send_buffer_signal);
     mtx_init(&client->wait_lock, mtx_plain);
-    mtx_init(&client->messages_lock, mtx_plain);
+    mtx_init(&client->timers_lock, mtx_plain);
     mtx_init(&client->awaiters_lock, mtx_plain);
     mtx_init(&client->stream_pools_lock, mtx_plain);
-    gr_hashtable_construct(&client->protocols, 0, sizeof(struct gracht_protocol), protocol_hash, protocol_cmp);
-    gr_hashtable_construct(&client->messages, 0, sizeof(struct gracht_message_descriptor), message_hash, message_cmp);
+    mtx_init(&client->receiver_lock, mtx_plain);
+    cnd_init(&client->receiver_signal);
+    gr_protocol_table_construct(&client->protocols);
+    gr_call_table_construct(&client->messages, sizeof(struct gracht_message_descriptor));
     gr_hashtable_construct(&client->awaiters, 0, sizeof(struct gracht_message_awaiter_entry), awaiter_hash, awaiter_cmp);
+    gr_timer_heap_construct(&client->timers);
 
     client->link = config->link;
     client->iod = GRACHT_CONN_INVALID;
-    client->current_awaiter_id = 1;
-    client->current_message_id = 1;
+    atomic_store(&client->current_awaiter_id, 1);
+    atomic_store(&client->current_message_id, 1);
+    atomic_store(&client->receiver_state, RECEIVER_NONE);
+    atomic_store(&client->receiver_waiters, 0);
+    atomic_store(&client->destination_calls, 0);
+    client->call_timeout_ms = config->call_timeout_ms > 0 ? (uint32_t)config->call_timeout_ms : 0;
+
+    // the receive thread must be able to interrupt the link on shutdown
+    if (config->receive_thread) {
+        if (!client->link->ops.client.interrupt) {
+            GRERROR(GRSTR("gracht_client: the link does not support a receive thread"));
+            errno = ENOTSUP;
+            goto error;
+        }
+        client->receiver_enabled = 1;
+    }
 
     // handle memory sizes
     client->max_message_size = config->max_message_size;
@@ -781,9 +2038,25 @@ int gracht_client_create(gracht_client_configuration_t* config, gracht_client_t*
         bufferCount = (size_t)(poolSize / client->max_message_size);
     }
 
-    // handle send buffer configuration
+    // handle send buffer configuration, a provided buffer means there is only one
     client->send_buffer = config->send_buffer;
-    if (!client->send_buffer) {
+    if (!client->send_buffer && config->send_buffer_count > 1) {
+        int i;
+
+        client->send_buffer_storage = malloc((size_t)client->max_message_size * (size_t)config->send_buffer_count);
+        if (!client->send_buffer_storage ||
+            gr_mpmc_queue_construct(&client->send_buffers, (unsigned int)config->send_buffer_count)) {
+            GRERROR(GRSTR("gracht_client: failed to allocate memory for send buffers"));
+            errno = ENOMEM;
+            goto error;
+        }
+
+        for (i = 0; i < config->send_buffer_count; i++) {
+            gr_mpmc_queue_enqueue(&client->send_buffers,
+                (char*)client->send_buffer_storage + ((size_t)i * (size_t)client->max_message_size));
+        }
+        client->send_buffer_count = config->send_buffer_count;
+    } else if (!client->send_buffer) {
         client->send_buffer = malloc(client->max_message_size);
         if (!client->send_buffer) {
             GRERROR(GRSTR("gracht_client: failed to allocate memory for send buffer"));
@@ -835,6 +2108,15 @@ int gracht_client_connect(gracht_client_t* client)
         return -1;
     }
 
+    // the pool dials its connections itself
+    if (client->pool) {
+        if (gracht_client_pool_connected(client->pool) <= 0) {
+            errno = ENOTCONN;
+            return -1;
+        }
+        return 0;
+    }
+
     if (client->iod != GRACHT_CONN_INVALID) {
         errno = EISCONN;
         return -1;
@@ -845,6 +2127,15 @@ int gracht_client_connect(gracht_client_t* client)
         GRERROR(GRSTR("gracht_client: failed to connect client"));
         return -1;
     }
+
+    if (client->receiver_enabled) {
+        atomic_store(&client->receiver_state, RECEIVER_RUNNING);
+        if (thrd_create(&client->receiver, __receiver_main, client) != thrd_success) {
+            GRERROR(GRSTR("gracht_client: failed to create the receive thread"));
+            atomic_store(&client->receiver_state, RECEIVER_NONE);
+            return -1;
+        }
+    }
     return 0;
 }
 
@@ -854,6 +2145,18 @@ void gracht_client_shutdown(gracht_client_t* client)
         errno = EINVAL;
         return;
     }
+
+    // the handle of a pool is destroyed with the pool
+    if (client->pool) {
+        return;
+    }
+
+    // stop the receive thread before the link goes away
+    if (atomic_load(&client->receiver_state) != RECEIVER_NONE) {
+        atomic_store(&client->receiver_state, RECEIVER_STOPPING);
+        client->link->ops.client.interrupt(client->link);
+        thrd_join(client->receiver, NULL);
+    }
     
     if (client->link != NULL && client->link->ops.client.destroy != NULL) {
         client->link->ops.client.destroy(client->link);
@@ -863,6 +2166,11 @@ void gracht_client_shutdown(gracht_client_t* client)
         free(client->send_buffer);
     }
 
+    if (client->send_buffer_storage) {
+        gr_mpmc_queue_destroy(&client->send_buffers);
+        free(client->send_buffer_storage);
+    }
+
     if (client->recv_pool) {
         gracht_buffer_pool_destroy(client->recv_pool);
     }
@@ -871,22 +2179,63 @@ void gracht_client_shutdown(gracht_client_t* client)
     gracht_stream_pool_registry_destroy(&client->stream_recv_pools);
     
     gr_hashtable_destroy(&client->awaiters);
-    gr_hashtable_destroy(&client->messages);
-    gr_hashtable_destroy(&client->protocols);
+    gr_call_table_destroy(&client->messages);
+    gr_timer_heap_destroy(&client->timers);
+    gr_protocol_table_destroy(&client->protocols);
     mtx_destroy(&client->wait_lock);
     mtx_destroy(&client->stream_pools_lock);
     mtx_destroy(&client->send_buffer_lock);
-    mtx_destroy(&client->messages_lock);
+    mtx_destroy(&client->send_lock);
+    cnd_destroy(&client->send_buffer_signal);
+    mtx_destroy(&client->timers_lock);
     mtx_destroy(&client->awaiters_lock);
+    mtx_destroy(&client->receiver_lock);
+    cnd_destroy(&client->receiver_signal);
+    free(client);
+}
+
+int gracht_client_create_pooled(struct gracht_client_pool* pool, gracht_client_t** clientOut)
+{
+    gracht_client_t* client;
+
+    client = calloc(1, sizeof(gracht_client_t));
+    if (!client) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    client->iod  = GRACHT_CONN_INVALID;
+    client->pool = pool;
+    *clientOut = client;
+    return 0;
+}
+
+void gracht_client_destroy_pooled(gracht_client_t* client)
+{
     free(client);
 }
 
+int gracht_client_outstanding_calls(gracht_client_t* client)
+{
+    return gr_call_table_count(&client->messages);
+}
+
+int gracht_client_is_connected(gracht_client_t* client)
+{
+    return atomic_load(&client->receiver_state) == RECEIVER_RUNNING;
+}
+
 gracht_conn_t gracht_client_iod(gracht_client_t* client)
 {
     if (!client) {
         errno = EINVAL;
         return -1;
     }
+
+    if (client->pool) {
+        errno = ENOTSUP;
+        return -1;
+    }
     return client->iod;
 }
 
@@ -896,8 +2245,24 @@ int gracht_client_register_protocol(gracht_client_t* client, gracht_protocol_t*
         errno = EINVAL;
         return -1;
     }
+
+    if (client->pool) {
+        return gracht_client_pool_register_protocol(client->pool, protocol);
+    }
     
-    gr_hashtable_set(&client->protocols, protocol);
+    // registering a protocol again replaces the previous registration
+    return gr_protocol_table_replace(&client->protocols, protocol);
+}
+
+int gracht_client_set_call_options(gracht_client_t* client, const struct gracht_call_options* options)
+{
+    if (!client || !options) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    g_callOptionsClient = client;
+    g_callTimeoutMs     = options->timeout_ms > UINT32_MAX ? UINT32_MAX : (uint32_t)options->timeout_ms;
     return 0;
 }
 
@@ -907,8 +2272,14 @@ void gracht_client_unregister_protocol(gracht_client_t* client, gracht_protocol_
         errno = EINVAL;
         return;
     }
+
+    // protocols stay registered with the connections of a pool
+    if (client->pool) {
+        errno = ENOTSUP;
+        return;
+    }
     
-    gr_hashtable_remove(&client->protocols, protocol);
+    (void)gr_protocol_table_remove(&client->protocols, protocol);
 }
 
 static void mark_awaiters(gracht_client_t* client, uint32_t awaiterID)
@@ -916,36 +2287,37 @@ static void mark_awaiters(gracht_client_t* client, uint32_t awaiterID)
     struct gracht_message_awaiter_entry* entry;
     struct gracht_message_awaiter*       awaiter;
 
+    // keep the awaiters lock while signalling, so the awaiter cannot be removed
+    // and freed underneath us
     mtx_lock(&client->awaiters_lock);
     entry = gr_hashtable_get(
             &client->awaiters,
             &(struct gracht_message_awaiter_entry) { .id = awaiterID }
     );
-    if (!entry) {
-        mtx_unlock(&client->awaiters_lock);
-        return;
-    }
-    awaiter = entry->awaiter;
-    mtx_unlock(&client->awaiters_lock);
-
-    awaiter->current_count++;
-    if (awaiter->flags & GRACHT_AWAIT_ALL) {
-        if (awaiter->current_count == awaiter->count) {
+    if (entry) {
+        // only take the mutex when the awaiter is done, the waiter checks the count
+        // while holding it, so the signal cannot be lost
+        awaiter = entry->awaiter;
+        if (__awaiter_done_count(awaiter, atomic_fetch_add(&awaiter->current_count, 1) + 1)) {
+            mtx_lock(&awaiter->mutex);
             cnd_signal(&awaiter->event);
+            mtx_unlock(&awaiter->mutex);
         }
-    } else {
-        cnd_signal(&awaiter->event);
     }
+    mtx_unlock(&client->awaiters_lock);
 }
 
 static uint32_t get_message_id(gracht_client_t* client)
 {
-    return client->current_message_id++;
+    // messages without a response are not stored in the call table, so they get ids with a
+    // generation of 0, which can never be mistaken for the id of an outstanding call
+    return (uint32_t)atomic_fetch_add(&client->current_message_id, 1) & GR_CALL_TABLE_INDEX_MASK;
 }
 
 static uint32_t get_awaiter_id(gracht_client_t* client)
 {
-    return client->current_awaiter_id++;
+    // awaiters are created by every thread that waits, which is common with a receive thread
+    return (uint32_t)atomic_fetch_add(&client->current_awaiter_id, 1);
 }
 
 void gracht_control_error_invocation(gracht_client_t* client, const uint32_t messageId, const int errorCode)
@@ -954,15 +2326,8 @@ void gracht_control_error_invocation(gracht_client_t* client, const uint32_t mes
     uint32_t                          awaiterID;
     (void)errorCode;
 
-    mtx_lock(&client->messages_lock);
-    descriptor = gr_hashtable_get(
-            &client->messages,
-            &(struct gracht_message_descriptor) {
-                .id = messageId
-            }
-    );
+    descriptor = gr_call_table_lock(&client->messages, messageId);
     if (!descriptor) {
-        mtx_unlock(&client->messages_lock);
         // what the heck?
         GRERROR(GRSTR("gracht_control_error_invocation no-one was listening for message %u"), messageId);
         return;
@@ -970,26 +2335,17 @@ void gracht_control_error_invocation(gracht_client_t* client, const uint32_t mes
     
     // set status
     descriptor->status = GRACHT_MESSAGE_ERROR;
+    if (descriptor->completion.handler) {
+        __complete_message(client, descriptor, GRACHT_MESSAGE_ERROR, NULL);
+        return;
+    }
     awaiterID = descriptor->awaiter_id;
-    mtx_unlock(&client->messages_lock);
+    gr_call_table_unlock(&client->messages, descriptor);
     
     // iterate awaiters and mark those that contain this message
     mark_awaiters(client, awaiterID);
 }
 
-static uint64_t message_hash(const void* element)
-{
-    const struct gracht_message_descriptor* message = element;
-    return message->id;
-}
-
-static int message_cmp(const void* element1, const void* element2)
-{
-    const struct gracht_message_descriptor* message1 = element1;
-    const struct gracht_message_descriptor* message2 = element2;
-    return message1->id == message2->id ? 0 : 1;
-}
-
 static uint64_t awaiter_hash(const void* element)
 {
     const struct gracht_message_awaiter_entry* awaiter = element;
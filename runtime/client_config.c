@@ -55,3 +55,47 @@ void gracht_client_configuration_set_stream_buffer_size(gracht_client_configurat
     config->stream_buffer_size = bufferSize;
     config->stream_buffer_count = bufferCount;
 }
+
+void gracht_client_configuration_set_send_buffer_count(gracht_client_configuration_t* config, int bufferCount)
+{
+    config->send_buffer_count = bufferCount;
+}
+
+void gracht_client_configuration_set_receive_thread(gracht_client_configuration_t* config, int enable)
+{
+    config->receive_thread = enable;
+}
+
+void gracht_client_configuration_set_call_timeout(gracht_client_configuration_t* config, int timeoutMs)
+{
+    config->call_timeout_ms = timeoutMs;
+}
+
+void gracht_client_pool_configuration_init(gracht_client_pool_configuration_t* config)
+{
+    memset(config, 0, sizeof(gracht_client_pool_configuration_t));
+    gracht_client_configuration_init(&config->client_config);
+    config->connection_count = GRACHT_CLIENT_POOL_DEFAULT_CONNECTIONS;
+    config->reconnect_interval_ms = GRACHT_CLIENT_POOL_DEFAULT_INTERVAL_MS;
+}
+
+void gracht_client_pool_configuration_set_client_config(gracht_client_pool_configuration_t* config, const gracht_client_configuration_t* clientConfig)
+{
+    memcpy(&config->client_config, clientConfig, sizeof(gracht_client_configuration_t));
+}
+
+void gracht_client_pool_configuration_set_connection_count(gracht_client_pool_configuration_t* config, int connectionCount)
+{
+    config->connection_count = connectionCount;
+}
+
+void gracht_client_pool_configuration_set_link_factory(gracht_client_pool_configuration_t* config, gracht_client_pool_link_fn createLink, void* context)
+{
+    config->create_link = createLink;
+    config->link_context = context;
+}
+
+void gracht_client_pool_configuration_set_reconnect_interval(gracht_client_pool_configuration_t* config, int intervalMs)
+{
+    config->reconnect_interval_ms = intervalMs;
+}
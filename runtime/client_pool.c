@@ -0,0 +1,488 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Client Pool
+ * - Keeps a number of clients connected to the same server, and spreads calls across
+ *   them. Lost connections are redialed by a monitor thread in the background.
+ *   The handle of the pool is a client that forwards every call to a connection, the
+ *   connection a call was made on is kept in its context, so it can be awaited later.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gracht/client.h"
+#include "client_private.h"
+#include "gatomic.h"
+#include "gtime.h"
+#include "logging.h"
+#include "thread_api.h"
+#include "utils.h"
+
+#define GRACHT_CLIENT_POOL_MAX_PROTOCOLS 255
+
+// the id of a connection is its index combined with the number of times it was dialed, so
+// calls made on a connection that has been redialed since are not looked up on the new one
+#define POOL_CONNECTION_INDEX_BITS 8
+#define POOL_CONNECTION_ID(index, generation) (((generation) << POOL_CONNECTION_INDEX_BITS) | (uint32_t)(index))
+#define POOL_CONNECTION_INDEX(id)             ((int)((id) & ((1U << POOL_CONNECTION_INDEX_BITS) - 1)))
+
+enum gracht_pool_connection_state {
+    POOL_CONNECTION_DISCONNECTED = 0,
+    POOL_CONNECTION_CONNECTED,
+    POOL_CONNECTION_LOST
+};
+
+// Connections are acquired without taking any locks. A caller first announces itself in users,
+// and then only uses the client if the connection is still connected. The monitor marks a
+// connection as lost before it waits for the users to leave, so once there are no users the
+// client can no longer be reached and is safe to replace.
+struct gracht_pool_connection {
+    gracht_client_t* client;
+    atomic_int       state;
+    atomic_int       users;
+    atomic_uint      generation;
+};
+
+struct gracht_client_pool {
+    gracht_client_configuration_t  client_config;
+    gracht_client_pool_link_fn     create_link;
+    void*                          link_context;
+    int                            reconnect_interval_ms;
+    struct gracht_pool_connection* connections;
+    int                            connection_count;
+    gracht_client_t*               handle;
+    gracht_protocol_t*             protocols[GRACHT_CLIENT_POOL_MAX_PROTOCOLS];
+    int                            protocol_count;
+
+    // the lock protects the protocols and the clients of the connections, it is held by the
+    // monitor while it replaces clients
+    mtx_t                          lock;
+    cnd_t                          signal;
+    thrd_t                         monitor;
+    int                            running;
+    atomic_int                     pending;
+};
+
+static int __dial(struct gracht_client_pool* pool, struct gracht_pool_connection* connection)
+{
+    gracht_client_configuration_t config;
+    struct gracht_link*           link;
+    gracht_client_t*              client;
+    int                           i;
+
+    if (pool->create_link(pool->link_context, &link)) {
+        GRERROR(GRSTR("gracht_client_pool: failed to create link"));
+        return -1;
+    }
+
+    memcpy(&config, &pool->client_config, sizeof(gracht_client_configuration_t));
+    config.link = link;
+    if (gracht_client_create(&config, &client)) {
+        link->ops.client.destroy(link);
+        return -1;
+    }
+
+    for (i = 0; i < pool->protocol_count; i++) {
+        gracht_client_register_protocol(client, pool->protocols[i]);
+    }
+
+    if (gracht_client_connect(client)) {
+        gracht_client_shutdown(client);
+        return -1;
+    }
+
+    connection->client = client;
+    atomic_fetch_add(&connection->generation, 1);
+    atomic_store(&connection->state, POOL_CONNECTION_CONNECTED);
+    return 0;
+}
+
+// Replaces the client of a lost connection once it has no users left, calls that were
+// outstanding on it have already been failed by its receive thread
+static void __retire(struct gracht_pool_connection* connection)
+{
+    if (atomic_load(&connection->users)) {
+        return;
+    }
+
+    GRTRACE(GRSTR("gracht_client_pool: retiring lost connection"));
+    gracht_client_shutdown(connection->client);
+    connection->client = NULL;
+    atomic_store(&connection->state, POOL_CONNECTION_DISCONNECTED);
+}
+
+static void __check_connections(struct gracht_client_pool* pool)
+{
+    int i;
+
+    for (i = 0; i < pool->connection_count; i++) {
+        struct gracht_pool_connection* connection = &pool->connections[i];
+        int                            state      = atomic_load(&connection->state);
+
+        if (state == POOL_CONNECTION_CONNECTED && !gracht_client_is_connected(connection->client)) {
+            atomic_store(&connection->state, POOL_CONNECTION_LOST);
+            state = POOL_CONNECTION_LOST;
+        }
+
+        if (state == POOL_CONNECTION_LOST) {
+            __retire(connection);
+            state = atomic_load(&connection->state);
+        }
+
+        if (state == POOL_CONNECTION_DISCONNECTED) {
+            (void)__dial(pool, connection);
+        }
+    }
+}
+
+static void __wait_interval(struct gracht_client_pool* pool)
+{
+    struct timespec ts;
+    uint64_t        interval = (uint64_t)pool->reconnect_interval_ms * 1000000ULL;
+
+    timespec_get(&ts, TIME_UTC);
+    ts.tv_sec  += (time_t)(interval / 1000000000ULL);
+    ts.tv_nsec += (long)(interval % 1000000000ULL);
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+
+    while (pool->running && !atomic_load(&pool->pending)) {
+        if (cnd_timedwait(&pool->signal, &pool->lock, &ts) != thrd_success) {
+            break;
+        }
+    }
+}
+
+static int __monitor_main(void* context)
+{
+    struct gracht_client_pool* pool = context;
+    GRTRACE(GRSTR("gracht_client_pool: monitor running"));
+
+    mtx_lock(&pool->lock);
+    while (pool->running) {
+        atomic_store(&pool->pending, 0);
+        __check_connections(pool);
+        __wait_interval(pool);
+    }
+    mtx_unlock(&pool->lock);
+    GRTRACE(GRSTR("gracht_client_pool: monitor exitting"));
+    return 0;
+}
+
+// Callers never block on the monitor, if it is busy the request is picked up by its next pass
+static void __wake_monitor(struct gracht_client_pool* pool)
+{
+    atomic_store(&pool->pending, 1);
+    if (mtx_trylock(&pool->lock) == thrd_success) {
+        cnd_signal(&pool->signal);
+        mtx_unlock(&pool->lock);
+    }
+}
+
+int gracht_client_pool_create(gracht_client_pool_configuration_t* config, gracht_client_pool_t** poolOut)
+{
+    struct gracht_client_pool* pool;
+    int                        connected = 0;
+    int                        i;
+
+    if (!config || !config->create_link || !poolOut) {
+        GRERROR(GRSTR("gracht_client_pool: config or link factory was null"));
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (config->connection_count > GRACHT_CLIENT_POOL_MAX_CONNECTIONS) {
+        GRERROR(GRSTR("gracht_client_pool: too many connections requested"));
+        errno = EINVAL;
+        return -1;
+    }
+
+    pool = calloc(1, sizeof(struct gracht_client_pool));
+    if (!pool) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    pool->connection_count = config->connection_count > 0 ? config->connection_count : GRACHT_CLIENT_POOL_DEFAULT_CONNECTIONS;
+    pool->connections = calloc((size_t)pool->connection_count, sizeof(struct gracht_pool_connection));
+    if (!pool->connections) {
+        free(pool);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // buffers provided by the caller can not be shared between the connections
+    memcpy(&pool->client_config, &config->client_config, sizeof(gracht_client_configuration_t));
+    pool->client_config.link = NULL;
+    pool->client_config.send_buffer = NULL;
+    pool->client_config.recv_buffer = NULL;
+    pool->client_config.receive_thread = 1;
+    pool->create_link = config->create_link;
+    pool->link_context = config->link_context;
+    pool->reconnect_interval_ms = config->reconnect_interval_ms > 0 ?
+        config->reconnect_interval_ms : GRACHT_CLIENT_POOL_DEFAULT_INTERVAL_MS;
+    mtx_init(&pool->lock, mtx_plain);
+    cnd_init(&pool->signal);
+
+    if (gracht_client_create_pooled(pool, &pool->handle)) {
+        gracht_client_pool_destroy(pool);
+        return -1;
+    }
+
+    for (i = 0; i < pool->connection_count; i++) {
+        if (!__dial(pool, &pool->connections[i])) {
+            connected++;
+        }
+    }
+
+    if (!connected) {
+        GRERROR(GRSTR("gracht_client_pool: failed to connect to the server"));
+        gracht_client_pool_destroy(pool);
+        errno = ENOTCONN;
+        return -1;
+    }
+
+    pool->running = 1;
+    if (thrd_create(&pool->monitor, __monitor_main, pool) != thrd_success) {
+        GRERROR(GRSTR("gracht_client_pool: failed to create the monitor thread"));
+        pool->running = 0;
+        gracht_client_pool_destroy(pool);
+        return -1;
+    }
+
+    *poolOut = pool;
+    return 0;
+}
+
+void gracht_client_pool_destroy(gracht_client_pool_t* pool)
+{
+    int i;
+
+    if (!pool) {
+        return;
+    }
+
+    mtx_lock(&pool->lock);
+    if (pool->running) {
+        pool->running = 0;
+        cnd_signal(&pool->signal);
+        mtx_unlock(&pool->lock);
+        thrd_join(pool->monitor, NULL);
+    } else {
+        mtx_unlock(&pool->lock);
+    }
+
+    for (i = 0; i < pool->connection_count; i++) {
+        if (pool->connections[i].client) {
+            gracht_client_shutdown(pool->connections[i].client);
+        }
+    }
+
+    gracht_client_destroy_pooled(pool->handle);
+    mtx_destroy(&pool->lock);
+    cnd_destroy(&pool->signal);
+    free(pool->connections);
+    free(pool);
+}
+
+int gracht_client_pool_register_protocol(gracht_client_pool_t* pool, gracht_protocol_t* protocol)
+{
+    int i;
+
+    if (!pool || !protocol) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    mtx_lock(&pool->lock);
+    for (i = 0; i < pool->protocol_count; i++) {
+        if (pool->protocols[i]->id == protocol->id) {
+            break;
+        }
+    }
+
+    if (i == GRACHT_CLIENT_POOL_MAX_PROTOCOLS) {
+        mtx_unlock(&pool->lock);
+        errno = ENOSPC;
+        return -1;
+    }
+
+    // registering a protocol again replaces the previous registration
+    pool->protocols[i] = protocol;
+    if (i == pool->protocol_count) {
+        pool->protocol_count++;
+    }
+
+    for (i = 0; i < pool->connection_count; i++) {
+        if (pool->connections[i].client) {
+            gracht_client_register_protocol(pool->connections[i].client, protocol);
+        }
+    }
+    mtx_unlock(&pool->lock);
+    return 0;
+}
+
+static struct gracht_pool_connection* __acquire(struct gracht_client_pool* pool)
+{
+    struct gracht_pool_connection* best = NULL;
+    int                            bestCount = 0;
+    int                            lost = 0;
+    int                            i;
+
+    for (i = 0; i < pool->connection_count; i++) {
+        struct gracht_pool_connection* connection = &pool->connections[i];
+        int                            count;
+
+        atomic_fetch_add(&connection->users, 1);
+        if (atomic_load(&connection->state) != POOL_CONNECTION_CONNECTED) {
+            atomic_fetch_sub(&connection->users, 1);
+            continue;
+        }
+
+        if (!gracht_client_is_connected(connection->client)) {
+            atomic_fetch_sub(&connection->users, 1);
+            lost = 1;
+            continue;
+        }
+
+        count = gracht_client_outstanding_calls(connection->client);
+        if (best && count >= bestCount) {
+            atomic_fetch_sub(&connection->users, 1);
+            continue;
+        }
+
+        if (best) {
+            atomic_fetch_sub(&best->users, 1);
+        }
+        best = connection;
+        bestCount = count;
+    }
+
+    // let the monitor redial lost connections right away instead of at the next interval
+    if (lost) {
+        __wake_monitor(pool);
+    }
+
+    if (!best) {
+        errno = ENOTCONN;
+    }
+    return best;
+}
+
+gracht_client_t* gracht_client_pool_acquire(gracht_client_pool_t* pool)
+{
+    struct gracht_pool_connection* connection;
+
+    if (!pool) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    connection = __acquire(pool);
+    return connection ? connection->client : NULL;
+}
+
+void gracht_client_pool_release(gracht_client_pool_t* pool, gracht_client_t* client)
+{
+    int i;
+
+    if (!pool || !client) {
+        errno = EINVAL;
+        return;
+    }
+
+    for (i = 0; i < pool->connection_count; i++) {
+        if (pool->connections[i].client == client) {
+            atomic_fetch_sub(&pool->connections[i].users, 1);
+            return;
+        }
+    }
+    GRWARNING(GRSTR("gracht_client_pool: released a client that is not part of the pool"));
+}
+
+gracht_client_t* gracht_client_pool_handle(gracht_client_pool_t* pool)
+{
+    if (!pool) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return pool->handle;
+}
+
+gracht_client_t* gracht_client_pool_acquire_call(struct gracht_client_pool* pool, uint32_t* connectionOut)
+{
+    struct gracht_pool_connection* connection = __acquire(pool);
+    int                            index;
+
+    if (!connection) {
+        return NULL;
+    }
+
+    // the generation is stored before the connection is marked connected, and it cannot
+    // be redialed while we are a user
+    index = (int)(connection - pool->connections);
+    *connectionOut = POOL_CONNECTION_ID(index, atomic_load(&connection->generation));
+    return connection->client;
+}
+
+gracht_client_t* gracht_client_pool_lookup_call(struct gracht_client_pool* pool, uint32_t connectionId)
+{
+    struct gracht_pool_connection* connection;
+    int                            index = POOL_CONNECTION_INDEX(connectionId);
+
+    if (index >= pool->connection_count) {
+        errno = ENOTCONN;
+        return NULL;
+    }
+
+    // calls of a lost connection have already been failed, and their slots are gone with the client
+    connection = &pool->connections[index];
+    atomic_fetch_add(&connection->users, 1);
+    if (atomic_load(&connection->state) != POOL_CONNECTION_CONNECTED ||
+        POOL_CONNECTION_ID(index, atomic_load(&connection->generation)) != connectionId) {
+        atomic_fetch_sub(&connection->users, 1);
+        errno = ENOTCONN;
+        return NULL;
+    }
+    return connection->client;
+}
+
+void gracht_client_pool_release_call(struct gracht_client_pool* pool, uint32_t connectionId)
+{
+    atomic_fetch_sub(&pool->connections[POOL_CONNECTION_INDEX(connectionId)].users, 1);
+}
+
+int gracht_client_pool_connected(gracht_client_pool_t* pool)
+{
+    int connected = 0;
+    int i;
+
+    if (!pool) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < pool->connection_count; i++) {
+        if (atomic_load(&pool->connections[i].state) == POOL_CONNECTION_CONNECTED) {
+            connected++;
+        }
+    }
+    return connected;
+}
@@ -0,0 +1,542 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Client Registry
+ * - Hashtable of connected clients that is read without locks. The writers are serialized
+ *   by a mutex and publish all changes with atomic stores, so readers always see a consistent
+ *   chain. Clients are kept in reference counted records, and the table only links to them.
+ *   Memory that readers may still reference is retired, and reclaimed once every reader slot
+ *   has drained the read sections that were started before it (two-phase counters). Nothing
+ *   ever waits for that, reclaiming is retried whenever the registry is changed.
+ */
+
+#include <errno.h>
+#include "client_registry.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+#define REGISTRY_MINIMUM_BUCKETS 64
+
+struct gr_client_retired {
+    struct gr_client_retired* next;
+    void                    (*destroy)(struct gr_client_retired*);
+};
+
+struct gr_client_record {
+    struct gr_client_retired retired;
+    atomic_uint              references;
+    struct gr_client_entry   entry;
+};
+
+struct gr_client_node {
+    struct gr_client_retired retired;
+    atomic_uintptr_t         next;
+    struct gr_client_record* record;
+};
+
+struct gr_client_table {
+    struct gr_client_retired retired;
+    size_t                   mask;
+    atomic_uintptr_t         buckets[];
+};
+
+// the reader slot is assigned the first time a thread enters a read section
+static __TLS_VAR unsigned int g_readerSlot = 0;
+static atomic_uint            g_readerSlotCount = 0;
+
+static inline size_t handle_bucket(struct gr_client_table* table, gracht_conn_t handle)
+{
+    // fibonacci hashing spreads sequential keys (like descriptors) evenly
+    return (size_t)((((uint64_t)handle) * 0x9E3779B97F4A7C15ULL) >> 32) & table->mask;
+}
+
+static inline struct gr_client_record* entry_record(struct gr_client_entry* entry)
+{
+    return (struct gr_client_record*)((char*)entry - offsetof(struct gr_client_record, entry));
+}
+
+static void retired_free(struct gr_client_retired* retired)
+{
+    free(retired);
+}
+
+// Frees the table and the nodes in it, the records are only freed if the table owns them.
+static void table_free(struct gr_client_table* table, int records)
+{
+    size_t i;
+
+    for (i = 0; i <= table->mask; i++) {
+        struct gr_client_node* node = (struct gr_client_node*)atomic_load(&table->buckets[i]);
+        while (node) {
+            struct gr_client_node* next = (struct gr_client_node*)atomic_load(&node->next);
+            if (records) {
+                free(node->record);
+            }
+            free(node);
+            node = next;
+        }
+    }
+    free(table);
+}
+
+static void table_retired_free(struct gr_client_retired* retired)
+{
+    table_free((struct gr_client_table*)retired, 0);
+}
+
+static struct gr_client_table* table_create(size_t bucketCount)
+{
+    struct gr_client_table* table;
+    size_t                  i;
+
+    table = malloc(sizeof(struct gr_client_table) + (sizeof(atomic_uintptr_t) * bucketCount));
+    if (!table) {
+        return NULL;
+    }
+
+    table->retired.next    = NULL;
+    table->retired.destroy = table_retired_free;
+    table->mask            = bucketCount - 1;
+    for (i = 0; i < bucketCount; i++) {
+        atomic_store(&table->buckets[i], 0);
+    }
+    return table;
+}
+
+static struct gr_client_node* node_create(struct gr_client_record* record)
+{
+    struct gr_client_node* node = malloc(sizeof(struct gr_client_node));
+    if (!node) {
+        return NULL;
+    }
+
+    node->retired.next    = NULL;
+    node->retired.destroy = retired_free;
+    node->record          = record;
+    atomic_store(&node->next, 0);
+    return node;
+}
+
+static void table_insert(struct gr_client_table* table, struct gr_client_node* node)
+{
+    size_t bucket = handle_bucket(table, node->record->entry.handle);
+
+    // the node must be fully initialized before it is published to readers
+    atomic_store(&node->next, atomic_load(&table->buckets[bucket]));
+    atomic_store(&table->buckets[bucket], (uintptr_t)node);
+}
+
+int gr_client_registry_construct(struct gr_client_registry* registry, gr_client_registry_enumfn released, void* context)
+{
+    struct gr_client_table* table;
+    int                     i;
+
+    if (!registry) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    table = table_create(REGISTRY_MINIMUM_BUCKETS);
+    if (!table) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    atomic_store(&registry->table, (uintptr_t)table);
+    atomic_store(&registry->phase, 0);
+    mtx_init(&registry->writer_lock, mtx_plain);
+    mtx_init(&registry->sync_lock, mtx_plain);
+    registry->count            = 0;
+    registry->released         = released;
+    registry->released_context = context;
+    registry->retired          = NULL;
+    registry->reclaiming       = NULL;
+    registry->reclaim_phase    = 0;
+    registry->reclaim_round    = 0;
+    for (i = 0; i < GR_CLIENT_REGISTRY_READERS; i++) {
+        atomic_store(&registry->readers[i].active[0], 0);
+        atomic_store(&registry->readers[i].active[1], 0);
+    }
+    return 0;
+}
+
+static void retired_list_free(struct gr_client_retired* retired)
+{
+    while (retired) {
+        struct gr_client_retired* next = retired->next;
+        retired->destroy(retired);
+        retired = next;
+    }
+}
+
+void gr_client_registry_destroy(struct gr_client_registry* registry)
+{
+    if (!registry) {
+        return;
+    }
+
+    retired_list_free(registry->reclaiming);
+    retired_list_free(registry->retired);
+    table_free((struct gr_client_table*)atomic_load(&registry->table), 1);
+    mtx_destroy(&registry->sync_lock);
+    mtx_destroy(&registry->writer_lock);
+}
+
+unsigned int gr_client_registry_read_lock(struct gr_client_registry* registry)
+{
+    unsigned int slot = g_readerSlot;
+    unsigned int phase;
+
+    if (!slot) {
+        slot = atomic_fetch_add(&g_readerSlotCount, 1) + 1;
+        g_readerSlot = slot;
+    }
+    slot = (slot - 1) % GR_CLIENT_REGISTRY_READERS;
+
+    // the counter is incremented before anything is read from the table, so a writer that
+    // has not yet seen the counter is guaranteed to have published its changes before our reads
+    phase = atomic_load(&registry->phase);
+    atomic_fetch_add(&registry->readers[slot].active[phase], 1);
+    return (slot << 1) | phase;
+}
+
+void gr_client_registry_read_unlock(struct gr_client_registry* registry, unsigned int section)
+{
+    atomic_fetch_sub(&registry->readers[section >> 1].active[section & 1], 1);
+}
+
+static int registry_readers_active(struct gr_client_registry* registry, unsigned int phase)
+{
+    int i;
+
+    for (i = 0; i < GR_CLIENT_REGISTRY_READERS; i++) {
+        if (atomic_load(&registry->readers[i].active[phase])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static unsigned int registry_flip_phase(struct gr_client_registry* registry)
+{
+    unsigned int phase = atomic_load(&registry->phase);
+    atomic_store(&registry->phase, phase ^ 1);
+    return phase;
+}
+
+// Frees the retired memory once all read sections that were active when it was retired have
+// ended. The phase is flipped twice, as readers can have read the phase right before the first
+// flip and still increment the counter of the old phase after we checked it. Read sections are
+// short, so this never waits for them, it is simply tried again the next time.
+static void registry_reclaim(struct gr_client_registry* registry)
+{
+    struct gr_client_retired* expired = NULL;
+
+    mtx_lock(&registry->sync_lock);
+    for (;;) {
+        if (!registry->reclaiming) {
+            if (!registry->retired) {
+                break;
+            }
+            registry->reclaiming    = registry->retired;
+            registry->retired       = NULL;
+            registry->reclaim_phase = registry_flip_phase(registry);
+            registry->reclaim_round = 0;
+        }
+
+        if (registry_readers_active(registry, registry->reclaim_phase)) {
+            break;
+        }
+
+        if (!registry->reclaim_round) {
+            registry->reclaim_phase = registry_flip_phase(registry);
+            registry->reclaim_round = 1;
+            continue;
+        }
+
+        // the grace period has ended, so nothing can reference the memory anymore
+        while (registry->reclaiming) {
+            struct gr_client_retired* next = registry->reclaiming->next;
+            registry->reclaiming->next = expired;
+            expired = registry->reclaiming;
+            registry->reclaiming = next;
+        }
+    }
+    mtx_unlock(&registry->sync_lock);
+    retired_list_free(expired);
+}
+
+static void registry_retire(struct gr_client_registry* registry, struct gr_client_retired* retired)
+{
+    mtx_lock(&registry->sync_lock);
+    retired->next     = registry->retired;
+    registry->retired = retired;
+    mtx_unlock(&registry->sync_lock);
+}
+
+struct gr_client_entry* gr_client_registry_get(struct gr_client_registry* registry, gracht_conn_t handle)
+{
+    struct gr_client_table* table = (struct gr_client_table*)atomic_load(&registry->table);
+    struct gr_client_node*  node;
+
+    node = (struct gr_client_node*)atomic_load(&table->buckets[handle_bucket(table, handle)]);
+    while (node) {
+        if (node->record->entry.handle == handle) {
+            return &node->record->entry;
+        }
+        node = (struct gr_client_node*)atomic_load(&node->next);
+    }
+    return NULL;
+}
+
+struct gr_client_entry* gr_client_registry_acquire(struct gr_client_registry* registry, gracht_conn_t handle)
+{
+    struct gr_client_entry* entry;
+    unsigned int            section;
+
+    if (!registry) {
+        return NULL;
+    }
+
+    section = gr_client_registry_read_lock(registry);
+    entry   = gr_client_registry_get(registry, handle);
+    if (entry) {
+        // a removed client can still be found until the removal is published, but once its
+        // last reference is gone it must not be revived
+        struct gr_client_record* record     = entry_record(entry);
+        unsigned int             references = atomic_load(&record->references);
+        do {
+            if (!references) {
+                entry = NULL;
+                break;
+            }
+        } while (!atomic_compare_exchange_strong(&record->references, &references, references + 1));
+    }
+    gr_client_registry_read_unlock(registry, section);
+    return entry;
+}
+
+void gr_client_registry_release(struct gr_client_registry* registry, struct gr_client_entry* entry)
+{
+    struct gr_client_record* record;
+
+    if (!registry || !entry) {
+        return;
+    }
+
+    record = entry_record(entry);
+    if (atomic_fetch_sub(&record->references, 1) != 1) {
+        return;
+    }
+
+    if (registry->released) {
+        registry->released(entry, registry->released_context);
+    }
+    registry_retire(registry, &record->retired);
+    registry_reclaim(registry);
+}
+
+void gr_client_registry_enumerate(struct gr_client_registry* registry, gr_client_registry_enumfn callback, void* context)
+{
+    struct gr_client_table* table;
+    unsigned int            section;
+    size_t                  i;
+
+    if (!registry || !callback) {
+        return;
+    }
+
+    section = gr_client_registry_read_lock(registry);
+    table   = (struct gr_client_table*)atomic_load(&registry->table);
+    for (i = 0; i <= table->mask; i++) {
+        struct gr_client_node* node = (struct gr_client_node*)atomic_load(&table->buckets[i]);
+        while (node) {
+            callback(&node->record->entry, context);
+            node = (struct gr_client_node*)atomic_load(&node->next);
+        }
+    }
+    gr_client_registry_read_unlock(registry, section);
+}
+
+// Replaces the table with one of twice the size, the old table is still being read and is
+// retired instead. The new table links to the same records, so references stay valid.
+static int registry_grow(struct gr_client_registry* registry, struct gr_client_table* table)
+{
+    struct gr_client_table* newTable;
+    size_t                  i;
+
+    newTable = table_create((table->mask + 1) * 2);
+    if (!newTable) {
+        return -1;
+    }
+
+    for (i = 0; i <= table->mask; i++) {
+        struct gr_client_node* node = (struct gr_client_node*)atomic_load(&table->buckets[i]);
+        while (node) {
+            struct gr_client_node* copy = node_create(node->record);
+            if (!copy) {
+                table_free(newTable, 0);
+                return -1;
+            }
+            table_insert(newTable, copy);
+            node = (struct gr_client_node*)atomic_load(&node->next);
+        }
+    }
+
+    atomic_store(&registry->table, (uintptr_t)newTable);
+    registry_retire(registry, &table->retired);
+    return 0;
+}
+
+int gr_client_registry_add(struct gr_client_registry* registry, const struct gr_client_entry* entry)
+{
+    struct gr_client_table*  table;
+    struct gr_client_record* record;
+    struct gr_client_node*   node;
+
+    if (!registry || !entry) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    record = malloc(sizeof(struct gr_client_record));
+    if (!record) {
+        errno = ENOMEM;
+        return -1;
+    }
+    record->retired.next    = NULL;
+    record->retired.destroy = retired_free;
+    record->entry           = *entry;
+    atomic_store(&record->references, 1);
+
+    node = node_create(record);
+    if (!node) {
+        free(record);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    mtx_lock(&registry->writer_lock);
+    if (gr_client_registry_get(registry, entry->handle)) {
+        mtx_unlock(&registry->writer_lock);
+        free(node);
+        free(record);
+        errno = EEXIST;
+        return -1;
+    }
+
+    // keep the chains short, failing to grow just means longer chains
+    table = (struct gr_client_table*)atomic_load(&registry->table);
+    if (registry->count >= (table->mask + 1) * 2) {
+        if (!registry_grow(registry, table)) {
+            table = (struct gr_client_table*)atomic_load(&registry->table);
+        }
+    }
+
+    table_insert(table, node);
+    registry->count++;
+    mtx_unlock(&registry->writer_lock);
+    registry_reclaim(registry);
+    return 0;
+}
+
+// Unlinks all matching nodes from the chain, must be called with the writer lock held.
+// Readers may be traversing the nodes, so their links are left untouched.
+static struct gr_client_node* registry_unlink(struct gr_client_registry* registry, atomic_uintptr_t* link,
+    gr_client_registry_matchfn match, void* context, struct gr_client_node* removed)
+{
+    struct gr_client_node* node = (struct gr_client_node*)atomic_load(link);
+
+    while (node) {
+        if (match(&node->record->entry, context)) {
+            atomic_store(link, atomic_load(&node->next));
+            node->retired.next = (struct gr_client_retired*)removed;
+            removed = node;
+            registry->count--;
+        } else {
+            link = &node->next;
+        }
+        node = (struct gr_client_node*)atomic_load(&node->next);
+    }
+    return removed;
+}
+
+// Retires the unlinked nodes and releases the references the registry held on their clients.
+static int registry_release_nodes(struct gr_client_registry* registry, struct gr_client_node* nodes)
+{
+    int count = 0;
+
+    while (nodes) {
+        struct gr_client_node*   next   = (struct gr_client_node*)nodes->retired.next;
+        struct gr_client_record* record = nodes->record;
+
+        registry_retire(registry, &nodes->retired);
+        gr_client_registry_release(registry, &record->entry);
+        nodes = next;
+        count++;
+    }
+    registry_reclaim(registry);
+    return count;
+}
+
+int gr_client_registry_remove_if(struct gr_client_registry* registry, gr_client_registry_matchfn match, void* context)
+{
+    struct gr_client_node*  nodes = NULL;
+    struct gr_client_table* table;
+    size_t                  i;
+
+    if (!registry || !match) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    mtx_lock(&registry->writer_lock);
+    table = (struct gr_client_table*)atomic_load(&registry->table);
+    for (i = 0; i <= table->mask; i++) {
+        nodes = registry_unlink(registry, &table->buckets[i], match, context, nodes);
+    }
+    mtx_unlock(&registry->writer_lock);
+    return registry_release_nodes(registry, nodes);
+}
+
+static int match_handle(struct gr_client_entry* entry, void* context)
+{
+    return entry->handle == *((gracht_conn_t*)context);
+}
+
+int gr_client_registry_remove(struct gr_client_registry* registry, gracht_conn_t handle)
+{
+    struct gr_client_node*  node;
+    struct gr_client_table* table;
+
+    if (!registry) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    mtx_lock(&registry->writer_lock);
+    table = (struct gr_client_table*)atomic_load(&registry->table);
+    node  = registry_unlink(registry, &table->buckets[handle_bucket(table, handle)], match_handle, &handle, NULL);
+    mtx_unlock(&registry->writer_lock);
+
+    if (!node) {
+        errno = ENOENT;
+        return -1;
+    }
+    registry_release_nodes(registry, node);
+    return 0;
+}
@@ -16,53 +16,57 @@
  *
  *
  * Gracht Server Dispatcher
+ * - Work-stealing worker pool. Every worker owns a bounded lock-free queue that
+ *   the reactors dispatch into, workers that run out of work steal from the
+ *   queues of the other workers before parking. Messages that must be handled
+ *   in order are put in a separate pinned queue, which is never stolen from.
  */
 
+#include "gatomic.h"
 #include "logging.h"
 #include "thread_api.h"
-#include "queue.h"
+#include "mpmc_queue.h"
+#include "parker.h"
 #include "server_private.h"
 #include <errno.h>
 #include <stdlib.h>
 
-enum gracht_worker_state {
-    WORKER_STARTUP = 0,
-    WORKER_ALIVE,
-    WORKER_SHUTDOWN_REQUEST,
-    WORKER_SHUTDOWN
+enum gracht_pool_state {
+    POOL_RUNNING = 0,
+    POOL_SHUTDOWN
 };
 
 struct gracht_worker {
-    thrd_t          id;
-    mtx_t           sync_object;
-    struct gr_queue job_queue;
-    cnd_t           signal;
-    int             state;
-};
-
-struct gracht_worker_context {
-    struct gracht_worker* worker;
-    struct gracht_server* server;
+    thrd_t                     id;
+    int                        index;
+    struct gracht_worker_pool* pool;
+    struct gr_mpmc_queue       job_queue;
+    struct gr_mpmc_queue       pinned_queue;
+    struct gr_parker           parker;
+    unsigned int               steal_seed;
 };
 
 struct gracht_worker_pool {
+    struct gracht_server* server;
     struct gracht_worker* workers;
     int                   worker_count;
-    int                   rr_index; // no loadbalancing atm
+    atomic_uint           rr_index;
+    atomic_int            parked_count;
+    atomic_int            state;
 };
 
 static int  worker_dowork(void*);
-static void initialize_worker(struct gracht_server*, struct gracht_worker*);
+static int  initialize_worker(struct gracht_worker_pool*, struct gracht_worker*, int, int);
 static void cleanup_worker(struct gracht_worker*);
 
-int gracht_worker_pool_create(struct gracht_server* server, int numberOfWorkers, struct gracht_worker_pool** poolOut)
+int gracht_worker_pool_create(struct gracht_server* server, int numberOfWorkers, int queueDepth, struct gracht_worker_pool** poolOut)
 {
     struct gracht_worker_pool* pool;
     struct gracht_worker*      workers;
     size_t                     allocSize;
     int                        i;
 
-    if (!poolOut || numberOfWorkers < 0) {
+    if (!poolOut || numberOfWorkers <= 0 || queueDepth < 0) {
         errno = EINVAL;
         return -1;
     }
@@ -81,11 +85,29 @@ int gracht_worker_pool_create(struct gracht_server* server, int numberOfWorkers,
         return -1;
     }
 
-    pool->workers = workers;
+    pool->server       = server;
+    pool->workers      = workers;
     pool->worker_count = numberOfWorkers;
-    pool->rr_index = 0;
+    atomic_store(&pool->rr_index, 0);
+    atomic_store(&pool->parked_count, 0);
+    atomic_store(&pool->state, POOL_RUNNING);
+
+    // all queues must exist before any worker starts, as workers steal from each other
     for (i = 0; i < numberOfWorkers; i++) {
-        initialize_worker(server, &pool->workers[i]);
+        if (initialize_worker(pool, &pool->workers[i], i, queueDepth > 0 ? queueDepth : SERVER_WORKER_DEFAULT_QUEUE_SIZE)) {
+            while (i--) {
+                cleanup_worker(&pool->workers[i]);
+            }
+            free(workers);
+            free(pool);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < numberOfWorkers; i++) {
+        if (thrd_create(&pool->workers[i].id, worker_dowork, &pool->workers[i]) != thrd_success) {
+            GRERROR(GRSTR("gracht_worker_pool_create: failed to create worker-thread"));
+        }
     }
 
     *poolOut = pool;
@@ -94,20 +116,38 @@ int gracht_worker_pool_create(struct gracht_server* server, int numberOfWorkers,
 
 void gracht_worker_pool_destroy(struct gracht_worker_pool* pool)
 {
-    int exitCode;
-    int i;
+    struct gracht_message* job;
+    int                    exitCode;
+    int                    i;
 
     if (!pool) {
         return;
     }
 
-    // destroy pool of workers
+    // request shutdown of all workers
+    atomic_store(&pool->state, POOL_SHUTDOWN);
     for (i = 0; i < pool->worker_count; i++) {
-        pool->workers[i].state = WORKER_SHUTDOWN_REQUEST;
-        cnd_signal(&pool->workers[i].signal);
+        gr_parker_unpark(&pool->workers[i].parker);
+    }
 
-        // wait for cleanup
+    // wait for cleanup
+    for (i = 0; i < pool->worker_count; i++) {
         thrd_join(pool->workers[i].id, &exitCode);
+    }
+
+    // destroy any outstanding messages, as no one is left to steal them
+    for (i = 0; i < pool->worker_count; i++) {
+        job = gr_mpmc_queue_dequeue(&pool->workers[i].job_queue);
+        while (job) {
+            server_cleanup_message(pool->server, job);
+            job = gr_mpmc_queue_dequeue(&pool->workers[i].job_queue);
+        }
+
+        job = gr_mpmc_queue_dequeue(&pool->workers[i].pinned_queue);
+        while (job) {
+            server_cleanup_message(pool->server, job);
+            job = gr_mpmc_queue_dequeue(&pool->workers[i].pinned_queue);
+        }
         cleanup_worker(&pool->workers[i]);
     }
 
@@ -116,101 +156,176 @@ void gracht_worker_pool_destroy(struct gracht_worker_pool* pool)
     free(pool);
 }
 
-void gracht_worker_pool_dispatch(struct gracht_worker_pool* pool, struct gracht_message* recvMessage)
+static void wake_idle_worker(struct gracht_worker_pool* pool)
 {
-    struct gracht_worker* worker;
+    for (int i = 0; i < pool->worker_count; i++) {
+        if (gr_parker_unpark(&pool->workers[i].parker)) {
+            break;
+        }
+    }
+}
+
+int gracht_worker_pool_dispatch(struct gracht_worker_pool* pool, struct gracht_message* recvMessage)
+{
+    struct gracht_worker* worker = NULL;
+    unsigned int          start;
+    int                   i;
 
     if (!pool || !recvMessage) {
-        return;
+        errno = EINVAL;
+        return -1;
     }
 
-    worker = &pool->workers[pool->rr_index];
-    mtx_lock(&worker->sync_object);
-    gr_queue_enqueue(&worker->job_queue, recvMessage);
-    mtx_unlock(&worker->sync_object);
-    cnd_signal(&worker->signal);
+    // distribute new work in round robin fashion, and skip workers that have a full queue
+    start = atomic_fetch_add(&pool->rr_index, 1);
+    for (i = 0; i < pool->worker_count; i++) {
+        struct gracht_worker* candidate = &pool->workers[(start + (unsigned int)i) % (unsigned int)pool->worker_count];
+        if (!gr_mpmc_queue_enqueue(&candidate->job_queue, recvMessage)) {
+            worker = candidate;
+            break;
+        }
+    }
+
+    if (!worker) {
+        errno = ENOENT;
+        return -1;
+    }
 
-    // increase round robin index and handle limit
-    pool->rr_index++;
-    if (pool->rr_index == pool->worker_count) {
-        pool->rr_index = 0;
+    // wake up the worker if it was parked, otherwise if it is busy and there are idle
+    // workers around, then wake one of those so it can steal the work
+    if (!gr_parker_unpark(&worker->parker) && atomic_load(&pool->parked_count) > 0) {
+        wake_idle_worker(pool);
     }
+    return 0;
 }
 
-static void initialize_worker(struct gracht_server* server, struct gracht_worker* worker)
+int gracht_worker_pool_dispatch_affinity(struct gracht_worker_pool* pool, struct gracht_message* recvMessage, uint64_t key)
 {
-    struct gracht_worker_context* context;
+    struct gracht_worker* worker;
 
-    context = malloc(sizeof(struct gracht_worker_context));
-    if (!context) {
-        GRERROR(GRSTR("initialize_worker: failed to allocate memory for worker context"));
-        return;
+    if (!pool || !recvMessage) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // fibonacci hashing spreads sequential keys (like descriptors) evenly
+    key *= 0x9E3779B97F4A7C15ULL;
+    worker = &pool->workers[(key >> 32) % (uint64_t)pool->worker_count];
+    if (gr_mpmc_queue_enqueue(&worker->pinned_queue, recvMessage)) {
+        errno = ENOENT;
+        return -1;
     }
 
-    context->worker = worker;
-    context->server = server;
+    // only the owner can handle pinned messages, so no reason to wake anyone else
+    gr_parker_unpark(&worker->parker);
+    return 0;
+}
 
-    gr_queue_construct(&worker->job_queue, SERVER_WORKER_DEFAULT_QUEUE_SIZE);
-    mtx_init(&worker->sync_object, mtx_plain);
-    cnd_init(&worker->signal);
-    worker->state = WORKER_STARTUP;
+static int initialize_worker(struct gracht_worker_pool* pool, struct gracht_worker* worker, int index, int queueDepth)
+{
+    if (gr_mpmc_queue_construct(&worker->job_queue, (unsigned int)queueDepth)) {
+        GRERROR(GRSTR("initialize_worker: failed to allocate memory for worker queue"));
+        return -1;
+    }
 
-    if (thrd_create(&worker->id, worker_dowork, context) != thrd_success) {
-        GRERROR(GRSTR("initialize_worker: failed to create worker-thread"));
+    if (gr_mpmc_queue_construct(&worker->pinned_queue, (unsigned int)queueDepth)) {
+        GRERROR(GRSTR("initialize_worker: failed to allocate memory for worker queue"));
+        gr_mpmc_queue_destroy(&worker->job_queue);
+        return -1;
     }
+
+    gr_parker_init(&worker->parker);
+    worker->index      = index;
+    worker->pool       = pool;
+    worker->steal_seed = 0x9E3779B9U * (unsigned int)(index + 1);
+    return 0;
 }
 
 static void cleanup_worker(struct gracht_worker* worker)
 {
-    mtx_destroy(&worker->sync_object);
-    cnd_destroy(&worker->signal);
-    gr_queue_destroy(&worker->job_queue);
+    gr_parker_destroy(&worker->parker);
+    gr_mpmc_queue_destroy(&worker->pinned_queue);
+    gr_mpmc_queue_destroy(&worker->job_queue);
+}
+
+static struct gracht_message* worker_steal(struct gracht_worker* worker)
+{
+    struct gracht_worker_pool* pool = worker->pool;
+    unsigned int               start;
+    int                        i;
+
+    if (pool->worker_count == 1) {
+        return NULL;
+    }
+
+    // start at a pseudo-random victim, so thieves do not all hit the same worker
+    worker->steal_seed ^= worker->steal_seed << 13;
+    worker->steal_seed ^= worker->steal_seed >> 17;
+    worker->steal_seed ^= worker->steal_seed << 5;
+    start = worker->steal_seed;
+
+    for (i = 0; i < pool->worker_count; i++) {
+        struct gracht_worker*  victim = &pool->workers[(start + (unsigned int)i) % (unsigned int)pool->worker_count];
+        struct gracht_message* job;
+
+        if (victim == worker) {
+            continue;
+        }
+
+        job = gr_mpmc_queue_dequeue(&victim->job_queue);
+        if (job) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+static struct gracht_message* worker_find_job(struct gracht_worker* worker)
+{
+    struct gracht_message* job = gr_mpmc_queue_dequeue(&worker->pinned_queue);
+    if (!job) {
+        job = gr_mpmc_queue_dequeue(&worker->job_queue);
+    }
+    if (!job) {
+        job = worker_steal(worker);
+    }
+    return job;
 }
 
 static int worker_dowork(void* context)
 {
-    struct gracht_worker_context* workerContext = context;
-    struct gracht_message*        job;
-    struct gracht_worker*         worker;
+    struct gracht_worker*      worker = context;
+    struct gracht_worker_pool* pool   = worker->pool;
+    struct gracht_message*     job;
     GRTRACE(GRSTR("worker_dowork: running"));
 
-    worker = workerContext->worker;
-    worker->state = WORKER_ALIVE;
-    while (1) {
-        mtx_lock(&worker->sync_object);
-        job = gr_queue_dequeue(&worker->job_queue);
+    while (atomic_load(&pool->state) == POOL_RUNNING) {
+        job = worker_find_job(worker);
         if (!job) {
-            cnd_wait(&worker->signal, &worker->sync_object);
-            if (worker->state == WORKER_SHUTDOWN_REQUEST) {
-                worker->state = WORKER_SHUTDOWN;
-                mtx_unlock(&worker->sync_object);
-                break;
+            // announce that we are going idle before checking the queues one final time, any
+            // work that is dispatched after this point will see that we are parked.
+            gr_parker_prepare(&worker->parker);
+            atomic_fetch_add(&pool->parked_count, 1);
+
+            job = worker_find_job(worker);
+            if (!job && atomic_load(&pool->state) == POOL_RUNNING) {
+                gr_parker_wait(&worker->parker);
+            } else {
+                gr_parker_cancel(&worker->parker);
             }
+            atomic_fetch_sub(&pool->parked_count, 1);
 
-            job = gr_queue_dequeue(&worker->job_queue);
-            // assert(job_header != NULL);
+            if (!job) {
+                continue;
+            }
         }
-        mtx_unlock(&worker->sync_object);
 
         // handle the job
         GRTRACE(GRSTR("worker_dowork: handling message"));
-        server_invoke_action(workerContext->server, job);
-        server_cleanup_message(workerContext->server, job);
-
-        // check again at exit of iteration
-        if (worker->state == WORKER_SHUTDOWN_REQUEST) {
-            worker->state = WORKER_SHUTDOWN;
-            break;
-        }
+        server_invoke_action(pool->server, job);
+        server_cleanup_message(pool->server, job);
+        server_notify_capacity(pool->server);
     }
     GRTRACE(GRSTR("worker_dowork: shutting down"));
-
-    job = gr_queue_dequeue(&worker->job_queue);
-    while (job) {
-        server_cleanup_message(workerContext->server, job);
-        job = gr_queue_dequeue(&worker->job_queue);
-    }
-
-    free(workerContext);
     return 0;
 }
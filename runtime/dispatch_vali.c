@@ -34,10 +34,11 @@ struct gracht_worker_pool {
     struct gracht_server*  server;
 };
 
-int gracht_worker_pool_create(struct gracht_server* server, int numberOfWorkers, struct gracht_worker_pool** poolOut)
+int gracht_worker_pool_create(struct gracht_server* server, int numberOfWorkers, int queueDepth, struct gracht_worker_pool** poolOut)
 {
     struct gracht_worker_pool* pool;
     _CRT_UNUSED(numberOfWorkers);
+    _CRT_UNUSED(queueDepth);
 
     pool = malloc(sizeof(struct gracht_worker_pool));
     if (pool == NULL) {
@@ -86,10 +87,20 @@ static struct handle_context* __handle_context_new(struct gracht_server* server,
     return context;
 }
 
-void gracht_worker_pool_dispatch(struct gracht_worker_pool* pool, struct gracht_message* recvMessage)
+int gracht_worker_pool_dispatch(struct gracht_worker_pool* pool, struct gracht_message* recvMessage)
 {
     if (!pool || !recvMessage) {
-        return;
+        errno = EINVAL;
+        return -1;
     }
     usched_job_queue(__handle_message, __handle_context_new(pool->server, recvMessage));
+    return 0;
+}
+
+int gracht_worker_pool_dispatch_affinity(struct gracht_worker_pool* pool, struct gracht_message* recvMessage, uint64_t key)
+{
+    // the green threads are scheduled cooperatively in the order they were queued, and
+    // there is no notion of workers to pin messages to
+    (void)key;
+    return gracht_worker_pool_dispatch(pool, recvMessage);
 }
@@ -44,18 +44,11 @@ static int socket_link_send_stream(struct gracht_link_socket* link,
     return 0;
 }
 
-static int socket_link_peek_header(struct gracht_link_socket* link,
-    uint32_t* messageLengthOut, uint8_t* serviceIdOut, unsigned int flags)
+static int socket_link_peek_raw(struct gracht_link_socket* link, uint8_t* header, unsigned int flags)
 {
     unsigned int socketFlags = 0;
-    uint8_t      header[GRACHT_MESSAGE_HEADER_SIZE];
     intmax_t     bytesRead;
 
-    if (!messageLengthOut || !serviceIdOut) {
-        errno = EINVAL;
-        return -1;
-    }
-
 #ifdef _WIN32
     __set_nonblocking_if_needed(link->base.connection, flags);
 #endif
@@ -80,15 +73,32 @@ static int socket_link_peek_header(struct gracht_link_socket* link,
         return -1;
     }
 
-    *messageLengthOut = *((uint32_t*)&header[MSG_INDEX_LEN]);
-    *serviceIdOut = header[MSG_INDEX_SID];
-    if (*messageLengthOut < GRACHT_MESSAGE_HEADER_SIZE) {
+    if (*((uint32_t*)&header[MSG_INDEX_LEN]) < GRACHT_MESSAGE_HEADER_SIZE) {
         errno = EPROTO;
         return -1;
     }
     return 0;
 }
 
+static int socket_link_peek_header(struct gracht_link_socket* link,
+    uint32_t* messageLengthOut, uint8_t* serviceIdOut, unsigned int flags)
+{
+    uint8_t header[GRACHT_MESSAGE_HEADER_SIZE];
+
+    if (!messageLengthOut || !serviceIdOut) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (socket_link_peek_raw(link, &header[0], flags)) {
+        return -1;
+    }
+
+    *messageLengthOut = *((uint32_t*)&header[MSG_INDEX_LEN]);
+    *serviceIdOut = header[MSG_INDEX_SID];
+    return 0;
+}
+
 static int socket_link_recv_stream(struct gracht_link_socket* link,
     struct gracht_buffer* message, unsigned int flags)
 {
@@ -124,6 +134,52 @@ static int socket_link_recv_stream(struct gracht_link_socket* link,
     return 0;
 }
 
+// Only the stream recv is split up, as a packet must be received in one go
+static int socket_link_recv_stream_vectored(struct gracht_link_socket* link,
+    struct gracht_iovec* vectors, int count, unsigned int flags)
+{
+    size_t expected = 0;
+    int    i;
+
+#if defined(__linux__)
+    struct iovec  iov[GRACHT_LINK_MAX_VECTORS];
+    struct msghdr msg = { 0 };
+    ssize_t       bytesRead;
+
+    if (count > GRACHT_LINK_MAX_VECTORS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        iov[i].iov_base = vectors[i].data;
+        iov[i].iov_len  = vectors[i].length;
+        expected += vectors[i].length;
+    }
+    msg.msg_iov    = &iov[0];
+    msg.msg_iovlen = (size_t)count;
+
+    bytesRead = recvmsg(link->base.connection, &msg, (int)flags);
+    if (bytesRead < 0 || (size_t)bytesRead != expected) {
+        GRERROR(GRSTR("[socket_link_recv_stream_vectored] did not read full amount of bytes (%li, expected %u)"),
+              (long)bytesRead, (uint32_t)expected);
+        errno = bytesRead == 0 ? ENODATA : EPIPE;
+        return -1;
+    }
+#else
+    for (i = 0; i < count; i++) {
+        long bytesRead = (long)recv(link->base.connection, vectors[i].data, vectors[i].length, flags | MSG_WAITALL);
+        if (bytesRead < 0 || (uint32_t)bytesRead != vectors[i].length) {
+            errno = bytesRead == 0 ? ENODATA : EPIPE;
+            return -1;
+        }
+        expected += vectors[i].length;
+    }
+    (void)expected;
+#endif
+    return 0;
+}
+
 static int socket_link_send_packet(struct gracht_link_socket* link, struct gracht_buffer* message)
 {
     intmax_t byteCount;
@@ -140,6 +196,64 @@ static int socket_link_send_packet(struct gracht_link_socket* link, struct grach
     return 0;
 }
 
+#if defined(__linux__)
+// Sends the message from all the segments with as few calls to sendmsg as possible. Stream
+// sockets may take the message in parts, while packets are always sent in one go.
+static int socket_link_send_vectored(struct gracht_link_socket* link,
+    struct gracht_iovec* vectors, int count, void* messageContext)
+{
+    struct iovec  iov[GRACHT_LINK_MAX_VECTORS];
+    struct msghdr msg = { 0 };
+    size_t        expected = 0;
+    ssize_t       bytesWritten;
+    int           i;
+
+    // not used for socket
+    (void)messageContext;
+
+    if (count > GRACHT_LINK_MAX_VECTORS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        iov[i].iov_base = vectors[i].data;
+        iov[i].iov_len  = vectors[i].length;
+        expected += vectors[i].length;
+    }
+    msg.msg_iov    = &iov[0];
+    msg.msg_iovlen = (size_t)count;
+
+    GRTRACE(GRSTR("link_client: send message (%u) in %i segments"), (uint32_t)expected, count);
+    while (msg.msg_iovlen) {
+        bytesWritten = sendmsg(link->base.connection, &msg, 0);
+        if (bytesWritten < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (bytesWritten <= 0 || (link->base.type == gracht_link_packet_based && (size_t)bytesWritten != expected)) {
+            GRERROR(GRSTR("link_client: failed to send message, bytes sent: %li, expected: %u (%i)"),
+                  (long)bytesWritten, (uint32_t)expected, errno);
+            errno = (EPIPE);
+            return -1;
+        }
+
+        // skip past everything that was written, and continue with the rest of the message
+        while (msg.msg_iovlen && (size_t)bytesWritten >= msg.msg_iov->iov_len) {
+            bytesWritten -= (ssize_t)msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+
+        if (msg.msg_iovlen) {
+            msg.msg_iov->iov_base = (char*)msg.msg_iov->iov_base + bytesWritten;
+            msg.msg_iov->iov_len -= (size_t)bytesWritten;
+        }
+    }
+    return 0;
+}
+#endif
+
 static int socket_link_recv_packet(struct gracht_link_socket* link, struct gracht_buffer* message, unsigned int flags)
 {
     // important to use the address we receive from (i.e 
@@ -252,6 +366,23 @@ static int socket_link_send(struct gracht_link_socket* link,
     }
 }
 
+static int socket_link_recv_vectored(struct gracht_link_socket* link,
+    struct gracht_iovec* vectors, int count, unsigned int flags)
+{
+    (void)flags;
+
+    if (link->base.type != gracht_link_stream_based) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    // the header has been peeked by the caller, so always wait for the rest of the message
+#ifdef _WIN32
+    __set_nonblocking_if_needed(link->base.connection, GRACHT_MESSAGE_BLOCK);
+#endif
+    return socket_link_recv_stream_vectored(link, vectors, count, MSG_WAITALL);
+}
+
 static int socket_link_peek(struct gracht_link_socket* link,
     uint32_t* messageLengthOut, uint8_t* serviceIdOut, unsigned int flags)
 {
@@ -262,6 +393,28 @@ static int socket_link_peek(struct gracht_link_socket* link,
     return socket_link_peek_header(link, messageLengthOut, serviceIdOut, flags);
 }
 
+#ifdef socket_poll
+static int socket_link_poll(struct gracht_link_socket* link, int timeoutMs)
+{
+    struct pollfd pfd = { .fd = link->base.connection, .events = POLLIN };
+    int           status;
+
+    status = socket_poll(&pfd, 1, timeoutMs);
+    if (status == 0) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return status < 0 ? -1 : 0;
+}
+#endif
+
+static void socket_link_interrupt(struct gracht_link_socket* link)
+{
+    if (link->base.connection != GRACHT_CONN_INVALID) {
+        shutdown(link->base.connection, SHUT_RDWR);
+    }
+}
+
 static void socket_link_destroy(struct gracht_link_socket* link)
 {
     if (!link) {
@@ -276,9 +429,18 @@ static void socket_link_destroy(struct gracht_link_socket* link)
 
 void gracht_link_client_socket_api(struct gracht_link_socket* link)
 {
-    link->base.ops.client.connect = (client_link_connect_fn)socket_link_connect;
-    link->base.ops.client.recv    = (client_link_recv_fn)socket_link_recv;
-    link->base.ops.client.send    = (client_link_send_fn)socket_link_send;
-    link->base.ops.client.peek    = (client_link_peek_fn)socket_link_peek;
-    link->base.ops.client.destroy = (client_link_destroy_fn)socket_link_destroy;
+    link->base.ops.client.connect       = (client_link_connect_fn)socket_link_connect;
+    link->base.ops.client.recv          = (client_link_recv_fn)socket_link_recv;
+    link->base.ops.client.send          = (client_link_send_fn)socket_link_send;
+    link->base.ops.client.peek          = (client_link_peek_fn)socket_link_peek;
+    link->base.ops.client.destroy       = (client_link_destroy_fn)socket_link_destroy;
+    link->base.ops.client.interrupt     = (client_link_interrupt_fn)socket_link_interrupt;
+    link->base.ops.client.peek_header   = (client_link_peek_header_fn)socket_link_peek_raw;
+    link->base.ops.client.recv_vectored = (client_link_recv_vectored_fn)socket_link_recv_vectored;
+#if defined(__linux__)
+    link->base.ops.client.send_vectored = (client_link_send_vectored_fn)socket_link_send_vectored;
+#endif
+#ifdef socket_poll
+    link->base.ops.client.poll          = (client_link_poll_fn)socket_link_poll;
+#endif
 }
@@ -25,7 +25,9 @@
 #include "gracht/link/socket.h"
 #include "logging.h"
 #include "crc.h"
+#include "recv_ring.h"
 #include "server_private.h"
+#include "thread_api.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -38,6 +40,26 @@ struct socket_link_client {
     gracht_conn_t               socket;
     gracht_conn_t               link;
     int                         streaming;
+#ifndef _WIN32
+    // data received from the connection, messages are handed out directly from the ring. The
+    // ring is grown for messages that do not fit, and shrunk to <rx_size> once it is drained.
+    struct gr_recv_ring*        rx_ring;
+    size_t                      rx_size;
+#endif
+#ifdef GRACHT_SOCKET_HAS_SEND_QUEUE
+    // data the connection could not take yet, senders append to the queue while it holds
+    // data and the reactor writes it out once the connection is writable again
+    mtx_t                       tx_lock;
+    cnd_t                       tx_drained;
+    char*                       tx_buffer;
+    size_t                      tx_head;
+    size_t                      tx_tail;
+    size_t                      tx_capacity;
+    size_t                      tx_low_water;
+    size_t                      tx_high_water;
+    gracht_handle_t             set_handle;
+    int                         tx_watching;
+#endif
 #ifdef _WIN32
     WSABUF                      waitbuf;
     uint8_t                     headerbuf[GRACHT_MESSAGE_HEADER_SIZE];
@@ -100,6 +122,218 @@ static unsigned int get_socket_flags(unsigned int flags)
     return socketFlags;
 }
 
+#ifdef GRACHT_SOCKET_HAS_SEND_QUEUE
+static size_t socket_link_tx_pending(struct socket_link_client* client)
+{
+    return client->tx_tail - client->tx_head;
+}
+
+// Makes room for <length> bytes more in the send queue, the send lock must be held. The queue is
+// compacted before it is grown, as the written part of the queue is only reclaimed once it is empty.
+static int socket_link_tx_reserve(struct socket_link_client* client, size_t length)
+{
+    if (client->tx_head && client->tx_tail + length > client->tx_capacity) {
+        memmove(client->tx_buffer, &client->tx_buffer[client->tx_head], socket_link_tx_pending(client));
+        client->tx_tail -= client->tx_head;
+        client->tx_head  = 0;
+    }
+
+    if (client->tx_tail + length > client->tx_capacity) {
+        size_t capacity = client->tx_capacity ? client->tx_capacity * 2 : 4096;
+        char*  buffer;
+
+        while (capacity < client->tx_tail + length) {
+            capacity *= 2;
+        }
+
+        buffer = realloc(client->tx_buffer, capacity);
+        if (!buffer) {
+            errno = ENOMEM;
+            return -1;
+        }
+        client->tx_buffer   = buffer;
+        client->tx_capacity = capacity;
+    }
+    return 0;
+}
+
+// Appends data to the send queue, room must have been reserved for it.
+static void socket_link_tx_append(struct socket_link_client* client, const char* data, size_t length)
+{
+    memcpy(&client->tx_buffer[client->tx_tail], data, length);
+    client->tx_tail += length;
+}
+
+// Writes as much of the send queue as the connection will take, the send lock must be held.
+// Returns -1 and sets errno to EAGAIN if data is left in the queue.
+static int socket_link_tx_write(struct socket_link_client* client)
+{
+    while (client->tx_head < client->tx_tail) {
+        intmax_t bytesWritten = send(client->base.handle, &client->tx_buffer[client->tx_head],
+            socket_link_tx_pending(client), MSG_DONTWAIT);
+        if (bytesWritten < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EWOULDBLOCK) {
+                errno = EAGAIN;
+            }
+            return -1;
+        }
+        client->tx_head += (size_t)bytesWritten;
+    }
+
+    client->tx_head = 0;
+    client->tx_tail = 0;
+    return 0;
+}
+
+// The watch is set again every time data is left, as pausing the connection removes it from
+// the set, and resuming it again does not restore the watch.
+static void socket_link_tx_watch(struct socket_link_client* client, int enable)
+{
+    if (!enable && !client->tx_watching) {
+        return;
+    }
+
+    if (socket_aio_watch_write(client->set_handle, client->base.handle, enable)) {
+        GRTRACE(GRSTR("socket_link_tx_watch failed to update watch for %i: %i"), client->base.handle, errno);
+    }
+    client->tx_watching = enable;
+}
+
+// Waits until no more than <limit> bytes are left in the send queue. The send lock must be held,
+// and is released while waiting, so the reactor keeps flushing the connection and signals us once
+// the queue is below the low watermark. The queue is also written from here at every interval, which
+// keeps senders on the reactor itself going, and the wait ends once the connection is closed.
+static int socket_link_tx_drain(struct socket_link_client* client, size_t limit)
+{
+    while (socket_link_tx_pending(client) > limit) {
+        if (!socket_link_tx_write(client)) {
+            break;
+        } else if (errno != EAGAIN) {
+            return -1;
+        }
+
+        if (socket_closed(client->base.handle)) {
+            errno = EPIPE;
+            return -1;
+        }
+
+        socket_link_tx_watch(client, 1);
+        socket_wait_interval(&client->tx_drained, &client->tx_lock, GRACHT_SOCKET_DRAIN_INTERVAL_MS);
+    }
+    return 0;
+}
+
+// Sends the message on a connection with a send queue. The message is written directly when
+// nothing is queued, and whatever the connection cannot take is copied to the queue, as the
+// message segments are returned to the server once we return. Coalesced messages are always
+// queued, and the server flushes the queue, so the queue is then written with a single send.
+static int socket_link_send_queued(struct socket_link_client* client,
+    struct gracht_iovec* vectors, int count, unsigned int flags)
+{
+    struct iovec  iov[GRACHT_LINK_MAX_VECTORS];
+    struct msghdr msg = { 0 };
+    size_t        length = 0;
+    size_t        pending;
+    intmax_t      bytesWritten = 0;
+    int           i;
+
+    if (count > GRACHT_LINK_MAX_VECTORS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        iov[i].iov_base = vectors[i].data;
+        iov[i].iov_len  = vectors[i].length;
+        length += vectors[i].length;
+    }
+    msg.msg_iov    = &iov[0];
+    msg.msg_iovlen = (size_t)count;
+
+    mtx_lock(&client->tx_lock);
+    pending = socket_link_tx_pending(client);
+    if (pending && pending + length > client->tx_high_water) {
+        if (!(flags & GRACHT_MESSAGE_BLOCK)) {
+            mtx_unlock(&client->tx_lock);
+            errno = EAGAIN;
+            return -1;
+        }
+
+        if (socket_link_tx_drain(client, client->tx_low_water)) {
+            mtx_unlock(&client->tx_lock);
+            return -1;
+        }
+        pending = socket_link_tx_pending(client);
+    }
+
+    if (!pending && !(flags & GRACHT_MESSAGE_COALESCE)) {
+        do {
+            bytesWritten = sendmsg(client->base.handle, &msg, MSG_DONTWAIT);
+        } while (bytesWritten < 0 && errno == EINTR);
+
+        if (bytesWritten < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                mtx_unlock(&client->tx_lock);
+                return -1;
+            }
+            bytesWritten = 0;
+        }
+    }
+
+    if ((size_t)bytesWritten < length) {
+        size_t skip = (size_t)bytesWritten;
+
+        // the rest of the message is queued in its entirety or not at all
+        if (socket_link_tx_reserve(client, length - skip)) {
+            mtx_unlock(&client->tx_lock);
+            GRERROR(GRSTR("socket_link_send_queued failed to queue %zu bytes"), length - skip);
+            return -1;
+        }
+
+        for (i = 0; i < count; i++) {
+            if (skip >= vectors[i].length) {
+                skip -= vectors[i].length;
+                continue;
+            }
+            socket_link_tx_append(client, (const char*)vectors[i].data + skip, vectors[i].length - skip);
+            skip = 0;
+        }
+
+        if (!(flags & GRACHT_MESSAGE_COALESCE)) {
+            socket_link_tx_watch(client, 1);
+        }
+    }
+    mtx_unlock(&client->tx_lock);
+    return 0;
+}
+
+static int socket_link_flush_client(struct socket_link_client* client)
+{
+    int status;
+
+    if (!client->streaming) {
+        return 0;
+    }
+
+    mtx_lock(&client->tx_lock);
+    status = socket_link_tx_write(client);
+    if (!status) {
+        socket_link_tx_watch(client, 0);
+    } else if (errno == EAGAIN) {
+        socket_link_tx_watch(client, 1);
+    }
+
+    if (socket_link_tx_pending(client) <= client->tx_low_water) {
+        cnd_broadcast(&client->tx_drained);
+    }
+    mtx_unlock(&client->tx_lock);
+    return status;
+}
+#endif
+
 static int socket_link_send_client(struct socket_link_client* client,
     struct gracht_buffer* message, unsigned int flags)
 {
@@ -107,6 +341,13 @@ static int socket_link_send_client(struct socket_link_client* client,
     intmax_t     bytesWritten;
     GRTRACE(GRSTR("socket_link_send_client(fd=%i, len=%u, flags=0x%x)"), client->base.handle, message->index, socketFlags);
 
+#ifdef GRACHT_SOCKET_HAS_SEND_QUEUE
+    if (client->streaming) {
+        struct gracht_iovec vector = { &message->data[0], message->index };
+        return socket_link_send_queued(client, &vector, 1, flags);
+    }
+#endif
+
 #ifdef _WIN32
     __set_nonblocking_if_needed(client->base.handle, flags);
 #endif
@@ -118,6 +359,41 @@ static int socket_link_send_client(struct socket_link_client* client,
     return 0;
 }
 
+#ifdef GRACHT_SOCKET_HAS_SEND_QUEUE
+static int socket_link_send_client_vectored(struct socket_link_client* client,
+    struct gracht_iovec* vectors, int count, unsigned int flags)
+{
+    struct iovec  iov[GRACHT_LINK_MAX_VECTORS];
+    struct msghdr msg = { 0 };
+    size_t        length = 0;
+    intmax_t      bytesWritten;
+    int           i;
+
+    if (client->streaming) {
+        return socket_link_send_queued(client, vectors, count, flags);
+    }
+
+    if (count > GRACHT_LINK_MAX_VECTORS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        iov[i].iov_base = vectors[i].data;
+        iov[i].iov_len  = vectors[i].length;
+        length += vectors[i].length;
+    }
+    msg.msg_iov    = &iov[0];
+    msg.msg_iovlen = (size_t)count;
+
+    bytesWritten = sendmsg(client->base.handle, &msg, (int)get_socket_flags(flags));
+    if (bytesWritten < 0 || (size_t)bytesWritten != length) {
+        return -1;
+    }
+    return 0;
+}
+#endif
+
 static int socket_link_peek_socket(gracht_conn_t socket,
     uint32_t* messageLengthOut, uint8_t* serviceIdOut, unsigned int flags)
 {
@@ -154,12 +430,208 @@ static int socket_link_peek_socket(gracht_conn_t socket,
     return 0;
 }
 
+#ifndef _WIN32
+// Makes sure at least <length> bytes are buffered for the client. Everything that is
+// available on the connection (and fits) is read with a single call to recv. If the ring
+// is completely occupied by messages that are still being handled, ENOSPC is returned.
+static int socket_link_rx_fill(struct socket_link_client* client, size_t length, unsigned int flags)
+{
+    char*    data;
+    char*    space;
+    size_t   available = gr_recv_ring_peek(client->rx_ring, &data);
+    size_t   spaceLength;
+    intmax_t bytesRead;
+
+    if (available >= length) {
+        return 0;
+    }
+
+    spaceLength = gr_recv_ring_space(client->rx_ring, &space);
+    if (!spaceLength) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    bytesRead = recv(client->base.handle, space, spaceLength, get_socket_flags(flags));
+    if (bytesRead <= 0) {
+        if (bytesRead == 0) {
+            errno = ENODATA;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            errno = EPIPE;
+        }
+        return -1;
+    }
+
+    gr_recv_ring_produce(client->rx_ring, (size_t)bytesRead);
+    if ((available + (size_t)bytesRead) < length) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return 0;
+}
+
+static int socket_link_rx_header(struct socket_link_client* client, uint32_t* lengthOut, unsigned int flags)
+{
+    char* data;
+
+    if (socket_link_rx_fill(client, GRACHT_MESSAGE_HEADER_SIZE, flags)) {
+        return -1;
+    }
+
+    (void)gr_recv_ring_peek(client->rx_ring, &data);
+    *lengthOut = *((uint32_t*)&data[MSG_INDEX_LEN]);
+    if (*lengthOut < GRACHT_MESSAGE_HEADER_SIZE) {
+        errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+// Replaces the ring with one of the given size, the data that has not been handed out yet is
+// moved along. Messages that are still being handled keep the previous ring alive.
+static int socket_link_rx_resize(struct socket_link_client* client, size_t size)
+{
+    struct gr_recv_ring* ring;
+    char*                data;
+    char*                space;
+    size_t               available;
+
+    available = gr_recv_ring_peek(client->rx_ring, &data);
+    if (size < available) {
+        size = available;
+    }
+
+    if (gr_recv_ring_create(size, GRACHT_SOCKET_RECV_RING_SLOTS, &ring)) {
+        return -1;
+    }
+
+    (void)gr_recv_ring_space(ring, &space);
+    memcpy(space, data, available);
+    gr_recv_ring_produce(ring, available);
+
+    gr_recv_ring_put(client->rx_ring);
+    client->rx_ring = ring;
+    return 0;
+}
+
+static int socket_link_rx_recv(struct socket_link_client* client, struct gracht_message* context, unsigned int flags)
+{
+    char*    data;
+    uint32_t length;
+
+    if (socket_link_rx_header(client, &length, flags)) {
+        return -1;
+    }
+
+    // the ring could not be grown for the message, and it can not be received without blocking
+    if (length > client->rx_ring->capacity) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    // partial messages are left in the ring until the rest of it arrives
+    if (socket_link_rx_fill(client, length, flags)) {
+        return -1;
+    }
+
+    (void)gr_recv_ring_peek(client->rx_ring, &data);
+    memcpy(&context->payload[0], data, length);
+    gr_recv_ring_consume(client->rx_ring, length);
+
+    GRTRACE(GRSTR("socket_link_recv_client message id %u, length of message %u"), 
+        *((uint32_t*)&context->payload[0]), length);
+
+    // ->server is set by server
+    context->link   = client->link;
+    context->client = client->socket;
+    context->index  = 0;
+    context->rsize  = 0;
+    context->size   = length;
+    return 0;
+}
+#endif
+
 static int socket_link_peek_client(struct socket_link_client* client,
     uint32_t* messageLengthOut, uint8_t* serviceIdOut, unsigned int flags)
 {
+#ifndef _WIN32
+    if (client->rx_ring) {
+        char* data;
+
+        if (!messageLengthOut || !serviceIdOut) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        if (socket_link_rx_header(client, messageLengthOut, flags)) {
+            return -1;
+        }
+
+        (void)gr_recv_ring_peek(client->rx_ring, &data);
+        *serviceIdOut = (uint8_t)data[MSG_INDEX_SID];
+        return 0;
+    }
+#endif
     return socket_link_peek_socket(client->base.handle, messageLengthOut, serviceIdOut, flags);
 }
 
+// Hands out the next message directly from the receive ring, without copying it. The ring is grown
+// for messages that are larger than it, if that fails they must be received through
+// socket_link_recv_client instead.
+static int socket_link_recv_client_inplace(struct socket_link_client* client,
+    struct gracht_message** messageOut, unsigned int flags)
+{
+#ifndef _WIN32
+    struct gracht_message* message;
+    char*                  data;
+    uint32_t               length;
+
+    if (!client->rx_ring) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    // a ring that was grown for a large message is shrunk again once it has been drained
+    if (client->rx_ring->capacity > client->rx_size && !gr_recv_ring_peek(client->rx_ring, &data)) {
+        (void)socket_link_rx_resize(client, client->rx_size);
+    }
+
+    if (socket_link_rx_header(client, &length, flags)) {
+        return -1;
+    }
+
+    if (length > client->rx_ring->capacity && socket_link_rx_resize(client, length)) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    // partial messages are left in the ring until the rest of it arrives
+    if (socket_link_rx_fill(client, length, flags)) {
+        return -1;
+    }
+
+    message = gr_recv_ring_take(client->rx_ring, length);
+    if (!message) {
+        return -1;
+    }
+
+    GRTRACE(GRSTR("socket_link_recv_client_inplace message id %u, length of message %u"), 
+        *((uint32_t*)&message->payload[0]), length);
+
+    // ->server is set by server
+    message->link   = client->link;
+    message->client = client->socket;
+    *messageOut = message;
+    return 0;
+#else
+    (void)client;
+    (void)messageOut;
+    (void)flags;
+    errno = ENOBUFS;
+    return -1;
+#endif
+}
+
 static int socket_link_recv_client(struct socket_link_client* client,
     struct gracht_message* context, unsigned int flags)
 {
@@ -197,6 +669,10 @@ static int socket_link_recv_client(struct socket_link_client* client,
         }
     }
 #else
+    if (client->rx_ring) {
+        return socket_link_rx_recv(client, context, flags);
+    }
+
     bytesRead = recv(client->base.handle, &context->payload[0], GRACHT_MESSAGE_HEADER_SIZE, socketFlags);
     if (bytesRead != GRACHT_MESSAGE_HEADER_SIZE) {
         if (bytesRead == 0) {
@@ -280,14 +756,24 @@ static int socket_link_destroy_client(struct socket_link_client* client, gracht_
         return -1;
     }
     
-    // remove the client if the client is a streaming one
-    if (client->streaming) {
+    // remove the client if the client is a streaming one, and the server has not done so already
+    if (client->streaming && set_handle != GRACHT_HANDLE_INVALID) {
         status = socket_aio_remove(set_handle, client->socket);
         if (status) {
             GRWARNING(GRSTR("socket_link_destroy_client failed to remove client socket from set_handle"));
         }
     }
     status = close(client->base.handle);
+#ifndef _WIN32
+    gr_recv_ring_put(client->rx_ring);
+#endif
+#ifdef GRACHT_SOCKET_HAS_SEND_QUEUE
+    if (client->streaming) {
+        mtx_destroy(&client->tx_lock);
+        cnd_destroy(&client->tx_drained);
+        free(client->tx_buffer);
+    }
+#endif
     free(client);
     return status;
 }
@@ -348,6 +834,18 @@ static gracht_conn_t socket_link_setup(struct gracht_link_socket* link, gracht_h
             return GRACHT_CONN_INVALID;
         }
         
+#if defined(SO_REUSEPORT) && !defined(_WIN32)
+        // Sharded links listen on the same address from multiple reactors, and
+        // let the kernel spread the incoming connections between them.
+        if (link->reuse_port) {
+            int enable = 1;
+            status = setsockopt(link->base.connection, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(int));
+            if (status) {
+                GRWARNING(GRSTR("socket_link_setup failed to enable SO_REUSEPORT"));
+            }
+        }
+#endif
+
         status = bind(link->base.connection,
             (const struct sockaddr*)&link->bind_address, link->bind_address_length);
         if (status) {
@@ -461,6 +959,23 @@ static int socket_link_accept(
     client->base.handle    = client->socket;
     client->streaming      = 1;
     client->address_length = address_length;
+#ifdef GRACHT_SOCKET_HAS_SEND_QUEUE
+    mtx_init(&client->tx_lock, mtx_plain);
+    cnd_init(&client->tx_drained);
+    client->tx_low_water  = link->send_low_water;
+    client->tx_high_water = link->send_high_water;
+    client->set_handle    = set_handle;
+#endif
+
+    // the receive ring is optional, without it messages are read directly from the socket
+    if (link->recv_buffer_size >= GRACHT_MESSAGE_HEADER_SIZE) {
+        if (gr_recv_ring_create(link->recv_buffer_size, GRACHT_SOCKET_RECV_RING_SLOTS, &client->rx_ring)) {
+            GRWARNING(GRSTR("socket_link_accept failed to create the receive ring: %i"), errno);
+            client->rx_ring = NULL;
+        } else {
+            client->rx_size = client->rx_ring->capacity;
+        }
+    }
     
     status = socket_aio_add(set_handle, client->socket);
     if (status) {
@@ -637,6 +1152,37 @@ static void socket_link_destroy(struct gracht_link_socket* link, gracht_handle_t
     free(link);
 }
 
+static struct gracht_link_socket* socket_link_clone(struct gracht_link_socket* link)
+{
+#if defined(SO_REUSEPORT) && !defined(_WIN32)
+    struct gracht_link_socket* clone;
+
+    // Only internet stream sockets can share their listening address, local sockets
+    // are bound to a path that can only be bound once.
+    if (link->base.type != gracht_link_stream_based ||
+        (link->domain != AF_INET && link->domain != AF_INET6)) {
+        errno = ENOTSUP;
+        return NULL;
+    }
+
+    clone = (struct gracht_link_socket*)malloc(sizeof(struct gracht_link_socket));
+    if (!clone) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memcpy(clone, link, sizeof(struct gracht_link_socket));
+    clone->base.connection = GRACHT_CONN_INVALID;
+    clone->reuse_port      = 1;
+    link->reuse_port       = 1;
+    return clone;
+#else
+    (void)link;
+    errno = ENOTSUP;
+    return NULL;
+#endif
+}
+
 void gracht_link_server_socket_api(struct gracht_link_socket* link)
 {
     link->base.ops.server.accept_client  = (server_accept_client_fn)socket_link_accept;
@@ -646,6 +1192,11 @@ void gracht_link_server_socket_api(struct gracht_link_socket* link)
     link->base.ops.server.recv_client = (server_recv_client_fn)socket_link_recv_client;
     link->base.ops.server.send_client = (server_send_client_fn)socket_link_send_client;
     link->base.ops.server.peek_client = (server_peek_client_fn)socket_link_peek_client;
+    link->base.ops.server.recv_client_inplace = (server_recv_client_inplace_fn)socket_link_recv_client_inplace;
+#ifdef GRACHT_SOCKET_HAS_SEND_QUEUE
+    link->base.ops.server.flush_client = (server_flush_client_fn)socket_link_flush_client;
+    link->base.ops.server.send_client_vectored = (server_send_client_vectored_fn)socket_link_send_client_vectored;
+#endif
 
     link->base.ops.server.recv    = (server_link_recv_fn)socket_link_recv_packet;
     link->base.ops.server.send    = (server_link_send_fn)socket_link_send_packet;
@@ -653,4 +1204,5 @@ void gracht_link_server_socket_api(struct gracht_link_socket* link)
 
     link->base.ops.server.setup   = (server_link_setup_fn)socket_link_setup;
     link->base.ops.server.destroy = (server_link_destroy_fn)socket_link_destroy;
+    link->base.ops.server.clone   = (server_link_clone_fn)socket_link_clone;
 }
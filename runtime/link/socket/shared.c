@@ -21,6 +21,7 @@
  */
 
 #include "gracht/link/socket.h"
+#include "gracht/link/uring.h"
 #include "logging.h"
 #include "socket_os.h"
 #include <errno.h>
@@ -62,6 +63,9 @@ int gracht_link_socket_cleanup(void)
 // extern functions, this is the interfaces described in client.c/server.c
 extern void gracht_link_client_socket_api(struct gracht_link_socket* link);
 extern void gracht_link_server_socket_api(struct gracht_link_socket* link);
+#ifdef GRACHT_SOCKET_HAS_URING
+extern void gracht_link_server_uring_api(struct gracht_link_socket* link);
+#endif
 
 int gracht_link_socket_create(struct gracht_link_socket** linkOut)
 {
@@ -76,12 +80,43 @@ int gracht_link_socket_create(struct gracht_link_socket** linkOut)
     memset(link, 0, sizeof(struct gracht_link_socket));
     gracht_link_client_socket_api(link);
     link->domain = AF_INET;
+    link->recv_buffer_size = GRACHT_SOCKET_DEFAULT_RECV_BUFFER_SIZE;
+    link->send_low_water = GRACHT_SOCKET_DEFAULT_SEND_LOW_WATER;
+    link->send_high_water = GRACHT_SOCKET_DEFAULT_SEND_HIGH_WATER;
+    link->uring_buffer_size = GRACHT_SOCKET_DEFAULT_URING_BUFFER_SIZE;
+    link->uring_buffer_count = GRACHT_SOCKET_DEFAULT_URING_BUFFER_COUNT;
     link->base.connection = GRACHT_CONN_INVALID;
 
     *linkOut = link;
     return 0;
 }
 
+int gracht_link_uring_create(struct gracht_link_socket** linkOut)
+{
+    int status = gracht_link_socket_create(linkOut);
+    if (!status) {
+        (*linkOut)->use_uring = 1;
+    }
+    return status;
+}
+
+void gracht_link_uring_set_buffers(struct gracht_link_socket* link, size_t bufferSize, size_t bufferCount)
+{
+    size_t count = 1;
+
+    // the kernel requires the ring of buffers to have a power of two entries
+    while (count < bufferCount) {
+        count <<= 1;
+    }
+    link->uring_buffer_size  = bufferSize;
+    link->uring_buffer_count = count;
+}
+
+int gracht_link_uring_is_active(struct gracht_link_socket* link)
+{
+    return link->uring != NULL;
+}
+
 void gracht_link_socket_set_type(struct gracht_link_socket* link, enum gracht_link_type type)
 {
     link->base.type = type;
@@ -92,6 +127,11 @@ void gracht_link_socket_set_listen(struct gracht_link_socket* link, int listen)
     link->listen = listen;
     if (listen) {
         gracht_link_server_socket_api(link);
+#ifdef GRACHT_SOCKET_HAS_URING
+        if (link->use_uring) {
+            gracht_link_server_uring_api(link);
+        }
+#endif
     }
     else {
         gracht_link_client_socket_api(link);
@@ -103,6 +143,17 @@ void gracht_link_socket_set_domain(struct gracht_link_socket* link, int socketDo
     link->domain = socketDomain;
 }
 
+void gracht_link_socket_set_recv_buffer_size(struct gracht_link_socket* link, size_t size)
+{
+    link->recv_buffer_size = size;
+}
+
+void gracht_link_socket_set_send_watermarks(struct gracht_link_socket* link, size_t lowWater, size_t highWater)
+{
+    link->send_low_water = lowWater < highWater ? lowWater : highWater;
+    link->send_high_water = highWater;
+}
+
 void gracht_link_socket_set_bind_address(struct gracht_link_socket* link, const struct sockaddr_storage* address, socklen_t length)
 {
     memcpy(&link->bind_address, address, sizeof(struct sockaddr_storage));
@@ -23,6 +23,8 @@
 #ifndef __GRACHT_SOCKET_OS_H__
 #define __GRACHT_SOCKET_OS_H__
 
+#include "config.h"
+#include "thread_api.h"
 #include "utils.h"
 
 #if defined(MOLLENOS)
@@ -42,9 +44,12 @@ static int socket_aio_add(int aio, int iod) {
 
 #elif defined(__linux__)
 #include <unistd.h>
+#include <poll.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
 
+#define socket_poll poll
+
 static int socket_aio_add(int aio, int iod) {
     struct epoll_event event = {
         .events = EPOLLIN | EPOLLRDHUP,
@@ -55,6 +60,53 @@ static int socket_aio_add(int aio, int iod) {
 
 #define socket_aio_remove(aio, iod) epoll_ctl(aio, EPOLL_CTL_DEL, iod, NULL)
 
+// Connections keep the data that could not be written in a send queue, which is written
+// once the set reports the connection as writable.
+#define GRACHT_SOCKET_HAS_SEND_QUEUE
+
+// Senders waiting for the send queue to drain check the connection at this interval.
+#define GRACHT_SOCKET_DRAIN_INTERVAL_MS 50
+
+// Returns whether the peer has closed or reset the connection, without waiting.
+static int socket_closed(int iod) {
+#ifdef POLLRDHUP
+    struct pollfd fds = { .fd = iod, .events = POLLRDHUP };
+#else
+    struct pollfd fds = { .fd = iod, .events = 0 };
+#endif
+    if (poll(&fds, 1, 0) <= 0) {
+        return 0;
+    }
+    return (fds.revents & (POLLHUP | POLLERR | fds.events)) != 0;
+}
+
+// Waits on the condition for at most <intervalMs>, the lock must be held.
+static void socket_wait_interval(cnd_t* cnd, mtx_t* lock, unsigned int intervalMs) {
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+    ts.tv_sec  += (time_t)(intervalMs / 1000);
+    ts.tv_nsec += (long)(intervalMs % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    (void)cnd_timedwait(cnd, lock, &ts);
+}
+
+static int socket_aio_watch_write(int aio, int iod, int enable) {
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLRDHUP | (enable ? EPOLLOUT : 0),
+        .data.fd = iod
+    };
+    return epoll_ctl(aio, EPOLL_CTL_MOD, iod, &event);
+}
+
+// Listening stream links can be served through io_uring, see uring.c
+#if defined(HAVE_IO_URING)
+#define GRACHT_SOCKET_HAS_URING
+#endif
+
 #elif defined(_WIN32)
 #include <windows.h>
 #include <mswsock.h>
@@ -63,6 +115,8 @@ static int socket_aio_add(int aio, int iod) {
 #include <stdlib.h>
     
 #define close closesocket
+#define SHUT_RDWR SD_BOTH
+#define socket_poll WSAPoll
 
 #define MSG_DONTWAIT 0
 
@@ -144,6 +198,27 @@ static inline void __set_nonblocking_if_needed(gracht_conn_t socket, unsigned in
 
 #endif
 
+// The default size of the receive buffer that is kept for each accepted connection. Incoming
+// data is read in chunks of this size, so multiple small messages can be received at once.
+#define GRACHT_SOCKET_DEFAULT_RECV_BUFFER_SIZE (16 * 1024)
+
+// The maximum number of messages that can be handed out from the receive buffer of a
+// connection at once, the connection is paused until one of them is released.
+#define GRACHT_SOCKET_RECV_RING_SLOTS 64
+
+// The default watermarks of the send queue of each accepted connection. Sends that do not
+// block fail once the queue holds more than the high mark, and blocking sends wait for the
+// queue to be written down to the low mark.
+#define GRACHT_SOCKET_DEFAULT_SEND_LOW_WATER  (256 * 1024)
+#define GRACHT_SOCKET_DEFAULT_SEND_HIGH_WATER (1024 * 1024)
+
+// The default buffers that links served through io_uring receive into, they are shared
+// by all connections of the link.
+#define GRACHT_SOCKET_DEFAULT_URING_BUFFER_SIZE  (8 * 1024)
+#define GRACHT_SOCKET_DEFAULT_URING_BUFFER_COUNT 256
+
+struct gracht_uring;
+
 struct gracht_link_socket {
     struct gracht_link      base;
     int                     listen;
@@ -152,6 +227,14 @@ struct gracht_link_socket {
     socklen_t               bind_address_length;
     struct sockaddr_storage connect_address;
     socklen_t               connect_address_length;
+    int                     reuse_port;
+    size_t                  recv_buffer_size;
+    size_t                  send_low_water;
+    size_t                  send_high_water;
+    int                     use_uring;
+    size_t                  uring_buffer_size;
+    size_t                  uring_buffer_count;
+    struct gracht_uring*    uring;
 #ifdef _WIN32
     WSABUF                  waitbuf;
     DWORD                   recvFlags;
@@ -0,0 +1,1359 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht io_uring Link Implementation
+ * - Serves listening stream socket links through io_uring. Connections are accepted and
+ *   received from with multishot requests, and the data is received into a ring of provided
+ *   buffers that is shared by all connections of the link. Each connection has a doorbell
+ *   that is registered in the aio set of the reactor handling it, and which is rung whenever
+ *   data arrives, so the server handles the connections like any other.
+ */
+
+#include <errno.h>
+#include "gracht/link/uring.h"
+#include "logging.h"
+#include "buffer_pool.h"
+#include "recv_ring.h"
+#include "thread_api.h"
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "socket_os.h"
+
+#define GRACHT_URING_SQ_ENTRIES   256
+#define GRACHT_URING_CQ_ENTRIES   4096
+#define GRACHT_URING_BUFFER_GROUP 0
+
+// The operation of a request is kept in the low bits of its user data, and the
+// connection the request belongs to (if any) in the rest.
+#define GRACHT_URING_OP_ACCEPT 1
+#define GRACHT_URING_OP_RECV   2
+#define GRACHT_URING_OP_SEND   3
+#define GRACHT_URING_OP_CANCEL 4
+#define GRACHT_URING_OP_MASK   0x7
+
+struct gracht_uring {
+    int                        fd;
+    int                        event_fd;
+    int                        listen_socket;
+    void*                      ring;
+    size_t                     ring_size;
+    struct io_uring_sqe*       sqes;
+    size_t                     sqes_size;
+
+    // the submission queue is shared by all threads sending to the connections
+    mtx_t                      sq_lock;
+    unsigned int*              sq_head;
+    unsigned int*              sq_tail;
+    unsigned int*              sq_array;
+    unsigned int               sq_mask;
+    unsigned int               sq_entries;
+    unsigned int               sq_pending;
+
+    // the completion queue is only reaped by the reactor the link belongs to
+    unsigned int*              cq_head;
+    unsigned int*              cq_tail;
+    unsigned int               cq_mask;
+    struct io_uring_cqe*       cqes;
+
+    // the provided buffers are taken from a buffer pool, and are put back in the ring
+    // once the data in them has been read by the connection that received it
+    mtx_t                      buf_lock;
+    struct io_uring_buf_ring*  buf_ring;
+    size_t                     buf_ring_size;
+    struct gracht_buffer_pool* buf_pool;
+    char*                      buf_storage;
+    size_t                     buf_size;
+    unsigned int               buf_count;
+    unsigned int               buf_held;
+    uint16_t                   buf_tail;
+    struct uring_link_client*  starved;
+
+    int                        accept_multishot;
+    int                        recv_multishot;
+    int*                       accepted;
+    int                        accepted_count;
+    int                        accepted_capacity;
+    atomic_int                 outstanding;
+    atomic_int                 closing;
+    atomic_int                 references;
+    thrd_t                     reaper;
+    atomic_int                 reaper_known;
+};
+
+struct uring_link_chunk {
+    uint16_t bid;
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct uring_link_client {
+    struct gracht_server_client base;
+    struct gracht_uring*        uring;
+    gracht_conn_t               link;
+    int                         socket;
+    gracht_handle_t             set_handle;
+    atomic_int                  references;
+
+    // the receive state is shared between the reactor of the link, which receives the data,
+    // and the reactor of the connection, which reads the messages from it
+    mtx_t                       lock;
+    int                         dead;
+    struct gr_recv_ring*        rx_ring;
+    struct uring_link_chunk*    rx_chunks;
+    unsigned int                rx_chunk_head;
+    unsigned int                rx_chunk_count;
+    size_t                      rx_pending;
+    size_t                      rx_need;
+    int                         rx_armed;
+    int                         rx_paused;
+    int                         rx_starved;
+    int                         rx_closed;
+    struct uring_link_client*   starved_next;
+
+    // messages are queued while a send is in flight, and sent together once it completes
+    mtx_t                       tx_lock;
+    cnd_t                       tx_drained;
+    char*                       tx_queue;
+    size_t                      tx_queued;
+    size_t                      tx_queue_capacity;
+    char*                       tx_sending;
+    size_t                      tx_sending_length;
+    size_t                      tx_sending_offset;
+    size_t                      tx_sending_capacity;
+    size_t                      tx_low_water;
+    size_t                      tx_high_water;
+    int                         tx_inflight;
+    int                         tx_failed;
+};
+
+static void uring_destroy(struct gracht_uring* uring);
+
+static int uring_setup(unsigned int entries, struct io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned int opcode, void* arg, unsigned int count)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static int uring_is_reaper(struct gracht_uring* uring)
+{
+    return atomic_load(&uring->reaper_known) && thrd_equal(uring->reaper, thrd_current());
+}
+
+static void uring_doorbell_ring(gracht_conn_t doorbell)
+{
+    uint64_t value = 1;
+    (void)!write(doorbell, &value, sizeof(uint64_t));
+}
+
+static void uring_doorbell_reset(gracht_conn_t doorbell)
+{
+    uint64_t value;
+    (void)!read(doorbell, &value, sizeof(uint64_t));
+}
+
+// Submits the queued requests, the submission lock must be held. Requests that could not be
+// submitted are left queued, and are submitted with the next request or once the link is reaped.
+static int uring_submit(struct gracht_uring* uring)
+{
+    while (uring->sq_pending) {
+        int status = uring_enter(uring->fd, uring->sq_pending, 0, 0);
+        if (status <= 0) {
+            if (status < 0 && errno == EINTR) {
+                continue;
+            }
+            GRTRACE(GRSTR("uring_submit failed to submit %u requests: %i"), uring->sq_pending, errno);
+            return -1;
+        }
+        uring->sq_pending -= (unsigned int)status;
+    }
+    return 0;
+}
+
+// Returns a cleared submission entry, the submission lock must be held.
+static struct io_uring_sqe* uring_get_sqe(struct gracht_uring* uring)
+{
+    unsigned int         tail = *uring->sq_tail;
+    unsigned int         index;
+    struct io_uring_sqe* sqe;
+
+    if (tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) >= uring->sq_entries) {
+        (void)uring_submit(uring);
+        if (tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) >= uring->sq_entries) {
+            errno = EBUSY;
+            return NULL;
+        }
+    }
+
+    index = tail & uring->sq_mask;
+    sqe   = &uring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    uring->sq_array[index] = index;
+    return sqe;
+}
+
+// Queues the entry returned by uring_get_sqe and submits it.
+static void uring_push_sqe(struct gracht_uring* uring)
+{
+    __atomic_store_n(uring->sq_tail, *uring->sq_tail + 1, __ATOMIC_RELEASE);
+    uring->sq_pending++;
+    atomic_fetch_add(&uring->outstanding, 1);
+    (void)uring_submit(uring);
+}
+
+static int uring_arm_accept(struct gracht_uring* uring)
+{
+    struct io_uring_sqe* sqe;
+
+    mtx_lock(&uring->sq_lock);
+    sqe = uring_get_sqe(uring);
+    if (!sqe) {
+        mtx_unlock(&uring->sq_lock);
+        return -1;
+    }
+
+    sqe->opcode       = IORING_OP_ACCEPT;
+    sqe->fd           = uring->listen_socket;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->ioprio       = uring->accept_multishot ? IORING_ACCEPT_MULTISHOT : 0;
+    sqe->user_data    = GRACHT_URING_OP_ACCEPT;
+    uring_push_sqe(uring);
+    mtx_unlock(&uring->sq_lock);
+    return 0;
+}
+
+static void uring_cancel(struct gracht_uring* uring, uint64_t userData, uint32_t flags)
+{
+    struct io_uring_sqe* sqe;
+
+    mtx_lock(&uring->sq_lock);
+    sqe = uring_get_sqe(uring);
+    if (sqe) {
+        sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+        sqe->fd           = -1;
+        sqe->addr         = userData;
+        sqe->cancel_flags = flags;
+        sqe->user_data    = GRACHT_URING_OP_CANCEL;
+        uring_push_sqe(uring);
+    }
+    mtx_unlock(&uring->sq_lock);
+}
+
+static uint64_t uring_link_user_data(struct uring_link_client* client, int op)
+{
+    return (uint64_t)(uintptr_t)client | (uint64_t)op;
+}
+
+// The ring is kept until the link and all of its connections have been destroyed, as
+// connections can outlive the link when they are handled by other reactors.
+static void uring_put(struct gracht_uring* uring)
+{
+    if (atomic_fetch_sub(&uring->references, 1) == 1) {
+        uring_destroy(uring);
+    }
+}
+
+static void uring_link_client_put(struct uring_link_client* client)
+{
+    struct gracht_uring* uring = client->uring;
+
+    if (atomic_fetch_sub(&client->references, 1) != 1) {
+        return;
+    }
+
+    close(client->socket);
+    gr_recv_ring_put(client->rx_ring);
+    mtx_destroy(&client->lock);
+    mtx_destroy(&client->tx_lock);
+    cnd_destroy(&client->tx_drained);
+    free(client->rx_chunks);
+    free(client->tx_queue);
+    free(client->tx_sending);
+    free(client);
+    uring_put(uring);
+}
+
+// Queues a multishot receive on the connection, the connection lock must be held. The
+// receive keeps delivering data into the provided buffers until it is cancelled, or
+// the link runs out of buffers.
+static int uring_link_rx_arm(struct uring_link_client* client)
+{
+    struct gracht_uring* uring = client->uring;
+    struct io_uring_sqe* sqe;
+
+    mtx_lock(&uring->sq_lock);
+    sqe = uring_get_sqe(uring);
+    if (!sqe) {
+        mtx_unlock(&uring->sq_lock);
+        GRERROR(GRSTR("uring_link_rx_arm failed to queue a receive for %i"), client->socket);
+        return -1;
+    }
+
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = client->socket;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = GRACHT_URING_BUFFER_GROUP;
+    sqe->ioprio    = uring->recv_multishot ? IORING_RECV_MULTISHOT : 0;
+    sqe->user_data = uring_link_user_data(client, GRACHT_URING_OP_RECV);
+    atomic_fetch_add(&client->references, 1);
+    client->rx_armed = 1;
+    uring_push_sqe(uring);
+    mtx_unlock(&uring->sq_lock);
+    return 0;
+}
+
+// The connection holds on to at most the size of its receive ring in buffers, unless
+// a message that is larger than the ring is being received.
+static size_t uring_link_rx_limit(struct uring_link_client* client)
+{
+    return client->rx_need > client->rx_ring->capacity ? client->rx_need : client->rx_ring->capacity;
+}
+
+// Queues the receive again if it was cancelled because the connection held too many
+// buffers, and enough of them have been read. The connection lock must be held.
+static void uring_link_rx_resume(struct uring_link_client* client)
+{
+    if (client->rx_paused && !client->rx_armed && !client->dead && !client->rx_closed &&
+        client->rx_pending < uring_link_rx_limit(client)) {
+        client->rx_paused = 0;
+        (void)uring_link_rx_arm(client);
+    }
+}
+
+// Returns buffers to the ring once their data has been read. Connections that ran out of
+// buffers are queued again by the reactor of the link, which is woken up for that.
+static void uring_buffers_put(struct gracht_uring* uring, const uint16_t* bids, unsigned int count)
+{
+    unsigned int i;
+
+    if (!count) {
+        return;
+    }
+
+    mtx_lock(&uring->buf_lock);
+    for (i = 0; i < count; i++) {
+        struct io_uring_buf* buf = &uring->buf_ring->bufs[uring->buf_tail & (uring->buf_count - 1)];
+        buf->addr = (uint64_t)(uintptr_t)&uring->buf_storage[(size_t)bids[i] * uring->buf_size];
+        buf->len  = (uint32_t)uring->buf_size;
+        buf->bid  = bids[i];
+        uring->buf_tail++;
+    }
+    __atomic_store_n(&uring->buf_ring->tail, uring->buf_tail, __ATOMIC_RELEASE);
+    uring->buf_held -= count;
+    if (uring->starved) {
+        uring_doorbell_ring(uring->event_fd);
+    }
+    mtx_unlock(&uring->buf_lock);
+}
+
+static void uring_link_rx_starve(struct uring_link_client* client)
+{
+    struct gracht_uring* uring = client->uring;
+
+    mtx_lock(&uring->buf_lock);
+    if (uring->buf_held < uring->buf_count) {
+        // buffers were returned since the receive ran out of them
+        mtx_unlock(&uring->buf_lock);
+        (void)uring_link_rx_arm(client);
+        return;
+    }
+
+    atomic_fetch_add(&client->references, 1);
+    client->rx_starved   = 1;
+    client->starved_next = uring->starved;
+    uring->starved       = client;
+    mtx_unlock(&uring->buf_lock);
+}
+
+static void uring_link_rx_complete(struct uring_link_client* client, int result, uint32_t cqeFlags)
+{
+    struct gracht_uring* uring = client->uring;
+    int                  more  = (cqeFlags & IORING_CQE_F_MORE) != 0;
+    uint16_t             bid   = 0;
+    int                  release = 0;
+
+    mtx_lock(&client->lock);
+    if (result > 0 && (cqeFlags & IORING_CQE_F_BUFFER)) {
+        bid = (uint16_t)(cqeFlags >> IORING_CQE_BUFFER_SHIFT);
+        mtx_lock(&uring->buf_lock);
+        uring->buf_held++;
+        mtx_unlock(&uring->buf_lock);
+
+        if (client->dead) {
+            release = 1;
+        } else {
+            struct uring_link_chunk* chunk = &client->rx_chunks[
+                (client->rx_chunk_head + client->rx_chunk_count) % uring->buf_count];
+            chunk->bid    = bid;
+            chunk->offset = 0;
+            chunk->length = (uint32_t)result;
+            client->rx_chunk_count++;
+            client->rx_pending += (size_t)result;
+            uring_doorbell_ring(client->base.handle);
+
+            // stop receiving while the connection holds too many buffers, so slow
+            // connections cannot starve the others
+            if (more && !client->rx_paused && client->rx_pending >= uring_link_rx_limit(client)) {
+                client->rx_paused = 1;
+                uring_cancel(uring, uring_link_user_data(client, GRACHT_URING_OP_RECV), 0);
+            }
+        }
+    } else if (result == 0) {
+        client->rx_closed = 1;
+    } else if (result == -EINVAL && uring->recv_multishot) {
+        GRWARNING(GRSTR("uring_link_rx_complete multishot receives are not supported, receiving once per request"));
+        uring->recv_multishot = 0;
+    } else if (result < 0 && result != -ENOBUFS && result != -ECANCELED) {
+        GRTRACE(GRSTR("uring_link_rx_complete receive failed for %i: %i"), client->socket, -result);
+        client->rx_closed = 1;
+    }
+
+    if (client->rx_closed && !client->dead) {
+        uring_doorbell_ring(client->base.handle);
+    }
+
+    if (!more) {
+        client->rx_armed = 0;
+        if (!client->dead && !client->rx_closed && !atomic_load(&uring->closing)) {
+            if (result == -ENOBUFS) {
+                uring_link_rx_starve(client);
+            } else if (!client->rx_paused || client->rx_pending < uring_link_rx_limit(client)) {
+                client->rx_paused = 0;
+                (void)uring_link_rx_arm(client);
+            }
+        }
+    }
+    mtx_unlock(&client->lock);
+
+    if (release) {
+        uring_buffers_put(uring, &bid, 1);
+    }
+    if (!more) {
+        uring_link_client_put(client);
+    }
+}
+
+// Queues a receive again for the connections that ran out of buffers.
+static void uring_link_rx_feed_starved(struct gracht_uring* uring)
+{
+    struct uring_link_client* client;
+
+    mtx_lock(&uring->buf_lock);
+    client = uring->starved;
+    uring->starved = NULL;
+    mtx_unlock(&uring->buf_lock);
+
+    while (client) {
+        struct uring_link_client* next = client->starved_next;
+
+        mtx_lock(&client->lock);
+        client->rx_starved = 0;
+        if (!client->dead && !client->rx_closed && !client->rx_armed && !atomic_load(&uring->closing)) {
+            (void)uring_link_rx_arm(client);
+        }
+        mtx_unlock(&client->lock);
+        uring_link_client_put(client);
+        client = next;
+    }
+}
+
+// Moves received data from the buffers of the connection into its receive ring, until at least
+// <length> bytes are in the ring. Fails with EAGAIN if not enough data has been received yet,
+// ENOSPC if the ring is occupied by messages that are still being handled, and EFAULT if the
+// connection was closed.
+static int uring_link_rx_fill(struct uring_link_client* client, size_t length)
+{
+    struct gracht_uring* uring = client->uring;
+    uint16_t             bids[GRACHT_SOCKET_RECV_RING_SLOTS];
+    unsigned int         bidCount = 0;
+    char*                data;
+    size_t               available = gr_recv_ring_peek(client->rx_ring, &data);
+    int                  status = 0;
+
+    if (available >= length) {
+        return 0;
+    }
+
+    mtx_lock(&client->lock);
+    while (client->rx_chunk_count && available < length && bidCount < GRACHT_SOCKET_RECV_RING_SLOTS) {
+        struct uring_link_chunk* chunk = &client->rx_chunks[client->rx_chunk_head];
+        char*                    space;
+        size_t                   spaceLength = gr_recv_ring_space(client->rx_ring, &space);
+
+        if (!spaceLength) {
+            break;
+        }
+
+        if (spaceLength > chunk->length) {
+            spaceLength = chunk->length;
+        }
+        memcpy(space, &uring->buf_storage[(size_t)chunk->bid * uring->buf_size + chunk->offset], spaceLength);
+        gr_recv_ring_produce(client->rx_ring, spaceLength);
+        chunk->offset      += (uint32_t)spaceLength;
+        chunk->length      -= (uint32_t)spaceLength;
+        client->rx_pending -= spaceLength;
+        available          += spaceLength;
+
+        if (!chunk->length) {
+            bids[bidCount++] = chunk->bid;
+            client->rx_chunk_head = (client->rx_chunk_head + 1) % uring->buf_count;
+            client->rx_chunk_count--;
+        }
+    }
+
+    if (available < length) {
+        status = -1;
+        if (client->rx_chunk_count) {
+            errno = gr_recv_ring_space(client->rx_ring, &data) ? EAGAIN : ENOSPC;
+        } else if (client->rx_closed) {
+            errno = EFAULT;
+        } else {
+            uring_doorbell_reset(client->base.handle);
+            errno = EAGAIN;
+        }
+    }
+    uring_link_rx_resume(client);
+    mtx_unlock(&client->lock);
+
+    uring_buffers_put(uring, &bids[0], bidCount);
+    return status;
+}
+
+static int uring_link_rx_header(struct uring_link_client* client, uint32_t* lengthOut)
+{
+    char* data;
+
+    if (uring_link_rx_fill(client, GRACHT_MESSAGE_HEADER_SIZE)) {
+        return -1;
+    }
+
+    (void)gr_recv_ring_peek(client->rx_ring, &data);
+    *lengthOut = *((uint32_t*)&data[MSG_INDEX_LEN]);
+    if (*lengthOut < GRACHT_MESSAGE_HEADER_SIZE) {
+        errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+static int uring_link_peek_client(struct uring_link_client* client,
+    uint32_t* messageLengthOut, uint8_t* serviceIdOut, unsigned int flags)
+{
+    char* data;
+    (void)flags;
+
+    if (!messageLengthOut || !serviceIdOut) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (uring_link_rx_header(client, messageLengthOut)) {
+        return -1;
+    }
+
+    (void)gr_recv_ring_peek(client->rx_ring, &data);
+    *serviceIdOut = (uint8_t)data[MSG_INDEX_SID];
+    return 0;
+}
+
+static int uring_link_recv_client_inplace(struct uring_link_client* client,
+    struct gracht_message** messageOut, unsigned int flags)
+{
+    struct gracht_message* message;
+    uint32_t               length;
+    (void)flags;
+
+    if (uring_link_rx_header(client, &length)) {
+        return -1;
+    }
+
+    if (length > client->rx_ring->capacity) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    if (uring_link_rx_fill(client, length)) {
+        return -1;
+    }
+
+    message = gr_recv_ring_take(client->rx_ring, length);
+    if (!message) {
+        return -1;
+    }
+
+    GRTRACE(GRSTR("uring_link_recv_client_inplace message id %u, length of message %u"), 
+        *((uint32_t*)&message->payload[0]), length);
+
+    // ->server is set by server
+    message->link   = client->link;
+    message->client = client->base.handle;
+    *messageOut = message;
+    return 0;
+}
+
+// Receives messages that are larger than the receive ring, these are copied from the ring
+// and the buffers of the connection once all of the message has been received.
+static int uring_link_recv_client(struct uring_link_client* client,
+    struct gracht_message* context, unsigned int flags)
+{
+    struct gracht_uring* uring = client->uring;
+    uint16_t             bids[GRACHT_SOCKET_RECV_RING_SLOTS];
+    unsigned int         bidCount = 0;
+    char*                data;
+    size_t               available;
+    size_t               copied;
+    uint32_t             length;
+    (void)flags;
+
+    if (uring_link_rx_header(client, &length)) {
+        return -1;
+    }
+
+    if (length <= client->rx_ring->capacity) {
+        if (uring_link_rx_fill(client, length)) {
+            return -1;
+        }
+        available = gr_recv_ring_peek(client->rx_ring, &data);
+        memcpy(&context->payload[0], data, length);
+        gr_recv_ring_consume(client->rx_ring, length);
+    } else {
+        mtx_lock(&client->lock);
+        available = gr_recv_ring_peek(client->rx_ring, &data);
+        if (available + client->rx_pending < length) {
+            // let the connection hold on to enough buffers for the entire message
+            client->rx_need = length;
+            if (client->rx_closed) {
+                errno = EFAULT;
+            } else {
+                uring_doorbell_reset(client->base.handle);
+                errno = EAGAIN;
+            }
+            uring_link_rx_resume(client);
+            mtx_unlock(&client->lock);
+            return -1;
+        }
+
+        memcpy(&context->payload[0], data, available);
+        gr_recv_ring_consume(client->rx_ring, available);
+        copied = available;
+        while (copied < length) {
+            struct uring_link_chunk* chunk = &client->rx_chunks[client->rx_chunk_head];
+            size_t                   count = length - copied;
+
+            if (count > chunk->length) {
+                count = chunk->length;
+            }
+            memcpy(&context->payload[copied],
+                &uring->buf_storage[(size_t)chunk->bid * uring->buf_size + chunk->offset], count);
+            chunk->offset      += (uint32_t)count;
+            chunk->length      -= (uint32_t)count;
+            client->rx_pending -= count;
+            copied             += count;
+
+            if (!chunk->length) {
+                if (bidCount == GRACHT_SOCKET_RECV_RING_SLOTS) {
+                    uring_buffers_put(uring, &bids[0], bidCount);
+                    bidCount = 0;
+                }
+                bids[bidCount++] = chunk->bid;
+                client->rx_chunk_head = (client->rx_chunk_head + 1) % uring->buf_count;
+                client->rx_chunk_count--;
+            }
+        }
+        client->rx_need = 0;
+        uring_link_rx_resume(client);
+        mtx_unlock(&client->lock);
+        uring_buffers_put(uring, &bids[0], bidCount);
+    }
+
+    GRTRACE(GRSTR("uring_link_recv_client message id %u, length of message %u"), 
+        *((uint32_t*)&context->payload[0]), length);
+
+    // ->server is set by server
+    context->link   = client->link;
+    context->client = client->base.handle;
+    context->index  = 0;
+    context->rsize  = 0;
+    context->size   = length;
+    return 0;
+}
+
+static size_t uring_link_tx_pending(struct uring_link_client* client)
+{
+    return client->tx_queued + (client->tx_sending_length - client->tx_sending_offset);
+}
+
+// Sends the rest of the data in flight, the send lock must be held.
+static int uring_link_tx_send(struct uring_link_client* client)
+{
+    struct gracht_uring* uring = client->uring;
+    struct io_uring_sqe* sqe;
+
+    mtx_lock(&uring->sq_lock);
+    sqe = uring_get_sqe(uring);
+    if (!sqe) {
+        mtx_unlock(&uring->sq_lock);
+        GRERROR(GRSTR("uring_link_tx_send failed to queue a send for %i"), client->socket);
+        client->tx_inflight = 0;
+        client->tx_failed   = 1;
+        errno = EPIPE;
+        return -1;
+    }
+
+    sqe->opcode    = IORING_OP_SEND;
+    sqe->fd        = client->socket;
+    sqe->addr      = (uint64_t)(uintptr_t)&client->tx_sending[client->tx_sending_offset];
+    sqe->len       = (uint32_t)(client->tx_sending_length - client->tx_sending_offset);
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->user_data = uring_link_user_data(client, GRACHT_URING_OP_SEND);
+    atomic_fetch_add(&client->references, 1);
+    client->tx_inflight = 1;
+    uring_push_sqe(uring);
+    mtx_unlock(&uring->sq_lock);
+    return 0;
+}
+
+// Puts everything that has been queued in flight. The queue and the data in flight swap
+// buffers, as the data in flight must stay in place until the send completes.
+static int uring_link_tx_flush(struct uring_link_client* client)
+{
+    char*  buffer   = client->tx_sending;
+    size_t capacity = client->tx_sending_capacity;
+
+    client->tx_sending          = client->tx_queue;
+    client->tx_sending_capacity = client->tx_queue_capacity;
+    client->tx_sending_length   = client->tx_queued;
+    client->tx_sending_offset   = 0;
+    client->tx_queue            = buffer;
+    client->tx_queue_capacity   = capacity;
+    client->tx_queued           = 0;
+    return uring_link_tx_send(client);
+}
+
+static void uring_link_tx_complete(struct uring_link_client* client, int result)
+{
+    mtx_lock(&client->tx_lock);
+    client->tx_inflight = 0;
+    if (result < 0 && result != -EINTR && result != -EAGAIN) {
+        GRTRACE(GRSTR("uring_link_tx_complete send failed for %i: %i"), client->socket, -result);
+        client->tx_failed = 1;
+    } else if (!client->tx_failed && !atomic_load(&client->uring->closing)) {
+        if (result > 0) {
+            client->tx_sending_offset += (size_t)result;
+        }
+
+        if (client->tx_sending_offset < client->tx_sending_length) {
+            (void)uring_link_tx_send(client);
+        } else if (client->tx_queued) {
+            (void)uring_link_tx_flush(client);
+        }
+    }
+
+    if (client->tx_failed || uring_link_tx_pending(client) <= client->tx_low_water) {
+        cnd_broadcast(&client->tx_drained);
+    }
+    mtx_unlock(&client->tx_lock);
+    uring_link_client_put(client);
+}
+
+// Queues the message for the connection, the message is copied as the segments are returned to
+// the server once we return. Only a single send is in flight per connection, which keeps the data
+// in order, and everything queued in the meantime is sent with the next. Blocking sends wait for
+// the connection to catch up once more than the high watermark is queued, but never on the reactor
+// of the link, as that is the one completing the sends. Senders give up once the peer is gone.
+static int uring_link_send_client_vectored(struct uring_link_client* client,
+    struct gracht_iovec* vectors, int count, unsigned int flags)
+{
+    struct gracht_uring* uring = client->uring;
+    size_t               length = 0;
+    size_t               pending;
+    int                  status = 0;
+    int                  i;
+
+    for (i = 0; i < count; i++) {
+        length += vectors[i].length;
+    }
+
+    mtx_lock(&client->tx_lock);
+    pending = uring_link_tx_pending(client);
+    if (pending && pending + length > client->tx_high_water) {
+        if (!(flags & GRACHT_MESSAGE_BLOCK)) {
+            mtx_unlock(&client->tx_lock);
+            errno = EAGAIN;
+            return -1;
+        }
+
+        // the connection is checked at every interval, as the reactor of the link may be
+        // waiting for us to finish before it destroys the connection
+        if (!uring_is_reaper(uring)) {
+            while (!client->tx_failed && uring_link_tx_pending(client) > client->tx_low_water) {
+                if (socket_closed(client->socket)) {
+                    client->tx_failed = 1;
+                    break;
+                }
+                socket_wait_interval(&client->tx_drained, &client->tx_lock, GRACHT_SOCKET_DRAIN_INTERVAL_MS);
+            }
+        }
+    }
+
+    if (client->tx_failed || atomic_load(&uring->closing)) {
+        mtx_unlock(&client->tx_lock);
+        errno = EPIPE;
+        return -1;
+    }
+
+    if (client->tx_queued + length > client->tx_queue_capacity) {
+        size_t capacity = client->tx_queue_capacity ? client->tx_queue_capacity * 2 : 4096;
+        char*  buffer;
+
+        while (capacity < client->tx_queued + length) {
+            capacity *= 2;
+        }
+
+        buffer = realloc(client->tx_queue, capacity);
+        if (!buffer) {
+            mtx_unlock(&client->tx_lock);
+            GRERROR(GRSTR("uring_link_send_client_vectored failed to queue %zu bytes"), length);
+            errno = ENOMEM;
+            return -1;
+        }
+        client->tx_queue          = buffer;
+        client->tx_queue_capacity = capacity;
+    }
+
+    for (i = 0; i < count; i++) {
+        memcpy(&client->tx_queue[client->tx_queued], vectors[i].data, vectors[i].length);
+        client->tx_queued += vectors[i].length;
+    }
+
+    if (!client->tx_inflight) {
+        status = uring_link_tx_flush(client);
+    }
+    mtx_unlock(&client->tx_lock);
+    return status;
+}
+
+static int uring_link_send_client(struct uring_link_client* client,
+    struct gracht_buffer* message, unsigned int flags)
+{
+    struct gracht_iovec vector = { &message->data[0], message->index };
+    GRTRACE(GRSTR("uring_link_send_client(fd=%i, len=%u)"), client->socket, message->index);
+    return uring_link_send_client_vectored(client, &vector, 1, flags);
+}
+
+static int uring_link_destroy_client(struct uring_link_client* client, gracht_handle_t set_handle)
+{
+    struct gracht_uring* uring;
+    uint16_t*            bids;
+    unsigned int         bidCount = 0;
+
+    if (!client) {
+        errno = (EINVAL);
+        return -1;
+    }
+
+    uring = client->uring;
+    if (set_handle != GRACHT_HANDLE_INVALID && socket_aio_remove(set_handle, client->base.handle)) {
+        GRWARNING(GRSTR("uring_link_destroy_client failed to remove client doorbell from set_handle"));
+    }
+
+    // no more data is handed to the connection once it is marked, so the doorbell can
+    // be closed while receives are still completing
+    mtx_lock(&client->lock);
+    client->dead = 1;
+    close(client->base.handle);
+    if (client->rx_armed) {
+        uring_cancel(uring, uring_link_user_data(client, GRACHT_URING_OP_RECV), 0);
+    }
+
+    bids = malloc(sizeof(uint16_t) * (client->rx_chunk_count + 1));
+    while (bids && client->rx_chunk_count) {
+        bids[bidCount++] = client->rx_chunks[client->rx_chunk_head].bid;
+        client->rx_chunk_head = (client->rx_chunk_head + 1) % uring->buf_count;
+        client->rx_chunk_count--;
+    }
+    mtx_unlock(&client->lock);
+    uring_buffers_put(uring, bids, bidCount);
+    free(bids);
+
+    // fail the send in flight, and any sender waiting for it
+    shutdown(client->socket, SHUT_RDWR);
+    mtx_lock(&client->tx_lock);
+    client->tx_failed = 1;
+    cnd_broadcast(&client->tx_drained);
+    mtx_unlock(&client->tx_lock);
+
+    uring_link_client_put(client);
+    return 0;
+}
+
+static int uring_link_create_client(struct gracht_link_socket* link, int socket,
+    gracht_handle_t set_handle, struct uring_link_client** clientOut)
+{
+    struct uring_link_client* client;
+    size_t                    ringSize = link->recv_buffer_size;
+
+    client = (struct uring_link_client*)malloc(sizeof(struct uring_link_client));
+    if (!client) {
+        errno = (ENOMEM);
+        return -1;
+    }
+
+    memset(client, 0, sizeof(struct uring_link_client));
+    client->rx_chunks = malloc(sizeof(struct uring_link_chunk) * link->uring->buf_count);
+    if (!client->rx_chunks) {
+        free(client);
+        errno = (ENOMEM);
+        return -1;
+    }
+
+    // messages are always read from the receive ring, so it cannot be disabled for this link
+    if (ringSize < GRACHT_MESSAGE_HEADER_SIZE) {
+        ringSize = GRACHT_SOCKET_DEFAULT_RECV_BUFFER_SIZE;
+    }
+
+    if (gr_recv_ring_create(ringSize, GRACHT_SOCKET_RECV_RING_SLOTS, &client->rx_ring)) {
+        GRERROR(GRSTR("uring_link_create_client failed to create the receive ring: %i"), errno);
+        free(client->rx_chunks);
+        free(client);
+        return -1;
+    }
+
+    client->base.handle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (client->base.handle < 0) {
+        gr_recv_ring_put(client->rx_ring);
+        free(client->rx_chunks);
+        free(client);
+        return -1;
+    }
+
+    client->uring         = link->uring;
+    client->link          = link->base.connection;
+    client->socket        = socket;
+    client->set_handle    = set_handle;
+    client->tx_low_water  = link->send_low_water;
+    client->tx_high_water = link->send_high_water;
+    atomic_store(&client->references, 1);
+    atomic_fetch_add(&link->uring->references, 1);
+    mtx_init(&client->lock, mtx_plain);
+    mtx_init(&client->tx_lock, mtx_plain);
+    cnd_init(&client->tx_drained);
+    *clientOut = client;
+    return 0;
+}
+
+static void uring_link_accepted(struct gracht_uring* uring, int socket)
+{
+    if (uring->accepted_count == uring->accepted_capacity) {
+        int  capacity = uring->accepted_capacity ? uring->accepted_capacity * 2 : 8;
+        int* accepted = realloc(uring->accepted, sizeof(int) * (size_t)capacity);
+        if (!accepted) {
+            GRERROR(GRSTR("uring_link_accepted failed to keep the accepted connection"));
+            close(socket);
+            return;
+        }
+        uring->accepted          = accepted;
+        uring->accepted_capacity = capacity;
+    }
+    uring->accepted[uring->accepted_count++] = socket;
+}
+
+static void uring_link_accept_complete(struct gracht_uring* uring, int result, uint32_t cqeFlags)
+{
+    if (result >= 0) {
+        uring_link_accepted(uring, result);
+    } else if (result == -EINVAL && uring->accept_multishot) {
+        GRWARNING(GRSTR("uring_link_accept_complete multishot accepts are not supported, accepting once per request"));
+        uring->accept_multishot = 0;
+    } else if (result != -ECANCELED) {
+        GRERROR(GRSTR("uring_link_accept_complete failed to accept client: %i"), -result);
+    }
+
+    if (!(cqeFlags & IORING_CQE_F_MORE) && !atomic_load(&uring->closing)) {
+        if (uring_arm_accept(uring)) {
+            GRERROR(GRSTR("uring_link_accept_complete failed to queue up an accept on the listen socket"));
+        }
+    }
+}
+
+// Handles all completions that have been posted, this is only done by the reactor of the link.
+static void uring_reap(struct gracht_uring* uring)
+{
+    unsigned int head = *uring->cq_head;
+    unsigned int tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        while (head != tail) {
+            struct io_uring_cqe*      cqe      = &uring->cqes[head & uring->cq_mask];
+            uint64_t                  userData = cqe->user_data;
+            int                       result   = cqe->res;
+            uint32_t                  cqeFlags = cqe->flags;
+            struct uring_link_client* client   = (struct uring_link_client*)(uintptr_t)(userData & ~(uint64_t)GRACHT_URING_OP_MASK);
+
+            __atomic_store_n(uring->cq_head, ++head, __ATOMIC_RELEASE);
+            if (!(cqeFlags & IORING_CQE_F_MORE)) {
+                atomic_fetch_sub(&uring->outstanding, 1);
+            }
+
+            switch (userData & GRACHT_URING_OP_MASK) {
+                case GRACHT_URING_OP_ACCEPT: uring_link_accept_complete(uring, result, cqeFlags); break;
+                case GRACHT_URING_OP_RECV:   uring_link_rx_complete(client, result, cqeFlags); break;
+                case GRACHT_URING_OP_SEND:   uring_link_tx_complete(client, result); break;
+                default: break;
+            }
+        }
+        tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+    }
+
+    uring_link_rx_feed_starved(uring);
+    mtx_lock(&uring->sq_lock);
+    (void)uring_submit(uring);
+    mtx_unlock(&uring->sq_lock);
+}
+
+// Invoked by the server whenever the link is signalled, which happens for every completion. The
+// completions are handled first, and then the connections that were accepted are handed out one
+// at a time, the link signals itself while connections are left. Fails with EAGAIN if no
+// connection was accepted.
+static int uring_link_accept(
+    struct gracht_link_socket*    link,
+    gracht_handle_t               set_handle,
+    struct gracht_server_client** clientOut)
+{
+    struct gracht_uring*      uring = link->uring;
+    struct uring_link_client* client;
+    int                       socket;
+
+    if (!atomic_load(&uring->reaper_known)) {
+        uring->reaper = thrd_current();
+        atomic_store(&uring->reaper_known, 1);
+    }
+
+    uring_doorbell_reset(uring->event_fd);
+    uring_reap(uring);
+    if (!uring->accepted_count) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    socket = uring->accepted[0];
+    memmove(&uring->accepted[0], &uring->accepted[1], sizeof(int) * (size_t)(--uring->accepted_count));
+    if (uring->accepted_count) {
+        uring_doorbell_ring(uring->event_fd);
+    }
+    GRTRACE(GRSTR("uring_link_accept %i"), socket);
+
+    if (uring_link_create_client(link, socket, set_handle, &client)) {
+        GRERROR(GRSTR("uring_link_accept failed to create client: %i"), errno);
+        close(socket);
+        return -1;
+    }
+
+    if (socket_aio_add(set_handle, client->base.handle)) {
+        GRWARNING(GRSTR("uring_link_accept failed to add client doorbell to set_handle"));
+    }
+
+    mtx_lock(&client->lock);
+    (void)uring_link_rx_arm(client);
+    mtx_unlock(&client->lock);
+
+    *clientOut = &client->base;
+    return 0;
+}
+
+static void uring_destroy(struct gracht_uring* uring)
+{
+    int i;
+
+    for (i = 0; i < uring->accepted_count; i++) {
+        close(uring->accepted[i]);
+    }
+    free(uring->accepted);
+
+    if (uring->fd >= 0) {
+        close(uring->fd);
+    }
+    if (uring->ring && uring->ring != MAP_FAILED) {
+        munmap(uring->ring, uring->ring_size);
+    }
+    if (uring->sqes && uring->sqes != MAP_FAILED) {
+        munmap(uring->sqes, uring->sqes_size);
+    }
+    if (uring->buf_ring && uring->buf_ring != MAP_FAILED) {
+        munmap(uring->buf_ring, uring->buf_ring_size);
+    }
+    if (uring->event_fd >= 0) {
+        close(uring->event_fd);
+    }
+    if (uring->listen_socket >= 0) {
+        close(uring->listen_socket);
+    }
+    gracht_buffer_pool_destroy(uring->buf_pool);
+    free(uring->buf_storage);
+    mtx_destroy(&uring->sq_lock);
+    mtx_destroy(&uring->buf_lock);
+    free(uring);
+}
+
+// Maps the queues of the ring, which requires a kernel that maps both queues at once.
+static int uring_map(struct gracht_uring* uring, struct io_uring_params* params)
+{
+    size_t sqSize = params->sq_off.array + params->sq_entries * sizeof(unsigned int);
+    size_t cqSize = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    char*  ring;
+
+    if (!(params->features & IORING_FEAT_SINGLE_MMAP) || !(params->features & IORING_FEAT_NODROP)) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    uring->ring_size = sqSize > cqSize ? sqSize : cqSize;
+    uring->ring = mmap(NULL, uring->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        uring->fd, IORING_OFF_SQ_RING);
+    if (uring->ring == MAP_FAILED) {
+        return -1;
+    }
+
+    uring->sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+    uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        uring->fd, IORING_OFF_SQES);
+    if (uring->sqes == MAP_FAILED) {
+        return -1;
+    }
+
+    ring = uring->ring;
+    uring->sq_head    = (unsigned int*)&ring[params->sq_off.head];
+    uring->sq_tail    = (unsigned int*)&ring[params->sq_off.tail];
+    uring->sq_array   = (unsigned int*)&ring[params->sq_off.array];
+    uring->sq_mask    = *(unsigned int*)&ring[params->sq_off.ring_mask];
+    uring->sq_entries = params->sq_entries;
+    uring->cq_head    = (unsigned int*)&ring[params->cq_off.head];
+    uring->cq_tail    = (unsigned int*)&ring[params->cq_off.tail];
+    uring->cq_mask    = *(unsigned int*)&ring[params->cq_off.ring_mask];
+    uring->cqes       = (struct io_uring_cqe*)&ring[params->cq_off.cqes];
+    return 0;
+}
+
+// Registers the provided buffers with the ring. The buffers are all taken from a buffer pool,
+// and the id of each buffer is its index in the pool storage.
+static int uring_provide_buffers(struct gracht_uring* uring, size_t bufferSize, unsigned int bufferCount)
+{
+    struct io_uring_buf_reg reg = { 0 };
+    uint16_t                bid;
+    void*                   buffer;
+
+    uring->buf_size  = bufferSize;
+    uring->buf_count = bufferCount;
+    uring->buf_storage = malloc(bufferSize * bufferCount);
+    if (!uring->buf_storage) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    if (gracht_buffer_pool_create_with_storage(bufferSize, bufferCount, uring->buf_storage, &uring->buf_pool)) {
+        return -1;
+    }
+
+    uring->buf_ring_size = bufferCount * sizeof(struct io_uring_buf);
+    uring->buf_ring = mmap(NULL, uring->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (uring->buf_ring == MAP_FAILED) {
+        return -1;
+    }
+
+    reg.ring_addr    = (uint64_t)(uintptr_t)uring->buf_ring;
+    reg.ring_entries = bufferCount;
+    reg.bgid         = GRACHT_URING_BUFFER_GROUP;
+    if (uring_register(uring->fd, IORING_REGISTER_PBUF_RING, &reg, 1)) {
+        return -1;
+    }
+
+    uring->buf_held = bufferCount;
+    while ((buffer = gracht_buffer_pool_acquire(uring->buf_pool))) {
+        bid = (uint16_t)(((char*)buffer - uring->buf_storage) / bufferSize);
+        uring_buffers_put(uring, &bid, 1);
+    }
+    return 0;
+}
+
+static int uring_create(struct gracht_link_socket* link, struct gracht_uring** uringOut)
+{
+    struct gracht_uring*   uring;
+    struct io_uring_params params = { 0 };
+
+    if (!link->uring_buffer_size || !link->uring_buffer_count || link->uring_buffer_count > 32768) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uring = malloc(sizeof(struct gracht_uring));
+    if (!uring) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memset(uring, 0, sizeof(struct gracht_uring));
+    uring->event_fd         = -1;
+    uring->listen_socket    = -1;
+    uring->accept_multishot = 1;
+    uring->recv_multishot   = 1;
+    atomic_store(&uring->references, 1);
+    mtx_init(&uring->sq_lock, mtx_plain);
+    mtx_init(&uring->buf_lock, mtx_plain);
+
+    params.flags      = IORING_SETUP_CQSIZE;
+    params.cq_entries = GRACHT_URING_CQ_ENTRIES;
+    uring->fd = uring_setup(GRACHT_URING_SQ_ENTRIES, &params);
+    if (uring->fd < 0 || uring_map(uring, &params)) {
+        uring_destroy(uring);
+        return -1;
+    }
+
+    // every completion signals the event, which is what the server waits for
+    uring->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (uring->event_fd < 0 || uring_register(uring->fd, IORING_REGISTER_EVENTFD, &uring->event_fd, 1)) {
+        uring_destroy(uring);
+        return -1;
+    }
+
+    if (uring_provide_buffers(uring, link->uring_buffer_size, (unsigned int)link->uring_buffer_count)) {
+        uring_destroy(uring);
+        return -1;
+    }
+
+    *uringOut = uring;
+    return 0;
+}
+
+static int uring_listen(struct gracht_link_socket* link, struct gracht_uring* uring)
+{
+    uring->listen_socket = socket(link->domain, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (uring->listen_socket < 0) {
+        return -1;
+    }
+
+#if defined(SO_REUSEPORT)
+    // Sharded links listen on the same address from multiple reactors, and
+    // let the kernel spread the incoming connections between them.
+    if (link->reuse_port) {
+        int enable = 1;
+        if (setsockopt(uring->listen_socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(int))) {
+            GRWARNING(GRSTR("uring_listen failed to enable SO_REUSEPORT"));
+        }
+    }
+#endif
+
+    if (bind(uring->listen_socket, (const struct sockaddr*)&link->bind_address, link->bind_address_length)) {
+        return -1;
+    }
+
+    // Enable listening for connections, with a maximum of 2 on backlog
+    if (listen(uring->listen_socket, 2)) {
+        return -1;
+    }
+    return uring_arm_accept(uring);
+}
+
+extern void gracht_link_server_socket_api(struct gracht_link_socket* link);
+
+static gracht_conn_t uring_link_setup(struct gracht_link_socket* link, gracht_handle_t set_handle)
+{
+    struct gracht_uring* uring;
+
+    if (link->base.type != gracht_link_stream_based || uring_create(link, &uring)) {
+        if (link->base.type == gracht_link_stream_based) {
+            GRWARNING(GRSTR("uring_link_setup io_uring is unavailable (%i), falling back to the socket link"), errno);
+        }
+        gracht_link_server_socket_api(link);
+        return link->base.ops.server.setup(&link->base, set_handle);
+    }
+
+    if (uring_listen(link, uring)) {
+        uring_destroy(uring);
+        return GRACHT_CONN_INVALID;
+    }
+
+    if (socket_aio_add(set_handle, uring->event_fd)) {
+        GRWARNING(GRSTR("uring_link_setup failed to add link event to set_handle"));
+    }
+
+    link->uring           = uring;
+    link->base.connection = uring->event_fd;
+    return link->base.connection;
+}
+
+static void uring_link_destroy(struct gracht_link_socket* link, gracht_handle_t set_handle)
+{
+    struct gracht_uring* uring;
+
+    if (!link) {
+        return;
+    }
+
+    uring = link->uring;
+    if (uring) {
+        if (socket_aio_remove(set_handle, uring->event_fd)) {
+            GRWARNING(GRSTR("uring_link_destroy failed to remove link event from set_handle"));
+        }
+
+        // cancel everything that is in flight, and wait for it to complete, as the
+        // requests of connections still hold on to them
+        atomic_store(&uring->closing, 1);
+        uring_cancel(uring, 0, IORING_ASYNC_CANCEL_ANY);
+        while (atomic_load(&uring->outstanding) > 0) {
+            if (uring_enter(uring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                GRWARNING(GRSTR("uring_link_destroy failed to wait for requests: %i"), errno);
+                break;
+            }
+            uring_reap(uring);
+        }
+
+        close(uring->listen_socket);
+        uring->listen_socket = -1;
+        uring_put(uring);
+    }
+    free(link);
+}
+
+void gracht_link_server_uring_api(struct gracht_link_socket* link)
+{
+    // connection-less links and the fallback are served by the socket link
+    link->base.ops.server.accept_client  = (server_accept_client_fn)uring_link_accept;
+    link->base.ops.server.destroy_client = (server_destroy_client_fn)uring_link_destroy_client;
+
+    link->base.ops.server.recv_client = (server_recv_client_fn)uring_link_recv_client;
+    link->base.ops.server.send_client = (server_send_client_fn)uring_link_send_client;
+    link->base.ops.server.peek_client = (server_peek_client_fn)uring_link_peek_client;
+    link->base.ops.server.recv_client_inplace  = (server_recv_client_inplace_fn)uring_link_recv_client_inplace;
+    link->base.ops.server.send_client_vectored = (server_send_client_vectored_fn)uring_link_send_client_vectored;
+    link->base.ops.server.flush_client         = NULL;
+
+    link->base.ops.server.setup   = (server_link_setup_fn)uring_link_setup;
+    link->base.ops.server.destroy = (server_link_destroy_fn)uring_link_destroy;
+}
@@ -99,9 +99,11 @@ static void vali_link_destroy(struct gracht_link_vali* link)
 
 void gracht_link_client_vali_api(struct gracht_link_vali* link)
 {
-    link->base.ops.client.connect = (client_link_connect_fn)vali_link_connect;
-    link->base.ops.client.recv    = (client_link_recv_fn)vali_link_recv;
-    link->base.ops.client.send    = (client_link_send_fn)vali_link_send;
-    link->base.ops.client.peek    = NULL;
-    link->base.ops.client.destroy = (client_link_destroy_fn)vali_link_destroy;
+    link->base.ops.client.connect   = (client_link_connect_fn)vali_link_connect;
+    link->base.ops.client.recv      = (client_link_recv_fn)vali_link_recv;
+    link->base.ops.client.send      = (client_link_send_fn)vali_link_send;
+    link->base.ops.client.peek      = NULL;
+    link->base.ops.client.destroy   = (client_link_destroy_fn)vali_link_destroy;
+    link->base.ops.client.interrupt = NULL;
+    link->base.ops.client.poll      = NULL;
 }
@@ -237,4 +237,5 @@ void gracht_link_server_vali_api(struct gracht_link_vali* link)
 
     link->base.ops.server.setup   = (server_link_setup_fn)vali_link_setup;
     link->base.ops.server.destroy = (server_link_destroy_fn)vali_link_destroy;
+    link->base.ops.server.clone   = NULL;
 }
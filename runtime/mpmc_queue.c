@@ -0,0 +1,158 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Bounded lock-free multi-producer multi-consumer queue. Every cell carries a
+ * sequence number that tells producers and consumers whether the cell is ready
+ * for them, so the only contended operation is the claim of an index.
+ */
+
+#include <errno.h>
+#include "mpmc_queue.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+size_t gr_mpmc_queue_capacity(unsigned int capacity)
+{
+    size_t size = 2;
+
+    // the sequence numbers cannot distinguish a full cell from a free one when there
+    // is only a single cell, so the queue always has room for atleast two elements
+    while (size < capacity) {
+        size <<= 1;
+    }
+    return size;
+}
+
+int gr_mpmc_queue_construct(struct gr_mpmc_queue* queue, unsigned int capacity)
+{
+    size_t size;
+    size_t i;
+
+    if (!queue || !capacity) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size = gr_mpmc_queue_capacity(capacity);
+    queue->cells = malloc(sizeof(struct gr_mpmc_cell) * size);
+    if (!queue->cells) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (i = 0; i < size; i++) {
+        atomic_store(&queue->cells[i].sequence, i);
+        queue->cells[i].data = NULL;
+    }
+
+    queue->mask = size - 1;
+    atomic_store(&queue->enqueue_index, 0);
+    atomic_store(&queue->dequeue_index, 0);
+    return 0;
+}
+
+void gr_mpmc_queue_destroy(struct gr_mpmc_queue* queue)
+{
+    if (!queue) {
+        return;
+    }
+
+    free(queue->cells);
+    queue->cells = NULL;
+}
+
+int gr_mpmc_queue_enqueue(struct gr_mpmc_queue* queue, void* pointer)
+{
+    struct gr_mpmc_cell* cell;
+    size_t               index;
+
+    if (!queue || !pointer) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    index = atomic_load(&queue->enqueue_index);
+    while (1) {
+        size_t   sequence;
+        intptr_t difference;
+
+        cell       = &queue->cells[index & queue->mask];
+        sequence   = atomic_load(&cell->sequence);
+        difference = (intptr_t)sequence - (intptr_t)index;
+        if (difference == 0) {
+            // the cell is free, try to claim the index
+            if (atomic_compare_exchange_strong(&queue->enqueue_index, &index, index + 1)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // the cell still holds an element from the previous lap, the queue is full
+            errno = ENOENT;
+            return -1;
+        } else {
+            index = atomic_load(&queue->enqueue_index);
+        }
+    }
+
+    cell->data = pointer;
+    atomic_store(&cell->sequence, index + 1);
+    return 0;
+}
+
+void* gr_mpmc_queue_dequeue(struct gr_mpmc_queue* queue)
+{
+    struct gr_mpmc_cell* cell;
+    size_t               index;
+    void*                data;
+
+    if (!queue) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    index = atomic_load(&queue->dequeue_index);
+    while (1) {
+        size_t   sequence;
+        intptr_t difference;
+
+        cell       = &queue->cells[index & queue->mask];
+        sequence   = atomic_load(&cell->sequence);
+        difference = (intptr_t)sequence - (intptr_t)(index + 1);
+        if (difference == 0) {
+            // the cell has been published, try to claim it
+            if (atomic_compare_exchange_strong(&queue->dequeue_index, &index, index + 1)) {
+                break;
+            }
+        } else if (difference < 0) {
+            errno = ENOENT;
+            return NULL;
+        } else {
+            index = atomic_load(&queue->dequeue_index);
+        }
+    }
+
+    // release the cell for the producers of the next lap
+    data = cell->data;
+    atomic_store(&cell->sequence, index + queue->mask + 1);
+    return data;
+}
+
+size_t gr_mpmc_queue_count(struct gr_mpmc_queue* queue)
+{
+    size_t enqueueIndex = atomic_load(&queue->enqueue_index);
+    size_t dequeueIndex = atomic_load(&queue->dequeue_index);
+    return enqueueIndex > dequeueIndex ? enqueueIndex - dequeueIndex : 0;
+}
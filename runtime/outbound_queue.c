@@ -0,0 +1,196 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Shared broadcast messages and the per-client queues they are sent from. Queues are
+ * small rings that are never resized, the capacity is fixed when the client is registered.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gracht/server.h"
+#include "outbound_queue.h"
+#include "utils.h"
+
+struct gr_shared_message* gr_shared_message_create(const void* data, uint32_t length)
+{
+    struct gr_shared_message* message = malloc(sizeof(struct gr_shared_message) + length);
+    if (!message) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    atomic_store(&message->references, 1);
+    message->length = length;
+    memcpy(&message->data[0], data, length);
+    return message;
+}
+
+void gr_shared_message_acquire(struct gr_shared_message* message)
+{
+    atomic_fetch_add(&message->references, 1);
+}
+
+void gr_shared_message_release(struct gr_shared_message* message)
+{
+    if (atomic_fetch_sub(&message->references, 1) == 1) {
+        free(message);
+    }
+}
+
+int gr_outbound_queue_create(int capacity, int policy, struct gr_outbound_queue** queueOut)
+{
+    struct gr_outbound_queue* queue;
+
+    // the busy message is never discarded, so there must always be room for one more
+    if (capacity < 2) {
+        capacity = 2;
+    }
+
+    queue = malloc(sizeof(struct gr_outbound_queue) + (sizeof(struct gr_shared_message*) * (size_t)capacity));
+    if (!queue) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    mtx_init(&queue->lock, mtx_plain);
+    queue->messages = (struct gr_shared_message**)(queue + 1);
+    queue->head     = 0;
+    queue->count    = 0;
+    queue->capacity = capacity;
+    queue->policy   = policy;
+    queue->busy     = 0;
+    atomic_store(&queue->scheduled, 1);
+    atomic_store(&queue->coalesced, 0);
+
+    *queueOut = queue;
+    return 0;
+}
+
+void gr_outbound_queue_destroy(struct gr_outbound_queue* queue)
+{
+    if (!queue) {
+        return;
+    }
+
+    for (int i = 0; i < queue->count; i++) {
+        gr_shared_message_release(queue->messages[(queue->head + i) % queue->capacity]);
+    }
+    mtx_destroy(&queue->lock);
+    free(queue);
+}
+
+static struct gr_shared_message* queue_at(struct gr_outbound_queue* queue, int index)
+{
+    return queue->messages[(queue->head + index) % queue->capacity];
+}
+
+static void queue_remove(struct gr_outbound_queue* queue, int index)
+{
+    int i;
+
+    gr_shared_message_release(queue_at(queue, index));
+    if (!index) {
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        return;
+    }
+
+    for (i = index; i < queue->count - 1; i++) {
+        queue->messages[(queue->head + i) % queue->capacity] = queue_at(queue, i + 1);
+    }
+    queue->count--;
+}
+
+// Events are coalesced when they are the same event from the same protocol, in which case
+// only the most recent one is of interest to the client.
+static int queue_find_same_event(struct gr_outbound_queue* queue, int first, struct gr_shared_message* message)
+{
+    for (int i = first; i < queue->count; i++) {
+        struct gr_shared_message* pending = queue_at(queue, i);
+        if (pending->data[MSG_INDEX_SID] == message->data[MSG_INDEX_SID] &&
+            pending->data[MSG_INDEX_AID] == message->data[MSG_INDEX_AID]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int gr_outbound_queue_push(struct gr_outbound_queue* queue, struct gr_shared_message* message)
+{
+    int discarded = 0;
+    int first;
+    int index;
+
+    mtx_lock(&queue->lock);
+    first = queue->busy ? 1 : 0;
+    if (queue->policy == GRACHT_BROADCAST_COALESCE) {
+        index = queue_find_same_event(queue, first, message);
+        if (index != -1) {
+            queue_remove(queue, index);
+            discarded = 1;
+        }
+    }
+
+    if (queue->count == queue->capacity) {
+        if (queue->policy == GRACHT_BROADCAST_DROP_NEWEST) {
+            mtx_unlock(&queue->lock);
+            return 1;
+        }
+        queue_remove(queue, first);
+        discarded = 1;
+    }
+
+    gr_shared_message_acquire(message);
+    queue->messages[(queue->head + queue->count) % queue->capacity] = message;
+    queue->count++;
+    mtx_unlock(&queue->lock);
+    return discarded;
+}
+
+int gr_outbound_queue_count(struct gr_outbound_queue* queue)
+{
+    int count;
+
+    mtx_lock(&queue->lock);
+    count = queue->count;
+    mtx_unlock(&queue->lock);
+    return count;
+}
+
+struct gr_shared_message* gr_outbound_queue_front(struct gr_outbound_queue* queue)
+{
+    struct gr_shared_message* message = NULL;
+
+    mtx_lock(&queue->lock);
+    if (queue->count) {
+        message     = queue_at(queue, 0);
+        queue->busy = 1;
+    }
+    mtx_unlock(&queue->lock);
+    return message;
+}
+
+void gr_outbound_queue_complete(struct gr_outbound_queue* queue, int sent)
+{
+    mtx_lock(&queue->lock);
+    if (sent && queue->count) {
+        queue_remove(queue, 0);
+    }
+    queue->busy = 0;
+    mtx_unlock(&queue->lock);
+}
@@ -0,0 +1,107 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Thread parking implementation, the parker state is 1 while the owner is
+ * parked (or about to park) and 0 otherwise. Whoever moves the state from
+ * 1 to 0 is responsible for waking up the owner.
+ */
+
+#include "parker.h"
+
+#if defined(GRACHT_PARKER_FUTEX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static void __futex_wait(atomic_int* address, int value)
+{
+    syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void __futex_wake(atomic_int* address)
+{
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+#endif
+
+void gr_parker_init(struct gr_parker* parker)
+{
+    atomic_store(&parker->state, 0);
+#ifndef GRACHT_PARKER_FUTEX
+    mtx_init(&parker->lock, mtx_plain);
+    cnd_init(&parker->signal);
+#endif
+}
+
+void gr_parker_destroy(struct gr_parker* parker)
+{
+#ifndef GRACHT_PARKER_FUTEX
+    mtx_destroy(&parker->lock);
+    cnd_destroy(&parker->signal);
+#else
+    (void)parker;
+#endif
+}
+
+void gr_parker_prepare(struct gr_parker* parker)
+{
+    atomic_store(&parker->state, 1);
+}
+
+void gr_parker_cancel(struct gr_parker* parker)
+{
+    atomic_store(&parker->state, 0);
+}
+
+void gr_parker_wait(struct gr_parker* parker)
+{
+#if defined(GRACHT_PARKER_FUTEX)
+    while (atomic_load(&parker->state) == 1) {
+        __futex_wait(&parker->state, 1);
+    }
+#else
+    mtx_lock(&parker->lock);
+    while (atomic_load(&parker->state) == 1) {
+        cnd_wait(&parker->signal, &parker->lock);
+    }
+    mtx_unlock(&parker->lock);
+#endif
+}
+
+int gr_parker_unpark(struct gr_parker* parker)
+{
+#if defined(GRACHT_PARKER_FUTEX)
+    int expected = 1;
+
+    if (!atomic_compare_exchange_strong(&parker->state, &expected, 0)) {
+        return 0;
+    }
+    __futex_wake(&parker->state);
+    return 1;
+#else
+    int parked;
+
+    mtx_lock(&parker->lock);
+    parked = atomic_load(&parker->state) == 1;
+    if (parked) {
+        atomic_store(&parker->state, 0);
+        cnd_signal(&parker->signal);
+    }
+    mtx_unlock(&parker->lock);
+    return parked;
+#endif
+}
@@ -0,0 +1,237 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Protocol Table
+ * - Two-level dispatch table of the registered protocols. Writers are serialized by a
+ *   mutex, and publish a new copy of the top level table for every change. The entries
+ *   of the protocols are shared between the copies, as they never change.
+ */
+
+#include <errno.h>
+#include "logging.h"
+#include "protocol_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+int gr_protocol_table_construct(struct gr_protocol_table* table)
+{
+    struct gr_protocol_snapshot* snapshot;
+
+    if (!table) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    snapshot = calloc(1, sizeof(struct gr_protocol_snapshot));
+    if (!snapshot) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    atomic_store(&table->current, (uintptr_t)snapshot);
+    mtx_init(&table->lock, mtx_plain);
+    table->retired_tables  = NULL;
+    table->retired_entries = NULL;
+    return 0;
+}
+
+void gr_protocol_table_destroy(struct gr_protocol_table* table)
+{
+    struct gr_protocol_snapshot* snapshot;
+    int                          i;
+
+    if (!table) {
+        return;
+    }
+
+    snapshot = (struct gr_protocol_snapshot*)atomic_load(&table->current);
+    for (i = 0; i < GR_PROTOCOL_TABLE_SIZE; i++) {
+        free(snapshot->protocols[i]);
+    }
+    free(snapshot);
+
+    while (table->retired_tables) {
+        snapshot = table->retired_tables;
+        table->retired_tables = snapshot->retired_next;
+        free(snapshot);
+    }
+
+    while (table->retired_entries) {
+        struct gr_protocol_entry* entry = table->retired_entries;
+        table->retired_entries = entry->retired_next;
+        free(entry);
+    }
+    mtx_destroy(&table->lock);
+}
+
+// Creates a copy of the current table with the entry for the protocol id replaced, and
+// publishes it. Must be called with the writer lock held.
+static int publish_entry(struct gr_protocol_table* table, uint8_t protocolId, struct gr_protocol_entry* entry)
+{
+    struct gr_protocol_snapshot* current = (struct gr_protocol_snapshot*)atomic_load(&table->current);
+    struct gr_protocol_snapshot* snapshot;
+
+    snapshot = malloc(sizeof(struct gr_protocol_snapshot));
+    if (!snapshot) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memcpy(&snapshot->protocols[0], &current->protocols[0], sizeof(current->protocols));
+    snapshot->protocols[protocolId] = entry;
+    snapshot->retired_next          = NULL;
+    atomic_store(&table->current, (uintptr_t)snapshot);
+
+    current->retired_next = table->retired_tables;
+    table->retired_tables = current;
+    return 0;
+}
+
+static struct gr_protocol_entry* create_entry(const gracht_protocol_t* protocol)
+{
+    struct gr_protocol_entry* entry;
+    int                       i;
+
+    entry = calloc(1, sizeof(struct gr_protocol_entry));
+    if (!entry) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memcpy(&entry->protocol, protocol, sizeof(gracht_protocol_t));
+    for (i = 0; i < protocol->num_functions; i++) {
+        if (!entry->actions[protocol->functions[i].id]) {
+            entry->actions[protocol->functions[i].id] = &protocol->functions[i];
+        }
+    }
+    return entry;
+}
+
+int gr_protocol_table_add(struct gr_protocol_table* table, const gracht_protocol_t* protocol)
+{
+    struct gr_protocol_entry* entry;
+    int                       status;
+
+    if (!table || !protocol) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    entry = create_entry(protocol);
+    if (!entry) {
+        return -1;
+    }
+
+    mtx_lock(&table->lock);
+    if (gr_protocol_table_get(table, protocol->id)) {
+        mtx_unlock(&table->lock);
+        free(entry);
+        errno = EEXIST;
+        return -1;
+    }
+
+    status = publish_entry(table, protocol->id, entry);
+    mtx_unlock(&table->lock);
+    if (status) {
+        free(entry);
+    }
+    return status;
+}
+
+int gr_protocol_table_replace(struct gr_protocol_table* table, const gracht_protocol_t* protocol)
+{
+    struct gr_protocol_snapshot* current;
+    struct gr_protocol_entry*    previous;
+    struct gr_protocol_entry*    entry;
+    int                          status;
+
+    if (!table || !protocol) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    entry = create_entry(protocol);
+    if (!entry) {
+        return -1;
+    }
+
+    // the new entry is published in one go, so lookups see either registration, but never none
+    mtx_lock(&table->lock);
+    current  = (struct gr_protocol_snapshot*)atomic_load(&table->current);
+    previous = current->protocols[protocol->id];
+    status   = publish_entry(table, protocol->id, entry);
+    if (status) {
+        mtx_unlock(&table->lock);
+        free(entry);
+        return status;
+    }
+
+    if (previous) {
+        previous->retired_next = table->retired_entries;
+        table->retired_entries = previous;
+    }
+    mtx_unlock(&table->lock);
+    return 0;
+}
+
+int gr_protocol_table_remove(struct gr_protocol_table* table, const gracht_protocol_t* protocol)
+{
+    struct gr_protocol_snapshot* current;
+    struct gr_protocol_entry*    entry;
+    int                          status;
+
+    if (!table || !protocol) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    mtx_lock(&table->lock);
+    current = (struct gr_protocol_snapshot*)atomic_load(&table->current);
+    entry   = current->protocols[protocol->id];
+    if (!entry) {
+        mtx_unlock(&table->lock);
+        errno = ENOENT;
+        return -1;
+    }
+
+    status = publish_entry(table, protocol->id, NULL);
+    if (!status) {
+        entry->retired_next    = table->retired_entries;
+        table->retired_entries = entry;
+    }
+    mtx_unlock(&table->lock);
+    return status;
+}
+
+gracht_protocol_function_t* gr_protocol_table_get_action(struct gr_protocol_table* table, uint8_t protocolId, uint8_t actionId)
+{
+    struct gr_protocol_snapshot* snapshot = (struct gr_protocol_snapshot*)atomic_load(&table->current);
+    struct gr_protocol_entry*    entry    = snapshot->protocols[protocolId];
+
+    if (!entry) {
+        GRERROR(GRSTR("get_protocol_action(p=%u, a=%u) protocol was not implemented"), protocolId, actionId);
+        errno = ENOTSUP;
+        return NULL;
+    }
+
+    if (!entry->actions[actionId]) {
+        GRERROR(GRSTR("get_protocol_action(p=%u, a=%u) action was not implemented"), protocolId, actionId);
+        errno = ENOTSUP;
+        return NULL;
+    }
+    return entry->actions[actionId];
+}
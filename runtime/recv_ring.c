@@ -0,0 +1,233 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Per-connection receive ring. The ring memory is mapped twice back-to-back, which
+ * means that any range of up to capacity bytes starting inside the ring is contiguous
+ * in memory. Data can then be received with a single call, and messages are handed
+ * out pointing directly to their data, regardless of where they start in the ring.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include "recv_ring.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(SYS_memfd_create)
+#define GRACHT_RECV_RING_SUPPORTED
+#endif
+#endif
+
+#ifdef GRACHT_RECV_RING_SUPPORTED
+static char* map_mirrored(size_t size)
+{
+    char* base;
+    int   fd;
+
+    fd = (int)syscall(SYS_memfd_create, "gracht-ring", 0);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (ftruncate(fd, (off_t)size)) {
+        close(fd);
+        return NULL;
+    }
+
+    // reserve the full range first, and then map the same pages into both halves
+    base = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, size * 2);
+        close(fd);
+        return NULL;
+    }
+
+    // the mappings keep the memory alive
+    close(fd);
+    return base;
+}
+#endif
+
+static void recv_ring_release(struct gracht_message* message);
+
+int gr_recv_ring_create(size_t size, unsigned int slotCount, struct gr_recv_ring** ringOut)
+{
+#ifdef GRACHT_RECV_RING_SUPPORTED
+    struct gr_recv_ring* ring;
+    size_t               pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    unsigned int         i;
+
+    if (!size || !slotCount || !ringOut) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ring = malloc(sizeof(struct gr_recv_ring));
+    if (!ring) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    ring->slots = malloc(sizeof(struct gr_recv_ring_slot) * slotCount);
+    if (!ring->slots) {
+        free(ring);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    ring->capacity = (size + pageSize - 1) & ~(pageSize - 1);
+    ring->base     = map_mirrored(ring->capacity);
+    if (!ring->base) {
+        free(ring->slots);
+        free(ring);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (i = 0; i < slotCount; i++) {
+        ring->slots[i].ring            = ring;
+        ring->slots[i].end             = 0;
+        ring->slots[i].message.release = recv_ring_release;
+        atomic_store(&ring->slots[i].busy, 0);
+    }
+
+    ring->head       = 0;
+    ring->parse      = 0;
+    ring->tail       = 0;
+    ring->slot_count = slotCount;
+    ring->slot_head  = 0;
+    ring->slot_tail  = 0;
+    atomic_store(&ring->references, 1);
+
+    *ringOut = ring;
+    return 0;
+#else
+    (void)size;
+    (void)slotCount;
+    (void)ringOut;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+static void recv_ring_destroy(struct gr_recv_ring* ring)
+{
+#ifdef GRACHT_RECV_RING_SUPPORTED
+    munmap(ring->base, ring->capacity * 2);
+#endif
+    free(ring->slots);
+    free(ring);
+}
+
+void gr_recv_ring_put(struct gr_recv_ring* ring)
+{
+    if (!ring) {
+        return;
+    }
+
+    if (atomic_fetch_sub(&ring->references, 1) == 1) {
+        recv_ring_destroy(ring);
+    }
+}
+
+// Invoked by the server when a message has been handled, this can be any thread
+static void recv_ring_release(struct gracht_message* message)
+{
+    struct gr_recv_ring_slot* slot = (struct gr_recv_ring_slot*)message;
+    struct gr_recv_ring*      ring = slot->ring;
+
+    atomic_store(&slot->busy, 0);
+    gr_recv_ring_put(ring);
+}
+
+static void recv_ring_reclaim(struct gr_recv_ring* ring)
+{
+    // space can only be reclaimed up to the oldest message that is still in use
+    while (ring->slot_head != ring->slot_tail) {
+        struct gr_recv_ring_slot* slot = &ring->slots[ring->slot_head % ring->slot_count];
+        if (atomic_load(&slot->busy)) {
+            return;
+        }
+        ring->head = slot->end;
+        ring->slot_head++;
+    }
+
+    // nothing is in use, so everything that was handed out or copied is free
+    ring->head = ring->parse;
+}
+
+size_t gr_recv_ring_space(struct gr_recv_ring* ring, char** spaceOut)
+{
+    recv_ring_reclaim(ring);
+    *spaceOut = &ring->base[ring->tail % ring->capacity];
+    return ring->capacity - (size_t)(ring->tail - ring->head);
+}
+
+void gr_recv_ring_produce(struct gr_recv_ring* ring, size_t length)
+{
+    ring->tail += length;
+}
+
+size_t gr_recv_ring_peek(struct gr_recv_ring* ring, char** dataOut)
+{
+    *dataOut = &ring->base[ring->parse % ring->capacity];
+    return (size_t)(ring->tail - ring->parse);
+}
+
+void gr_recv_ring_consume(struct gr_recv_ring* ring, size_t length)
+{
+    ring->parse += length;
+}
+
+struct gracht_message* gr_recv_ring_take(struct gr_recv_ring* ring, size_t length)
+{
+    struct gr_recv_ring_slot* slot;
+
+    if (ring->slot_tail - ring->slot_head == ring->slot_count) {
+        recv_ring_reclaim(ring);
+        if (ring->slot_tail - ring->slot_head == ring->slot_count) {
+            errno = ENOSPC;
+            return NULL;
+        }
+    }
+
+    slot = &ring->slots[ring->slot_tail % ring->slot_count];
+    slot->end = ring->parse + length;
+    slot->message.payload = (uint8_t*)&ring->base[ring->parse % ring->capacity];
+    slot->message.size    = (uint32_t)length;
+    slot->message.index   = 0;
+    slot->message.rsize   = 0;
+    atomic_store(&slot->busy, 1);
+    atomic_fetch_add(&ring->references, 1);
+
+    ring->slot_tail++;
+    ring->parse += length;
+    return &slot->message;
+}
@@ -23,44 +23,80 @@
 #include <errno.h>
 #include "aio.h"
 #include "buffer_pool.h"
+#include "client_registry.h"
 #include "stream_pool_registry.h"
 #include "logging.h"
 #include "gracht/server.h"
 #include "thread_api.h"
-#include "rwlock.h"
 #include "utils.h"
 #include "server_private.h"
 #include "hashtable.h"
+#include "protocol_table.h"
 #include "stack.h"
 #include "control.h"
+#include "gatomic.h"
+#include "gtime.h"
+#include "timer_heap.h"
+#include "outbound_queue.h"
+#include "subscriber_table.h"
+#include "mpmc_queue.h"
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define GRACHT_SERVER_MAX_LINKS 4
+#define GRACHT_SERVER_DEFAULT_EVENT_BATCH_SIZE 32
+#define GRACHT_SERVER_DEFAULT_BROADCAST_DEPTH  64
+#define GRACHT_SERVER_CONTROL_SLOTS            64
 
 #define GRACHT_CLIENT_FLAG_STREAM  0x1
 #define GRACHT_CLIENT_FLAG_CLEANUP 0x2
-
-struct client_wrapper {
-    gracht_conn_t                handle;
-    struct gracht_link*          link;
-    struct gracht_server_client* client;
+#define GRACHT_CLIENT_FLAG_ALL     0x4
+
+// forward declarations
+struct gracht_reactor;
+
+// Timers are run by the first reactor in between waiting for events, the heap only
+// holds deadlines, the timer itself is looked up by id when a deadline expires.
+struct gracht_server_timer {
+    uint32_t               id;
+    uint32_t               interval_ms;
+    int                    periodic;
+    uint64_t               deadline;
+    gracht_server_timer_fn callback;
+    void*                  context;
 };
 
+// Broadcasts are serialized once into a shared message that is queued for every subscriber,
+// the original buffer is only used when a client must be sent to directly.
 struct broadcast_context {
-    struct gracht_buffer* message;
-    unsigned int          flags;
+    struct gracht_server*     server;
+    struct gr_shared_message* message;
+    struct gracht_buffer*     buffer;
+    unsigned int              flags;
+    uint8_t                   protocol;
+};
+
+// A throttled entry is a connection (or link) that has been paused because the server
+// had no capacity for the message it received. The message is kept until it can be dispatched.
+struct gracht_throttled {
+    struct gracht_throttled* next;
+    gracht_conn_t            handle;
+    struct gracht_message*   message;
+    unsigned int             epoch;
+    uint64_t                 since;
 };
 
 struct server_operations {
-    void                   (*dispatch)(struct gracht_server*, struct gracht_message*);
-    struct gracht_message* (*get_incoming_buffer)(struct gracht_server*, uint32_t streamMessageSize);
-    void                   (*put_message)(struct gracht_server*, struct gracht_message*);
+    int                    (*dispatch)(struct gracht_server*, struct gracht_message*);
+    struct gracht_message* (*get_incoming_buffer)(struct gracht_reactor*, uint32_t streamMessageSize);
+    void                   (*put_message)(struct gracht_reactor*, struct gracht_message*);
 };
 
 struct link_table {
     gracht_conn_t       handles[GRACHT_SERVER_MAX_LINKS];
     struct gracht_link* links[GRACHT_SERVER_MAX_LINKS];
+    int                 sharded[GRACHT_SERVER_MAX_LINKS];
 };
 
 enum server_state {
@@ -69,6 +105,34 @@ enum server_state {
     SHUTDOWN_REQUESTED
 };
 
+// A reactor is an event loop that owns an aio set, the clients that were assigned
+// to it and the links (or link shards) that were set up in its set. Clients never move
+// between reactors, so all receiving for a client is done by the same thread.
+struct gracht_reactor {
+    struct gracht_server* server;
+    int                   index;
+    thrd_t                id;
+    gracht_handle_t       set_handle;
+    gracht_conn_t         wake_handle;
+    void*                 recv_buffer;
+    gracht_aio_event_t*   events;
+    int                   event_count;
+    struct link_table     link_table;
+    
+    // throttled connections are only ever touched by the reactor thread, the
+    // count is read by workers to determine whether the reactor should be woken
+    struct gracht_throttled* throttled_head;
+    struct gracht_throttled* throttled_tail;
+    atomic_int               throttled_count;
+
+    // clients with pending broadcasts, these are handed over by the broadcasting threads
+    // and the reactor is woken up to send them
+    mtx_t          outbound_lock;
+    gracht_conn_t* outbound_handles;
+    int            outbound_count;
+    int            outbound_capacity;
+};
+
 typedef struct gracht_server {
     enum server_state              state;
     struct server_operations*      ops;
@@ -78,18 +142,32 @@ typedef struct gracht_server {
     size_t                         allocation_size;
     size_t                         stream_buffer_size;
     size_t                         stream_buffer_count;
-    void*                          recv_buffer;
     struct gracht_buffer_pool*     recv_pool;
     struct gracht_stream_pool_registry stream_send_pools;
     struct gracht_stream_pool_registry stream_recv_pools;
     mtx_t                          stream_pools_lock;
-    gracht_handle_t                set_handle;
     int                            set_handle_provided;
-    gr_hashtable_t                 protocols;
-    struct rwlock                  protocols_lock;
-    gr_hashtable_t                 clients;
-    struct rwlock                  clients_lock;
-    struct link_table              link_table;
+    struct gr_protocol_table       protocols;
+    struct gr_client_registry      clients;
+    struct gr_subscriber_table     subscribers;
+    int                            broadcast_queue_depth;
+    int                            broadcast_policy;
+    atomic_ullong                  broadcast_dropped;
+    unsigned int                   coalesce_threshold;
+    struct gracht_reactor*         reactors;
+    int                            reactor_count;
+    atomic_uint                    reactor_rr;
+    atomic_int                     throttled_count;
+    atomic_uint                    capacity_epoch;
+    atomic_int                     capacity_wanted;
+    atomic_int                     control_pending[GRACHT_SERVER_CONTROL_SLOTS];
+    atomic_ullong                  throttle_count;
+    atomic_ullong                  throttled_time_ns;
+    atomic_ullong                  expired_count;
+    mtx_t                          timers_lock;
+    struct gr_timer_heap           timers;
+    gr_hashtable_t                 timer_entries;
+    uint32_t                       timer_id;
 } gracht_server_t;
 
 // api we export to generated files
@@ -98,14 +176,18 @@ GRACHTAPI int gracht_server_get_stream_buffer(gracht_server_t*, gracht_buffer_t*
 GRACHTAPI int gracht_server_get_stream_buffer_sized(gracht_server_t*, uint32_t, gracht_buffer_t*);
 GRACHTAPI int gracht_server_respond(struct gracht_message*, gracht_buffer_t*);
 GRACHTAPI int gracht_server_respond_stream(struct gracht_message*, gracht_buffer_t*);
+GRACHTAPI int gracht_server_respond_segments(struct gracht_message*, gracht_buffer_t*, struct gracht_message_segments*);
+GRACHTAPI int gracht_server_respond_stream_segments(struct gracht_message*, gracht_buffer_t*, struct gracht_message_segments*);
 GRACHTAPI int gracht_server_send_event(gracht_server_t*, gracht_conn_t client, gracht_buffer_t*, unsigned int flags);
 GRACHTAPI int gracht_server_send_stream_event(gracht_server_t*, gracht_conn_t client, gracht_buffer_t*, unsigned int flags);
+GRACHTAPI int gracht_server_send_event_segments(gracht_server_t*, gracht_conn_t client, gracht_buffer_t*, unsigned int flags, struct gracht_message_segments*);
+GRACHTAPI int gracht_server_send_stream_event_segments(gracht_server_t*, gracht_conn_t client, gracht_buffer_t*, unsigned int flags, struct gracht_message_segments*);
 GRACHTAPI int gracht_server_broadcast_event(gracht_server_t*, gracht_buffer_t*, unsigned int flags);
 GRACHTAPI int gracht_server_broadcast_stream_event(gracht_server_t*, gracht_buffer_t*, unsigned int flags);
 
-static struct gracht_message* get_in_buffer_st(struct gracht_server*, uint32_t);
-static void                   put_message_st(struct gracht_server*, struct gracht_message*);
-static void                   dispatch_st(struct gracht_server*, struct gracht_message*);
+static struct gracht_message* get_in_buffer_st(struct gracht_reactor*, uint32_t);
+static void                   put_message_st(struct gracht_reactor*, struct gracht_message*);
+static int                    dispatch_st(struct gracht_server*, struct gracht_message*);
 
 static struct server_operations g_stOperations = {
     dispatch_st,
@@ -113,9 +195,9 @@ static struct server_operations g_stOperations = {
     put_message_st
 };
 
-static struct gracht_message* get_in_buffer_mt(struct gracht_server*, uint32_t);
-static void                   put_message_mt(struct gracht_server*, struct gracht_message*);
-static void                   dispatch_mt(struct gracht_server*, struct gracht_message*);
+static struct gracht_message* get_in_buffer_mt(struct gracht_reactor*, uint32_t);
+static void                   put_message_mt(struct gracht_reactor*, struct gracht_message*);
+static int                    dispatch_mt(struct gracht_server*, struct gracht_message*);
 
 static struct server_operations g_mtOperations = {
     dispatch_mt,
@@ -123,32 +205,41 @@ static struct server_operations g_mtOperations = {
     put_message_mt
 };
 
-static void client_destroy(struct gracht_server*, gracht_conn_t);
-static void client_subscribe(struct gracht_server_client*, uint8_t);
-static void client_unsubscribe(struct gracht_server_client*, uint8_t);
+static struct gracht_link* get_link_by_conn(struct gracht_reactor*, gracht_conn_t, int*);
+static int                 handle_client_event(struct gracht_reactor*, gracht_conn_t, uint32_t);
+static void                reactor_flush_client(struct gracht_reactor*, gracht_conn_t);
+
+static struct gr_client_entry* get_client(struct gracht_server*, gracht_conn_t);
+static void                    invoke_action(struct gracht_server*, struct gracht_message*);
+
+static void client_destroy(struct gracht_reactor*, gracht_conn_t);
+static int  client_register(struct gracht_server*, struct gr_client_entry*, uint8_t);
+static void client_unregister(struct gracht_reactor*, gracht_conn_t);
+static void client_release(struct gr_client_entry*, void*);
+static void client_subscribe(struct gracht_server*, struct gr_client_entry*, uint8_t);
+static void client_unsubscribe(struct gracht_server*, struct gr_client_entry*, uint8_t);
 static int  client_is_subscribed(struct gracht_server_client*, uint8_t);
+static void client_schedule_flush(struct gr_client_entry*);
 
-static uint64_t client_hash(const void*);
-static int      client_cmp(const void*, const void*);
-static void     client_enum_destroy(int index, const void* element, void* userContext);
-static void     client_enum_broadcast(int index, const void* element, void* userContext);
+static int      client_match_reactor(struct gr_client_entry* entry, void* context);
+static void     client_enum_broadcast(struct gr_client_entry* entry, void* context);
 static int      server_protocol_uses_stream_pool(struct gracht_server*, uint8_t);
+static uint64_t timer_hash(const void* element);
+static int      timer_cmp(const void* element1, const void* element2);
 
 
 static int configure_server(struct gracht_server*, gracht_server_configuration_t*);
+static int configure_reactors(struct gracht_server*, gracht_server_configuration_t*);
 
-static int server_protocol_uses_stream_pool(struct gracht_server* server, uint8_t protocolId)
+static uint32_t server_protocol_flags(struct gracht_server* server, uint8_t protocolId)
 {
-    struct gracht_protocol* protocol;
-    int                     useStream = 0;
+    const gracht_protocol_t* protocol = gr_protocol_table_get(&server->protocols, protocolId);
+    return protocol ? protocol->flags : 0;
+}
 
-    rwlock_r_lock(&server->protocols_lock);
-    protocol = gr_hashtable_get(&server->protocols, &(struct gracht_protocol){ .id = protocolId });
-    if (protocol && (protocol->flags & GRACHT_PROTOCOL_FLAG_STREAM)) {
-        useStream = 1;
-    }
-    rwlock_r_unlock(&server->protocols_lock);
-    return useStream;
+static int server_protocol_uses_stream_pool(struct gracht_server* server, uint8_t protocolId)
+{
+    return (server_protocol_flags(server, protocolId) & GRACHT_PROTOCOL_FLAG_STREAM) != 0;
 }
 
 int gracht_server_create(gracht_server_configuration_t* config, gracht_server_t** serverOut)
@@ -167,22 +258,25 @@ int gracht_server_create(gracht_server_configuration_t* config, gracht_server_t*
         return -1;
     }
     memset(server, 0, sizeof(gracht_server_t));
-    server->set_handle = GRACHT_HANDLE_INVALID;
     mtx_init(&server->stream_pools_lock, mtx_plain);
+    mtx_init(&server->timers_lock, mtx_plain);
 
     status = configure_server(server, config);
     if (status) {
         GRERROR(GRSTR("gracht_server_start: invalid configuration provided"));
+        mtx_destroy(&server->timers_lock);
+        mtx_destroy(&server->stream_pools_lock);
         free(server);
         return -1;
     }
 
     // initialize static members of the instance
-    rwlock_init(&server->protocols_lock);
-    rwlock_init(&server->clients_lock);
-    gr_hashtable_construct(&server->protocols, 0, sizeof(struct gracht_protocol), protocol_hash, protocol_cmp);
-    gr_hashtable_construct(&server->clients, 0, sizeof(struct client_wrapper), client_hash, client_cmp);
+    gr_client_registry_construct(&server->clients, client_release, server);
+    gr_subscriber_table_construct(&server->subscribers);
+    gr_protocol_table_construct(&server->protocols);
     stack_construct(&server->buffer_stack, 8);
+    gr_timer_heap_construct(&server->timers);
+    gr_hashtable_construct(&server->timer_entries, 0, sizeof(struct gracht_server_timer), timer_hash, timer_cmp);
 
     // everything is set up - update state before registering control protocol
     server->state = RUNNING;
@@ -193,24 +287,81 @@ int gracht_server_create(gracht_server_configuration_t* config, gracht_server_t*
     return 0;
 }
 
+static int configure_reactors(struct gracht_server* server, gracht_server_configuration_t* configuration)
+{
+    int reactorCount = configuration->server_reactors > 1 ? configuration->server_reactors : 1;
+    int i;
+
+    // multiple reactors require that we own the set handles, and that we have a way
+    // of waking up reactors that are blocked waiting for events
+#ifndef GRACHT_AIO_HAS_WAKE
+    if (reactorCount > 1) {
+        GRWARNING(GRSTR("configure_reactors: multiple reactors are not supported on this platform"));
+        reactorCount = 1;
+    }
+#endif
+    if (reactorCount > 1 && configuration->set_descriptor_provided) {
+        GRWARNING(GRSTR("configure_reactors: multiple reactors cannot be used with a provided aio descriptor"));
+        reactorCount = 1;
+    }
+
+    server->reactors = malloc(sizeof(struct gracht_reactor) * reactorCount);
+    if (!server->reactors) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(server->reactors, 0, sizeof(struct gracht_reactor) * reactorCount);
+
+    for (i = 0; i < reactorCount; i++) {
+        struct gracht_reactor* reactor = &server->reactors[i];
+
+        reactor->server      = server;
+        reactor->index       = i;
+        reactor->wake_handle = GRACHT_CONN_INVALID;
+        mtx_init(&reactor->outbound_lock, mtx_plain);
+        
+        // handle the aio descriptor
+        if (i == 0 && configuration->set_descriptor_provided) {
+            reactor->set_handle         = configuration->set_descriptor;
+            server->set_handle_provided = 1;
+        } else {
+            reactor->set_handle = gracht_aio_create();
+            if (reactor->set_handle == GRACHT_HANDLE_INVALID) {
+                GRERROR(GRSTR("gracht_server: failed to create aio handle"));
+                return -1;
+            }
+        }
+
+        reactor->event_count = configuration->event_batch_size > 0 ?
+            configuration->event_batch_size : GRACHT_SERVER_DEFAULT_EVENT_BATCH_SIZE;
+        reactor->events = malloc(sizeof(gracht_aio_event_t) * reactor->event_count);
+        if (!reactor->events) {
+            GRERROR(GRSTR("gracht_server: failed to allocate the event array"));
+            errno = ENOMEM;
+            return -1;
+        }
+
+        reactor->wake_handle = gracht_aio_wake_create(reactor->set_handle);
+        server->reactor_count++;
+    }
+    return 0;
+}
+
 static int configure_server(struct gracht_server* server, gracht_server_configuration_t* configuration)
 {
+    size_t queueDepth;
     size_t bufferCount;
     int    status;
+    int    i;
 
     // set the configuration params that are just transfer
     memcpy(&server->callbacks, &configuration->callbacks, sizeof(struct gracht_server_callbacks));
 
-    // handle the aio descriptor
-    if (configuration->set_descriptor_provided) {
-        server->set_handle          = configuration->set_descriptor;
-        server->set_handle_provided = 1;
-    } else {
-        server->set_handle = gracht_aio_create();
-        if (server->set_handle == GRACHT_HANDLE_INVALID) {
-            GRERROR(GRSTR("gracht_server: failed to create aio handle"));
-            return -1;
-        }
+    // create the reactors, each of them owns an aio descriptor
+    status = configure_reactors(server, configuration);
+    if (status) {
+        GRERROR(GRSTR("configure_server: failed to create the server reactors"));
+        return -1;
     }
 
     // configure the allocation size, we use the max message size and add
@@ -220,7 +371,8 @@ static int configure_server(struct gracht_server* server, gracht_server_configur
     // handle the worker count, if the worker count is not provided we do not use
     // the dispatcher, but instead handle single-threaded.
     if (configuration->server_workers > 1) {
-        status = gracht_worker_pool_create(server, configuration->server_workers, &server->worker_pool);
+        status = gracht_worker_pool_create(server, configuration->server_workers,
+            configuration->worker_queue_depth, &server->worker_pool);
         if (status) {
             GRERROR(GRSTR("configure_server: failed to create the worker pool"));
             return -1;
@@ -232,17 +384,24 @@ static int configure_server(struct gracht_server* server, gracht_server_configur
 
     // handle the max message size override, otherwise we default to our default value.
     if (configuration->server_workers > 1) {
-        bufferCount = (size_t)configuration->server_workers * 32;
+        // allow for full queues for each worker, and the message each of them is handling. The
+        // queues are rounded up to a power of two, so size the pool from their real capacity.
+        queueDepth  = gr_mpmc_queue_capacity(configuration->worker_queue_depth > 0 ?
+            (unsigned int)configuration->worker_queue_depth : SERVER_WORKER_DEFAULT_QUEUE_SIZE);
+        bufferCount = (size_t)configuration->server_workers * ((queueDepth * 2) + 1);
         status      = gracht_buffer_pool_create(server->allocation_size, bufferCount, &server->recv_pool);
         if (status) {
             GRERROR(GRSTR("configure_server: failed to create the receive buffer pool"));
             return -1;
         }
     } else {
-        server->recv_buffer = malloc(server->allocation_size);
-        if (!server->recv_buffer) {
-            GRERROR(GRSTR("configure_server: failed to allocate memory for incoming messages"));
-            return -1;
+        // when handling single-threaded, every reactor handles one message at the time
+        for (i = 0; i < server->reactor_count; i++) {
+            server->reactors[i].recv_buffer = malloc(server->allocation_size);
+            if (!server->reactors[i].recv_buffer) {
+                GRERROR(GRSTR("configure_server: failed to allocate memory for incoming messages"));
+                return -1;
+            }
         }
     }
 
@@ -252,13 +411,51 @@ static int configure_server(struct gracht_server* server, gracht_server_configur
         server->stream_buffer_size = GRACHT_DEFAULT_MESSAGE_SIZE;
     }
     server->stream_buffer_count = (size_t)(configuration->stream_buffer_count > 0 ? configuration->stream_buffer_count : 8);
+    server->broadcast_queue_depth = configuration->broadcast_queue_depth > 0 ?
+        configuration->broadcast_queue_depth : GRACHT_SERVER_DEFAULT_BROADCAST_DEPTH;
+    server->broadcast_policy = configuration->broadcast_policy;
+    server->coalesce_threshold = configuration->coalesce_threshold > 0 ? (unsigned int)configuration->coalesce_threshold : 0;
     return 0;
 }
 
+static void destroy_link_shards(struct gracht_server* server, struct gracht_link** shards)
+{
+    for (int i = 1; i < server->reactor_count; i++) {
+        if (shards[i]) {
+            shards[i]->ops.server.destroy(shards[i], server->reactors[i].set_handle);
+            shards[i] = NULL;
+        }
+    }
+}
+
+static int create_link_shards(struct gracht_server* server, struct gracht_link* link, struct gracht_link** shards)
+{
+    int i;
+
+    shards[0] = link;
+    if (server->reactor_count == 1 || link->type != gracht_link_stream_based || !link->ops.server.clone) {
+        return 0;
+    }
+
+    // clones must be created before the original link is set up, as links may need to know they
+    // are sharded before they can be bound.
+    for (i = 1; i < server->reactor_count; i++) {
+        shards[i] = link->ops.server.clone(link);
+        if (!shards[i]) {
+            destroy_link_shards(server, shards);
+            return 0;
+        }
+    }
+    return 1;
+}
+
 int gracht_server_add_link(gracht_server_t* server, struct gracht_link* link)
 {
-    gracht_conn_t connection;
-    int           tableIndex;
+    struct gracht_link** shards;
+    gracht_conn_t        connection;
+    int                  tableIndex;
+    int                  sharded;
+    int                  i;
 
     if (!server || !link) {
         errno = EINVAL;
@@ -271,7 +468,7 @@ int gracht_server_add_link(gracht_server_t* server, struct gracht_link* link)
     }
 
     for (tableIndex = 0; tableIndex < GRACHT_SERVER_MAX_LINKS; tableIndex++) {
-        if (!server->link_table.links[tableIndex]) {
+        if (!server->reactors[0].link_table.links[tableIndex]) {
             break;
         }
     }
@@ -282,23 +479,72 @@ int gracht_server_add_link(gracht_server_t* server, struct gracht_link* link)
         return -1;
     }
 
-    connection = link->ops.server.setup(link, server->set_handle);
+    // Stream links are sharded across all reactors if the link supports it, otherwise
+    // the link is only set up on the first reactor, which then distributes the clients.
+    shards = calloc((size_t)server->reactor_count, sizeof(struct gracht_link*));
+    if (!shards) {
+        errno = ENOMEM;
+        return -1;
+    }
+    sharded = create_link_shards(server, link, &shards[0]);
+
+    connection = link->ops.server.setup(link, server->reactors[0].set_handle);
     if (connection == GRACHT_CONN_INVALID) {
         GRERROR(GRSTR("gracht_server_add_link: provided link failed setup"));
+        destroy_link_shards(server, &shards[0]);
+        free(shards);
         return -1;
     }
 
-    server->link_table.handles[tableIndex] = connection;
-    server->link_table.links[tableIndex]   = link;
+    for (i = 1; sharded && i < server->reactor_count; i++) {
+        if (shards[i]->ops.server.setup(shards[i], server->reactors[i].set_handle) == GRACHT_CONN_INVALID) {
+            GRWARNING(GRSTR("gracht_server_add_link: failed to setup link shard, clients will be distributed instead"));
+            destroy_link_shards(server, &shards[0]);
+            sharded = 0;
+        }
+    }
+
+    for (i = 0; i < server->reactor_count; i++) {
+        struct link_table* table = &server->reactors[i].link_table;
+        if (shards[i]) {
+            table->handles[tableIndex] = shards[i]->connection;
+            table->links[tableIndex]   = shards[i];
+            table->sharded[tableIndex] = sharded;
+        }
+    }
+    free(shards);
     return 0;
 }
 
-static int handle_connection(struct gracht_server* server, struct gracht_link* link)
+static struct gracht_reactor* get_reactor_for_client(struct gracht_reactor* reactor, int sharded)
 {
+    struct gracht_server* server = reactor->server;
+    unsigned int          index;
+
+    if (sharded || server->reactor_count == 1) {
+        return reactor;
+    }
+
+    index = atomic_fetch_add(&server->reactor_rr, 1);
+    return &server->reactors[index % (unsigned int)server->reactor_count];
+}
+
+static int handle_connection(struct gracht_reactor* reactor, struct gracht_link* link, int sharded)
+{
+    struct gracht_server*        server = reactor->server;
+    struct gracht_reactor*       target = get_reactor_for_client(reactor, sharded);
     struct gracht_server_client* client;
+    struct gr_client_entry       entry;
 
-    int status = link->ops.server.accept_client(link, server->set_handle, &client);
+    // the client is added directly to the aio set of the reactor that will be handling it,
+    // events that arrive before it's registered are kept as we use level-triggered events
+    int status = link->ops.server.accept_client(link, target->set_handle, &client);
     if (status) {
+        // links that complete their own requests are also signalled for other requests
+        // than accepts, and fail with EAGAIN when no client was accepted
+        if (errno == EAGAIN) {
+            return 0;
+        }
         GRERROR(GRSTR("gracht_server: failed to accept client"));
         return status;
     }
@@ -306,15 +552,17 @@ static int handle_connection(struct gracht_server* server, struct gracht_link* l
     // this is a streaming client, which means we handle them differently if they should
     // unsubscribe to certain protocols. Streaming clients are subscribed to all from start
     client->flags |= GRACHT_CLIENT_FLAG_STREAM;
-    memset(&client->subscriptions[0], 0xFF, sizeof(client->subscriptions));
-    
-    rwlock_w_lock(&server->clients_lock);
-    gr_hashtable_set(&server->clients, &(struct client_wrapper) { 
-        .handle = client->handle,
-        .link = link,
-        .client = client
-    });
-    rwlock_w_unlock(&server->clients_lock);
+
+    entry.handle  = client->handle;
+    entry.link    = link;
+    entry.client  = client;
+    entry.reactor = target;
+    status = client_register(server, &entry, 0xFF);
+    if (status) {
+        GRERROR(GRSTR("gracht_server: failed to register client: %i"), errno);
+        link->ops.server.destroy_client(client, target->set_handle);
+        return status;
+    }
 
     // invoke the new client callback at last
     if (server->callbacks.clientConnected) {
@@ -323,35 +571,46 @@ static int handle_connection(struct gracht_server* server, struct gracht_link* l
     return 0;
 }
 
-static struct gracht_message* get_in_buffer_st(struct gracht_server* server, uint32_t streamMessageSize)
+// Messages from the receive buffers have their payload right after the message header
+static struct gracht_message* init_in_buffer(struct gracht_server* server, void* buffer, size_t size)
+{
+    struct gracht_message* message = buffer;
+
+    message->server  = server;
+    message->index   = (uint32_t)size;
+    message->payload  = (uint8_t*)(message + 1);
+    message->release  = NULL;
+    message->deadline = 0;
+    return message;
+}
+
+static struct gracht_message* get_in_buffer_st(struct gracht_reactor* reactor, uint32_t streamMessageSize)
 {
-    struct gracht_message*      message;
+    struct gracht_server*       server = reactor->server;
     struct gracht_buffer_pool*  pool;
+    void*                       buffer;
     size_t                      requestedSize;
 
     if (streamMessageSize == 0) {
-        message = (struct gracht_message*)server->recv_buffer;
-        message->server = server;
-        message->index  = server->allocation_size;
-        return message;
+        return init_in_buffer(server, reactor->recv_buffer, server->allocation_size);
     }
 
     requestedSize = gracht_stream_normalize_buffer_size((size_t)streamMessageSize + 512, server->stream_buffer_size + 512);
     mtx_lock(&server->stream_pools_lock);
     pool = gracht_stream_pool_registry_get_or_create(&server->stream_recv_pools, requestedSize, server->stream_buffer_count);
-    message = pool ? gracht_buffer_pool_acquire(pool) : NULL;
+    buffer = pool ? gracht_buffer_pool_acquire(pool) : NULL;
     mtx_unlock(&server->stream_pools_lock);
-    if (!message) {
+    if (!buffer) {
         return NULL;
     }
-    message->server = server;
-    message->index  = (uint32_t)requestedSize;
-    return message;
+    return init_in_buffer(server, buffer, requestedSize);
 }
 
-static void put_message_st(struct gracht_server* server, struct gracht_message* message)
+static void put_message_st(struct gracht_reactor* reactor, struct gracht_message* message)
 {
-    if (!message || message == server->recv_buffer) {
+    struct gracht_server* server = reactor->server;
+
+    if (!message || message == reactor->recv_buffer) {
         return;
     }
 
@@ -360,62 +619,290 @@ static void put_message_st(struct gracht_server* server, struct gracht_message*
     mtx_unlock(&server->stream_pools_lock);
 }
 
-static void dispatch_st(struct gracht_server* server, struct gracht_message* message)
+static int dispatch_st(struct gracht_server* server, struct gracht_message* message)
 {
     server_invoke_action(server, message);
     server_cleanup_message(server, message);
+    return 0;
 }
 
-static void dispatch_mt(struct gracht_server* server, struct gracht_message* message)
+static int client_has_record(struct gracht_server* server, gracht_conn_t handle)
 {
-    uint8_t protocol = *((uint8_t*)&message->payload[message->index + MSG_INDEX_SID]);
+    struct gr_client_entry* entry = get_client(server, handle);
+    if (!entry) {
+        return 0;
+    }
+    gr_client_registry_release(&server->clients, entry);
+    return 1;
+}
+
+// Deferred control messages are counted per client, clients sharing a slot are pinned together
+// while one of them has a control message pending.
+static atomic_int* control_pending(struct gracht_server* server, gracht_conn_t client)
+{
+    uint64_t key = (uint64_t)client * 0x9E3779B97F4A7C15ULL;
+    return &server->control_pending[(key >> 32) % GRACHT_SERVER_CONTROL_SLOTS];
+}
 
-    // due to the fact that the control protocol modifies state on the server, especially
-    // client state - we want to ensure that these methods are run on orchestrator thread.
+static int dispatch_mt(struct gracht_server* server, struct gracht_message* message)
+{
+    uint8_t     protocol = *((uint8_t*)&message->payload[message->index + MSG_INDEX_SID]);
+    atomic_int* pending  = control_pending(server, message->client);
+    int         status;
+
+    // the control protocol only updates the subscriptions atomically, so it is applied inline
+    // before the next message of the client is read. Creating the record of a connection-less
+    // client is the exception, that is deferred to the pinned lane of the client. While a control
+    // message of the client is pending, its messages are pinned as well, so they run after it.
     if (protocol == 0) {
-        server_invoke_action(server, message);
-        server_cleanup_message(server, message);
+        if (!atomic_load(pending) && client_has_record(server, message->client)) {
+            invoke_action(server, message);
+            server_cleanup_message(server, message);
+            server_notify_capacity(server);
+            return 0;
+        }
+
+        atomic_fetch_add(pending, 1);
+        status = gracht_worker_pool_dispatch_affinity(server->worker_pool, message, (uint64_t)message->client);
+        if (status) {
+            atomic_fetch_sub(pending, 1);
+        }
+        return status;
     }
-    else {
-        gracht_worker_pool_dispatch(server->worker_pool, message);
+
+    // ordered protocols must have all messages of a client handled by the same worker
+    if (atomic_load(pending) ||
+        (server_protocol_flags(server, protocol) & GRACHT_PROTOCOL_FLAG_ORDERED)) {
+        return gracht_worker_pool_dispatch_affinity(server->worker_pool, message, (uint64_t)message->client);
     }
+    return gracht_worker_pool_dispatch(server->worker_pool, message);
 }
 
-static struct gracht_message* get_in_buffer_mt(struct gracht_server* server, uint32_t streamMessageSize)
+// Pauses the connection, so no further messages are read from it until the server has capacity
+// again. The message that could not be dispatched (if any) is kept with the connection. If no message
+// is provided, the connection is resumed when the capacity epoch has moved past <epoch>.
+static int reactor_throttle(struct gracht_reactor* reactor, gracht_conn_t handle, struct gracht_message* message, unsigned int epoch)
 {
-    struct gracht_message* message;
+#ifdef GRACHT_AIO_HAS_PAUSE
+    struct gracht_server*    server = reactor->server;
+    struct gracht_throttled* entry;
+
+    // resuming requires that workers can wake up the reactor
+    if (!server->worker_pool || reactor->wake_handle == GRACHT_CONN_INVALID) {
+        goto drop;
+    }
+
+    entry = malloc(sizeof(struct gracht_throttled));
+    if (!entry) {
+        goto drop;
+    }
+
+    if (gracht_aio_pause(reactor->set_handle, handle)) {
+        free(entry);
+        goto drop;
+    }
+    GRTRACE(GRSTR("reactor_throttle: pausing %" F_CONN_T), handle);
+
+    entry->next    = NULL;
+    entry->handle  = handle;
+    entry->message = message;
+    entry->epoch   = epoch;
+    entry->since   = gracht_time_ns();
+
+    // the workers only move the epoch once a reactor has run out of buffers, so a buffer released
+    // after our failed attempt, but before this, was not announced. The reactor that announces it
+    // checks once more by treating the epoch as moved, later releases will move it for everyone.
+    if (!message && !atomic_exchange(&server->capacity_wanted, 1)) {
+        entry->epoch = epoch - 1;
+    }
+    if (reactor->throttled_tail) {
+        reactor->throttled_tail->next = entry;
+    } else {
+        reactor->throttled_head = entry;
+    }
+    reactor->throttled_tail = entry;
+    atomic_fetch_add(&reactor->throttled_count, 1);
+    atomic_fetch_add(&server->throttled_count, 1);
+    atomic_fetch_add(&server->throttle_count, 1);
+
+    // a worker may have finished between our failed attempt and the registration above,
+    // so make sure we check for capacity at least once
+    gracht_aio_wake_signal(reactor->wake_handle);
+    return 0;
+
+drop:
+#endif
+    if (message) {
+        GRERROR(GRSTR("reactor_throttle: server has no capacity, dropping message"));
+        server_cleanup_message(reactor->server, message);
+    }
+    return -1;
+}
+
+static void reactor_unthrottle_entry(struct gracht_reactor* reactor, struct gracht_throttled* entry)
+{
+#ifdef GRACHT_AIO_HAS_PAUSE
+    struct gracht_server* server = reactor->server;
+
+    GRTRACE(GRSTR("reactor_unthrottle_entry: resuming %" F_CONN_T), entry->handle);
+    if (gracht_aio_resume(reactor->set_handle, entry->handle)) {
+        GRWARNING(GRSTR("reactor_unthrottle_entry: failed to resume %" F_CONN_T), entry->handle);
+    }
+
+    atomic_fetch_add(&server->throttled_time_ns, gracht_time_ns() - entry->since);
+    atomic_fetch_sub(&server->throttled_count, 1);
+    atomic_fetch_sub(&reactor->throttled_count, 1);
+#endif
+    free(entry);
+}
+
+// Resumes paused connections in the order they were paused, for as long as their pending
+// messages can be dispatched.
+static void reactor_resume_throttled(struct gracht_reactor* reactor)
+{
+    struct gracht_server* server = reactor->server;
+    gracht_conn_t         handle;
+
+    while (reactor->throttled_head) {
+        struct gracht_throttled* entry = reactor->throttled_head;
+
+        if (entry->message) {
+            if (server->ops->dispatch(server, entry->message)) {
+                break;
+            }
+        } else if (entry->epoch == atomic_load(&server->capacity_epoch)) {
+            // no messages have been released since we ran out of buffers
+            break;
+        }
+
+        reactor->throttled_head = entry->next;
+        if (!reactor->throttled_head) {
+            reactor->throttled_tail = NULL;
+        }
+        handle = entry->handle;
+        reactor_unthrottle_entry(reactor, entry);
+
+        // links may have buffered frames from the connection that will not trigger any
+        // new events, so drain the connection right away. Broadcasts that were waiting for
+        // the connection to become writable are not being watched for anymore either.
+        if (!get_link_by_conn(reactor, handle, NULL)) {
+            reactor_flush_client(reactor, handle);
+            handle_client_event(reactor, handle, GRACHT_AIO_EVENT_IN);
+        }
+    }
+}
+
+// Removes a paused connection without dispatching its pending message, this is used when
+// connections are destroyed.
+static void reactor_cancel_throttled(struct gracht_reactor* reactor, gracht_conn_t handle)
+{
+    struct gracht_throttled* previous = NULL;
+    struct gracht_throttled* entry    = reactor->throttled_head;
+
+    while (entry) {
+        if (entry->handle == handle) {
+            if (previous) {
+                previous->next = entry->next;
+            } else {
+                reactor->throttled_head = entry->next;
+            }
+            if (reactor->throttled_tail == entry) {
+                reactor->throttled_tail = previous;
+            }
+
+            if (entry->message) {
+                server_cleanup_message(reactor->server, entry->message);
+            }
+            reactor_unthrottle_entry(reactor, entry);
+            return;
+        }
+        previous = entry;
+        entry    = entry->next;
+    }
+}
+
+// Calls can carry the time the caller is willing to wait for the response, which is converted
+// to a deadline when the message is received so it can be checked when the call is handled.
+static void stamp_deadline(struct gracht_message* message)
+{
+    uint8_t* header = &message->payload[message->index];
+    uint32_t length;
+    uint32_t timeoutMs;
+
+    message->deadline = 0;
+    if (!(header[MSG_INDEX_FLG] & MESSAGE_FLAG_DEADLINE)) {
+        return;
+    }
+
+    memcpy(&length, &header[MSG_INDEX_LEN], sizeof(uint32_t));
+    if (length < GRACHT_MESSAGE_HEADER_SIZE + GRACHT_MESSAGE_DEADLINE_SIZE) {
+        return;
+    }
+
+    memcpy(&timeoutMs, &header[length - GRACHT_MESSAGE_DEADLINE_SIZE], sizeof(uint32_t));
+    message->deadline = gracht_time_ns() + ((uint64_t)timeoutMs * 1000000ULL);
+}
+
+// Dispatches a received message, if the server has no capacity for the message the connection
+// is paused. Returns non-zero if the connection should not be read from any further.
+static int reactor_dispatch(struct gracht_reactor* reactor, gracht_conn_t handle, struct gracht_message* message)
+{
+    stamp_deadline(message);
+    if (!reactor->server->ops->dispatch(reactor->server, message)) {
+        return 0;
+    }
+    reactor_throttle(reactor, handle, message, 0);
+    return 1;
+}
+
+void server_notify_capacity(struct gracht_server* server)
+{
+    // only move the epoch when a reactor is waiting for buffers, so the workers do not all write
+    // the same cache line for every message they handle
+    if (atomic_load(&server->capacity_wanted) && atomic_exchange(&server->capacity_wanted, 0)) {
+        atomic_fetch_add(&server->capacity_epoch, 1);
+    }
+    if (!atomic_load(&server->throttled_count)) {
+        return;
+    }
+
+    for (int i = 0; i < server->reactor_count; i++) {
+        if (atomic_load(&server->reactors[i].throttled_count)) {
+            gracht_aio_wake_signal(server->reactors[i].wake_handle);
+        }
+    }
+}
+
+static struct gracht_message* get_in_buffer_mt(struct gracht_reactor* reactor, uint32_t streamMessageSize)
+{
+    struct gracht_server*      server = reactor->server;
+    struct gracht_buffer_pool* pool;
+    void*                      buffer;
+    size_t                     requestedSize;
 
     if (streamMessageSize == 0) {
-        message = gracht_buffer_pool_acquire(server->recv_pool);
-        if (!message) {
+        buffer = gracht_buffer_pool_acquire(server->recv_pool);
+        if (!buffer) {
             return NULL;
         }
-        message->server = server;
-        message->index  = server->allocation_size;
-        return message;
+        return init_in_buffer(server, buffer, server->allocation_size);
     }
 
+    requestedSize = gracht_stream_normalize_buffer_size((size_t)streamMessageSize + 512, server->stream_buffer_size + 512);
     mtx_lock(&server->stream_pools_lock);
-    {
-        struct gracht_buffer_pool* pool;
-        size_t requestedSize = gracht_stream_normalize_buffer_size((size_t)streamMessageSize + 512, server->stream_buffer_size + 512);
-
-        pool = gracht_stream_pool_registry_get_or_create(&server->stream_recv_pools, requestedSize, server->stream_buffer_count);
-        message = pool ? gracht_buffer_pool_acquire(pool) : NULL;
-        if (message) {
-            message->index = (uint32_t)requestedSize;
-        }
-    }
+    pool = gracht_stream_pool_registry_get_or_create(&server->stream_recv_pools, requestedSize, server->stream_buffer_count);
+    buffer = pool ? gracht_buffer_pool_acquire(pool) : NULL;
     mtx_unlock(&server->stream_pools_lock);
-    if (!message) {
+    if (!buffer) {
         return NULL;
     }
-    message->server = server;
-    return message;
+    return init_in_buffer(server, buffer, requestedSize);
 }
 
-static void put_message_mt(struct gracht_server* server, struct gracht_message* message)
+static void put_message_mt(struct gracht_reactor* reactor, struct gracht_message* message)
 {
+    struct gracht_server* server = reactor->server;
+
     mtx_lock(&server->stream_pools_lock);
     if (!gracht_stream_pool_registry_release(&server->stream_recv_pools, message)) {
         gracht_buffer_pool_release(server->recv_pool, message);
@@ -423,10 +910,12 @@ static void put_message_mt(struct gracht_server* server, struct gracht_message*
     mtx_unlock(&server->stream_pools_lock);
 }
 
-static int handle_packet(struct gracht_server* server, struct gracht_link* link)
+static int handle_packet(struct gracht_reactor* reactor, struct gracht_link* link)
 {
+    struct gracht_server*  server = reactor->server;
     struct gracht_message* message;
     int                    status;
+    unsigned int           epoch;
     uint32_t               incomingLength = 0;
     uint8_t                protocolId = 0;
     uint32_t               streamMessageSize = 0;
@@ -449,11 +938,16 @@ static int handle_packet(struct gracht_server* server, struct gracht_link* link)
         }
     }
 
-    message = server->ops->get_incoming_buffer(server, streamMessageSize);
+    epoch   = atomic_load(&server->capacity_epoch);
+    message = server->ops->get_incoming_buffer(reactor, streamMessageSize);
     if (!message) {
-        GRERROR(GRSTR("handle_packet ran out of receiving buffers"));
-        errno = ENOMEM;
-        return -1;
+        // wait for messages to be released before reading any further
+        if (reactor_throttle(reactor, link->connection, NULL, epoch)) {
+            GRERROR(GRSTR("handle_packet ran out of receiving buffers"));
+            errno = ENOMEM;
+            return -1;
+        }
+        return 0;
     }
 
     status = link->ops.server.recv(link, message, GRACHT_MESSAGE_BLOCK);
@@ -461,103 +955,263 @@ static int handle_packet(struct gracht_server* server, struct gracht_link* link)
         if (errno != ENODATA) {
             GRERROR(GRSTR("handle_packet link->ops.server.recv returned %i"), errno);
         }
-        server->ops->put_message(server, message);
+        server->ops->put_message(reactor, message);
         return status;
     }
 
-    server->ops->dispatch(server, message);
+    reactor_dispatch(reactor, link->connection, message);
     return 0;
 }
 
-static struct gracht_link* get_link_by_conn(struct gracht_server* server, gracht_conn_t connection)
+static struct gracht_link* get_link_by_conn(struct gracht_reactor* reactor, gracht_conn_t connection, int* sharded)
 {
     for (int i = 0; i < GRACHT_SERVER_MAX_LINKS; i++) {
-        if (server->link_table.handles[i] == connection) {
-            return server->link_table.links[i];
+        if (reactor->link_table.links[i] && reactor->link_table.handles[i] == connection) {
+            if (sharded) {
+                *sharded = reactor->link_table.sharded[i];
+            }
+            return reactor->link_table.links[i];
+        }
+    }
+    return NULL;
+}
+
+static struct gracht_link* get_server_link_by_conn(struct gracht_server* server, gracht_conn_t connection, struct gracht_reactor** reactorOut)
+{
+    for (int i = 0; i < server->reactor_count; i++) {
+        struct gracht_link* link = get_link_by_conn(&server->reactors[i], connection, NULL);
+        if (link) {
+            if (reactorOut) {
+                *reactorOut = &server->reactors[i];
+            }
+            return link;
         }
     }
     return NULL;
 }
 
-static int handle_client_event(struct gracht_server* server, gracht_conn_t handle, uint32_t events)
+// Looks up the client, if the client was found a reference is held on it on return, and must be
+// released by the caller with gr_client_registry_release.
+static struct gr_client_entry* get_client(struct gracht_server* server, gracht_conn_t handle)
+{
+    return gr_client_registry_acquire(&server->clients, handle);
+}
+
+// Writes the data the link has queued for the client, and then the pending broadcasts of the client.
+// This must only be called from the reactor of the client. When the connection cannot take any more
+// data, the link watches for it to become writable and the client is flushed again from there.
+static void reactor_flush_client(struct gracht_reactor* reactor, gracht_conn_t handle)
+{
+    struct gracht_server*     server = reactor->server;
+    struct gr_client_entry*   entry;
+    struct gr_outbound_queue* queue;
+    struct gr_shared_message* message;
+    int                       status;
+
+    entry = get_client(server, handle);
+    if (!entry) {
+        return;
+    }
+    queue = entry->outbound;
+
+    atomic_store(&queue->coalesced, 0);
+    if (entry->link->ops.server.flush_client) {
+        (void)entry->link->ops.server.flush_client(entry->client);
+    }
+
+    // clear the mark before looking at the queue, so broadcasts that are queued while we
+    // are sending will hand the client to us again
+    atomic_store(&queue->scheduled, 0);
+    while ((message = gr_outbound_queue_front(queue))) {
+        struct gracht_buffer buffer = { .data = &message->data[0], .index = message->length };
+
+        status = entry->link->ops.server.send_client(entry->client, &buffer, 0);
+        if (status && errno == EAGAIN && entry->link->ops.server.flush_client) {
+            // the link holds more than it should for the client, keep the client marked while
+            // we wait for the link to report the connection as writable
+            gr_outbound_queue_complete(queue, 0);
+            atomic_store(&queue->scheduled, 1);
+            break;
+        }
+
+        if (status) {
+            atomic_fetch_add(&server->broadcast_dropped, 1);
+        }
+        gr_outbound_queue_complete(queue, 1);
+    }
+    gr_client_registry_release(&server->clients, entry);
+}
+
+// Flushes the clients that broadcasting threads have handed to the reactor.
+static void reactor_flush_scheduled(struct gracht_reactor* reactor)
+{
+    gracht_conn_t handle;
+
+    for (;;) {
+        mtx_lock(&reactor->outbound_lock);
+        if (!reactor->outbound_count) {
+            mtx_unlock(&reactor->outbound_lock);
+            break;
+        }
+        handle = reactor->outbound_handles[--reactor->outbound_count];
+        mtx_unlock(&reactor->outbound_lock);
+
+        reactor_flush_client(reactor, handle);
+    }
+}
+
+// Handles a failed read from a client, errno must be set by the link. The read lock of the
+// reactor must not be held when calling this.
+static void handle_client_error(struct gracht_reactor* reactor, gracht_conn_t handle, unsigned int epoch, const char* operation)
 {
-    int status;
+    int error = errno;
+
+    // the link cannot hold any more data until the messages it holds are released
+    if (error == ENOSPC) {
+        if (reactor_throttle(reactor, handle, NULL, epoch)) {
+            GRERROR(GRSTR("handle_client_event link ran out of receiving buffers"));
+        }
+        return;
+    }
+
+    // silence the three below error codes, those are expected
+    if (error != ENODATA && error != EAGAIN && error != EFAULT) {
+        GRERROR(GRSTR("handle_client_event server_object.link->%s returned %i"), operation, error);
+    }
+
+    // detect cases of disconnection or transmission failures that are fatal.
+    // in these cases we expect the underlying link to specify EFAULT
+    if (error == EFAULT) {
+        GRTRACE(GRSTR("handle_client_event client disconnected, cleaning up"));
+        client_destroy(reactor, handle);
+    }
+}
+
+static int handle_client_event(struct gracht_reactor* reactor, gracht_conn_t handle, uint32_t events)
+{
+    struct gracht_server* server = reactor->server;
+    int                   status;
     GRTRACE(GRSTR("handle_client_event %" F_CONN_T ", 0x%x"), handle, events);
 
     // Check for control event. On non-passive sockets, control event is the
     // disconnect event.
     if (events & GRACHT_AIO_EVENT_DISCONNECT) {
-        client_destroy(server, handle);
+        client_destroy(reactor, handle);
     } else if ((events & GRACHT_AIO_EVENT_IN) || !events) {
-        struct client_wrapper* entry;
+        struct gr_client_entry* entry;
 
-        rwlock_r_lock(&server->clients_lock);
-        entry = gr_hashtable_get(&server->clients, &(struct client_wrapper){ .handle = handle });
+        // the client is referenced while it is drained, so it is not destroyed under us even if
+        // a handler unregisters it
+        entry = get_client(server, handle);
         while (entry) {
             uint32_t               incomingLength = 0;
             uint8_t                protocolId = 0;
             uint32_t               streamMessageSize = 0;
+            unsigned int           epoch;
             struct gracht_message* message;
 
+            epoch = atomic_load(&server->capacity_epoch);
             if (entry->link->ops.server.peek_client) {
                 status = entry->link->ops.server.peek_client(entry->client, &incomingLength, &protocolId, 0);
                 if (status) {
-                    rwlock_r_unlock(&server->clients_lock);
-
-                    if (errno != ENODATA && errno != EAGAIN && errno != EFAULT) {
-                        GRERROR(GRSTR("handle_client_event server_object.link->peek_client returned %i"), errno);
-                    }
-
-                    if (errno == EFAULT) {
-                        GRTRACE(GRSTR("handle_client_event client disconnected, cleaning up"));
-                        client_destroy(server, handle);
-                    }
+                    gr_client_registry_release(&server->clients, entry);
+                    handle_client_error(reactor, handle, epoch, "peek_client");
                     return 0;
                 }
 
                 if (server_protocol_uses_stream_pool(server, protocolId)) {
                     streamMessageSize = incomingLength;
                 } else if (incomingLength > (uint32_t)(server->allocation_size - 512)) {
-                    rwlock_r_unlock(&server->clients_lock);
+                    gr_client_registry_release(&server->clients, entry);
                     errno = EMSGSIZE;
                     return -1;
                 }
             }
 
-            message = server->ops->get_incoming_buffer(server, streamMessageSize);
+            // prefer to let the link hand out the message from its own buffers, this avoids
+            // both copying the message and acquiring a receive buffer for it
+            if (entry->link->ops.server.recv_client_inplace) {
+                status = entry->link->ops.server.recv_client_inplace(entry->client, &message, 0);
+                if (!status) {
+                    message->server = server;
+                    if (reactor_dispatch(reactor, handle, message)) {
+                        break;
+                    }
+                    continue;
+                } else if (errno != ENOBUFS) {
+                    gr_client_registry_release(&server->clients, entry);
+                    handle_client_error(reactor, handle, epoch, "recv_client_inplace");
+                    return 0;
+                }
+            }
+
+            message = server->ops->get_incoming_buffer(reactor, streamMessageSize);
             if (!message) {
-                rwlock_r_unlock(&server->clients_lock);
-                GRERROR(GRSTR("handle_client_event ran out of receiving buffers"));
-                errno = ENOMEM;
-                return -1;
+                gr_client_registry_release(&server->clients, entry);
+
+                // wait for messages to be released before reading any further
+                if (reactor_throttle(reactor, handle, NULL, epoch)) {
+                    GRERROR(GRSTR("handle_client_event ran out of receiving buffers"));
+                    errno = ENOMEM;
+                    return -1;
+                }
+                return 0;
             }
             
             status = entry->link->ops.server.recv_client(entry->client, message, 0);
             if (status) {
-                server->ops->put_message(server, message);
-                rwlock_r_unlock(&server->clients_lock);
-
-                // silence the three below error codes, those are expected
-                if (errno != ENODATA && errno != EAGAIN && errno != EFAULT) {
-                    GRERROR(GRSTR("handle_client_event server_object.link->recv_client returned %i"), errno);
-                }
-
-                // detect cases of disconnection or transmission failures that are fatal.
-                // in these cases we expect the underlying link to specify EFAULT
-                if (errno == EFAULT) {
-                    GRTRACE(GRSTR("handle_client_event client disconnected, cleaning up"));
-                    client_destroy(server, handle);
-                }
+                server->ops->put_message(reactor, message);
+                gr_client_registry_release(&server->clients, entry);
+                handle_client_error(reactor, handle, epoch, "recv_client");
                 return 0;
             }
 
-            server->ops->dispatch(server, message);
+            if (reactor_dispatch(reactor, handle, message)) {
+                break;
+            }
         }
-        rwlock_r_unlock(&server->clients_lock);
+        gr_client_registry_release(&server->clients, entry);
     }
     return 0;
 }
 
+static void destroy_reactor(struct gracht_reactor* reactor)
+{
+    struct gracht_server* server = reactor->server;
+    int                   i;
+
+    // release the messages of all paused connections
+    while (reactor->throttled_head) {
+        reactor_cancel_throttled(reactor, reactor->throttled_head->handle);
+    }
+
+    // start out by destroying all our clients
+    gr_client_registry_remove_if(&server->clients, client_match_reactor, reactor);
+    free(reactor->outbound_handles);
+    mtx_destroy(&reactor->outbound_lock);
+
+    // destroy all our links
+    for (i = 0; i < GRACHT_SERVER_MAX_LINKS; i++) {
+        if (reactor->link_table.links[i]) {
+            reactor->link_table.links[i]->ops.server.destroy(reactor->link_table.links[i], reactor->set_handle);
+            reactor->link_table.links[i] = NULL;
+        }
+    }
+
+    gracht_aio_wake_destroy(reactor->set_handle, reactor->wake_handle);
+
+    // destroy the event descriptor
+    if (reactor->set_handle != GRACHT_HANDLE_INVALID && !(reactor->index == 0 && server->set_handle_provided)) {
+        gracht_aio_destroy(reactor->set_handle);
+    }
+
+    if (reactor->recv_buffer) {
+        free(reactor->recv_buffer);
+    }
+    free(reactor->events);
+
+}
+
 static int gracht_server_shutdown(gracht_server_t* server)
 {
     void* buffer;
@@ -575,23 +1229,11 @@ static int gracht_server_shutdown(gracht_server_t* server)
         gracht_worker_pool_destroy(server->worker_pool);
     }
 
-    // start out by destroying all our clients
-    rwlock_w_lock(&server->clients_lock);
-    gr_hashtable_enumerate(&server->clients, client_enum_destroy, server);
-    rwlock_w_unlock(&server->clients_lock);
-
-    // destroy all our links
-    for (i = 0; i < GRACHT_SERVER_MAX_LINKS; i++) {
-        if (server->link_table.links[i]) {
-            server->link_table.links[i]->ops.server.destroy(server->link_table.links[i], server->set_handle);
-            server->link_table.links[i] = NULL;
-        }
-    }
-    
-    // destroy the event descriptor
-    if (server->set_handle != GRACHT_HANDLE_INVALID && !server->set_handle_provided) {
-        gracht_aio_destroy(server->set_handle);
+    // destroy all our reactors, which own the clients and links
+    for (i = 0; i < server->reactor_count; i++) {
+        destroy_reactor(&server->reactors[i]);
     }
+    free(server->reactors);
 
     // iterate all our serializer buffers and destroy them
     buffer = stack_pop(&server->buffer_stack);
@@ -608,16 +1250,14 @@ static int gracht_server_shutdown(gracht_server_t* server)
     gracht_stream_pool_registry_destroy(&server->stream_send_pools);
     gracht_stream_pool_registry_destroy(&server->stream_recv_pools);
     
-    if (server->recv_buffer) {
-        free(server->recv_buffer);
-    }
-
     stack_destroy(&server->buffer_stack);
-    gr_hashtable_destroy(&server->protocols);
-    gr_hashtable_destroy(&server->clients);
+    gr_protocol_table_destroy(&server->protocols);
+    gr_client_registry_destroy(&server->clients);
+    gr_subscriber_table_destroy(&server->subscribers);
+    gr_hashtable_destroy(&server->timer_entries);
+    gr_timer_heap_destroy(&server->timers);
+    mtx_destroy(&server->timers_lock);
     mtx_destroy(&server->stream_pools_lock);
-    rwlock_destroy(&server->protocols_lock);
-    rwlock_destroy(&server->clients_lock);
     free(server);
     return 0;
 }
@@ -635,9 +1275,14 @@ void gracht_server_request_shutdown(gracht_server_t* server)
     }
     
     server->state = SHUTDOWN_REQUESTED;
+
+    // wake up all reactors so they can observe the state change
+    for (int i = 0; i < server->reactor_count; i++) {
+        gracht_aio_wake_signal(server->reactors[i].wake_handle);
+    }
 }
 
-void server_invoke_action(struct gracht_server* server, struct gracht_message* recvMessage)
+static void invoke_action(struct gracht_server* server, struct gracht_message* recvMessage)
 {
     gracht_protocol_function_t* function;
     gracht_buffer_t             buffer = { .data = (char*)&recvMessage->payload[0], .index = recvMessage->index };
@@ -650,9 +1295,14 @@ void server_invoke_action(struct gracht_server* server, struct gracht_message* r
     action    = GB_MSG_AID(&buffer);
     GRTRACE(GRSTR("server_invoke_action %u: %u/%u"), messageId, protocol, action);
 
-    rwlock_r_lock(&server->protocols_lock);
-    function = get_protocol_action(&server->protocols, protocol, action);
-    rwlock_r_unlock(&server->protocols_lock);
+    // the caller has already given up on the call, so do not waste any time on it
+    if (recvMessage->deadline && gracht_time_ns() > recvMessage->deadline) {
+        GRTRACE(GRSTR("server_invoke_action dropping expired message %u"), messageId);
+        atomic_fetch_add(&server->expired_count, 1);
+        return;
+    }
+
+    function = gr_protocol_table_get_action(&server->protocols, protocol, action);
     if (!function) {
         GRWARNING(GRSTR("server_invoke_action failed to invoke server action"));
         gracht_control_event_error_single(server, recvMessage->client, messageId, ENOENT);
@@ -664,12 +1314,30 @@ void server_invoke_action(struct gracht_server* server, struct gracht_message* r
     ((server_invoke_t)function->address)(recvMessage, &buffer);
 }
 
+void server_invoke_action(struct gracht_server* server, struct gracht_message* recvMessage)
+{
+    uint8_t protocol = *((uint8_t*)&recvMessage->payload[recvMessage->index + MSG_INDEX_SID]);
+
+    invoke_action(server, recvMessage);
+
+    // control messages only reach the workers when they were deferred by dispatch_mt
+    if (protocol == 0 && server->worker_pool) {
+        atomic_fetch_sub(control_pending(server, recvMessage->client), 1);
+    }
+}
+
 void server_cleanup_message(struct gracht_server* server, struct gracht_message* recvMessage)
 {
     if (!server || !recvMessage) {
         return;
     }
 
+    // messages that were received in-place are owned by the link
+    if (recvMessage->release) {
+        recvMessage->release(recvMessage);
+        return;
+    }
+
     mtx_lock(&server->stream_pools_lock);
     if (!gracht_stream_pool_registry_release(&server->stream_recv_pools, recvMessage) && server->recv_pool) {
         gracht_buffer_pool_release(server->recv_pool, recvMessage);
@@ -677,70 +1345,122 @@ void server_cleanup_message(struct gracht_server* server, struct gracht_message*
     mtx_unlock(&server->stream_pools_lock);
 }
 
-int gracht_server_handle_event(gracht_server_t* server, gracht_conn_t handle, unsigned int events)
+static int reactor_handle_event(struct gracht_reactor* reactor, gracht_conn_t handle, unsigned int events)
 {
     struct gracht_link* link;
+    int                 sharded = 0;
 
-    if (!server) {
-        errno = EINVAL;
+    if (reactor->server->state != RUNNING) {
+        errno = EPIPE;
         return -1;
     }
 
-    // assert current state, and cleanup if state is request shutdown
-    if (server->state != RUNNING) {
-        if (server->state == SHUTDOWN_REQUESTED) {
-            gracht_server_shutdown(server);
-        }
-        errno = EPIPE;
-        return -1;
+    if (reactor->wake_handle != GRACHT_CONN_INVALID && handle == reactor->wake_handle) {
+        gracht_aio_wake_drain(reactor->wake_handle);
+        reactor_flush_scheduled(reactor);
+        reactor_resume_throttled(reactor);
+        return 0;
     }
 
-    link = get_link_by_conn(server, handle);
+    link = get_link_by_conn(reactor, handle, &sharded);
     if (!link) {
-        return handle_client_event(server, handle, events);
+#ifdef GRACHT_AIO_EVENT_OUT
+        if ((events & GRACHT_AIO_EVENT_OUT) && !(events & GRACHT_AIO_EVENT_DISCONNECT)) {
+            reactor_flush_client(reactor, handle);
+        }
+#endif
+        return handle_client_event(reactor, handle, events);
     }
 
     if (link->type == gracht_link_stream_based) {
-        return handle_connection(server, link);
+        return handle_connection(reactor, link, sharded);
     }
     else if (link->type == gracht_link_packet_based) {
-        return handle_packet(server, link);
+        return handle_packet(reactor, link);
     }
     return -1;
 }
 
-int gracht_server_main_loop(gracht_server_t* server)
+int gracht_server_handle_event(gracht_server_t* server, gracht_conn_t handle, unsigned int events)
 {
-    gracht_aio_event_t events[32];
-    int                i;
-
     if (!server) {
         errno = EINVAL;
         return -1;
     }
 
+    // assert current state, and cleanup if state is request shutdown
     if (server->state != RUNNING) {
-        errno = EPERM;
+        if (server->state == SHUTDOWN_REQUESTED) {
+            gracht_server_shutdown(server);
+        }
+        errno = EPIPE;
         return -1;
     }
 
-    GRTRACE(GRSTR("gracht_server: started..."));
-    while (server->state == RUNNING) {
+    // events can only be delivered externally when running with a single reactor
+    return reactor_handle_event(&server->reactors[0], handle, events);
+}
+
+static void reactor_run(struct gracht_reactor* reactor)
+{
+    gracht_aio_event_t* events = reactor->events;
+    int                 i;
+
+    GRTRACE(GRSTR("gracht_server: reactor %i started..."), reactor->index);
+    while (reactor->server->state == RUNNING) {
+        // timers are only run by the first reactor, which waits no longer than the next deadline
+        int timeout = reactor->index == 0 ? gracht_server_run_timers(reactor->server) : -1;
         GRTRACE(GRSTR("gracht_server: waiting for events..."));
-        int num_events = gracht_io_wait(server->set_handle, &events[0], 32);
+        int num_events = gracht_io_wait(reactor->set_handle, &events[0], reactor->event_count, timeout);
         GRTRACE(GRSTR("gracht_server: %i events received!"), num_events);
         for (i = 0; i < num_events; i++) {
             gracht_conn_t handle = gracht_aio_event_handle(&events[i]);
             uint32_t      flags  = gracht_aio_event_events(&events[i]);
 
             GRTRACE(GRSTR("gracht_server: event %u from %" F_CONN_T), flags, handle);
-            if (gracht_server_handle_event(server, handle, flags) == -1 && errno == EPIPE) {
-                // server has been shutdown by the handle_event
-                return 0;
+            if (reactor_handle_event(reactor, handle, flags) == -1 && errno == EPIPE) {
+                // server is shutting down
+                return;
             }
         }
     }
+}
+
+static int reactor_main(void* context)
+{
+    reactor_run((struct gracht_reactor*)context);
+    return 0;
+}
+
+int gracht_server_main_loop(gracht_server_t* server)
+{
+    int i;
+
+    if (!server) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (server->state != RUNNING) {
+        errno = EPERM;
+        return -1;
+    }
+
+    // the calling thread acts as the first reactor, the rest get their own threads
+    for (i = 1; i < server->reactor_count; i++) {
+        if (thrd_create(&server->reactors[i].id, reactor_main, &server->reactors[i]) != thrd_success) {
+            GRERROR(GRSTR("gracht_server_main_loop: failed to start reactor %i"), i);
+            break;
+        }
+    }
 
+    reactor_run(&server->reactors[0]);
+
+    // make sure every reactor has observed the shutdown before tearing down
+    while (--i > 0) {
+        gracht_aio_wake_signal(server->reactors[i].wake_handle);
+        thrd_join(server->reactors[i].id, NULL);
+    }
     return gracht_server_shutdown(server);
 }
 
@@ -811,10 +1531,67 @@ static void __release_send_buffer(gracht_server_t* server, void* data, int strea
     }
 }
 
-static int __server_respond(struct gracht_message* messageContext, gracht_buffer_t* message, int stream)
+// Sends a message to a connected client, the message is sent from its segments if the link supports
+// it, otherwise the segments are copied into the message buffer first
+static int __send_client(struct gr_client_entry* entry, gracht_buffer_t* message, unsigned int flags,
+    const struct gracht_message_segments* segments)
 {
-    struct client_wrapper* entry;
-    int                    status;
+    struct gracht_iovec vectors[GRACHT_LINK_MAX_VECTORS];
+    int                 count;
+
+    if (!segments || !segments->count) {
+        return entry->link->ops.server.send_client(entry->client, message, flags);
+    }
+
+    if (!entry->link->ops.server.send_client_vectored) {
+        gr_message_segments_flatten(message, segments);
+        return entry->link->ops.server.send_client(entry->client, message, flags);
+    }
+
+    count = gr_message_segments_vectors(message, segments, &vectors[0]);
+    return entry->link->ops.server.send_client_vectored(entry->client, &vectors[0], count, flags);
+}
+
+// Sends a response to a connected client. When responses are coalesced the link holds on to the
+// response, and the client is handed to its reactor, which writes everything the link holds for the
+// client at once. The client is written right away instead once enough bytes are held for it.
+static int __respond_client(struct gracht_server* server, struct gr_client_entry* entry, gracht_buffer_t* message,
+    const struct gracht_message_segments* segments)
+{
+    uint32_t     length = GB_MSG_LEN_0(message);
+    unsigned int coalesced;
+    int          status;
+
+    if (!server->coalesce_threshold || !entry->link->ops.server.flush_client ||
+        entry->reactor->wake_handle == GRACHT_CONN_INVALID) {
+        return __send_client(entry, message, GRACHT_MESSAGE_BLOCK, segments);
+    }
+
+    status = __send_client(entry, message, GRACHT_MESSAGE_BLOCK | GRACHT_MESSAGE_COALESCE, segments);
+    if (status) {
+        return status;
+    }
+
+    coalesced = atomic_fetch_add(&entry->outbound->coalesced, length) + length;
+    if (coalesced < server->coalesce_threshold) {
+        client_schedule_flush(entry);
+        return 0;
+    }
+
+    // whatever the connection cannot take is written by the reactor once it becomes writable
+    atomic_store(&entry->outbound->coalesced, 0);
+    status = entry->link->ops.server.flush_client(entry->client);
+    if (status && errno == EAGAIN) {
+        status = 0;
+    }
+    return status;
+}
+
+static int __server_respond(struct gracht_message* messageContext, gracht_buffer_t* message, int stream,
+    const struct gracht_message_segments* segments)
+{
+    struct gr_client_entry* entry;
+    int                     status;
     GRTRACE(GRSTR("gracht_server_respond()"));
 
     if (!messageContext || !message) {
@@ -825,15 +1602,13 @@ static int __server_respond(struct gracht_message* messageContext, gracht_buffer
 
     // update message header
     GB_MSG_ID_0(message)  = *((uint32_t*)&messageContext->payload[messageContext->index]);
-    GB_MSG_LEN_0(message) = message->index;
+    GB_MSG_LEN_0(message) = message->index + gr_message_segments_length(segments);
 
-    rwlock_r_lock(&messageContext->server->clients_lock);
-    entry = gr_hashtable_get(&messageContext->server->clients, &(struct client_wrapper){ .handle = messageContext->client });
+    entry = get_client(messageContext->server, messageContext->client);
     if (!entry) {
         struct gracht_link* link;
 
-        rwlock_r_unlock(&messageContext->server->clients_lock);
-        link = get_link_by_conn(messageContext->server, messageContext->link);
+        link = get_server_link_by_conn(messageContext->server, messageContext->link, NULL);
         if (!link) {
             errno = ENODEV;
             if (stream) {
@@ -841,10 +1616,15 @@ static int __server_respond(struct gracht_message* messageContext, gracht_buffer
             }
             return -1;
         }
+
+        // connection-less links always send the message in one piece
+        if (segments && segments->count) {
+            gr_message_segments_flatten(message, segments);
+        }
         status = link->ops.server.send(link, messageContext, message);
     } else {
-        status = entry->link->ops.server.send_client(entry->client, message, GRACHT_MESSAGE_BLOCK);
-        rwlock_r_unlock(&messageContext->server->clients_lock);
+        status = __respond_client(messageContext->server, entry, message, segments);
+        gr_client_registry_release(&messageContext->server->clients, entry);
     }
 
     __release_send_buffer(messageContext->server, message->data, stream);
@@ -853,18 +1633,31 @@ static int __server_respond(struct gracht_message* messageContext, gracht_buffer
 
 int gracht_server_respond(struct gracht_message* messageContext, gracht_buffer_t* message)
 {
-    return __server_respond(messageContext, message, 0);
+    return __server_respond(messageContext, message, 0, NULL);
 }
 
 int gracht_server_respond_stream(struct gracht_message* messageContext, gracht_buffer_t* message)
 {
-    return __server_respond(messageContext, message, 1);
+    return __server_respond(messageContext, message, 1, NULL);
 }
 
-static int __server_send_event(gracht_server_t* server, gracht_conn_t client, gracht_buffer_t* message, unsigned int flags, int stream)
+int gracht_server_respond_segments(struct gracht_message* messageContext, gracht_buffer_t* message,
+    struct gracht_message_segments* segments)
 {
-    struct client_wrapper* clientEntry;
-    int                    status;
+    return __server_respond(messageContext, message, 0, segments);
+}
+
+int gracht_server_respond_stream_segments(struct gracht_message* messageContext, gracht_buffer_t* message,
+    struct gracht_message_segments* segments)
+{
+    return __server_respond(messageContext, message, 1, segments);
+}
+
+static int __server_send_event(gracht_server_t* server, gracht_conn_t client, gracht_buffer_t* message, unsigned int flags, int stream,
+    const struct gracht_message_segments* segments)
+{
+    struct gr_client_entry* clientEntry;
+    int                     status;
     GRTRACE(GRSTR("gracht_server_send_event()"));
 
     if (!server || !message) {
@@ -873,12 +1666,10 @@ static int __server_send_event(gracht_server_t* server, gracht_conn_t client, gr
     }
 
     // update message header
-    GB_MSG_LEN_0(message) = message->index;
+    GB_MSG_LEN_0(message) = message->index + gr_message_segments_length(segments);
 
-    rwlock_r_lock(&server->clients_lock);
-    clientEntry = gr_hashtable_get(&server->clients, &(struct client_wrapper){ .handle = client });
+    clientEntry = get_client(server, client);
     if (!clientEntry) {
-        rwlock_r_unlock(&server->clients_lock);
         errno = ENOENT;
         if (stream) {
             __release_send_buffer(server, message->data, stream);
@@ -887,8 +1678,8 @@ static int __server_send_event(gracht_server_t* server, gracht_conn_t client, gr
     }
 
     // When sending target specific events - we do not care about subscriptions
-    status = clientEntry->link->ops.server.send_client(clientEntry->client, message, flags);
-    rwlock_r_unlock(&server->clients_lock);
+    status = __send_client(clientEntry, message, flags, segments);
+    gr_client_registry_release(&server->clients, clientEntry);
 
     __release_send_buffer(server, message->data, stream);
     return status;
@@ -896,20 +1687,29 @@ static int __server_send_event(gracht_server_t* server, gracht_conn_t client, gr
 
 int gracht_server_send_event(gracht_server_t* server, gracht_conn_t client, gracht_buffer_t* message, unsigned int flags)
 {
-    return __server_send_event(server, client, message, flags, 0);
+    return __server_send_event(server, client, message, flags, 0, NULL);
 }
 
 int gracht_server_send_stream_event(gracht_server_t* server, gracht_conn_t client, gracht_buffer_t* message, unsigned int flags)
 {
-    return __server_send_event(server, client, message, flags, 1);
+    return __server_send_event(server, client, message, flags, 1, NULL);
+}
+
+int gracht_server_send_event_segments(gracht_server_t* server, gracht_conn_t client, gracht_buffer_t* message, unsigned int flags,
+    struct gracht_message_segments* segments)
+{
+    return __server_send_event(server, client, message, flags, 0, segments);
+}
+
+int gracht_server_send_stream_event_segments(gracht_server_t* server, gracht_conn_t client, gracht_buffer_t* message, unsigned int flags,
+    struct gracht_message_segments* segments)
+{
+    return __server_send_event(server, client, message, flags, 1, segments);
 }
 
 static int __server_broadcast_event(gracht_server_t* server, gracht_buffer_t* message, unsigned int flags, int stream)
 {
-    struct broadcast_context context = {
-        .message = message,
-        .flags   = flags
-    };
+    struct broadcast_context context;
 
     if (!server || !message) {
         errno = EINVAL;
@@ -919,9 +1719,17 @@ static int __server_broadcast_event(gracht_server_t* server, gracht_buffer_t* me
     // update message header
     GB_MSG_LEN_0(message) = message->index;
 
-    rwlock_r_lock(&server->clients_lock);
-    gr_hashtable_enumerate(&server->clients, client_enum_broadcast, &context);
-    rwlock_r_unlock(&server->clients_lock);
+    // the message is queued for each subscriber and sent by their reactors, so a slow client
+    // does not hold up the broadcast. If we cannot make the shared copy, we send directly.
+    context.server   = server;
+    context.message  = gr_shared_message_create(message->data, message->index);
+    context.buffer   = message;
+    context.flags    = flags;
+    context.protocol = GB_MSG_SID_0(message);
+    gr_subscriber_table_enumerate(&server->subscribers, context.protocol, client_enum_broadcast, &context);
+    if (context.message) {
+        gr_shared_message_release(context.message);
+    }
 
     __release_send_buffer(server, message->data, stream);
     return 0;
@@ -949,15 +1757,7 @@ int gracht_server_register_protocol(gracht_server_t* server, gracht_protocol_t*
         return -1;
     }
 
-    rwlock_w_lock(&server->protocols_lock);
-    if (gr_hashtable_get(&server->protocols, protocol)) {
-        rwlock_w_unlock(&server->protocols_lock);
-        errno = EEXIST;
-        return -1;
-    }
-    gr_hashtable_set(&server->protocols, protocol);
-    rwlock_w_unlock(&server->protocols_lock);
-    return 0;
+    return gr_protocol_table_add(&server->protocols, protocol);
 }
 
 void gracht_server_unregister_protocol(gracht_server_t* server, gracht_protocol_t* protocol)
@@ -972,9 +1772,7 @@ void gracht_server_unregister_protocol(gracht_server_t* server, gracht_protocol_
         return;
     }
     
-    rwlock_w_lock(&server->protocols_lock);
-    gr_hashtable_remove(&server->protocols, protocol);
-    rwlock_w_unlock(&server->protocols_lock);
+    (void)gr_protocol_table_remove(&server->protocols, protocol);
 }
 
 gracht_handle_t gracht_server_get_aio_handle(gracht_server_t* server)
@@ -989,7 +1787,157 @@ gracht_handle_t gracht_server_get_aio_handle(gracht_server_t* server)
         return GRACHT_HANDLE_INVALID;
     }
 
-    return server->set_handle;
+    return server->reactors[0].set_handle;
+}
+
+int gracht_server_get_stats(gracht_server_t* server, gracht_server_stats_t* stats)
+{
+    if (!server || !stats) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    stats->throttle_count    = (uint64_t)atomic_load(&server->throttle_count);
+    stats->throttled_time_us = (uint64_t)atomic_load(&server->throttled_time_ns) / 1000;
+    stats->throttled_now     = (int)atomic_load(&server->throttled_count);
+    stats->expired_count     = (uint64_t)atomic_load(&server->expired_count);
+    stats->broadcast_dropped = (uint64_t)atomic_load(&server->broadcast_dropped);
+    return 0;
+}
+
+static int timer_is_armed(const struct gr_timer_entry* entry, void* context)
+{
+    struct gracht_server*       server = context;
+    struct gracht_server_timer* timer  = gr_hashtable_get(&server->timer_entries,
+        &(struct gracht_server_timer) { .id = (uint32_t)entry->id });
+    return timer != NULL && timer->deadline == entry->deadline;
+}
+
+int gracht_server_add_timer(gracht_server_t* server, unsigned int intervalMs, int periodic,
+    gracht_server_timer_fn callback, void* context, uint32_t* timerIdOut)
+{
+    struct gracht_server_timer timer;
+    uint64_t                   next;
+
+    if (!server || !callback || (periodic && !intervalMs)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    mtx_lock(&server->timers_lock);
+    timer.id          = ++server->timer_id;
+    timer.interval_ms = intervalMs;
+    timer.periodic    = periodic;
+    timer.deadline    = gracht_time_ns() + ((uint64_t)intervalMs * 1000000ULL);
+    timer.callback    = callback;
+    timer.context     = context;
+
+    // removed timers leave their deadlines in the heap, so filter those out once in a while
+    if (server->timers.count > (server->timer_entries.element_count * 2) + 64) {
+        gr_timer_heap_filter(&server->timers, timer_is_armed, server);
+    }
+
+    next = gr_timer_heap_next(&server->timers);
+    if (gr_timer_heap_push(&server->timers, timer.deadline, timer.id)) {
+        mtx_unlock(&server->timers_lock);
+        return -1;
+    }
+    gr_hashtable_set(&server->timer_entries, &timer);
+    mtx_unlock(&server->timers_lock);
+
+    // the first reactor might be sleeping past the new deadline, so wake it up
+    if ((!next || timer.deadline < next) && server->reactors) {
+        gracht_aio_wake_signal(server->reactors[0].wake_handle);
+    }
+
+    if (timerIdOut) {
+        *timerIdOut = timer.id;
+    }
+    return 0;
+}
+
+int gracht_server_remove_timer(gracht_server_t* server, uint32_t timerId)
+{
+    struct gracht_server_timer* timer;
+
+    if (!server) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    mtx_lock(&server->timers_lock);
+    timer = gr_hashtable_remove(&server->timer_entries, &(struct gracht_server_timer) { .id = timerId });
+    mtx_unlock(&server->timers_lock);
+    if (!timer) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+int gracht_server_run_timers(gracht_server_t* server)
+{
+    struct gr_timer_entry entry;
+    uint64_t              now;
+    uint64_t              next;
+
+    if (!server) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // only timers that expired before we started are run, rescheduled periodic
+    // timers are always in the future, so this cannot keep the reactor busy
+    mtx_lock(&server->timers_lock);
+    now = gracht_time_ns();
+    while (!gr_timer_heap_pop_expired(&server->timers, now, &entry)) {
+        struct gracht_server_timer* timer = gr_hashtable_get(&server->timer_entries,
+            &(struct gracht_server_timer) { .id = (uint32_t)entry.id });
+        gracht_server_timer_fn      callback;
+        void*                       context;
+
+        // skip deadlines of timers that have been removed
+        if (!timer || timer->deadline != entry.deadline) {
+            continue;
+        }
+
+        callback = timer->callback;
+        context  = timer->context;
+        if (timer->periodic) {
+            // keep the period stable, but do not try to catch up on missed invocations
+            timer->deadline += (uint64_t)timer->interval_ms * 1000000ULL;
+            if (timer->deadline <= now) {
+                timer->deadline = now + ((uint64_t)timer->interval_ms * 1000000ULL);
+            }
+            if (gr_timer_heap_push(&server->timers, timer->deadline, timer->id)) {
+                GRERROR(GRSTR("gracht_server_run_timers: failed to reschedule timer %u"), timer->id);
+                gr_hashtable_remove(&server->timer_entries, timer);
+            }
+        }
+        else {
+            gr_hashtable_remove(&server->timer_entries, timer);
+        }
+
+        // invoke without holding the lock, so the callback can add and remove timers
+        mtx_unlock(&server->timers_lock);
+        callback(server, context);
+        mtx_lock(&server->timers_lock);
+    }
+    next = gr_timer_heap_next(&server->timers);
+    mtx_unlock(&server->timers_lock);
+
+    if (!next) {
+        return -1;
+    }
+
+    now = gracht_time_ns();
+    if (next <= now) {
+        return 0;
+    }
+
+    // round up, otherwise we end up waking right before the deadline
+    next = (next - now + 999999ULL) / 1000000ULL;
+    return next > (uint64_t)INT_MAX ? INT_MAX : (int)next;
 }
 
 void gracht_server_defer_message(struct gracht_message* in, struct gracht_message* out)
@@ -998,67 +1946,222 @@ void gracht_server_defer_message(struct gracht_message* in, struct gracht_messag
         return;
     }
 
-    memcpy(out, in, GRACHT_MESSAGE_DEFERRABLE_SIZE(in));
+    // the payload is always stored right after the header in the copy
+    memcpy(out, in, sizeof(struct gracht_message));
+    out->payload = (uint8_t*)(out + 1);
+    out->release = NULL;
+    memcpy(out->payload, in->payload, in->size);
 }
 
 // Client helpers
-static void client_destroy(struct gracht_server* server, gracht_conn_t client)
+static void client_destroy(struct gracht_reactor* reactor, gracht_conn_t client)
 {
-    struct client_wrapper* entry;
+    // the throttled list is owned by the reactor, so this must only be called from the
+    // reactor thread. Connection-less clients are never throttled themselves, their link is.
+    reactor_cancel_throttled(reactor, client);
+    client_unregister(reactor, client);
+}
+
+// Registers the client with the server. The client is subscribed before the record is published,
+// so broadcasts never see a half-subscribed client, but the broadcasts it receives in the meantime
+// are not handed to the reactor before the client can be found in the registry.
+static int client_register(struct gracht_server* server, struct gr_client_entry* entry, uint8_t protocol)
+{
+    struct gr_client_entry* published;
+    int                     status;
+
+    status = gr_outbound_queue_create(server->broadcast_queue_depth, server->broadcast_policy, &entry->outbound);
+    if (status) {
+        return status;
+    }
 
-    if (server->callbacks.clientDisconnected) {
-        server->callbacks.clientDisconnected(client);
+    client_subscribe(server, entry, protocol);
+    status = gr_client_registry_add(&server->clients, entry);
+    if (status) {
+        int error = errno;
+        client_unsubscribe(server, entry, 0xFF);
+        gr_outbound_queue_destroy(entry->outbound);
+        errno = error;
+        return status;
     }
 
-    rwlock_w_lock(&server->clients_lock);
-    entry = gr_hashtable_remove(&server->clients, &(struct client_wrapper){ .handle = client });
-    if (entry) {
-        entry->link->ops.server.destroy_client(entry->client, server->set_handle);
+    // the client may already be gone again, so only touch it while it is published
+    published = get_client(server, entry->handle);
+    if (published && published->outbound == entry->outbound) {
+        atomic_store(&published->outbound->scheduled, 0);
+        if (gr_outbound_queue_count(published->outbound)) {
+            client_schedule_flush(published);
+        }
     }
-    rwlock_w_unlock(&server->clients_lock);
+    gr_client_registry_release(&server->clients, published);
+    return 0;
 }
 
-// Client subscription helpers
-static void client_subscribe(struct gracht_server_client* client, uint8_t id)
+static void client_unregister(struct gracht_reactor* reactor, gracht_conn_t client)
 {
-    int block  = id / 32;
-    int offset = id % 32;
+    struct gr_client_entry* entry;
+
+    if (reactor->server->callbacks.clientDisconnected) {
+        reactor->server->callbacks.clientDisconnected(client);
+    }
+
+    // the client is destroyed by the thread that releases the last reference to it, which may
+    // be long after this. Its connection must not deliver events until then, as the descriptor
+    // can be reused by a new connection as soon as it is closed, and events that were already
+    // collected for the old one would then be handled for the new one.
+    entry = get_client(reactor->server, client);
+    if (!entry) {
+        return;
+    }
+#ifdef GRACHT_AIO_HAS_PAUSE
+    if (atomic_load_u32(&entry->client->flags) & GRACHT_CLIENT_FLAG_STREAM) {
+        (void)gracht_aio_pause(reactor->set_handle, client);
+    }
+#endif
+    (void)gr_client_registry_remove(&reactor->server->clients, client);
+    gr_client_registry_release(&reactor->server->clients, entry);
+}
+
+// Destroys a client that has been removed from the registry once no thread references it anymore,
+// once it has left the subscriber lists no broadcast can reach it anymore either.
+static void client_release(struct gr_client_entry* entry, void* context)
+{
+    struct gracht_server* server = context;
+
+    client_unsubscribe(server, entry, 0xFF);
+    gr_outbound_queue_destroy(entry->outbound);
+#ifdef GRACHT_AIO_HAS_PAUSE
+    // the connection has already left the set when it was removed, or the set is being destroyed
+    entry->link->ops.server.destroy_client(entry->client, GRACHT_HANDLE_INVALID);
+#else
+    entry->link->ops.server.destroy_client(entry->client, entry->reactor->set_handle);
+#endif
+}
+
+// Hands the client to its reactor, which sends the pending broadcasts of the client. Clients
+// are only handed over once until the reactor has started flushing them.
+static void client_schedule_flush(struct gr_client_entry* entry)
+{
+    struct gracht_reactor* reactor  = entry->reactor;
+    int                    expected = 0;
+    int                    signal;
+
+    if (!atomic_compare_exchange_strong(&entry->outbound->scheduled, &expected, 1)) {
+        return;
+    }
+
+    mtx_lock(&reactor->outbound_lock);
+    if (reactor->outbound_count == reactor->outbound_capacity) {
+        int            capacity = reactor->outbound_capacity ? reactor->outbound_capacity * 2 : 16;
+        gracht_conn_t* handles  = realloc(reactor->outbound_handles, sizeof(gracht_conn_t) * (size_t)capacity);
+        if (!handles) {
+            // the broadcasts stay queued until the client is handed over by the next broadcast
+            mtx_unlock(&reactor->outbound_lock);
+            atomic_store(&entry->outbound->scheduled, 0);
+            return;
+        }
+        reactor->outbound_handles  = handles;
+        reactor->outbound_capacity = capacity;
+    }
+    reactor->outbound_handles[reactor->outbound_count++] = entry->handle;
+    signal = reactor->outbound_count == 1;
+    mtx_unlock(&reactor->outbound_lock);
+
+    if (signal) {
+        gracht_aio_wake_signal(reactor->wake_handle);
+    }
+}
+
+// Client subscription helpers. The subscriptions are read by the broadcasting threads while the
+// control protocol updates them, so all accesses to the bitmap must be atomic. Changes for a client
+// never race, they are made before the client is registered, from the reactor of the client or the
+// lane it is pinned to while a control message is deferred, or after the client was removed. Clients that are subscribed to all protocols are kept
+// in a single list and filtered by the bitmap, other clients are in the list of each of their protocols.
+static void client_leave_lists(struct gracht_server* server, struct gr_client_entry* entry)
+{
+    struct gracht_server_client* client = entry->client;
+    int                          id;
+
+    if (atomic_load_u32(&client->flags) & GRACHT_CLIENT_FLAG_ALL) {
+        gr_subscriber_table_remove(&server->subscribers, GR_SUBSCRIBER_TABLE_ALL, entry->handle);
+        atomic_fetch_and_u32(&client->flags, ~(uint32_t)GRACHT_CLIENT_FLAG_ALL);
+        return;
+    }
+
+    for (id = 0; id < GR_SUBSCRIBER_TABLE_ALL; id++) {
+        if (client_is_subscribed(client, (uint8_t)id)) {
+            gr_subscriber_table_remove(&server->subscribers, (uint8_t)id, entry->handle);
+        }
+    }
+}
+
+static void client_subscribe(struct gracht_server* server, struct gr_client_entry* entry, uint8_t id)
+{
+    struct gracht_server_client* client = entry->client;
+    int                          block  = id / 32;
+    int                          offset = id % 32;
 
     if (id == 0xFF) {
-        // subscribe to all
-        memset(&client->subscriptions[0], 0xFF, sizeof(client->subscriptions));
+        // subscribe to all, the protocol lists are left first so no broadcast reaches the client twice
+        if (!(atomic_load_u32(&client->flags) & GRACHT_CLIENT_FLAG_ALL)) {
+            client_leave_lists(server, entry);
+            if (gr_subscriber_table_add(&server->subscribers, GR_SUBSCRIBER_TABLE_ALL, entry)) {
+                GRERROR(GRSTR("client_subscribe failed to subscribe client to all protocols"));
+                return;
+            }
+            atomic_fetch_or_u32(&client->flags, GRACHT_CLIENT_FLAG_ALL);
+        }
+        for (block = 0; block < 8; block++) {
+            atomic_store_u32(&client->subscriptions[block], 0xFFFFFFFFu);
+        }
+        return;
+    }
+
+    if (atomic_fetch_or_u32(&client->subscriptions[block], 1u << offset) & (1u << offset)) {
         return;
     }
 
-    client->subscriptions[block] |= (1 << offset);
+    if (!(atomic_load_u32(&client->flags) & GRACHT_CLIENT_FLAG_ALL) &&
+        gr_subscriber_table_add(&server->subscribers, id, entry)) {
+        GRERROR(GRSTR("client_subscribe failed to subscribe client to protocol %u"), id);
+        atomic_fetch_and_u32(&client->subscriptions[block], ~(1u << offset));
+    }
 }
 
-static void client_unsubscribe(struct gracht_server_client* client, uint8_t id)
+static void client_unsubscribe(struct gracht_server* server, struct gr_client_entry* entry, uint8_t id)
 {
-    int block  = id / 32;
-    int offset = id % 32;
+    struct gracht_server_client* client = entry->client;
+    int                          block  = id / 32;
+    int                          offset = id % 32;
 
     if (id == 0xFF) {
         // unsubscribe to all
-        memset(&client->subscriptions[0], 0, sizeof(client->subscriptions));
+        client_leave_lists(server, entry);
+        for (block = 0; block < 8; block++) {
+            atomic_store_u32(&client->subscriptions[block], 0);
+        }
         return;
     }
 
-    client->subscriptions[block] &= ~(1 << offset);
+    if ((atomic_fetch_and_u32(&client->subscriptions[block], ~(1u << offset)) & (1u << offset)) &&
+        !(atomic_load_u32(&client->flags) & GRACHT_CLIENT_FLAG_ALL)) {
+        gr_subscriber_table_remove(&server->subscribers, id, entry->handle);
+    }
 }
 
 static int client_is_subscribed(struct gracht_server_client* client, uint8_t id)
 {
     int block  = id / 32;
     int offset = id % 32;
-    return (client->subscriptions[block] & (1 << offset)) != 0;
+    return (atomic_load_u32(&client->subscriptions[block]) & (1u << offset)) != 0;
 }
 
 // Server control protocol implementation
 void gracht_control_subscribe_invocation(const struct gracht_message* message, const uint8_t protocol)
 {
-    struct client_wrapper* entry;
-    struct client_wrapper  newEntry;
+    struct gracht_reactor*  reactor;
+    struct gr_client_entry* entry;
+    struct gr_client_entry  newEntry;
     GRTRACE(GRSTR("gracht_control_subscribe_invocation(protocol=%u, client=%i)"), protocol, message->client);
     
     // When dealing with connectionless clients, they aren't really created in the client register. To deal
@@ -1066,111 +2169,115 @@ void gracht_control_subscribe_invocation(const struct gracht_message* message, c
     // that connection-less clients aren't considered connected unless they subscribe to some protocol - even
     // if they actually use the functions provided by the protocol. It is also possible to receive targetted
     // events that come in response to a function call even without subscribing.
-    rwlock_r_lock(&message->server->clients_lock);
-    entry = gr_hashtable_get(&message->server->clients, &(struct client_wrapper){ .handle = message->client });
+    entry = get_client(message->server, message->client);
     if (!entry) {
         // So, client did not have a record, at this point we then know this message was received on a 
-        // connection-less stream, meaning we do not currently hold another _read_lock on this thread, thus we can
-        // release our reader lock and acqurie the write-lock
-        rwlock_r_unlock(&message->server->clients_lock);
+        // connection-less stream. Control messages are pinned by client, so no other thread can be creating
+        // a record for the same client.
 
         // lookup the connection as the client wasn't recorded on a specific link
-        newEntry.link = get_link_by_conn(message->server, message->link);
+        newEntry.link = get_server_link_by_conn(message->server, message->link, &reactor);
+        if (!newEntry.link) {
+            GRERROR(GRSTR("gracht_control_subscribe_invocation link %" F_CONN_T " was removed"), message->link);
+            return;
+        }
+
         if (newEntry.link->ops.server.create_client(newEntry.link, (struct gracht_message*)message, &newEntry.client)) {
             GRERROR(GRSTR("gracht_control_subscribe_invocation server_object.link->create_client returned error"));
             return;
         }
 
-        newEntry.handle = message->client;
-
-        // this does not have to be serialized with the above read lock due to the fact that all
-        // write-locks are only acquired by this thread. So any changes made are only the ones we make
-        // right now
-        rwlock_w_lock(&message->server->clients_lock);
-        gr_hashtable_set(&message->server->clients, &newEntry);
-        rwlock_w_unlock(&message->server->clients_lock);
+        newEntry.handle  = message->client;
+        newEntry.reactor = reactor;
+        if (client_register(message->server, &newEntry, protocol)) {
+            GRERROR(GRSTR("gracht_control_subscribe_invocation failed to register client: %i"), errno);
+            newEntry.link->ops.server.destroy_client(newEntry.client, reactor->set_handle);
+            return;
+        }
 
         if (message->server->callbacks.clientConnected) {
             message->server->callbacks.clientConnected(message->client);
         }
-
-        // not really neccessary but for correctness
-        rwlock_r_lock(&message->server->clients_lock);
-        
-        // set the entry pointer
-        entry = &newEntry;
-    } else {
-        // make sure if they were marked cleanup that we remove that
-        entry->client->flags &= ~(GRACHT_CLIENT_FLAG_CLEANUP);
+        return;
     }
 
-    client_subscribe(entry->client, protocol);
-    rwlock_r_unlock(&message->server->clients_lock);
+    // make sure if they were marked cleanup that we remove that
+    atomic_fetch_and_u32(&entry->client->flags, ~(uint32_t)GRACHT_CLIENT_FLAG_CLEANUP);
+    client_subscribe(message->server, entry, protocol);
+    gr_client_registry_release(&message->server->clients, entry);
 }
 
 void gracht_control_unsubscribe_invocation(const struct gracht_message* message, const uint8_t protocol)
 {
-    struct client_wrapper* entry;
-    int                    cleanup = 0;
+    struct gracht_reactor*  reactor;
+    struct gr_client_entry* entry;
+    int                     cleanup = 0;
     
-    rwlock_r_lock(&message->server->clients_lock);
-    entry = gr_hashtable_get(&message->server->clients, &(struct client_wrapper){ .handle = message->client });
+    entry = get_client(message->server, message->client);
     if (!entry) {
-        rwlock_r_unlock(&message->server->clients_lock);
         return;
     }
 
-    client_unsubscribe(entry->client, protocol);
+    client_unsubscribe(message->server, entry, protocol);
     
-    // cleanup the client if we unsubscribe, but do not do it from here as the client
-    // structure will be reffered later on
+    // connection-less clients are removed once they unsubscribe from everything, which happens
+    // after our reference is released so the record outlives our use of it
     if (protocol == 0xFF) {
-        if (!(entry->client->flags & GRACHT_CLIENT_FLAG_STREAM)) {
-            entry->client->flags |= GRACHT_CLIENT_FLAG_CLEANUP; // this flag is not needed
+        if (!(atomic_load_u32(&entry->client->flags) & GRACHT_CLIENT_FLAG_STREAM)) {
+            atomic_fetch_or_u32(&entry->client->flags, GRACHT_CLIENT_FLAG_CLEANUP); // this flag is not needed
             cleanup = 1;
         }
     }
-    rwlock_r_unlock(&message->server->clients_lock);
+    reactor = entry->reactor;
+    gr_client_registry_release(&message->server->clients, entry);
 
-    // when receiving unsubscribe events on connection-less links we must check
-    // after handling messages whether a client has been marked for cleanup
-    // in this case we do not hold the lock and can therefore actually take the write-lock
+    // this may run inline on the reactor thread, which is fine as removing the client never waits
+    // for other threads. The record is destroyed by whichever thread releases it last. Connection-less
+    // clients are never throttled, so the reactor does not need to be involved.
     if (cleanup) {
-        client_destroy(message->server, message->client);
+        client_unregister(reactor, message->client);
     }
 }
 
-static uint64_t client_hash(const void* element)
+static int client_match_reactor(struct gr_client_entry* entry, void* context)
 {
-    const struct client_wrapper* client = element;
-    return (uint64_t)client->handle;
+    return entry->reactor == (struct gracht_reactor*)context;
 }
 
-static int client_cmp(const void* element1, const void* element2)
+// Invoked for each client in the subscriber lists of the protocol with the list lock held, clients
+// that are subscribed to all protocols may have unsubscribed from this one.
+static void client_enum_broadcast(struct gr_client_entry* entry, void* context)
 {
-    const struct client_wrapper* client1 = element1;
-    const struct client_wrapper* client2 = element2;
-    return client1->handle == client2->handle ? 0 : 1;
-}
-
-static void client_enum_broadcast(int index, const void* element, void* userContext)
-{
-    const struct client_wrapper* entry   = element;
-    struct broadcast_context*    context = userContext;
-    uint8_t                      protocol = GB_MSG_SID_0(context->message);
+    struct broadcast_context* broadcastContext = context;
+    int                       dropped;
     GRTRACE(GRSTR("client_enum_broadcast()"));
-    (void)index;
 
-    if (client_is_subscribed(entry->client, protocol)) {
-        entry->link->ops.server.send_client(entry->client, context->message, context->flags);
+    if (!client_is_subscribed(entry->client, broadcastContext->protocol)) {
+        return;
+    }
+
+    // without a way to wake up the reactor the client must be sent to directly
+    if (!broadcastContext->message || entry->reactor->wake_handle == GRACHT_CONN_INVALID) {
+        entry->link->ops.server.send_client(entry->client, broadcastContext->buffer, broadcastContext->flags);
+        return;
+    }
+
+    dropped = gr_outbound_queue_push(entry->outbound, broadcastContext->message);
+    if (dropped) {
+        atomic_fetch_add(&broadcastContext->server->broadcast_dropped, (unsigned long long)dropped);
     }
+    client_schedule_flush(entry);
+}
+
+static uint64_t timer_hash(const void* element)
+{
+    const struct gracht_server_timer* timer = element;
+    return timer->id;
 }
 
-static void client_enum_destroy(int index, const void* element, void* userContext)
+static int timer_cmp(const void* element1, const void* element2)
 {
-    const struct client_wrapper* entry  = element;
-    struct gracht_server*        server = userContext;
-    (void)index;
-    (void)userContext;
-    entry->link->ops.server.destroy_client(entry->client, server->set_handle);
+    const struct gracht_server_timer* timer1 = element1;
+    const struct gracht_server_timer* timer2 = element2;
+    return timer1->id == timer2->id ? 0 : 1;
 }
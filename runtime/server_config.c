@@ -27,6 +27,7 @@ void gracht_server_configuration_init(gracht_server_configuration_t* config)
     config->server_workers = 1;
     config->max_message_size = GRACHT_DEFAULT_MESSAGE_SIZE;
     config->stream_buffer_count = 8;
+    config->server_reactors = 1;
 }
 
 void gracht_server_configuration_set_aio_descriptor(gracht_server_configuration_t* config, gracht_handle_t descriptor)
@@ -50,3 +51,29 @@ void gracht_server_configuration_set_stream_buffer_size(gracht_server_configurat
     config->stream_buffer_size = bufferSize;
     config->stream_buffer_count = bufferCount;
 }
+
+void gracht_server_configuration_set_num_reactors(gracht_server_configuration_t* config, int reactorCount)
+{
+    config->server_reactors = reactorCount;
+}
+
+void gracht_server_configuration_set_worker_queue_depth(gracht_server_configuration_t* config, int queueDepth)
+{
+    config->worker_queue_depth = queueDepth;
+}
+
+void gracht_server_configuration_set_event_batch_size(gracht_server_configuration_t* config, int eventCount)
+{
+    config->event_batch_size = eventCount;
+}
+
+void gracht_server_configuration_set_broadcast_queue(gracht_server_configuration_t* config, int queueDepth, int policy)
+{
+    config->broadcast_queue_depth = queueDepth;
+    config->broadcast_policy = policy;
+}
+
+void gracht_server_configuration_set_response_coalescing(gracht_server_configuration_t* config, int byteThreshold)
+{
+    config->coalesce_threshold = byteThreshold;
+}
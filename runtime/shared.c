@@ -21,35 +21,10 @@
  */
 
 #include "gracht/types.h"
-#include "hashtable.h"
-#include "logging.h"
 #include "utils.h"
 #include <errno.h>
 #include <stdlib.h>
-
-gracht_protocol_function_t* get_protocol_action(gr_hashtable_t* protocols,
-    uint8_t protocol_id, uint8_t action_id)
-{
-    int                i;
-    gracht_protocol_t* protocol;
-    
-    protocol = gr_hashtable_get(protocols, &(gracht_protocol_t) { .id = protocol_id });
-    if (!protocol) {
-        GRERROR(GRSTR("get_protocol_action(p=%u, a=%u) protocol was not implemented"), protocol_id, action_id);
-        errno = ENOTSUP;
-        return NULL;
-    }
-    
-    for (i = 0; i < protocol->num_functions; i++) {
-        if (protocol->functions[i].id == action_id) {
-            return &protocol->functions[i];
-        }
-    }
-
-    GRERROR(GRSTR("get_protocol_action(p=%u, a=%u) action was not implemented"), protocol_id, action_id);
-    errno = ENOTSUP;
-    return NULL;
-}
+#include <string.h>
 
 gracht_conn_t gracht_link_get_handle(struct gracht_link* link)
 {
@@ -69,6 +44,65 @@ enum gracht_link_type gracht_link_get_type(struct gracht_link* link)
     return link->type;
 }
 
+uint32_t gr_message_segments_length(const struct gracht_message_segments* segments)
+{
+    uint32_t length = 0;
+    int      i;
+
+    for (i = 0; segments && i < segments->count; i++) {
+        length += segments->entries[i].length;
+    }
+    return length;
+}
+
+// Splits the message buffer at each segment, the segments are ordered by their offset. A message
+// never needs more than 2 vectors per segment plus one, which must fit GRACHT_LINK_MAX_VECTORS.
+int gr_message_segments_vectors(struct gracht_buffer* message, const struct gracht_message_segments* segments,
+    struct gracht_iovec* vectors)
+{
+    uint32_t offset = 0;
+    int      count  = 0;
+    int      i;
+
+    for (i = 0; i < segments->count; i++) {
+        const struct gracht_message_segment* segment = &segments->entries[i];
+        if (segment->offset > offset) {
+            vectors[count].data   = &message->data[offset];
+            vectors[count].length = segment->offset - offset;
+            count++;
+        }
+        vectors[count].data   = (void*)segment->data;
+        vectors[count].length = segment->length;
+        count++;
+        offset = segment->offset;
+    }
+
+    if (message->index > offset) {
+        vectors[count].data   = &message->data[offset];
+        vectors[count].length = message->index - offset;
+        count++;
+    }
+    return count;
+}
+
+// Copies the segments into the message buffer for links that cannot send segments, which is
+// done back to front so each part of the buffer is only moved once.
+void gr_message_segments_flatten(struct gracht_buffer* message, const struct gracht_message_segments* segments)
+{
+    uint32_t shift = gr_message_segments_length(segments);
+    uint32_t end   = message->index;
+    int      i;
+
+    for (i = segments->count - 1; i >= 0; i--) {
+        const struct gracht_message_segment* segment = &segments->entries[i];
+        memmove(&message->data[segment->offset + shift], &message->data[segment->offset], end - segment->offset);
+        shift -= segment->length;
+        memcpy(&message->data[segment->offset + shift], segment->data, segment->length);
+        end = segment->offset;
+    }
+    message->index += gr_message_segments_length(segments);
+}
+
 #if defined(GRACHT_SHARED_LIBRARY) && defined(MOLLENOS)
 // dll entry point for mollenos shared libraries
 // this must be present
@@ -0,0 +1,106 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Per-protocol subscriber lists. The lists are small arrays that are compacted on removal,
+ * broadcasts only walk the clients that are subscribed instead of all connected clients.
+ * Broadcasts only read the lists, so they take the read lock and can walk a list at the
+ * same time, subscriptions take the write lock.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include "subscriber_table.h"
+
+#define SUBSCRIBER_LIST_INITIAL_CAPACITY 8
+
+void gr_subscriber_table_construct(struct gr_subscriber_table* table)
+{
+    for (int i = 0; i < 256; i++) {
+        rwlock_init(&table->lists[i].lock);
+        table->lists[i].entries  = NULL;
+        table->lists[i].count    = 0;
+        table->lists[i].capacity = 0;
+    }
+}
+
+void gr_subscriber_table_destroy(struct gr_subscriber_table* table)
+{
+    for (int i = 0; i < 256; i++) {
+        free(table->lists[i].entries);
+        table->lists[i].entries  = NULL;
+        table->lists[i].count    = 0;
+        table->lists[i].capacity = 0;
+        rwlock_destroy(&table->lists[i].lock);
+    }
+}
+
+int gr_subscriber_table_add(struct gr_subscriber_table* table, uint8_t protocol, const struct gr_client_entry* entry)
+{
+    struct gr_subscriber_list* list = &table->lists[protocol];
+
+    rwlock_w_lock(&list->lock);
+    if (list->count == list->capacity) {
+        int                     capacity = list->capacity ? list->capacity * 2 : SUBSCRIBER_LIST_INITIAL_CAPACITY;
+        struct gr_client_entry* entries  = realloc(list->entries, (size_t)capacity * sizeof(struct gr_client_entry));
+        if (!entries) {
+            rwlock_w_unlock(&list->lock);
+            errno = ENOMEM;
+            return -1;
+        }
+        list->entries  = entries;
+        list->capacity = capacity;
+    }
+    list->entries[list->count++] = *entry;
+    rwlock_w_unlock(&list->lock);
+    return 0;
+}
+
+int gr_subscriber_table_remove(struct gr_subscriber_table* table, uint8_t protocol, gracht_conn_t handle)
+{
+    struct gr_subscriber_list* list = &table->lists[protocol];
+
+    rwlock_w_lock(&list->lock);
+    for (int i = 0; i < list->count; i++) {
+        if (list->entries[i].handle == handle) {
+            // order does not matter, so move the last entry into the free spot
+            list->entries[i] = list->entries[--list->count];
+            rwlock_w_unlock(&list->lock);
+            return 0;
+        }
+    }
+    rwlock_w_unlock(&list->lock);
+    errno = ENOENT;
+    return -1;
+}
+
+static void enumerate_list(struct gr_subscriber_list* list, gr_subscriber_table_enumfn callback, void* context)
+{
+    rwlock_r_lock(&list->lock);
+    for (int i = 0; i < list->count; i++) {
+        callback(&list->entries[i], context);
+    }
+    rwlock_r_unlock(&list->lock);
+}
+
+void gr_subscriber_table_enumerate(struct gr_subscriber_table* table, uint8_t protocol,
+    gr_subscriber_table_enumfn callback, void* context)
+{
+    enumerate_list(&table->lists[protocol], callback, context);
+    if (protocol != GR_SUBSCRIBER_TABLE_ALL) {
+        enumerate_list(&table->lists[GR_SUBSCRIBER_TABLE_ALL], callback, context);
+    }
+}
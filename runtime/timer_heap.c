@@ -0,0 +1,130 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Binary min-heap of deadlines, ordered by the time they expire. The heap is
+ * stored in a single array that doubles in size when it runs full.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include "timer_heap.h"
+
+#define TIMER_HEAP_INITIAL_CAPACITY 16
+
+void gr_timer_heap_construct(struct gr_timer_heap* heap)
+{
+    heap->entries  = NULL;
+    heap->count    = 0;
+    heap->capacity = 0;
+}
+
+void gr_timer_heap_destroy(struct gr_timer_heap* heap)
+{
+    free(heap->entries);
+    heap->entries  = NULL;
+    heap->count    = 0;
+    heap->capacity = 0;
+}
+
+static void sift_up(struct gr_timer_heap* heap, size_t index)
+{
+    struct gr_timer_entry entry = heap->entries[index];
+
+    while (index) {
+        size_t parent = (index - 1) / 2;
+        if (heap->entries[parent].deadline <= entry.deadline) {
+            break;
+        }
+        heap->entries[index] = heap->entries[parent];
+        index = parent;
+    }
+    heap->entries[index] = entry;
+}
+
+static void sift_down(struct gr_timer_heap* heap, size_t index)
+{
+    struct gr_timer_entry entry = heap->entries[index];
+
+    for (;;) {
+        size_t child = (index * 2) + 1;
+        if (child >= heap->count) {
+            break;
+        }
+
+        if (child + 1 < heap->count && heap->entries[child + 1].deadline < heap->entries[child].deadline) {
+            child++;
+        }
+        if (entry.deadline <= heap->entries[child].deadline) {
+            break;
+        }
+        heap->entries[index] = heap->entries[child];
+        index = child;
+    }
+    heap->entries[index] = entry;
+}
+
+int gr_timer_heap_push(struct gr_timer_heap* heap, uint64_t deadline, uint64_t id)
+{
+    if (heap->count == heap->capacity) {
+        size_t                 capacity = heap->capacity ? heap->capacity * 2 : TIMER_HEAP_INITIAL_CAPACITY;
+        struct gr_timer_entry* entries  = realloc(heap->entries, capacity * sizeof(struct gr_timer_entry));
+        if (!entries) {
+            errno = ENOMEM;
+            return -1;
+        }
+        heap->entries  = entries;
+        heap->capacity = capacity;
+    }
+
+    heap->entries[heap->count].deadline = deadline;
+    heap->entries[heap->count].id       = id;
+    sift_up(heap, heap->count++);
+    return 0;
+}
+
+int gr_timer_heap_pop_expired(struct gr_timer_heap* heap, uint64_t now, struct gr_timer_entry* entryOut)
+{
+    if (!heap->count || heap->entries[0].deadline > now) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    *entryOut = heap->entries[0];
+    if (--heap->count) {
+        heap->entries[0] = heap->entries[heap->count];
+        sift_down(heap, 0);
+    }
+    return 0;
+}
+
+void gr_timer_heap_filter(struct gr_timer_heap* heap, gr_timer_heap_filter_fn keep, void* context)
+{
+    size_t count = 0;
+    size_t i;
+
+    for (i = 0; i < heap->count; i++) {
+        if (keep(&heap->entries[i], context)) {
+            heap->entries[count++] = heap->entries[i];
+        }
+    }
+    heap->count = count;
+
+    // rebuild the heap from the bottom up
+    for (i = count / 2; i-- > 0;) {
+        sift_down(heap, i);
+    }
+}
@@ -0,0 +1,163 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Benchmark Suite
+ * - Measures the cost of awaiting large batches of calls, a single client issues
+ *   a batch of requests and awaits all of them at once. The time per call should
+ *   stay flat as the batch grows. By default the client receives on its own thread,
+ *   when the caller pumps the link instead, the batch size is limited by how many
+ *   responses the socket can buffer, as the server blocks on sending to a client
+ *   that is not reading while it is still sending the batch.
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <gracht/server.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_utils.h"
+#include "bench_workload_service_server.h"
+#include "bench_workload_service_client.h"
+
+#define DEFAULT_MAX_BATCH  1000
+#define DEFAULT_ITERATIONS 20
+
+static const char* g_benchPath = "/tmp/g_bench_await";
+
+void bench_workload_work_invocation(struct gracht_message* message, const uint32_t cost_us)
+{
+    bench_workload_work_response(message, cost_us);
+}
+
+static int server_worker(void* context)
+{
+    return gracht_server_main_loop((gracht_server_t*)context);
+}
+
+static int run_batch(gracht_client_t* client, struct gracht_message_context* contexts,
+    struct gracht_message_context** pointers, int batch, uint64_t* elapsedOut)
+{
+    uint64_t start = bench_time_ns();
+    int      failures = 0;
+    int      i;
+
+    for (i = 0; i < batch; i++) {
+        if (bench_workload_work(client, &contexts[i], (uint32_t)i)) {
+            return batch;
+        }
+    }
+
+    gracht_client_await_multiple(client, pointers, batch, GRACHT_AWAIT_ALL);
+    for (i = 0; i < batch; i++) {
+        uint32_t result = 0;
+        bench_workload_work_result(client, &contexts[i], &result);
+        if (result != (uint32_t)i) {
+            failures++;
+        }
+    }
+    *elapsedOut = bench_time_ns() - start;
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    struct gracht_server_configuration serverConfiguration;
+    struct gracht_link_socket*         link;
+    struct gracht_message_context*     contexts;
+    struct gracht_message_context**    pointers;
+    gracht_client_t*                   client;
+    gracht_server_t*                   server;
+    thrd_t                             serverThread;
+    int                                maxBatch   = argc > 1 ? atoi(argv[1]) : DEFAULT_MAX_BATCH;
+    int                                iterations = argc > 2 ? atoi(argv[2]) : DEFAULT_ITERATIONS;
+    int                                pumped     = argc > 3 ? atoi(argv[3]) : 0;
+    int                                failures = 0;
+    int                                batch;
+    int                                i;
+
+    if (maxBatch <= 0 || iterations <= 0) {
+        printf("await: batch size and iterations must be positive\n");
+        return -1;
+    }
+
+    gracht_server_configuration_init(&serverConfiguration);
+    if (gracht_server_create(&serverConfiguration, &server)) {
+        printf("await: failed to create server: %i\n", errno);
+        return -1;
+    }
+
+    if (bench_server_link_create(g_benchPath, &link) || gracht_server_add_link(server, (struct gracht_link*)link)) {
+        printf("await: failed to create server link: %i\n", errno);
+        return -1;
+    }
+    gracht_server_register_protocol(server, &bench_workload_server_protocol);
+    thrd_create(&serverThread, server_worker, server);
+
+    // every response keeps its receive buffer until the result is read, so the pool must
+    // be able to hold the entire batch
+    if (bench_client_create_with_config(g_benchPath, (maxBatch + 1) * GRACHT_DEFAULT_MESSAGE_SIZE, !pumped, &client)) {
+        return -1;
+    }
+
+    contexts = calloc((size_t)maxBatch, sizeof(struct gracht_message_context));
+    pointers = calloc((size_t)maxBatch, sizeof(struct gracht_message_context*));
+    if (!contexts || !pointers) {
+        printf("await: out of memory\n");
+        return -1;
+    }
+
+    for (i = 0; i < maxBatch; i++) {
+        pointers[i] = &contexts[i];
+    }
+
+    printf("await: batches of up to %i calls, %i iterations per batch size, %s\n", maxBatch, iterations,
+        pumped ? "caller pumps the link" : "receive thread");
+    for (batch = 10; ; batch *= 10) {
+        uint64_t total = 0;
+
+        if (batch > maxBatch) {
+            batch = maxBatch;
+        }
+
+        for (i = 0; i < iterations; i++) {
+            uint64_t elapsed = 0;
+            failures += run_batch(client, contexts, pointers, batch, &elapsed);
+            total += elapsed;
+        }
+
+        printf("await: batch of %i calls, %.1fus per batch, %.2fus per call\n", batch,
+            (double)total / (double)iterations / 1000.0,
+            (double)total / (double)iterations / (double)batch / 1000.0);
+        if (batch == maxBatch) {
+            break;
+        }
+    }
+
+    if (failures) {
+        printf("await: %i requests failed\n", failures);
+    }
+
+    gracht_client_shutdown(client);
+    gracht_server_request_shutdown(server);
+    thrd_join(serverThread, NULL);
+    free(contexts);
+    free(pointers);
+    return failures ? -1 : 0;
+}
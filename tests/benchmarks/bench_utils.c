@@ -0,0 +1,140 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Benchmark Suite
+ * - Shared helpers for timing, link setup and reporting of results
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench_utils.h"
+
+uint64_t bench_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void bench_sleep_us(uint32_t us)
+{
+    struct timespec ts = {
+        .tv_sec  = us / 1000000,
+        .tv_nsec = (long)(us % 1000000) * 1000
+    };
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) { }
+}
+
+static void init_address(const char* path, struct sockaddr_un* addr)
+{
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_LOCAL;
+    strncpy(addr->sun_path, path, sizeof(addr->sun_path));
+    addr->sun_path[sizeof(addr->sun_path) - 1] = '\0';
+}
+
+int bench_server_link_create(const char* path, struct gracht_link_socket** linkOut)
+{
+    struct sockaddr_un addr;
+
+    if (gracht_link_socket_create(linkOut)) {
+        return -1;
+    }
+
+    unlink(path);
+    init_address(path, &addr);
+    gracht_link_socket_set_type(*linkOut, gracht_link_stream_based);
+    gracht_link_socket_set_bind_address(*linkOut, (const struct sockaddr_storage*)&addr, sizeof(struct sockaddr_un));
+    gracht_link_socket_set_listen(*linkOut, 1);
+    gracht_link_socket_set_domain(*linkOut, AF_LOCAL);
+    return 0;
+}
+
+int bench_client_create(const char* path, gracht_client_t** clientOut)
+{
+    return bench_client_create_with_config(path, 0, 0, clientOut);
+}
+
+int bench_client_create_with_config(const char* path, int recvPoolSize, int receiveThread, gracht_client_t** clientOut)
+{
+    struct gracht_link_socket*         link;
+    struct gracht_client_configuration clientConfiguration;
+    struct sockaddr_un                 addr;
+    int                                code;
+
+    if (gracht_link_socket_create(&link)) {
+        return -1;
+    }
+
+    init_address(path, &addr);
+    gracht_link_socket_set_type(link, gracht_link_stream_based);
+    gracht_link_socket_set_connect_address(link, (const struct sockaddr_storage*)&addr, sizeof(struct sockaddr_un));
+    gracht_link_socket_set_domain(link, AF_LOCAL);
+
+    gracht_client_configuration_init(&clientConfiguration);
+    gracht_client_configuration_set_link(&clientConfiguration, (struct gracht_link*)link);
+    if (recvPoolSize > 0) {
+        gracht_client_configuration_set_recv_buffer(&clientConfiguration, NULL, recvPoolSize);
+    }
+    gracht_client_configuration_set_receive_thread(&clientConfiguration, receiveThread);
+    code = gracht_client_create(&clientConfiguration, clientOut);
+    if (code) {
+        printf("bench_client_create: error initializing client library %i\n", errno);
+        return code;
+    }
+
+    code = gracht_client_connect(*clientOut);
+    if (code) {
+        printf("bench_client_create: failed to connect client %i\n", errno);
+        gracht_client_shutdown(*clientOut);
+    }
+    return code;
+}
+
+static int latency_cmp(const void* a, const void* b)
+{
+    uint64_t la = *(const uint64_t*)a;
+    uint64_t lb = *(const uint64_t*)b;
+    return la < lb ? -1 : (la > lb ? 1 : 0);
+}
+
+static double percentile_us(uint64_t* sorted, size_t count, double percentile)
+{
+    size_t index = (size_t)(percentile * (double)(count - 1));
+    return (double)sorted[index] / 1000.0;
+}
+
+void bench_report_latencies(const char* name, uint64_t* latencies, size_t count, uint64_t elapsedNs)
+{
+    if (!count) {
+        return;
+    }
+
+    qsort(latencies, count, sizeof(uint64_t), latency_cmp);
+    printf("%s: %zu requests in %.2f ms (%.0f req/s)\n", name, count,
+        (double)elapsedNs / 1000000.0, (double)count / ((double)elapsedNs / 1000000000.0));
+    printf("%s: p50 %.1fus, p90 %.1fus, p99 %.1fus, p99.9 %.1fus, max %.1fus\n", name,
+        percentile_us(latencies, count, 0.50), percentile_us(latencies, count, 0.90),
+        percentile_us(latencies, count, 0.99), percentile_us(latencies, count, 0.999),
+        (double)latencies[count - 1] / 1000.0);
+}
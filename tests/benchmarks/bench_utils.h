@@ -0,0 +1,52 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Benchmark Suite
+ * - Shared helpers for timing, link setup and reporting of results
+ */
+
+#ifndef __GRACHT_BENCH_UTILS_H__
+#define __GRACHT_BENCH_UTILS_H__
+
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// reuse the private api
+#include <thread_api.h>
+
+uint64_t bench_time_ns(void);
+void     bench_sleep_us(uint32_t us);
+
+int  bench_server_link_create(const char* path, struct gracht_link_socket** linkOut);
+int  bench_client_create(const char* path, gracht_client_t** clientOut);
+
+/**
+ * Creates a client with a receive pool of <recvPoolSize> bytes, which is required when more
+ * responses than the default pool can hold are outstanding at once. A size of 0 uses the default.
+ * If <receiveThread> is set, the client receives on its own thread instead of the callers.
+ */
+int  bench_client_create_with_config(const char* path, int recvPoolSize, int receiveThread, gracht_client_t** clientOut);
+
+/**
+ * Sorts the provided latencies (in nanoseconds) and prints the percentiles together with
+ * the throughput achieved over the elapsed time.
+ */
+void bench_report_latencies(const char* name, uint64_t* latencies, size_t count, uint64_t elapsedNs);
+
+#endif //!__GRACHT_BENCH_UTILS_H__
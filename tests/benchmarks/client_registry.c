@@ -0,0 +1,203 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Benchmark Suite
+ * - Measures the cost of the client lookup that every response and event does, with
+ *   all workers responding at the same time. The lock-free client registry is compared
+ *   against the hashtable protected by the mutex based rwlock that it replaced. A writer
+ *   thread keeps connecting and disconnecting a client, like a reactor would.
+ */
+
+#include <rwlock.h>
+#include <hashtable.h>
+#include <client_registry.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_utils.h"
+#include "bench_workload_service_server.h"
+
+#define DEFAULT_THREADS 16
+#define DEFAULT_CLIENTS 256
+#define DEFAULT_LOOKUPS 1000000
+#define CHURN_HANDLE    0x7FFFFFF0
+#define CHURN_DELAY_US  100
+
+enum bench_mode {
+    BENCH_MODE_RWLOCK,
+    BENCH_MODE_REGISTRY
+};
+
+struct bench_context {
+    enum bench_mode           mode;
+    int                       clients;
+    int                       lookups;
+    atomic_int                running;
+    struct mtx_rwlock         lock;
+    gr_hashtable_t            table;
+    struct gr_client_registry registry;
+};
+
+struct thread_context {
+    thrd_t                id;
+    int                   index;
+    struct bench_context* bench;
+    uint64_t              found;
+};
+
+// the workload protocol is linked into all benchmarks, but not used by this one
+void bench_workload_work_invocation(struct gracht_message* message, const uint32_t cost_us)
+{
+    bench_workload_work_response(message, cost_us);
+}
+
+static uint64_t entry_hash(const void* element)
+{
+    const struct gr_client_entry* entry = element;
+    return (uint64_t)entry->handle;
+}
+
+static int entry_cmp(const void* element1, const void* element2)
+{
+    const struct gr_client_entry* entry1 = element1;
+    const struct gr_client_entry* entry2 = element2;
+    return entry1->handle == entry2->handle ? 0 : 1;
+}
+
+static int lookup_worker(void* context)
+{
+    struct thread_context* threadContext = context;
+    struct bench_context*  bench = threadContext->bench;
+    uint32_t               seed = 0x9E3779B9U * (uint32_t)(threadContext->index + 1);
+    int                    i;
+
+    for (i = 0; i < bench->lookups; i++) {
+        struct gr_client_entry* entry;
+        gracht_conn_t           handle;
+
+        seed   = seed * 1664525U + 1013904223U;
+        handle = (gracht_conn_t)((seed >> 8) % (uint32_t)bench->clients);
+        if (bench->mode == BENCH_MODE_RWLOCK) {
+            mtx_rwlock_r_lock(&bench->lock);
+            entry = gr_hashtable_get(&bench->table, &(struct gr_client_entry){ .handle = handle });
+            if (entry && entry->client) {
+                threadContext->found++;
+            }
+            mtx_rwlock_r_unlock(&bench->lock);
+        } else {
+            entry = gr_client_registry_acquire(&bench->registry, handle);
+            if (entry && entry->client) {
+                threadContext->found++;
+            }
+            gr_client_registry_release(&bench->registry, entry);
+        }
+    }
+    return 0;
+}
+
+static int churn_worker(void* context)
+{
+    struct bench_context*  bench = context;
+    struct gr_client_entry entry = { .handle = CHURN_HANDLE, .client = (void*)bench };
+
+    while (atomic_load(&bench->running)) {
+        if (bench->mode == BENCH_MODE_RWLOCK) {
+            mtx_rwlock_w_lock(&bench->lock);
+            gr_hashtable_set(&bench->table, &entry);
+            mtx_rwlock_w_unlock(&bench->lock);
+            mtx_rwlock_w_lock(&bench->lock);
+            gr_hashtable_remove(&bench->table, &entry);
+            mtx_rwlock_w_unlock(&bench->lock);
+        } else {
+            gr_client_registry_add(&bench->registry, &entry);
+            gr_client_registry_remove(&bench->registry, CHURN_HANDLE);
+        }
+        bench_sleep_us(CHURN_DELAY_US);
+    }
+    return 0;
+}
+
+static void run_bench(const char* name, enum bench_mode mode, int threads, int clients, int lookups)
+{
+    struct bench_context   bench;
+    struct thread_context* contexts;
+    thrd_t                 churnThread;
+    uint64_t               start, elapsed;
+    uint64_t               found = 0;
+    int                    i;
+
+    bench.mode    = mode;
+    bench.clients = clients;
+    bench.lookups = lookups;
+    atomic_store(&bench.running, 1);
+    mtx_rwlock_init(&bench.lock);
+    gr_hashtable_construct(&bench.table, 0, sizeof(struct gr_client_entry), entry_hash, entry_cmp);
+    gr_client_registry_construct(&bench.registry, NULL, NULL);
+    for (i = 0; i < clients; i++) {
+        struct gr_client_entry entry = { .handle = (gracht_conn_t)i, .client = (void*)&bench };
+        gr_hashtable_set(&bench.table, &entry);
+        gr_client_registry_add(&bench.registry, &entry);
+    }
+
+    contexts = calloc((size_t)threads, sizeof(struct thread_context));
+    if (!contexts) {
+        printf("client_registry: out of memory\n");
+        return;
+    }
+
+    thrd_create(&churnThread, churn_worker, &bench);
+    start = bench_time_ns();
+    for (i = 0; i < threads; i++) {
+        contexts[i].index = i;
+        contexts[i].bench = &bench;
+        thrd_create(&contexts[i].id, lookup_worker, &contexts[i]);
+    }
+
+    for (i = 0; i < threads; i++) {
+        thrd_join(contexts[i].id, NULL);
+        found += contexts[i].found;
+    }
+    elapsed = bench_time_ns() - start;
+    atomic_store(&bench.running, 0);
+    thrd_join(churnThread, NULL);
+
+    printf("client_registry (%s): %llu lookups in %.2f ms (%.0f lookups/s), %llu found\n", name,
+        (unsigned long long)threads * (unsigned long long)lookups, (double)elapsed / 1000000.0,
+        ((double)threads * (double)lookups) / ((double)elapsed / 1000000000.0), (unsigned long long)found);
+
+    free(contexts);
+    gr_client_registry_destroy(&bench.registry);
+    gr_hashtable_destroy(&bench.table);
+    mtx_rwlock_destroy(&bench.lock);
+}
+
+int main(int argc, char** argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    int clients = argc > 2 ? atoi(argv[2]) : DEFAULT_CLIENTS;
+    int lookups = argc > 3 ? atoi(argv[3]) : DEFAULT_LOOKUPS;
+
+    if (threads <= 0 || clients <= 0 || lookups <= 0) {
+        printf("usage: gbench_client_registry [threads] [clients] [lookups]\n");
+        return -1;
+    }
+
+    printf("client_registry: %i threads, %i clients, %i lookups per thread\n", threads, clients, lookups);
+    run_bench("rwlock", BENCH_MODE_RWLOCK, threads, clients, lookups);
+    run_bench("registry", BENCH_MODE_REGISTRY, threads, clients, lookups);
+    return 0;
+}
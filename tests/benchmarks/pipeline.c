@@ -0,0 +1,179 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Benchmark Suite
+ * - Measures throughput of pipelined connections, every client keeps a window of
+ *   requests in flight. This exposes the per-message cost of the receive path.
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <gracht/server.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_utils.h"
+#include "bench_workload_service_server.h"
+#include "bench_workload_service_client.h"
+
+#define DEFAULT_CLIENTS     4
+#define DEFAULT_WINDOW      16
+#define DEFAULT_ITERATIONS  2000
+#define DEFAULT_RECV_BUFFER (16 * 1024)
+#define MAX_WINDOW          64
+
+struct client_context {
+    thrd_t    id;
+    int       window;
+    int       iterations;
+    uint64_t* latencies;
+    int       failures;
+};
+
+static const char* g_benchPath = "/tmp/g_bench_pipeline";
+
+void bench_workload_work_invocation(struct gracht_message* message, const uint32_t cost_us)
+{
+    bench_workload_work_response(message, cost_us);
+}
+
+static int client_worker(void* context)
+{
+    struct client_context*         clientContext = context;
+    struct gracht_message_context  msgContexts[MAX_WINDOW];
+    struct gracht_message_context* msgPointers[MAX_WINDOW];
+    gracht_client_t*               client;
+    int                            i, j;
+
+    if (bench_client_create(g_benchPath, &client)) {
+        clientContext->failures = clientContext->iterations * clientContext->window;
+        return -1;
+    }
+
+    for (j = 0; j < clientContext->window; j++) {
+        msgPointers[j] = &msgContexts[j];
+    }
+
+    for (i = 0; i < clientContext->iterations; i++) {
+        uint64_t start = bench_time_ns();
+
+        for (j = 0; j < clientContext->window; j++) {
+            if (bench_workload_work(client, &msgContexts[j], (uint32_t)j)) {
+                clientContext->failures++;
+            }
+        }
+
+        gracht_client_await_multiple(client, &msgPointers[0], clientContext->window, GRACHT_AWAIT_ALL);
+        for (j = 0; j < clientContext->window; j++) {
+            uint32_t result = 0;
+            bench_workload_work_result(client, &msgContexts[j], &result);
+            if (result != (uint32_t)j) {
+                clientContext->failures++;
+            }
+        }
+        clientContext->latencies[i] = bench_time_ns() - start;
+    }
+
+    gracht_client_shutdown(client);
+    return 0;
+}
+
+static int server_worker(void* context)
+{
+    return gracht_server_main_loop((gracht_server_t*)context);
+}
+
+int main(int argc, char** argv)
+{
+    struct gracht_server_configuration serverConfiguration;
+    struct gracht_link_socket*         link;
+    struct client_context*             clients;
+    gracht_server_t*                   server;
+    thrd_t                             serverThread;
+    uint64_t*                          latencies;
+    uint64_t                           start, elapsed;
+    int                                clientCount = argc > 1 ? atoi(argv[1]) : DEFAULT_CLIENTS;
+    int                                window      = argc > 2 ? atoi(argv[2]) : DEFAULT_WINDOW;
+    int                                iterations  = argc > 3 ? atoi(argv[3]) : DEFAULT_ITERATIONS;
+    int                                recvBuffer  = argc > 4 ? atoi(argv[4]) : DEFAULT_RECV_BUFFER;
+    int                                failures = 0;
+    int                                i;
+
+    if (window <= 0 || window > MAX_WINDOW) {
+        printf("pipeline: window must be in range 1..%i\n", MAX_WINDOW);
+        return -1;
+    }
+
+    // handle everything on the reactor, so the receive path is what is measured
+    gracht_server_configuration_init(&serverConfiguration);
+    if (gracht_server_create(&serverConfiguration, &server)) {
+        printf("pipeline: failed to create server: %i\n", errno);
+        return -1;
+    }
+
+    if (bench_server_link_create(g_benchPath, &link)) {
+        printf("pipeline: failed to create server link: %i\n", errno);
+        return -1;
+    }
+    gracht_link_socket_set_recv_buffer_size(link, (size_t)recvBuffer);
+    if (gracht_server_add_link(server, (struct gracht_link*)link)) {
+        printf("pipeline: failed to add server link: %i\n", errno);
+        return -1;
+    }
+    gracht_server_register_protocol(server, &bench_workload_server_protocol);
+    thrd_create(&serverThread, server_worker, server);
+
+    latencies = calloc((size_t)clientCount * (size_t)iterations, sizeof(uint64_t));
+    clients   = calloc((size_t)clientCount, sizeof(struct client_context));
+    if (!latencies || !clients) {
+        printf("pipeline: out of memory\n");
+        return -1;
+    }
+
+    printf("pipeline: %i clients, %i requests in flight, %i iterations, %i bytes receive buffer\n",
+        clientCount, window, iterations, recvBuffer);
+
+    start = bench_time_ns();
+    for (i = 0; i < clientCount; i++) {
+        clients[i].window     = window;
+        clients[i].iterations = iterations;
+        clients[i].latencies  = &latencies[(size_t)i * (size_t)iterations];
+        thrd_create(&clients[i].id, client_worker, &clients[i]);
+    }
+
+    for (i = 0; i < clientCount; i++) {
+        thrd_join(clients[i].id, NULL);
+        failures += clients[i].failures;
+    }
+    elapsed = bench_time_ns() - start;
+
+    // the latencies are per window, so scale the throughput to messages
+    bench_report_latencies("pipeline (window)", latencies, (size_t)clientCount * (size_t)iterations, elapsed);
+    printf("pipeline: %.0f messages/s\n",
+        (double)clientCount * (double)iterations * (double)window / ((double)elapsed / 1e9));
+    if (failures) {
+        printf("pipeline: %i requests failed\n", failures);
+    }
+
+    gracht_server_request_shutdown(server);
+    thrd_join(serverThread, NULL);
+    free(latencies);
+    free(clients);
+    return failures ? -1 : 0;
+}
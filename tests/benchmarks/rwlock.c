@@ -0,0 +1,174 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Benchmark Suite
+ * - Measures the reader-writer lock under contention, a number of threads keep taking
+ *   the read lock (like the protocol lookup done for every message), while a writer
+ *   periodically takes the write lock. The mutex based implementation is compared
+ *   against the native one, both for reader throughput and writer latency.
+ */
+
+#include <gatomic.h>
+#include <rwlock.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_utils.h"
+#include "bench_workload_service_server.h"
+
+#define DEFAULT_THREADS 16
+#define DEFAULT_LOCKS   1000000
+#define WRITER_DELAY_US 100
+#define MAX_WRITES      100000
+
+enum bench_mode {
+    BENCH_MODE_MUTEX,
+    BENCH_MODE_NATIVE
+};
+
+struct bench_context {
+    enum bench_mode   mode;
+    int               locks;
+    atomic_int        running;
+    struct mtx_rwlock mutexLock;
+    struct rwlock     nativeLock;
+    volatile int      value;
+    uint64_t*         writeLatencies;
+    size_t            writes;
+};
+
+struct thread_context {
+    thrd_t                id;
+    int                   index;
+    struct bench_context* bench;
+    uint64_t              sum;
+};
+
+// the workload protocol is linked into all benchmarks, but not used by this one
+void bench_workload_work_invocation(struct gracht_message* message, const uint32_t cost_us)
+{
+    bench_workload_work_response(message, cost_us);
+}
+
+static int reader_worker(void* context)
+{
+    struct thread_context* threadContext = context;
+    struct bench_context*  bench = threadContext->bench;
+    int                    i;
+
+    for (i = 0; i < bench->locks; i++) {
+        if (bench->mode == BENCH_MODE_MUTEX) {
+            mtx_rwlock_r_lock(&bench->mutexLock);
+            threadContext->sum += (uint64_t)bench->value;
+            mtx_rwlock_r_unlock(&bench->mutexLock);
+        } else {
+            rwlock_r_lock(&bench->nativeLock);
+            threadContext->sum += (uint64_t)bench->value;
+            rwlock_r_unlock(&bench->nativeLock);
+        }
+    }
+    return 0;
+}
+
+static int writer_worker(void* context)
+{
+    struct bench_context* bench = context;
+
+    while (atomic_load(&bench->running) && bench->writes < MAX_WRITES) {
+        uint64_t start = bench_time_ns();
+        if (bench->mode == BENCH_MODE_MUTEX) {
+            mtx_rwlock_w_lock(&bench->mutexLock);
+            bench->value++;
+            mtx_rwlock_w_unlock(&bench->mutexLock);
+        } else {
+            rwlock_w_lock(&bench->nativeLock);
+            bench->value++;
+            rwlock_w_unlock(&bench->nativeLock);
+        }
+        bench->writeLatencies[bench->writes++] = bench_time_ns() - start;
+        bench_sleep_us(WRITER_DELAY_US);
+    }
+    return 0;
+}
+
+static void run_bench(const char* name, enum bench_mode mode, int threads, int locks)
+{
+    struct bench_context   bench;
+    struct thread_context* contexts;
+    thrd_t                 writerThread;
+    uint64_t               start, elapsed;
+    char                   writerName[64];
+    int                    i;
+
+    bench.mode   = mode;
+    bench.locks  = locks;
+    bench.value  = 0;
+    bench.writes = 0;
+    atomic_store(&bench.running, 1);
+    mtx_rwlock_init(&bench.mutexLock);
+    rwlock_init(&bench.nativeLock);
+
+    bench.writeLatencies = calloc(MAX_WRITES, sizeof(uint64_t));
+    contexts = calloc((size_t)threads, sizeof(struct thread_context));
+    if (!contexts || !bench.writeLatencies) {
+        printf("rwlock: out of memory\n");
+        return;
+    }
+
+    thrd_create(&writerThread, writer_worker, &bench);
+    start = bench_time_ns();
+    for (i = 0; i < threads; i++) {
+        contexts[i].index = i;
+        contexts[i].bench = &bench;
+        thrd_create(&contexts[i].id, reader_worker, &contexts[i]);
+    }
+
+    for (i = 0; i < threads; i++) {
+        thrd_join(contexts[i].id, NULL);
+    }
+    elapsed = bench_time_ns() - start;
+    atomic_store(&bench.running, 0);
+    thrd_join(writerThread, NULL);
+
+    printf("rwlock (%s): %llu read locks in %.2f ms (%.0f read locks/s)\n", name,
+        (unsigned long long)threads * (unsigned long long)locks, (double)elapsed / 1000000.0,
+        ((double)threads * (double)locks) / ((double)elapsed / 1000000000.0));
+
+    snprintf(&writerName[0], sizeof(writerName), "rwlock (%s writer)", name);
+    bench_report_latencies(&writerName[0], bench.writeLatencies, bench.writes, elapsed);
+
+    free(contexts);
+    free(bench.writeLatencies);
+    rwlock_destroy(&bench.nativeLock);
+    mtx_rwlock_destroy(&bench.mutexLock);
+}
+
+int main(int argc, char** argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    int locks   = argc > 2 ? atoi(argv[2]) : DEFAULT_LOCKS;
+
+    if (threads <= 0 || locks <= 0) {
+        printf("usage: gbench_rwlock [threads] [locks]\n");
+        return -1;
+    }
+
+    printf("rwlock: %i reader threads, %i read locks per thread, writer every %uus\n", threads, locks, WRITER_DELAY_US);
+    run_bench("mutex", BENCH_MODE_MUTEX, threads, locks);
+    run_bench("native", BENCH_MODE_NATIVE, threads, locks);
+    return 0;
+}
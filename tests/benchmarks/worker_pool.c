@@ -0,0 +1,176 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Benchmark Suite
+ * - Measures request latency through the server worker pool when the cost of
+ *   the handlers is skewed, a few requests are very expensive while the
+ *   majority are cheap. This exposes head-of-line blocking in the dispatcher.
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <gracht/server.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_utils.h"
+#include "bench_workload_service_server.h"
+#include "bench_workload_service_client.h"
+
+#define DEFAULT_WORKERS  4
+#define DEFAULT_CLIENTS  16
+#define DEFAULT_REQUESTS 500
+
+// The cost distribution, one in SLOW_RATIO requests are slow
+#define FAST_COST_US 50
+#define SLOW_COST_US 5000
+#define SLOW_RATIO   50
+
+struct client_context {
+    thrd_t    id;
+    int       index;
+    int       requests;
+    uint64_t* latencies;
+    int       failures;
+};
+
+static const char* g_benchPath = "/tmp/g_bench_workers";
+
+void bench_workload_work_invocation(struct gracht_message* message, const uint32_t cost_us)
+{
+    bench_sleep_us(cost_us);
+    bench_workload_work_response(message, cost_us);
+}
+
+static int client_worker(void* context)
+{
+    struct client_context* clientContext = context;
+    gracht_client_t*       client;
+    uint32_t               seed = 0x9E3779B9U * (uint32_t)(clientContext->index + 1);
+    int                    i;
+
+    if (bench_client_create(g_benchPath, &client)) {
+        clientContext->failures = clientContext->requests;
+        return -1;
+    }
+
+    for (i = 0; i < clientContext->requests; i++) {
+        struct gracht_message_context msgContext;
+        uint32_t                      cost = FAST_COST_US;
+        uint32_t                      result = 0;
+        uint64_t                      start;
+
+        seed = seed * 1664525U + 1013904223U;
+        if (((seed >> 16) % SLOW_RATIO) == 0) {
+            cost = SLOW_COST_US;
+        }
+
+        start = bench_time_ns();
+        if (bench_workload_work(client, &msgContext, cost)) {
+            clientContext->failures++;
+            continue;
+        }
+        gracht_client_wait_message(client, &msgContext, GRACHT_MESSAGE_BLOCK);
+        bench_workload_work_result(client, &msgContext, &result);
+        clientContext->latencies[i] = bench_time_ns() - start;
+        if (result != cost) {
+            clientContext->failures++;
+        }
+    }
+
+    gracht_client_shutdown(client);
+    return 0;
+}
+
+static int server_worker(void* context)
+{
+    return gracht_server_main_loop((gracht_server_t*)context);
+}
+
+int main(int argc, char** argv)
+{
+    struct gracht_server_configuration serverConfiguration;
+    struct gracht_link_socket*         link;
+    gracht_server_stats_t              stats;
+    struct client_context*             clients;
+    gracht_server_t*                   server;
+    thrd_t                             serverThread;
+    uint64_t*                          latencies;
+    uint64_t                           start, elapsed;
+    int                                workers     = argc > 1 ? atoi(argv[1]) : DEFAULT_WORKERS;
+    int                                clientCount = argc > 2 ? atoi(argv[2]) : DEFAULT_CLIENTS;
+    int                                requests    = argc > 3 ? atoi(argv[3]) : DEFAULT_REQUESTS;
+    int                                queueDepth  = argc > 4 ? atoi(argv[4]) : 0;
+    int                                failures = 0;
+    int                                i;
+
+    gracht_server_configuration_init(&serverConfiguration);
+    gracht_server_configuration_set_num_workers(&serverConfiguration, workers);
+    gracht_server_configuration_set_worker_queue_depth(&serverConfiguration, queueDepth);
+    if (gracht_server_create(&serverConfiguration, &server)) {
+        printf("worker_pool: failed to create server: %i\n", errno);
+        return -1;
+    }
+
+    if (bench_server_link_create(g_benchPath, &link) || gracht_server_add_link(server, (struct gracht_link*)link)) {
+        printf("worker_pool: failed to create server link: %i\n", errno);
+        return -1;
+    }
+    gracht_server_register_protocol(server, &bench_workload_server_protocol);
+    thrd_create(&serverThread, server_worker, server);
+
+    latencies = calloc((size_t)clientCount * (size_t)requests, sizeof(uint64_t));
+    clients   = calloc((size_t)clientCount, sizeof(struct client_context));
+    if (!latencies || !clients) {
+        printf("worker_pool: out of memory\n");
+        return -1;
+    }
+
+    printf("worker_pool: %i workers, %i clients, %i requests per client\n", workers, clientCount, requests);
+    printf("worker_pool: handler cost %uus, 1 in %u requests costs %uus\n", FAST_COST_US, SLOW_RATIO, SLOW_COST_US);
+
+    start = bench_time_ns();
+    for (i = 0; i < clientCount; i++) {
+        clients[i].index     = i;
+        clients[i].requests  = requests;
+        clients[i].latencies = &latencies[(size_t)i * (size_t)requests];
+        thrd_create(&clients[i].id, client_worker, &clients[i]);
+    }
+
+    for (i = 0; i < clientCount; i++) {
+        thrd_join(clients[i].id, NULL);
+        failures += clients[i].failures;
+    }
+    elapsed = bench_time_ns() - start;
+
+    bench_report_latencies("worker_pool", latencies, (size_t)clientCount * (size_t)requests, elapsed);
+    if (failures) {
+        printf("worker_pool: %i requests failed\n", failures);
+    }
+
+    gracht_server_get_stats(server, &stats);
+    printf("worker_pool: throttled %llu times for a total of %llu us\n",
+        (unsigned long long)stats.throttle_count, (unsigned long long)stats.throttled_time_us);
+
+    gracht_server_request_shutdown(server);
+    thrd_join(serverThread, NULL);
+    free(latencies);
+    free(clients);
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,192 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Testing Suite
+ * - Implementation of various test programs that verify behaviour of libgracht
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread_api.h>
+
+#include "test_utils_service_client.h"
+
+#define NUM_ASYNC_CALLS 64
+#define CALL_TIMEOUT_MS 100
+
+extern int init_client_with_socket_link(gracht_client_t** clientOut);
+extern int init_receiver_client_with_socket_link(int sendBufferCount, gracht_client_t** clientOut);
+
+struct async_state {
+    mtx_t lock;
+    cnd_t signal;
+    int   completed;
+    int   failures;
+    int   chained;
+    int   timed_out;
+};
+
+void test_utils_event_myevent_invocation(gracht_client_t* client, const int n)
+{
+    (void)client;
+    (void)n;
+}
+
+void test_utils_event_transfer_status_invocation(gracht_client_t* client, const struct test_transfer_status* transfer_status)
+{
+    (void)client;
+    (void)transfer_status;
+}
+
+static char* testMsg = "hello from an async call!";
+
+static void __complete(struct async_state* state, int failed)
+{
+    mtx_lock(&state->lock);
+    state->completed++;
+    state->failures += failed;
+    cnd_signal(&state->signal);
+    mtx_unlock(&state->lock);
+}
+
+// the first completion invokes a new call from within the callback
+static void print_callback(gracht_client_t* client, int status, const int result, void* userctx)
+{
+    struct async_state* state = userctx;
+    int                 chain = 0;
+
+    if (status != GRACHT_MESSAGE_COMPLETED || result != (int)strlen(testMsg)) {
+        printf("gracht_client: print completed with %i, returned %i\n", status, result);
+        __complete(state, 1);
+        return;
+    }
+
+    mtx_lock(&state->lock);
+    if (!state->chained) {
+        state->chained = chain = 1;
+    }
+    mtx_unlock(&state->lock);
+
+    if (chain && test_utils_print_async(client, testMsg, print_callback, state)) {
+        printf("gracht_client: failed to invoke print from the callback: %i\n", errno);
+        __complete(state, 1);
+    }
+    __complete(state, 0);
+}
+
+// the server never responds to transactions with an id of 2000 or above, so the call must time out
+static void transfer_callback(gracht_client_t* client, int status, const struct test_transfer_status* result, void* userctx)
+{
+    struct async_state* state = userctx;
+    int                 failed = status != GRACHT_MESSAGE_ERROR || errno != ETIMEDOUT;
+    (void)client;
+    (void)result;
+
+    if (failed) {
+        printf("gracht_client: transfer did not time out: %i\n", errno);
+    }
+    mtx_lock(&state->lock);
+    state->timed_out = 1;
+    mtx_unlock(&state->lock);
+    __complete(state, failed);
+}
+
+static int run_test(gracht_client_t* client, int receiver)
+{
+    struct gracht_call_options options = { .timeout_ms = CALL_TIMEOUT_MS };
+    struct async_state         state = { 0 };
+    struct test_transaction    transaction;
+    int                        i, expected = 0;
+
+    mtx_init(&state.lock, mtx_plain);
+    cnd_init(&state.signal);
+
+    test_transaction_init(&transaction);
+    transaction.test_id = 2000;
+
+    gracht_client_set_call_options(client, &options);
+    if (test_utils_transfer_async(client, &transaction, transfer_callback, &state)) {
+        printf("gracht_client: failed to invoke transfer: %i\n", errno);
+        return -1;
+    }
+    expected++;
+
+    for (i = 0; i < NUM_ASYNC_CALLS; i++) {
+        if (test_utils_print_async(client, testMsg, print_callback, &state)) {
+            printf("gracht_client: failed to invoke print %i: %i\n", i, errno);
+            return -1;
+        }
+        expected++;
+    }
+
+    // the chained call from the first callback
+    expected++;
+
+    // callbacks run on the receive thread, or on this thread while it pumps the client
+    mtx_lock(&state.lock);
+    while (state.completed < expected) {
+        if (receiver) {
+            cnd_wait(&state.signal, &state.lock);
+        } else {
+            mtx_unlock(&state.lock);
+            gracht_client_wait_message(client, NULL, GRACHT_MESSAGE_BLOCK);
+            mtx_lock(&state.lock);
+        }
+    }
+    mtx_unlock(&state.lock);
+
+    mtx_destroy(&state.lock);
+    cnd_destroy(&state.signal);
+    if (state.failures || !state.timed_out) {
+        printf("gracht_client: %i of %i calls failed\n", state.failures, expected);
+        return -1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    gracht_client_t* client;
+    int              code;
+
+    // the caller pumps the link itself
+    code = init_client_with_socket_link(&client);
+    if (code) {
+        return code;
+    }
+
+    gracht_client_register_protocol(client, &test_utils_client_protocol);
+    code = run_test(client, 0);
+    gracht_client_shutdown(client);
+    if (code) {
+        return code;
+    }
+
+    // the receive thread pumps the link
+    code = init_receiver_client_with_socket_link(0, &client);
+    if (code) {
+        return code;
+    }
+
+    gracht_client_register_protocol(client, &test_utils_client_protocol);
+    code = run_test(client, 1);
+    gracht_client_shutdown(client);
+    return code;
+}
@@ -0,0 +1,131 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Testing Suite
+ * - Implementation of various test programs that verify behaviour of libgracht
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_utils_service_client.h"
+
+#define NUM_BATCH_CALLS 12
+
+extern int init_client_with_socket_link(gracht_client_t** clientOut);
+extern int init_receiver_client_with_socket_link(int sendBufferCount, gracht_client_t** clientOut);
+
+void test_utils_event_myevent_invocation(gracht_client_t* client, const int n)
+{
+    (void)client;
+    (void)n;
+}
+
+void test_utils_event_transfer_status_invocation(gracht_client_t* client, const struct test_transfer_status* transfer_status)
+{
+    (void)client;
+    (void)transfer_status;
+}
+
+// adds a number of calls to the batch, with a call that has no response in the middle of them,
+// the smallest capacity makes the batch flush before every call
+static int run_test(gracht_client_t* client, int capacity)
+{
+    gracht_client_batch_t*          batch;
+    struct gracht_message_context   context[NUM_BATCH_CALLS];
+    struct gracht_message_context** contexts;
+    char                            messages[NUM_BATCH_CALLS][32];
+    uint8_t                         data[16] = { 0 };
+    int                             i, count, result, code = -1;
+
+    if (gracht_client_batch_create(client, capacity, &batch)) {
+        printf("gracht_client: failed to create batch: %i\n", errno);
+        return -1;
+    }
+
+    for (i = 0; i < NUM_BATCH_CALLS; i++) {
+        snprintf(&messages[i][0], sizeof(messages[i]), "batched call %i", i * 100);
+        if (test_utils_print_batch(batch, &context[i], &messages[i][0])) {
+            printf("gracht_client: failed to add call %i: %i\n", i, errno);
+            goto cleanup;
+        }
+
+        if (i == NUM_BATCH_CALLS / 2 && test_utils_transfer_data_batch(batch, NULL, &data[0], sizeof(data))) {
+            printf("gracht_client: failed to add transfer_data: %i\n", errno);
+            goto cleanup;
+        }
+    }
+
+    if (gracht_client_batch_flush(batch)) {
+        printf("gracht_client: failed to flush batch: %i\n", errno);
+        goto cleanup;
+    }
+
+    contexts = gracht_client_batch_contexts(batch, &count);
+    if (count != NUM_BATCH_CALLS) {
+        printf("gracht_client: batch has %i contexts, expected %i\n", count, NUM_BATCH_CALLS);
+        goto cleanup;
+    }
+
+    gracht_client_await_multiple(client, contexts, count, GRACHT_AWAIT_ALL);
+    code = 0;
+    for (i = 0; i < NUM_BATCH_CALLS; i++) {
+        result = -1;
+        test_utils_print_result(client, contexts[i], &result);
+        if (contexts[i] != &context[i] || result != (int)strlen(&messages[i][0])) {
+            printf("gracht_client: call %i returned %i\n", i, result);
+            code = -1;
+        }
+    }
+
+cleanup:
+    gracht_client_batch_destroy(batch);
+    return code;
+}
+
+int main(void)
+{
+    gracht_client_t* client;
+    int              code;
+
+    // the caller pumps the link itself
+    code = init_client_with_socket_link(&client);
+    if (code) {
+        return code;
+    }
+
+    gracht_client_register_protocol(client, &test_utils_client_protocol);
+    code = run_test(client, 0);
+    gracht_client_shutdown(client);
+    if (code) {
+        return code;
+    }
+
+    // the receive thread pumps the link
+    code = init_receiver_client_with_socket_link(0, &client);
+    if (code) {
+        return code;
+    }
+
+    gracht_client_register_protocol(client, &test_utils_client_protocol);
+    code = run_test(client, 1);
+    gracht_client_shutdown(client);
+    return code;
+}
@@ -0,0 +1,132 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Testing Suite
+ * - Implementation of various test programs that verify behaviour of libgracht
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread_api.h>
+
+#include "test_utils_service_client.h"
+
+#define NUM_SEND_BUFFERS 4
+#define NUM_THREADS      4
+#define NUM_CALLS        2
+#define NUM_ROUNDS       10
+
+struct sender_context {
+    thrd_t                        id;
+    gracht_client_t*              client;
+    struct gracht_message_context contexts[NUM_CALLS];
+    int                           failures;
+};
+
+extern int init_pooled_client_with_socket_link(int sendBufferCount, gracht_client_t** clientOut);
+
+void test_utils_event_myevent_invocation(gracht_client_t* client, const int n)
+{
+    (void)client;
+    (void)n;
+}
+
+void test_utils_event_transfer_status_invocation(gracht_client_t* client, const struct test_transfer_status* transfer_status)
+{
+    (void)client;
+    (void)transfer_status;
+}
+
+static char* testMsg = "hello from a concurrent sender!";
+
+// all senders share the same client, and serialize their messages at the same time
+static int sender_worker(void* context)
+{
+    struct sender_context* senderContext = context;
+    int                    i;
+
+    for (i = 0; i < NUM_CALLS; i++) {
+        if (test_utils_print(senderContext->client, &senderContext->contexts[i], testMsg)) {
+            senderContext->failures++;
+        }
+    }
+    return 0;
+}
+
+// responses keep their receive buffer until the result is read, so keep the number
+// of calls in flight below the size of the receive pool by awaiting every round
+static int run_round(gracht_client_t* client)
+{
+    struct sender_context          senders[NUM_THREADS];
+    struct gracht_message_context* contexts[NUM_THREADS * NUM_CALLS];
+    int                            i, j, status;
+    int                            failures = 0;
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        senders[i].client   = client;
+        senders[i].failures = 0;
+        thrd_create(&senders[i].id, sender_worker, &senders[i]);
+    }
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        thrd_join(senders[i].id, NULL);
+        failures += senders[i].failures;
+        for (j = 0; j < NUM_CALLS; j++) {
+            contexts[(i * NUM_CALLS) + j] = &senders[i].contexts[j];
+        }
+    }
+
+    if (failures) {
+        printf("gracht_client: %i calls failed to be sent\n", failures);
+        return failures;
+    }
+
+    gracht_client_await_multiple(client, contexts, NUM_THREADS * NUM_CALLS, GRACHT_AWAIT_ALL);
+    for (i = 0; i < NUM_THREADS * NUM_CALLS; i++) {
+        status = -1;
+        test_utils_print_result(client, contexts[i], &status);
+        if (status != (int)strlen(testMsg)) {
+            printf("gracht_client: call %i returned %i\n", i, status);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main(void)
+{
+    gracht_client_t* client;
+    int              i, code;
+    int              failures = 0;
+
+    code = init_pooled_client_with_socket_link(NUM_SEND_BUFFERS, &client);
+    if (code) {
+        return code;
+    }
+
+    gracht_client_register_protocol(client, &test_utils_client_protocol);
+
+    for (i = 0; i < NUM_ROUNDS && !failures; i++) {
+        failures += run_round(client);
+    }
+
+    gracht_client_shutdown(client);
+    return failures ? -1 : 0;
+}
@@ -67,6 +67,15 @@ int main(void)
     }
     
     printf("gracht_client: recieved event count %i\n", g_eventsReceived);
+
+    // broadcasts are queued by the server and sent by the reactor of the client
+    g_eventsReceived = 0;
+    test_utils_get_broadcast(client, NULL, code);
+    while (g_eventsReceived != code) {
+        gracht_client_wait_message(client, NULL, GRACHT_MESSAGE_BLOCK);
+    }
+
+    printf("gracht_client: recieved broadcast count %i\n", g_eventsReceived);
     gracht_client_shutdown(client);
     return 0;
 }
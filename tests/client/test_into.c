@@ -0,0 +1,162 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Testing Suite
+ * - Implementation of various test programs that verify behaviour of libgracht
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_utils_service_client.h"
+
+extern int init_client_with_socket_link(gracht_client_t** clientOut);
+extern int init_receiver_client_with_socket_link(int sendBufferCount, gracht_client_t** clientOut);
+
+void test_utils_event_myevent_invocation(gracht_client_t* client, const int n)
+{
+    (void)client;
+    (void)n;
+}
+
+void test_utils_event_transfer_status_invocation(gracht_client_t* client, const struct test_transfer_status* transfer_status)
+{
+    (void)client;
+    (void)transfer_status;
+}
+
+static char* testMsg = "hello from a call with a destination!";
+
+static int receive_data(gracht_client_t* client)
+{
+    struct gracht_message_context context;
+    uint8_t                       data[16];
+    uint32_t                      count = 0;
+    int                           status;
+    int                           i;
+
+    memset(&data[0], 0xFF, sizeof(data));
+    if (test_utils_receive_data_into(client, &context, &data[0], sizeof(data))) {
+        printf("gracht_client: failed to invoke receive_data_into: %i\n", errno);
+        return -1;
+    }
+    gracht_client_wait_message(client, &context, GRACHT_MESSAGE_BLOCK);
+    status = test_utils_receive_data_into_result(client, &context, &count);
+    if (status || count != sizeof(data)) {
+        printf("gracht_client: receive_data_into returned %i with %u elements\n", status, count);
+        return -1;
+    }
+
+    for (i = 0; i < (int)sizeof(data); i++) {
+        if (data[i] != (uint8_t)i) {
+            printf("gracht_client: data[%i] was %u\n", i, data[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// the server responds with 16 elements, which must not overflow the destination
+static int receive_data_truncated(gracht_client_t* client)
+{
+    struct gracht_message_context context;
+    uint8_t                       data[9];
+    uint32_t                      count = 0;
+    int                           status;
+
+    data[8] = 0xFF;
+    if (test_utils_receive_data_into(client, &context, &data[0], 8)) {
+        printf("gracht_client: failed to invoke receive_data_into: %i\n", errno);
+        return -1;
+    }
+    gracht_client_wait_message(client, &context, GRACHT_MESSAGE_BLOCK);
+    status = test_utils_receive_data_into_result(client, &context, &count);
+    if (status != GRACHT_MESSAGE_ERROR || errno != EMSGSIZE || count != 16 || data[8] != 0xFF) {
+        printf("gracht_client: truncated receive_data_into returned %i (%i) with %u elements\n", status, errno, count);
+        return -1;
+    }
+    return 0;
+}
+
+static int receive_string(gracht_client_t* client)
+{
+    struct gracht_message_context context;
+    char                          text[128];
+    uint32_t                      length = 0;
+    int                           result = 0;
+    int                           status;
+
+    test_utils_print(client, &context, testMsg);
+    gracht_client_wait_message(client, &context, GRACHT_MESSAGE_BLOCK);
+    test_utils_print_result(client, &context, &result);
+    if (result != (int)strlen(testMsg)) {
+        printf("gracht_client: print returned %i\n", result);
+        return -1;
+    }
+
+    if (test_utils_receive_string_into(client, &context, &text[0], sizeof(text))) {
+        printf("gracht_client: failed to invoke receive_string_into: %i\n", errno);
+        return -1;
+    }
+    gracht_client_wait_message(client, &context, GRACHT_MESSAGE_BLOCK);
+    status = test_utils_receive_string_into_result(client, &context, &length);
+    if (status || length != strlen(testMsg) || strcmp(&text[0], testMsg)) {
+        printf("gracht_client: receive_string_into returned %i with %u characters\n", status, length);
+        return -1;
+    }
+    return 0;
+}
+
+static int run_test(gracht_client_t* client)
+{
+    gracht_client_register_protocol(client, &test_utils_client_protocol);
+    if (receive_data(client) || receive_data_truncated(client) || receive_string(client)) {
+        return -1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    gracht_client_t* client;
+    int              code;
+
+    // the caller pumps the link itself
+    code = init_client_with_socket_link(&client);
+    if (code) {
+        return code;
+    }
+
+    code = run_test(client);
+    gracht_client_shutdown(client);
+    if (code) {
+        return code;
+    }
+
+    // the receive thread pumps the link
+    code = init_receiver_client_with_socket_link(0, &client);
+    if (code) {
+        return code;
+    }
+
+    code = run_test(client);
+    gracht_client_shutdown(client);
+    return code;
+}
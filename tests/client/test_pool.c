@@ -0,0 +1,187 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Testing Suite
+ * - Implementation of various test programs that verify behaviour of libgracht
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread_api.h>
+
+#include "test_utils_service_client.h"
+
+#define NUM_CONNECTIONS    3
+#define RECONNECT_INTERVAL 50
+
+extern int create_socket_link(void* context, struct gracht_link** linkOut);
+
+void test_utils_event_myevent_invocation(gracht_client_t* client, const int n)
+{
+    (void)client;
+    (void)n;
+}
+
+void test_utils_event_transfer_status_invocation(gracht_client_t* client, const struct test_transfer_status* transfer_status)
+{
+    (void)client;
+    (void)transfer_status;
+}
+
+static char* testMsg = "hello from a pooled client!";
+
+// calls stay outstanding until their result is read, so every connection of the
+// pool must be handed out once before any connection is handed out again
+static int run_round(gracht_client_pool_t* pool)
+{
+    gracht_client_t*              clients[NUM_CONNECTIONS];
+    struct gracht_message_context contexts[NUM_CONNECTIONS];
+    int                           i, j, result, code = 0;
+
+    for (i = 0; i < NUM_CONNECTIONS; i++) {
+        clients[i] = gracht_client_pool_acquire(pool);
+        if (!clients[i]) {
+            printf("gracht_client: failed to acquire connection %i: %i\n", i, errno);
+            return -1;
+        }
+
+        for (j = 0; j < i; j++) {
+            if (clients[j] == clients[i]) {
+                printf("gracht_client: connection %i was handed out twice\n", j);
+                code = -1;
+            }
+        }
+
+        if (test_utils_print(clients[i], &contexts[i], testMsg)) {
+            printf("gracht_client: failed to invoke print on connection %i: %i\n", i, errno);
+            code = -1;
+        }
+    }
+
+    for (i = 0; i < NUM_CONNECTIONS; i++) {
+        result = -1;
+        gracht_client_await(clients[i], &contexts[i], 0);
+        test_utils_print_result(clients[i], &contexts[i], &result);
+        if (result != (int)strlen(testMsg)) {
+            printf("gracht_client: print on connection %i returned %i\n", i, result);
+            code = -1;
+        }
+        gracht_client_pool_release(pool, clients[i]);
+    }
+    return code;
+}
+
+// the handle spreads calls like acquiring connections does, and finds the connection of
+// each call again when it is awaited and its result is read
+static int run_handle_round(gracht_client_pool_t* pool)
+{
+    gracht_client_t*               handle = gracht_client_pool_handle(pool);
+    struct gracht_message_context  contexts[NUM_CONNECTIONS];
+    struct gracht_message_context* awaited[NUM_CONNECTIONS];
+    int                            i, j, result, code = 0;
+
+    for (i = 0; i < NUM_CONNECTIONS; i++) {
+        if (test_utils_print(handle, &contexts[i], testMsg)) {
+            printf("gracht_client: failed to invoke print through the pool handle: %i\n", errno);
+            return -1;
+        }
+
+        for (j = 0; j < i; j++) {
+            if (contexts[j].connection == contexts[i].connection) {
+                printf("gracht_client: calls %i and %i were made on the same connection\n", j, i);
+                code = -1;
+            }
+        }
+        awaited[i] = &contexts[i];
+    }
+
+    gracht_client_await_multiple(handle, &awaited[0], NUM_CONNECTIONS, GRACHT_AWAIT_ALL);
+    for (i = 0; i < NUM_CONNECTIONS; i++) {
+        result = -1;
+        test_utils_print_result(handle, &contexts[i], &result);
+        if (result != (int)strlen(testMsg)) {
+            printf("gracht_client: print %i through the pool handle returned %i\n", i, result);
+            code = -1;
+        }
+    }
+    return code;
+}
+
+static void break_connection(gracht_client_pool_t* pool)
+{
+    gracht_client_t* client = gracht_client_pool_acquire(pool);
+    if (!client) {
+        return;
+    }
+
+#ifdef _WIN32
+    shutdown(gracht_client_iod(client), SD_BOTH);
+#else
+    shutdown(gracht_client_iod(client), SHUT_RDWR);
+#endif
+    gracht_client_pool_release(pool, client);
+}
+
+int main(void)
+{
+    gracht_client_pool_configuration_t config;
+    gracht_client_pool_t*              pool;
+    int                                code;
+
+    gracht_client_pool_configuration_init(&config);
+    gracht_client_pool_configuration_set_connection_count(&config, NUM_CONNECTIONS);
+    gracht_client_pool_configuration_set_link_factory(&config, create_socket_link, NULL);
+    gracht_client_pool_configuration_set_reconnect_interval(&config, RECONNECT_INTERVAL);
+
+    code = gracht_client_pool_create(&config, &pool);
+    if (code) {
+        printf("gracht_client: failed to create pool: %i\n", errno);
+        return code;
+    }
+
+    gracht_client_pool_register_protocol(pool, &test_utils_client_protocol);
+    if (gracht_client_pool_connected(pool) != NUM_CONNECTIONS) {
+        printf("gracht_client: pool only has %i connections\n", gracht_client_pool_connected(pool));
+        code = -1;
+        goto cleanup;
+    }
+
+    code = run_round(pool);
+    if (code) {
+        goto cleanup;
+    }
+
+    code = run_handle_round(pool);
+    if (code) {
+        goto cleanup;
+    }
+
+    // the lost connection must be redialed, so all connections are available again
+    break_connection(pool);
+    thrd_sleep(&(struct timespec) { .tv_nsec = RECONNECT_INTERVAL * 10 * 1000000 }, NULL);
+    code = run_round(pool);
+    if (!code) {
+        code = run_handle_round(pool);
+    }
+
+cleanup:
+    gracht_client_pool_destroy(pool);
+    return code;
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Testing Suite
+ * - Implementation of various test programs that verify behaviour of libgracht
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread_api.h>
+
+#include "test_utils_service_client.h"
+
+#define NUM_SEND_BUFFERS 4
+#define NUM_THREADS      4
+#define NUM_CALLS        25
+
+struct caller_context {
+    thrd_t           id;
+    gracht_client_t* client;
+    int              failures;
+};
+
+extern int init_receiver_client_with_socket_link(int sendBufferCount, gracht_client_t** clientOut);
+
+void test_utils_event_myevent_invocation(gracht_client_t* client, const int n)
+{
+    (void)client;
+    (void)n;
+}
+
+void test_utils_event_transfer_status_invocation(gracht_client_t* client, const struct test_transfer_status* transfer_status)
+{
+    (void)client;
+    (void)transfer_status;
+}
+
+static char* testMsg = "hello from a synchronous caller!";
+
+// every caller does synchronous calls, and relies on the receive thread to complete them
+static int caller_worker(void* context)
+{
+    struct caller_context* callerContext = context;
+    int                    i, status;
+
+    for (i = 0; i < NUM_CALLS; i++) {
+        struct gracht_message_context msgContext;
+
+        if (test_utils_print(callerContext->client, &msgContext, testMsg)) {
+            callerContext->failures++;
+            continue;
+        }
+
+        gracht_client_await(callerContext->client, &msgContext, 0);
+        status = -1;
+        test_utils_print_result(callerContext->client, &msgContext, &status);
+        if (status != (int)strlen(testMsg)) {
+            printf("gracht_client: call %i returned %i\n", i, status);
+            callerContext->failures++;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    gracht_client_t*      client;
+    struct caller_context callers[NUM_THREADS];
+    int                   i, code;
+    int                   failures = 0;
+
+    code = init_receiver_client_with_socket_link(NUM_SEND_BUFFERS, &client);
+    if (code) {
+        return code;
+    }
+
+    gracht_client_register_protocol(client, &test_utils_client_protocol);
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        callers[i].client   = client;
+        callers[i].failures = 0;
+        thrd_create(&callers[i].id, caller_worker, &callers[i]);
+    }
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        thrd_join(callers[i].id, NULL);
+        failures += callers[i].failures;
+    }
+
+    gracht_client_shutdown(client);
+    return failures ? -1 : 0;
+}
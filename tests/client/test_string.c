@@ -64,7 +64,7 @@ static int __test_receive_string(gracht_client_t* client, const char* expected)
 {
     struct gracht_message_context context;
     int code, status = -1337;
-    char buffer[128];
+    char buffer[2048];
 
     code = test_utils_receive_string(client, &context);
     if (code) {
@@ -94,6 +94,22 @@ static int __test_empty_strings(gracht_client_t* client)
     return 0;
 }
 
+// strings this long are sent from their own segment, both in the call and in the response
+static int __test_long_strings(gracht_client_t* client)
+{
+    char text[1500];
+    int  status;
+
+    memset(&text[0], 'g', sizeof(text) - 1);
+    text[sizeof(text) - 1] = 0;
+
+    status = __test_print(client, &text[0]);
+    if (status) {
+        return status;
+    }
+    return __test_receive_string(client, &text[0]);
+}
+
 static int __test_receive_data(gracht_client_t* client)
 {
     struct gracht_message_context context;
@@ -157,6 +173,12 @@ int main(int argc, char **argv)
         return status;
     }
 
+    status = __test_long_strings(client);
+    if (status) {
+        fprintf(stderr, "__test_long_strings: FAILED [%s]\n", strerror(errno));
+        return status;
+    }
+
     status = __test_receive_data(client);
     if (status) {
         fprintf(stderr, "__test_receive_data: FAILED [%s]\n", strerror(errno));
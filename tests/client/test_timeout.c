@@ -0,0 +1,118 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Testing Suite
+ * - Implementation of various test programs that verify behaviour of libgracht
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_utils_service_client.h"
+
+#define CALL_TIMEOUT_MS 100
+
+extern int init_client_with_socket_link(gracht_client_t** clientOut);
+extern int init_receiver_client_with_socket_link(int sendBufferCount, gracht_client_t** clientOut);
+
+void test_utils_event_myevent_invocation(gracht_client_t* client, const int n)
+{
+    (void)client;
+    (void)n;
+}
+
+void test_utils_event_transfer_status_invocation(gracht_client_t* client, const struct test_transfer_status* transfer_status)
+{
+    (void)client;
+    (void)transfer_status;
+}
+
+static char* testMsg = "hello after a timeout!";
+
+// the server never responds to transactions with an id of 2000 or above, so the call
+// must time out, and the client must still be usable afterwards
+static int run_test(gracht_client_t* client)
+{
+    struct gracht_call_options    options = { .timeout_ms = CALL_TIMEOUT_MS };
+    struct gracht_message_context context;
+    struct test_transaction       transaction;
+    struct test_transfer_status   status;
+    int                           result = -1;
+
+    test_transaction_init(&transaction);
+    transaction.test_id = 2000;
+
+    gracht_client_set_call_options(client, &options);
+    if (test_utils_transfer(client, &context, &transaction)) {
+        printf("gracht_client: failed to invoke transfer: %i\n", errno);
+        return -1;
+    }
+
+    gracht_client_await(client, &context, 0);
+    errno = 0;
+    if (test_utils_transfer_result(client, &context, &status) != GRACHT_MESSAGE_ERROR || errno != ETIMEDOUT) {
+        printf("gracht_client: transfer did not time out: %i\n", errno);
+        return -1;
+    }
+
+    // the options only apply to a single call
+    if (test_utils_print(client, &context, testMsg)) {
+        printf("gracht_client: failed to invoke print: %i\n", errno);
+        return -1;
+    }
+
+    gracht_client_await(client, &context, 0);
+    test_utils_print_result(client, &context, &result);
+    if (result != (int)strlen(testMsg)) {
+        printf("gracht_client: print returned %i\n", result);
+        return -1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    gracht_client_t* client;
+    int              code;
+
+    // the caller pumps the link itself
+    code = init_client_with_socket_link(&client);
+    if (code) {
+        return code;
+    }
+
+    gracht_client_register_protocol(client, &test_utils_client_protocol);
+    code = run_test(client);
+    gracht_client_shutdown(client);
+    if (code) {
+        return code;
+    }
+
+    // the receive thread pumps the link
+    code = init_receiver_client_with_socket_link(0, &client);
+    if (code) {
+        return code;
+    }
+
+    gracht_client_register_protocol(client, &test_utils_client_protocol);
+    code = run_test(client);
+    gracht_client_shutdown(client);
+    return code;
+}
@@ -0,0 +1,92 @@
+/**
+ * Copyright 2021, Philip Meulengracht
+ *
+ * This program is free software : you can redistribute it and / or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation ? , either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Gracht Testing Suite
+ * - Implementation of various test programs that verify behaviour of libgracht
+ */
+
+#include <errno.h>
+#include <gracht/link/socket.h>
+#include <gracht/client.h>
+#include <stdio.h>
+
+#include "test_utils_service_client.h"
+
+extern int init_client_with_socket_link(gracht_client_t** clientOut);
+
+void test_utils_event_myevent_invocation(gracht_client_t* client, const int n)
+{
+    (void)client;
+    (void)n;
+}
+
+void test_utils_event_transfer_status_invocation(gracht_client_t* client, const struct test_transfer_status* transfer_status)
+{
+    (void)client;
+    (void)transfer_status;
+}
+
+static int get_ticks(gracht_client_t* client, int* ticksOut)
+{
+    struct gracht_message_context context;
+
+    if (test_utils_get_timer_ticks(client, &context)) {
+        printf("gracht_client: failed to invoke get_timer_ticks: %i\n", errno);
+        return -1;
+    }
+
+    if (gracht_client_wait_message(client, &context, GRACHT_MESSAGE_BLOCK)) {
+        printf("gracht_client: failed to wait for get_timer_ticks: %i\n", errno);
+        return -1;
+    }
+    return test_utils_get_timer_ticks_result(client, &context, ticksOut);
+}
+
+// the test server runs a periodic timer on its loop, which must keep ticking while the
+// server is otherwise idle and waiting for events
+int main(void)
+{
+    gracht_client_t* client;
+    int              before = 0;
+    int              after = 0;
+    int              code;
+
+    code = init_client_with_socket_link(&client);
+    if (code) {
+        return code;
+    }
+
+    gracht_client_register_protocol(client, &test_utils_client_protocol);
+    code = get_ticks(client, &before);
+    if (!code) {
+#ifdef _WIN32
+        Sleep(200);
+#elif defined(MOLLENOS)
+        thrd_sleep(&(struct timespec) { .tv_nsec = 200000000 }, NULL);
+#else
+        usleep(200000);
+#endif
+        code = get_ticks(client, &after);
+    }
+
+    if (!code && after <= before) {
+        printf("gracht_client: timer did not tick while idle (%i => %i)\n", before, after);
+        code = -1;
+    }
+    gracht_client_shutdown(client);
+    return code;
+}
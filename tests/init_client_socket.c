@@ -66,7 +66,7 @@ static void init_socket_config(struct gracht_link_socket* link)
 }
 #endif
 
-int init_client_with_socket_link(gracht_client_t** clientOut)
+static int init_client(int sendBufferCount, int receiveThread, gracht_client_t** clientOut)
 {
     struct gracht_link_socket*         link;
     struct gracht_client_configuration clientConfiguration;
@@ -80,6 +80,8 @@ int init_client_with_socket_link(gracht_client_t** clientOut)
 
     gracht_client_configuration_set_link(&clientConfiguration, (struct gracht_link*)link);
     gracht_client_configuration_set_stream_buffer_size(&clientConfiguration, 8192, 8);
+    gracht_client_configuration_set_send_buffer_count(&clientConfiguration, sendBufferCount);
+    gracht_client_configuration_set_receive_thread(&clientConfiguration, receiveThread);
 
     code = gracht_client_create(&clientConfiguration, &client);
     if (code) {
@@ -95,3 +97,32 @@ int init_client_with_socket_link(gracht_client_t** clientOut)
     *clientOut = client;
     return code;
 }
+
+int create_socket_link(void* context, struct gracht_link** linkOut)
+{
+    struct gracht_link_socket* link;
+    (void)context;
+
+    if (gracht_link_socket_create(&link)) {
+        return -1;
+    }
+
+    init_socket_config(link);
+    *linkOut = (struct gracht_link*)link;
+    return 0;
+}
+
+int init_pooled_client_with_socket_link(int sendBufferCount, gracht_client_t** clientOut)
+{
+    return init_client(sendBufferCount, 0, clientOut);
+}
+
+int init_receiver_client_with_socket_link(int sendBufferCount, gracht_client_t** clientOut)
+{
+    return init_client(sendBufferCount, 1, clientOut);
+}
+
+int init_client_with_socket_link(gracht_client_t** clientOut)
+{
+    return init_client(0, 0, clientOut);
+}
@@ -21,11 +21,16 @@
  */
 
 #include <gracht/link/socket.h>
+#include <gracht/link/uring.h>
 #include <gracht/server.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
 
+#define TEST_TIMER_INTERVAL_MS 10
+
+extern void test_timer_tick(gracht_server_t* server, void* context);
+
 #if defined(__linux__)
 #include <sys/un.h>
 
@@ -96,13 +101,17 @@ static void init_client_link_config(struct gracht_link_socket* link)
 }
 #endif
 
-void register_server_links(gracht_server_t* server)
+static void register_links(gracht_server_t* server, int uring)
 {
     struct gracht_link_socket* clientLink;
     struct gracht_link_socket* packetLink;
     int                        code;
 
-    gracht_link_socket_create(&clientLink);
+    if (uring) {
+        gracht_link_uring_create(&clientLink);
+    } else {
+        gracht_link_socket_create(&clientLink);
+    }
     gracht_link_socket_create(&packetLink);
 
     init_client_link_config(clientLink);
@@ -117,9 +126,20 @@ void register_server_links(gracht_server_t* server)
     if (code) {
         printf("register_server_links failed to add link: %i (%i)\n", code, errno);
     }
+
+    // a periodic timer that the timer test can observe through the utils protocol
+    code = gracht_server_add_timer(server, TEST_TIMER_INTERVAL_MS, 1, test_timer_tick, NULL, NULL);
+    if (code) {
+        printf("register_server_links failed to add timer: %i (%i)\n", code, errno);
+    }
 }
 
-int init_server_with_socket_link(gracht_server_t** serverOut)
+void register_server_links(gracht_server_t* server)
+{
+    register_links(server, 0);
+}
+
+int init_server_with_socket_link_config(const gracht_server_configuration_t* configuration, int uring, gracht_server_t** serverOut)
 {
     struct gracht_server_configuration serverConfiguration;
     int                                code;
@@ -129,42 +149,23 @@ int init_server_with_socket_link(gracht_server_t** serverOut)
     gracht_link_socket_setup();
 #endif
 
-    gracht_server_configuration_init(&serverConfiguration);
-    gracht_server_configuration_set_stream_buffer_size(&serverConfiguration, 8192, 8);
-    
+    memcpy(&serverConfiguration, configuration, sizeof(struct gracht_server_configuration));
     code = gracht_server_create(&serverConfiguration, serverOut);
     if (code) {
         printf("init_server_with_socket_link: error initializing server library %i\n", errno);
         return code;
     }
 
-    // register links
-    register_server_links(*serverOut);
+    // register links, the stream link is served through io_uring where available if requested
+    register_links(*serverOut, uring);
     return 0;
 }
 
-int init_mt_server_with_socket_link(int workerCount, gracht_server_t** serverOut)
+int init_server_with_socket_link(gracht_server_t** serverOut)
 {
     struct gracht_server_configuration serverConfiguration;
-    int                                code;
-    
-#ifdef _WIN32
-    // initialize the WSA library
-    gracht_link_socket_setup();
-#endif
 
     gracht_server_configuration_init(&serverConfiguration);
     gracht_server_configuration_set_stream_buffer_size(&serverConfiguration, 8192, 8);
-
-    // setup the number of workers
-    gracht_server_configuration_set_num_workers(&serverConfiguration, workerCount);
-    code = gracht_server_create(&serverConfiguration, serverOut);
-    if (code) {
-        printf("init_server_with_socket_link: error initializing server library %i\n", errno);
-        return code;
-    }
-
-    // register links
-    register_server_links(*serverOut);
-    return 0;
+    return init_server_with_socket_link_config(&serverConfiguration, 0, serverOut);
 }
@@ -30,9 +30,11 @@
 #include <test_large_download_service_server.h>
 
 // reuse the private api
+#include <gatomic.h>
 #include <thread_api.h>
 
-static char* g_message = "hello from test server!";
+static char*      g_message = "hello from test server!";
+static atomic_int g_timerTicks = 0;
 
 #define TEST_SMALL_UPLOAD_RESOURCE_ID "small-upload-resource"
 #define TEST_SMALL_UPLOAD_SESSION_ID  "small-upload-session"
@@ -128,6 +130,11 @@ void test_utils_transfer_invocation(struct gracht_message* message, const struct
     thrd_t                      wait;
     struct gracht_message*      defer;
 
+    // never respond to these, so clients can test that their calls time out
+    if (transaction->test_id >= 2000) {
+        return;
+    }
+
     if (transaction->test_id < 1000) {
         status.test_id = transaction->test_id;
         status.code = 13;
@@ -188,12 +195,32 @@ void test_utils_get_event_invocation(struct gracht_message* message, const int c
     }
 }
 
+void test_utils_get_broadcast_invocation(struct gracht_message* message, const int count)
+{
+    for (int i = 0; i < count; i++) {
+        test_utils_event_myevent_all(message->server, i);
+    }
+}
+
 void test_utils_shutdown_invocation(struct gracht_message* message)
 {
     printf("shutdown requested\n");
     gracht_server_request_shutdown(message->server);
 }
 
+// invoked periodically by the server loop, see register_server_links
+void test_timer_tick(gracht_server_t* server, void* context)
+{
+    (void)server;
+    (void)context;
+    atomic_fetch_add(&g_timerTicks, 1);
+}
+
+void test_utils_get_timer_ticks_invocation(struct gracht_message* message)
+{
+    test_utils_get_timer_ticks_response(message, atomic_load(&g_timerTicks));
+}
+
 extern struct test_account g_testAccount_JohnDoe;
 extern struct test_payment g_testPayment_19;
 
@@ -30,20 +30,52 @@
 #include <test_small_upload_service_server.h>
 #include <test_large_download_service_server.h>
 
-extern int init_mt_server_with_socket_link(int workerCount, gracht_server_t** serverOut);
+// The multi-threaded server tests are all built from this file, each with its own set of the
+// options below. See tests/CMakeLists.txt for the configurations.
+#ifndef TEST_SERVER_WORKERS
+#define TEST_SERVER_WORKERS 4
+#endif
+#ifndef TEST_SERVER_REACTORS
+#define TEST_SERVER_REACTORS 1
+#endif
+#ifndef TEST_SERVER_QUEUE_DEPTH
+#define TEST_SERVER_QUEUE_DEPTH 0
+#endif
+#ifndef TEST_SERVER_COALESCE
+#define TEST_SERVER_COALESCE 0
+#endif
+#ifndef TEST_SERVER_ORDERED
+#define TEST_SERVER_ORDERED 0
+#endif
+#ifndef TEST_SERVER_URING
+#define TEST_SERVER_URING 0
+#endif
+
+extern int init_server_with_socket_link_config(const gracht_server_configuration_t* configuration, int uring, gracht_server_t** serverOut);
 
 int main(void)
 {
-    gracht_server_t* server;
-    int              code;
+    struct gracht_server_configuration serverConfiguration;
+    gracht_server_t*                   server;
+    int                                code;
+
+    gracht_server_configuration_init(&serverConfiguration);
+    gracht_server_configuration_set_stream_buffer_size(&serverConfiguration, 8192, 8);
+    gracht_server_configuration_set_num_workers(&serverConfiguration, TEST_SERVER_WORKERS);
+    gracht_server_configuration_set_num_reactors(&serverConfiguration, TEST_SERVER_REACTORS);
+    gracht_server_configuration_set_worker_queue_depth(&serverConfiguration, TEST_SERVER_QUEUE_DEPTH);
+    gracht_server_configuration_set_response_coalescing(&serverConfiguration, TEST_SERVER_COALESCE);
     
     // initialize server
-    code = init_mt_server_with_socket_link(4, &server);
+    code = init_server_with_socket_link_config(&serverConfiguration, TEST_SERVER_URING, &server);
     if (code) {
         return code;
     }
     
-    // register protocols
+    // register protocols, the utils protocol can be handled in order for each client
+    if (TEST_SERVER_ORDERED) {
+        test_utils_server_protocol.flags |= GRACHT_PROTOCOL_FLAG_ORDERED;
+    }
     gracht_server_register_protocol(server, &test_utils_server_protocol);
     gracht_server_register_protocol(server, &test_small_upload_server_protocol);
     gracht_server_register_protocol(server, &test_large_download_server_protocol);